@@ -123,21 +123,21 @@ const char *const forced_keyframes_const_names[] = {
     NULL
 };
 
-static void do_video_stats(OutputStream *ost, int frame_size);
+static int do_video_stats(OutputStream *ost, int frame_size);
 static int64_t getutime(void);
 static int64_t getmaxrss(void);
 static int ifilter_has_all_input_formats(FilterGraph *fg);
 
 static int run_as_daemon  = 0;
-static int nb_frames_dup = 0;
-static unsigned dup_warning = 1000;
-static int nb_frames_drop = 0;
+static atomic_int nb_frames_dup = ATOMIC_VAR_INIT(0);
+static atomic_int nb_frames_drop = ATOMIC_VAR_INIT(0);
 static int64_t decode_error_stat[2];
 
 static int want_sdp = 1;
 
 static int current_time;
 AVIOContext *progress_avio = NULL;
+AVIOContext *stats_json_avio = NULL;
 
 static uint8_t *subtitle_out;
 
@@ -163,6 +163,11 @@ static int restore_tty;
 
 #if HAVE_PTHREADS
 static void free_input_threads(void);
+static void free_encode_threads(int discard);
+static int send_close_to_encode_thread(OutputStream *ost);
+
+static pthread_mutex_t vstats_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int encode_thread_failed = ATOMIC_VAR_INIT(0);
 #endif
 
 /* sub2video hack:
@@ -467,6 +472,10 @@ static void ffmpeg_cleanup(int ret)
 {
     int i, j;
 
+#if HAVE_PTHREADS
+    free_encode_threads(1);
+#endif
+
     if (do_benchmark) {
         int maxrss = getmaxrss() / 1024;
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
@@ -524,6 +533,9 @@ static void ffmpeg_cleanup(int ret)
             avio_closep(&s->pb);
         avformat_free_context(s);
         av_dict_free(&of->opts);
+#if HAVE_PTHREADS
+        pthread_mutex_destroy(&of->mux_lock);
+#endif
 
         av_freep(&output_files[i]);
     }
@@ -665,15 +677,37 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     int i;
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost2 = output_streams[i];
-        ost2->finished |= ost == ost2 ? this_stream : others;
+        atomic_fetch_or(&ost2->finished, ost == ost2 ? this_stream : others);
     }
 }
 
-static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
+static void lock_output_file(OutputFile *of)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&of->mux_lock);
+#endif
+}
+
+static void unlock_output_file(OutputFile *of)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&of->mux_lock);
+#endif
+}
+
+/**
+ * Send a packet to the muxer, or buffer it if the header was not written yet.
+ * Called by the main thread and the encoder threads, the whole muxing state
+ * of the file is updated under its lock.
+ * The packet is unreferenced.
+ */
+static int write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
-    int ret;
+    int ret = 0;
+
+    lock_output_file(of);
 
     /*
      * Audio encoders may split the packets --  #frames in != #packets out.
@@ -684,10 +718,8 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
      * Do not count the packet when unqueued because it has been counted when queued.
      */
     if (!(st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && ost->encoding_needed) && !unqueue) {
-        if (ost->frame_number >= ost->max_frames) {
-            av_packet_unref(pkt);
-            return;
-        }
+        if (ost->frame_number >= ost->max_frames)
+            goto end;
         ost->frame_number++;
     }
 
@@ -701,18 +733,18 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                 av_log(NULL, AV_LOG_ERROR,
                        "Too many packets buffered for output stream %d:%d.\n",
                        ost->file_index, ost->st->index);
-                exit_program(1);
+                ret = AVERROR(ENOSPC);
+                goto end;
             }
             ret = av_fifo_realloc2(ost->muxing_queue, new_size);
             if (ret < 0)
-                exit_program(1);
+                goto end;
         }
         ret = av_packet_ref(&tmp_pkt, pkt);
         if (ret < 0)
-            exit_program(1);
+            goto end;
         av_fifo_generic_write(ost->muxing_queue, &tmp_pkt, sizeof(tmp_pkt), NULL);
-        av_packet_unref(pkt);
-        return;
+        goto end;
     }
 
     if ((st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
@@ -767,7 +799,8 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                        ost->file_index, ost->st->index, ost->last_mux_dts, pkt->dts);
                 if (exit_on_error) {
                     av_log(NULL, AV_LOG_FATAL, "aborting.\n");
-                    exit_program(1);
+                    ret = AVERROR(EINVAL);
+                    goto end;
                 }
                 av_log(s, loglevel, "changing to %"PRId64". This may result "
                        "in incorrect timestamps in the output file.\n",
@@ -800,22 +833,68 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
         close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+        ret = 0;
     }
+
+end:
+    unlock_output_file(of);
     av_packet_unref(pkt);
+    return ret;
 }
 
 static void close_output_stream(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
+    int finished = atomic_fetch_or(&ost->finished, ENCODER_FINISHED);
 
-    ost->finished |= ENCODER_FINISHED;
     if (of->shortest) {
-        int64_t end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
+        int64_t end;
+
+#if HAVE_PTHREADS
+        /* sync_opts belongs to the encoder thread, let it compute the end
+           once it has encoded the frames already queued */
+        if (ost->enc_thread_queue &&
+            !pthread_equal(ost->enc_thread, pthread_self())) {
+            if (!(finished & ENCODER_FINISHED))
+                send_close_to_encode_thread(ost);
+            return;
+        }
+#endif
+        end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
+        lock_output_file(of);
         of->recording_time = FFMIN(of->recording_time, end);
+        unlock_output_file(of);
     }
 }
 
-static void output_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost)
+static int64_t get_recording_time(OutputFile *of)
+{
+    int64_t recording_time;
+
+    lock_output_file(of);
+    recording_time = of->recording_time;
+    unlock_output_file(of);
+    return recording_time;
+}
+
+/**
+ * Account the time spent in the encoder since t0 and the frames and packets
+ * it consumed and produced. The counters are read by the progress reports
+ * while the encoder thread updates them.
+ */
+static void update_encode_stats(OutputFile *of, OutputStream *ost, int64_t t0,
+                                int frames, int packets)
+{
+    int64_t t = av_gettime_relative() - t0;
+
+    lock_output_file(of);
+    ost->encode_time     += t;
+    ost->frames_encoded  += frames;
+    ost->packets_encoded += packets;
+    unlock_output_file(of);
+}
+
+static int output_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost)
 {
     int ret = 0;
 
@@ -862,27 +941,29 @@ static void output_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost)
                 if (ret < 0)
                     goto finish;
                 idx++;
-            } else
-                write_packet(of, pkt, ost, 0);
+            } else if ((ret = write_packet(of, pkt, ost, 0)) < 0)
+                return ret;
         }
     } else
-        write_packet(of, pkt, ost, 0);
+        return write_packet(of, pkt, ost, 0);
 
 finish:
     if (ret < 0 && ret != AVERROR_EOF) {
         av_log(NULL, AV_LOG_ERROR, "Error applying bitstream filters to an output "
                "packet for stream #%d:%d.\n", ost->file_index, ost->index);
         if(exit_on_error)
-            exit_program(1);
+            return ret;
     }
+    return 0;
 }
 
 static int check_recording_time(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
+    int64_t recording_time = get_recording_time(of);
 
-    if (of->recording_time != INT64_MAX &&
-        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, of->recording_time,
+    if (recording_time != INT64_MAX &&
+        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, recording_time,
                       AV_TIME_BASE_Q) >= 0) {
         close_output_stream(ost);
         return 0;
@@ -890,11 +971,12 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
-static void do_audio_out(OutputFile *of, OutputStream *ost,
-                         AVFrame *frame)
+static int do_audio_out(OutputFile *of, OutputStream *ost,
+                        AVFrame *frame)
 {
     AVCodecContext *enc = ost->enc_ctx;
     AVPacket pkt;
+    int64_t t0;
     int ret;
 
     av_init_packet(&pkt);
@@ -902,13 +984,12 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
     pkt.size = 0;
 
     if (!check_recording_time(ost))
-        return;
+        return 0;
 
     if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
         frame->pts = ost->sync_opts;
     ost->sync_opts = frame->pts + frame->nb_samples;
     ost->samples_encoded += frame->nb_samples;
-    ost->frames_encoded++;
 
     av_assert0(pkt.size || !pkt.data);
     update_benchmark(NULL);
@@ -919,12 +1000,16 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
+    t0  = av_gettime_relative();
     ret = avcodec_send_frame(enc, frame);
+    update_encode_stats(of, ost, t0, 1, 0);
     if (ret < 0)
         goto error;
 
     while (1) {
+        t0  = av_gettime_relative();
         ret = avcodec_receive_packet(enc, &pkt);
+        update_encode_stats(of, ost, t0, 0, ret >= 0);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
@@ -941,13 +1026,14 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
         }
 
-        output_packet(of, &pkt, ost);
+        if ((ret = output_packet(of, &pkt, ost)) < 0)
+            return ret;
     }
 
-    return;
+    return 0;
 error:
     av_log(NULL, AV_LOG_FATAL, "Audio encoding failed\n");
-    exit_program(1);
+    return ret;
 }
 
 static void do_subtitle_out(OutputFile *of,
@@ -1029,31 +1115,31 @@ static void do_subtitle_out(OutputFile *of,
                 pkt.pts += av_rescale_q(sub->end_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
         }
         pkt.dts = pkt.pts;
-        output_packet(of, &pkt, ost);
+        if (output_packet(of, &pkt, ost) < 0)
+            exit_program(1);
     }
 }
 
-static void do_video_out(OutputFile *of,
-                         OutputStream *ost,
-                         AVFrame *next_picture,
-                         double sync_ipts)
+static int do_video_out(OutputFile *of,
+                        OutputStream *ost,
+                        AVFrame *next_picture,
+                        double sync_ipts,
+                        AVRational frame_rate)
 {
     int ret, format_video_sync;
     AVPacket pkt;
     AVCodecContext *enc = ost->enc_ctx;
     AVCodecParameters *mux_par = ost->st->codecpar;
-    AVRational frame_rate;
     int nb_frames, nb0_frames, i;
     double delta, delta0;
+    int64_t t0;
     double duration = 0;
     int frame_size = 0;
     InputStream *ist = NULL;
-    AVFilterContext *filter = ost->filter->filter;
 
     if (ost->source_index >= 0)
         ist = input_streams[ost->source_index];
 
-    frame_rate = av_buffersink_get_frame_rate(filter);
     if (frame_rate.num > 0 && frame_rate.den > 0)
         duration = 1/(av_q2d(frame_rate) * av_q2d(enc->time_base));
 
@@ -1156,23 +1242,27 @@ static void do_video_out(OutputFile *of,
     ost->last_nb0_frames[0] = nb0_frames;
 
     if (nb0_frames == 0 && ost->last_dropped) {
-        nb_frames_drop++;
+        atomic_fetch_add(&nb_frames_drop, 1);
         av_log(NULL, AV_LOG_VERBOSE,
                "*** dropping frame %d from stream %d at ts %"PRId64"\n",
                ost->frame_number, ost->st->index, ost->last_frame->pts);
     }
     if (nb_frames > (nb0_frames && ost->last_dropped) + (nb_frames > nb0_frames)) {
+        int nb_dups = nb_frames - (nb0_frames && ost->last_dropped) - (nb_frames > nb0_frames);
+        int64_t prev_dups, dup_warning = 1000;
+
         if (nb_frames > dts_error_threshold * 30) {
             av_log(NULL, AV_LOG_ERROR, "%d frame duplication too large, skipping\n", nb_frames - 1);
-            nb_frames_drop++;
-            return;
+            atomic_fetch_add(&nb_frames_drop, 1);
+            return 0;
         }
-        nb_frames_dup += nb_frames - (nb0_frames && ost->last_dropped) - (nb_frames > nb0_frames);
+        prev_dups = atomic_fetch_add(&nb_frames_dup, nb_dups);
         av_log(NULL, AV_LOG_VERBOSE, "*** %d dup!\n", nb_frames - 1);
-        if (nb_frames_dup > dup_warning) {
-            av_log(NULL, AV_LOG_WARNING, "More than %d frames duplicated\n", dup_warning);
+        /* warn once per power of ten, from the thread which crosses it */
+        while (dup_warning < prev_dups)
             dup_warning *= 10;
-        }
+        if (prev_dups + nb_dups > dup_warning)
+            av_log(NULL, AV_LOG_WARNING, "More than %"PRId64" frames duplicated\n", dup_warning);
     }
     ost->last_dropped = nb_frames == nb0_frames && next_picture;
 
@@ -1189,7 +1279,7 @@ static void do_video_out(OutputFile *of,
         in_picture = next_picture;
 
     if (!in_picture)
-        return;
+        return 0;
 
     in_picture->pts = ost->sync_opts;
 
@@ -1198,7 +1288,7 @@ static void do_video_out(OutputFile *of,
 #else
     if (ost->frame_number >= ost->max_frames)
 #endif
-        return;
+        return 0;
 
 #if FF_API_LAVF_FMT_RAWPICTURE
     if (of->ctx->oformat->flags & AVFMT_RAWPICTURE &&
@@ -1215,7 +1305,8 @@ static void do_video_out(OutputFile *of,
         pkt.pts    = av_rescale_q(in_picture->pts, enc->time_base, ost->mux_timebase);
         pkt.flags |= AV_PKT_FLAG_KEY;
 
-        output_packet(of, &pkt, ost);
+        if ((ret = output_packet(of, &pkt, ost)) < 0)
+            return ret;
     } else
 #endif
     {
@@ -1284,14 +1375,16 @@ static void do_video_out(OutputFile *of,
                    enc->time_base.num, enc->time_base.den);
         }
 
-        ost->frames_encoded++;
-
+        t0  = av_gettime_relative();
         ret = avcodec_send_frame(enc, in_picture);
+        update_encode_stats(of, ost, t0, 1, 0);
         if (ret < 0)
             goto error;
 
         while (1) {
+            t0  = av_gettime_relative();
             ret = avcodec_receive_packet(enc, &pkt);
+            update_encode_stats(of, ost, t0, 0, ret >= 0);
             update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
             if (ret == AVERROR(EAGAIN))
                 break;
@@ -1318,7 +1411,8 @@ static void do_video_out(OutputFile *of,
             }
 
             frame_size = pkt.size;
-            output_packet(of, &pkt, ost);
+            if ((ret = output_packet(of, &pkt, ost)) < 0)
+                return ret;
 
             /* if two pass, output log */
             if (ost->logfile && enc->stats_out) {
@@ -1332,10 +1426,13 @@ static void do_video_out(OutputFile *of,
      * But there may be reordering, so we can't throw away frames on encoder
      * flush, we need to limit them here, before they go into encoder.
      */
+    lock_output_file(of);
     ost->frame_number++;
+    unlock_output_file(of);
 
-    if (vstats_filename && frame_size)
-        do_video_stats(ost, frame_size);
+    if (vstats_filename && frame_size &&
+        (ret = do_video_stats(ost, frame_size)) < 0)
+        return ret;
   }
 
     if (!ost->last_frame)
@@ -1346,10 +1443,10 @@ static void do_video_out(OutputFile *of,
     else
         av_frame_free(&ost->last_frame);
 
-    return;
+    return 0;
 error:
     av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
-    exit_program(1);
+    return ret;
 }
 
 static double psnr(double d)
@@ -1357,23 +1454,32 @@ static double psnr(double d)
     return -10.0 * log10(d);
 }
 
-static void do_video_stats(OutputStream *ost, int frame_size)
+static int do_video_stats(OutputStream *ost, int frame_size)
 {
     AVCodecContext *enc;
     int frame_number;
     double ti1, bitrate, avg_bitrate;
 
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&vstats_lock);
+#endif
     /* this is executed just the first time do_video_stats is called */
     if (!vstats_file) {
         vstats_file = fopen(vstats_filename, "w");
         if (!vstats_file) {
+            int ret = AVERROR(errno);
             perror("fopen");
-            exit_program(1);
+#if HAVE_PTHREADS
+            pthread_mutex_unlock(&vstats_lock);
+#endif
+            return ret;
         }
     }
 
     enc = ost->enc_ctx;
     if (enc->codec_type == AVMEDIA_TYPE_VIDEO) {
+        /* the muxer may update the stream from another encoder thread */
+        lock_output_file(output_files[ost->file_index]);
         frame_number = ost->st->nb_frames;
         if (vstats_version <= 1) {
             fprintf(vstats_file, "frame= %5d q= %2.1f ", frame_number,
@@ -1397,7 +1503,12 @@ static void do_video_stats(OutputStream *ost, int frame_size)
         fprintf(vstats_file, "s_size= %8.0fkB time= %0.3f br= %7.1fkbits/s avg_br= %7.1fkbits/s ",
                (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
         fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(ost->pict_type));
+        unlock_output_file(output_files[ost->file_index]);
     }
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&vstats_lock);
+#endif
+    return 0;
 }
 
 static int init_output_stream(OutputStream *ost, char *error, int error_len);
@@ -1407,12 +1518,183 @@ static void finish_output_stream(OutputStream *ost)
     OutputFile *of = output_files[ost->file_index];
     int i;
 
-    ost->finished = ENCODER_FINISHED | MUXER_FINISHED;
+    atomic_store(&ost->finished, ENCODER_FINISHED | MUXER_FINISHED);
 
     if (of->shortest) {
         for (i = 0; i < of->ctx->nb_streams; i++)
-            output_streams[of->ost_index + i]->finished = ENCODER_FINISHED | MUXER_FINISHED;
+            atomic_store(&output_streams[of->ost_index + i]->finished,
+                         ENCODER_FINISHED | MUXER_FINISHED);
+    }
+}
+
+/**
+ * Encode one filtered frame, or flush the video frame rate conversion if
+ * frame is NULL.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+static int do_frame_out(OutputFile *of, OutputStream *ost, AVFrame *frame,
+                        double float_pts, AVRational frame_rate)
+{
+    AVCodecContext *enc = ost->enc_ctx;
+
+    switch (enc->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (!frame)
+            return do_video_out(of, ost, NULL, AV_NOPTS_VALUE, frame_rate);
+        if (!ost->frame_aspect_ratio.num)
+            enc->sample_aspect_ratio = frame->sample_aspect_ratio;
+
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s exact:%f time_base:%d/%d\n",
+                    av_ts2str(frame->pts), av_ts2timestr(frame->pts, &enc->time_base),
+                    float_pts,
+                    enc->time_base.num, enc->time_base.den);
+        }
+
+        return do_video_out(of, ost, frame, float_pts, frame_rate);
+    case AVMEDIA_TYPE_AUDIO:
+        if (!frame)
+            break;
+        if (!(enc->codec->capabilities & AV_CODEC_CAP_PARAM_CHANGE) &&
+            enc->channels != frame->channels) {
+            av_log(NULL, AV_LOG_ERROR,
+                   "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
+            break;
+        }
+        return do_audio_out(of, ost, frame);
+    default:
+        // TODO support subtitle filters
+        av_assert0(0);
+    }
+    return 0;
+}
+
+#if HAVE_PTHREADS
+typedef struct EncodeThreadMessage {
+    AVFrame *frame;
+    double float_pts;
+    AVRational frame_rate;
+    int close;          ///< close the stream instead of encoding a frame
+} EncodeThreadMessage;
+
+static void *encode_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    OutputFile *of = output_files[ost->file_index];
+    EncodeThreadMessage msg;
+    int ret;
+
+    while (av_thread_message_queue_recv(ost->enc_thread_queue, &msg, 0) >= 0) {
+        if (msg.close) {
+            close_output_stream(ost);
+            continue;
+        }
+        ret = do_frame_out(of, ost, msg.frame, msg.float_pts, msg.frame_rate);
+        av_frame_free(&msg.frame);
+        if (ret < 0) {
+            /* the main thread notices it on its next send and exits */
+            atomic_store(&encode_thread_failed, 1);
+            av_thread_message_queue_set_err_send(ost->enc_thread_queue, ret);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void free_encode_message(void *msg)
+{
+    av_frame_free(&((EncodeThreadMessage *)msg)->frame);
+}
+
+static int init_encode_thread(OutputStream *ost)
+{
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&ost->enc_thread_queue,
+                                        ost->enc_thread_queue_size,
+                                        sizeof(EncodeThreadMessage));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(ost->enc_thread_queue,
+                                          free_encode_message);
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encode_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+static int send_close_to_encode_thread(OutputStream *ost)
+{
+    EncodeThreadMessage msg = { NULL, 0, { 0, 1 }, 1 };
+
+    return av_thread_message_queue_send(ost->enc_thread_queue, &msg, 0);
+}
+
+/**
+ * Wait for the encoder threads to finish and join them.
+ *
+ * @param discard drop the frames still queued instead of encoding them
+ */
+static void free_encode_threads(int discard)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost || !ost->enc_thread_queue)
+            continue;
+        if (discard)
+            av_thread_message_flush(ost->enc_thread_queue);
+        av_thread_message_queue_set_err_recv(ost->enc_thread_queue, AVERROR_EOF);
+        pthread_join(ost->enc_thread, NULL);
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+    }
+}
+#endif
+
+/**
+ * Send a filtered frame to the encoder of the stream, possibly on its own
+ * thread. The frame is unreferenced.
+ */
+static void encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame,
+                         double float_pts, AVRational frame_rate)
+{
+#if HAVE_PTHREADS
+    /* The encoder thread is only started once the muxer is initialized,
+       so that the muxing queue and time base are only ever handled by the
+       main thread. */
+    if (ost->enc_thread_queue_size > 0 && of->header_written) {
+        EncodeThreadMessage msg = { NULL, float_pts, frame_rate, 0 };
+        int ret;
+
+        if (!ost->enc_thread_queue && (ret = init_encode_thread(ost)) < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Error starting the encoder thread for output stream %d:%d\n",
+                   ost->file_index, ost->index);
+            exit_program(1);
+        }
+        if (frame) {
+            if (!(msg.frame = av_frame_alloc()))
+                exit_program(1);
+            av_frame_move_ref(msg.frame, frame);
+        }
+        ret = av_thread_message_queue_send(ost->enc_thread_queue, &msg, 0);
+        if (ret < 0) {
+            av_frame_free(&msg.frame);
+            exit_program(1);
+        }
+        return;
     }
+#endif
+    if (do_frame_out(of, ost, frame, float_pts, frame_rate) < 0)
+        exit_program(1);
+    if (frame)
+        av_frame_unref(frame);
 }
 
 /**
@@ -1455,19 +1737,22 @@ static int reap_filters(int flush)
 
         while (1) {
             double float_pts = AV_NOPTS_VALUE; // this is identical to filtered_frame.pts but with higher precision
+            int64_t t0 = av_gettime_relative();
             ret = av_buffersink_get_frame_flags(filter, filtered_frame,
                                                AV_BUFFERSINK_FLAG_NO_REQUEST);
+            ost->filter->graph->filter_time += av_gettime_relative() - t0;
             if (ret < 0) {
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
                     av_log(NULL, AV_LOG_WARNING,
                            "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
                 } else if (flush && ret == AVERROR_EOF) {
                     if (av_buffersink_get_type(filter) == AVMEDIA_TYPE_VIDEO)
-                        do_video_out(of, ost, NULL, AV_NOPTS_VALUE);
+                        encode_frame(of, ost, NULL, AV_NOPTS_VALUE,
+                                     av_buffersink_get_frame_rate(filter));
                 }
                 break;
             }
-            if (ost->finished) {
+            if (atomic_load(&ost->finished)) {
                 av_frame_unref(filtered_frame);
                 continue;
             }
@@ -1492,35 +1777,8 @@ static int reap_filters(int flush)
             //if (ost->source_index >= 0)
             //    *filtered_frame= *input_streams[ost->source_index]->decoded_frame; //for me_threshold
 
-            switch (av_buffersink_get_type(filter)) {
-            case AVMEDIA_TYPE_VIDEO:
-                if (!ost->frame_aspect_ratio.num)
-                    enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
-
-                if (debug_ts) {
-                    av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s exact:%f time_base:%d/%d\n",
-                            av_ts2str(filtered_frame->pts), av_ts2timestr(filtered_frame->pts, &enc->time_base),
-                            float_pts,
-                            enc->time_base.num, enc->time_base.den);
-                }
-
-                do_video_out(of, ost, filtered_frame, float_pts);
-                break;
-            case AVMEDIA_TYPE_AUDIO:
-                if (!(enc->codec->capabilities & AV_CODEC_CAP_PARAM_CHANGE) &&
-                    enc->channels != filtered_frame->channels) {
-                    av_log(NULL, AV_LOG_ERROR,
-                           "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
-                    break;
-                }
-                do_audio_out(of, ost, filtered_frame);
-                break;
-            default:
-                // TODO support subtitle filters
-                av_assert0(0);
-            }
-
-            av_frame_unref(filtered_frame);
+            encode_frame(of, ost, filtered_frame, float_pts,
+                         av_buffersink_get_frame_rate(filter));
         }
     }
 
@@ -1644,6 +1902,132 @@ static void print_final_stats(int64_t total_size)
     }
 }
 
+static void json_print_str(AVBPrint *bp, const char *str)
+{
+    av_bprint_chars(bp, '"', 1);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            av_bprintf(bp, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            av_bprintf(bp, "\\u%04x", *str);
+        else
+            av_bprint_chars(bp, *str, 1);
+    }
+    av_bprint_chars(bp, '"', 1);
+}
+
+/**
+ * Write one line of JSON with the state of every stage of the transcoding:
+ * demuxing, filtering, encoding and muxing.
+ */
+static void print_stats_json(int is_last_report, int64_t cur_time, float t,
+                             int64_t pts, int64_t total_size, double speed)
+{
+    static int64_t last_time = -1;
+    double dt = last_time >= 0 ? (cur_time - last_time) / 1000000.0 : t;
+    AVBPrint bp;
+    int i, j;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "{\"progress\":\"%s\",\"time\":%.3f,\"out_time_us\":%"PRId64,
+               is_last_report ? "end" : "continue", t, pts);
+    if (total_size >= 0)
+        av_bprintf(&bp, ",\"total_size\":%"PRId64, total_size);
+    else
+        av_bprintf(&bp, ",\"total_size\":null");
+    av_bprintf(&bp, ",\"speed\":%.3f", speed);
+    av_bprintf(&bp, ",\"dup_frames\":%d,\"drop_frames\":%d",
+               atomic_load(&nb_frames_dup), atomic_load(&nb_frames_drop));
+
+    av_bprintf(&bp, ",\"inputs\":[");
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        uint64_t nb_packets = 0, data_size = 0;
+
+        for (j = 0; j < f->nb_streams; j++) {
+            InputStream *ist = input_streams[f->ist_index + j];
+            nb_packets += ist->nb_packets;
+            data_size  += ist->data_size;
+        }
+        av_bprintf(&bp, "%s{\"file\":%d,\"packets\":%"PRIu64",\"bytes\":%"PRIu64,
+                   i ? "," : "", i, nb_packets, data_size);
+        av_bprintf(&bp, ",\"packet_rate\":%.1f,\"bitrate\":%.0f",
+                   dt > 0 ? (nb_packets - f->last_nb_packets) / dt : 0,
+                   dt > 0 ? (data_size - f->last_data_size) * 8 / dt : 0);
+#if HAVE_PTHREADS
+        if (f->in_thread_queue)
+            av_bprintf(&bp, ",\"thread_queue\":%d,\"thread_queue_size\":%d",
+                       av_thread_message_queue_nb_elems(f->in_thread_queue),
+                       f->thread_queue_size);
+#endif
+        av_bprintf(&bp, "}");
+        f->last_nb_packets = nb_packets;
+        f->last_data_size  = data_size;
+    }
+
+    av_bprintf(&bp, "],\"filtergraphs\":[");
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        av_bprintf(&bp, "%s{\"index\":%d,\"time_us\":%"PRId64",\"filters\":[",
+                   i ? "," : "", i, fg->filter_time);
+        for (j = 0; fg->graph && j < fg->graph->nb_filters; j++) {
+            AVFilterContext *filter = fg->graph->filters[j];
+            AVFilterStats stats;
+
+            if (avfilter_get_stats(filter, &stats) < 0)
+                continue;
+            av_bprintf(&bp, "%s{\"name\":", j ? "," : "");
+            json_print_str(&bp, filter->name);
+            av_bprintf(&bp, ",\"filter\":\"%s\",\"frames_in\":%"PRId64",\"frames_out\":%"PRId64,
+                       filter->filter->name, stats.frames_in, stats.frames_out);
+            av_bprintf(&bp, ",\"wall_time_us\":%"PRId64",\"cpu_time_us\":%"PRId64,
+                       stats.wall_time, stats.cpu_time);
+            av_bprintf(&bp, ",\"max_queued\":%"PRId64",\"pool_bytes\":%"PRId64"}",
+                       stats.max_queued, stats.pool_bytes);
+        }
+        av_bprintf(&bp, "]}");
+    }
+
+    av_bprintf(&bp, "],\"outputs\":[");
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        /* the counters are updated by the encoder threads under this lock */
+        lock_output_file(output_files[ost->file_index]);
+        av_bprintf(&bp, "%s{\"file\":%d,\"stream\":%d", i ? "," : "",
+                   ost->file_index, ost->index);
+        if (!ost->stream_copy) {
+            av_bprintf(&bp, ",\"frames_encoded\":%"PRIu64",\"packets_encoded\":%"PRIu64,
+                       ost->frames_encoded, ost->packets_encoded);
+            av_bprintf(&bp, ",\"encode_time_us\":%"PRId64, ost->encode_time);
+        }
+#if HAVE_PTHREADS
+        if (ost->enc_thread_queue)
+            av_bprintf(&bp, ",\"encoder_queue\":%d,\"encoder_queue_size\":%d",
+                       av_thread_message_queue_nb_elems(ost->enc_thread_queue),
+                       ost->enc_thread_queue_size);
+#endif
+        av_bprintf(&bp, ",\"packets_written\":%"PRIu64",\"bytes_written\":%"PRIu64,
+                   ost->packets_written, ost->data_size);
+        av_bprintf(&bp, ",\"muxing_queue\":%d}",
+                   ost->muxing_queue ? (int)(av_fifo_size(ost->muxing_queue) / sizeof(AVPacket)) : 0);
+        unlock_output_file(output_files[ost->file_index]);
+    }
+    av_bprintf(&bp, "]}\n");
+    last_time = cur_time;
+
+    avio_write(stats_json_avio, bp.str, FFMIN(bp.len, bp.size - 1));
+    avio_flush(stats_json_avio);
+    av_bprint_finalize(&bp, NULL);
+    if (is_last_report) {
+        int ret;
+        if ((ret = avio_closep(&stats_json_avio)) < 0)
+            av_log(NULL, AV_LOG_ERROR,
+                   "Error closing stats log, loss of information possible: %s\n", av_err2str(ret));
+    }
+}
+
 static void print_report(int is_last_report, int64_t timer_start, int64_t cur_time)
 {
     char buf[1024];
@@ -1662,7 +2046,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     int ret;
     float t;
 
-    if (!print_stats && !is_last_report && !progress_avio)
+    if (!print_stats && !is_last_report && !progress_avio && !stats_json_avio)
         return;
 
     if (!is_last_report) {
@@ -1670,7 +2054,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             last_time = cur_time;
             return;
         }
-        if ((cur_time - last_time) < 500000)
+        if ((cur_time - last_time) < stats_period)
             return;
         last_time = cur_time;
     }
@@ -1680,9 +2064,11 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
+    lock_output_file(output_files[0]);
     total_size = avio_size(oc->pb);
     if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
         total_size = avio_tell(oc->pb);
+    unlock_output_file(output_files[0]);
 
     buf[0] = '\0';
     vid = 0;
@@ -1691,6 +2077,8 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         float q = -1;
         ost = output_streams[i];
         enc = ost->enc_ctx;
+        /* the encoder threads may update the stream statistics meanwhile */
+        lock_output_file(output_files[ost->file_index]);
         if (!ost->stream_copy)
             q = ost->quality / (float) FF_QP2LAMBDA;
 
@@ -1757,7 +2145,8 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
                                           ost->st->time_base, AV_TIME_BASE_Q));
         if (is_last_report)
-            nb_frames_drop += ost->last_dropped;
+            atomic_fetch_add(&nb_frames_drop, ost->last_dropped);
+        unlock_output_file(output_files[ost->file_index]);
     }
 
     secs = FFABS(pts) / AV_TIME_BASE;
@@ -1794,11 +2183,11 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     av_bprintf(&buf_script, "out_time=%02d:%02d:%02d.%06d\n",
                hours, mins, secs, us);
 
-    if (nb_frames_dup || nb_frames_drop)
+    if (atomic_load(&nb_frames_dup) || atomic_load(&nb_frames_drop))
         snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " dup=%d drop=%d",
-                nb_frames_dup, nb_frames_drop);
-    av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
-    av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+                atomic_load(&nb_frames_dup), atomic_load(&nb_frames_drop));
+    av_bprintf(&buf_script, "dup_frames=%d\n", atomic_load(&nb_frames_dup));
+    av_bprintf(&buf_script, "drop_frames=%d\n", atomic_load(&nb_frames_drop));
 
     if (speed < 0) {
         snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf)," speed=N/A");
@@ -1832,6 +2221,9 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         }
     }
 
+    if (stats_json_avio)
+        print_stats_json(is_last_report, cur_time, t, pts, total_size, speed);
+
     if (is_last_report)
         print_final_stats(total_size);
 }
@@ -1951,16 +2343,18 @@ static void flush_encoders(void)
                 if (ret == AVERROR_EOF) {
                     break;
                 }
-                if (ost->finished & MUXER_FINISHED) {
+                ost->packets_encoded++;
+                if (atomic_load(&ost->finished) & MUXER_FINISHED) {
                     av_packet_unref(&pkt);
                     continue;
                 }
                 av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
                 pkt_size = pkt.size;
-                output_packet(of, &pkt, ost);
-                if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
-                    do_video_stats(ost, pkt_size);
-                }
+                if (output_packet(of, &pkt, ost) < 0)
+                    exit_program(1);
+                if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename &&
+                    do_video_stats(ost, pkt_size) < 0)
+                    exit_program(1);
         }
     }
 }
@@ -1976,7 +2370,7 @@ static int check_output_constraints(InputStream *ist, OutputStream *ost)
     if (ost->source_index != ist_index)
         return 0;
 
-    if (ost->finished)
+    if (atomic_load(&ost->finished))
         return 0;
 
     if (of->start_time != AV_NOPTS_VALUE && ist->pts < of->start_time)
@@ -1991,6 +2385,7 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
     InputFile   *f = input_files [ist->file_index];
     int64_t start_time = (of->start_time == AV_NOPTS_VALUE) ? 0 : of->start_time;
     int64_t ost_tb_start_time = av_rescale_q(start_time, AV_TIME_BASE_Q, ost->mux_timebase);
+    int64_t recording_time;
     AVPicture pict;
     AVPacket opkt;
 
@@ -2010,8 +2405,9 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
             return;
     }
 
-    if (of->recording_time != INT64_MAX &&
-        ist->pts >= of->recording_time + start_time) {
+    recording_time = get_recording_time(of);
+    if (recording_time != INT64_MAX &&
+        ist->pts >= recording_time + start_time) {
         close_output_stream(ost);
         return;
     }
@@ -2096,7 +2492,8 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
     }
 #endif
 
-    output_packet(of, &opkt, ost);
+    if (output_packet(of, &opkt, ost) < 0)
+        exit_program(1);
 }
 
 int guess_input_channel_layout(InputStream *ist)
@@ -2151,6 +2548,7 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
 {
     FilterGraph *fg = ifilter->graph;
     int need_reinit, ret, i;
+    int64_t t0;
 
     /* determine if the parameters for this input changed */
     need_reinit = ifilter->format != frame->format;
@@ -2213,7 +2611,9 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
         }
     }
 
+    t0  = av_gettime_relative();
     ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
+    fg->filter_time += av_gettime_relative() - t0;
     if (ret < 0) {
         if (ret != AVERROR_EOF)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2956,7 +3356,9 @@ static int check_init_output_file(OutputFile *of, int file_index)
         return ret;
     }
     //assert_avoptions(of->opts);
+    lock_output_file(of);
     of->header_written = 1;
+    unlock_output_file(of);
 
     av_dump_format(of->ctx, file_index, of->ctx->filename, 1);
 
@@ -2974,7 +3376,8 @@ static int check_init_output_file(OutputFile *of, int file_index)
         while (av_fifo_size(ost->muxing_queue)) {
             AVPacket pkt;
             av_fifo_generic_read(ost->muxing_queue, &pkt, sizeof(pkt), NULL);
-            write_packet(of, &pkt, ost, 1);
+            if ((ret = write_packet(of, &pkt, ost, 1)) < 0)
+                return ret;
         }
     }
 
@@ -3767,11 +4170,20 @@ static int need_output(void)
         OutputStream *ost    = output_streams[i];
         OutputFile *of       = output_files[ost->file_index];
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
-
-        if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+        int64_t size = 0;
+        int frame_number;
+
+        /* both are updated by the encoder threads */
+        lock_output_file(of);
+        if (os->pb)
+            size = avio_tell(os->pb);
+        frame_number = ost->frame_number;
+        unlock_output_file(of);
+
+        if (atomic_load(&ost->finished) ||
+            (os->pb && size >= of->limit_filesize))
             continue;
-        if (ost->frame_number >= ost->max_frames) {
+        if (frame_number >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
                 close_output_stream(output_streams[of->ost_index + j]);
@@ -3797,16 +4209,22 @@ static OutputStream *choose_output(void)
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
-        int64_t opts = ost->st->cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
-                       av_rescale_q(ost->st->cur_dts, ost->st->time_base,
-                                    AV_TIME_BASE_Q);
-        if (ost->st->cur_dts == AV_NOPTS_VALUE)
+        int64_t cur_dts, opts;
+
+        /* cur_dts is updated by the muxer, possibly from an encoder thread */
+        lock_output_file(output_files[ost->file_index]);
+        cur_dts = ost->st->cur_dts;
+        unlock_output_file(output_files[ost->file_index]);
+
+        opts = cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
+               av_rescale_q(cur_dts, ost->st->time_base, AV_TIME_BASE_Q);
+        if (cur_dts == AV_NOPTS_VALUE)
             av_log(NULL, AV_LOG_DEBUG, "cur_dts is invalid (this is harmless if it occurs once at the start per stream)\n");
 
         if (!ost->initialized && !ost->inputs_done)
             return ost;
 
-        if (!ost->finished && opts < opts_min) {
+        if (!atomic_load(&ost->finished) && opts < opts_min) {
             opts_min = opts;
             ost_min  = ost->unavailable ? NULL : ost;
         }
@@ -4415,13 +4833,16 @@ discard_packet:
  */
 static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
 {
+    int64_t t0;
     int i, ret;
     int nb_requests, nb_requests_max = 0;
     InputFilter *ifilter;
     InputStream *ist;
 
     *best_ist = NULL;
+    t0  = av_gettime_relative();
     ret = avfilter_graph_request_oldest(graph->graph);
+    graph->filter_time += av_gettime_relative() - t0;
     if (ret >= 0)
         return reap_filters(0);
 
@@ -4586,6 +5007,11 @@ static int transcode(void)
             process_input_packet(ist, NULL, 0);
         }
     }
+#if HAVE_PTHREADS
+    free_encode_threads(0);
+    if (atomic_load(&encode_thread_failed))
+        exit_program(1);
+#endif
     flush_encoders();
 
     term_exit();
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
+#include <stdatomic.h>
 
 #if HAVE_PTHREADS
 #include <pthread.h>
@@ -214,6 +215,8 @@ typedef struct OptionsContext {
     int        nb_passlogfiles;
     SpecifierOpt *max_muxing_queue_size;
     int        nb_max_muxing_queue_size;
+    SpecifierOpt *enc_thread_queue_size;
+    int        nb_enc_thread_queue_size;
     SpecifierOpt *guess_layout_max;
     int        nb_guess_layout_max;
     SpecifierOpt *apad;
@@ -281,6 +284,8 @@ typedef struct FilterGraph {
 
     AVFilterGraph *graph;
     int reconfiguration;
+    /* wall time spent running the graph, in microseconds */
+    int64_t filter_time;
 
     InputFilter   **inputs;
     int          nb_inputs;
@@ -408,6 +413,10 @@ typedef struct InputFile {
     int rate_emu;
     int accurate_seek;
 
+    /* packets and bytes read at the previous stats report */
+    uint64_t last_nb_packets;
+    uint64_t last_data_size;
+
 #if HAVE_PTHREADS
     AVThreadMessageQueue *in_thread_queue;
     pthread_t thread;           /* thread reading from this file */
@@ -504,7 +513,7 @@ typedef struct OutputStream {
     AVDictionary *swr_opts;
     AVDictionary *resample_opts;
     char *apad;
-    OSTFinished finished;        /* no more packets should be written for this stream */
+    atomic_int finished;         /* OSTFinished flags, no more packets should be written for this stream */
     int unavailable;                     /* true if the steram is unavailable (possibly temporarily) */
     int stream_copy;
 
@@ -533,6 +542,10 @@ typedef struct OutputStream {
     // number of frames/samples sent to the encoder
     uint64_t frames_encoded;
     uint64_t samples_encoded;
+    // number of packets received from the encoder
+    uint64_t packets_encoded;
+    // wall time spent in the encoder, in microseconds
+    int64_t encode_time;
 
     /* packet quality factor */
     int quality;
@@ -547,6 +560,13 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+    int enc_thread_queue_size;  /* maximum number of frames queued for the encoder thread,
+                                   0 to encode on the main thread */
+#if HAVE_PTHREADS
+    AVThreadMessageQueue *enc_thread_queue;
+    pthread_t enc_thread;       /* thread encoding this stream */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -560,6 +580,11 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+#if HAVE_PTHREADS
+    pthread_mutex_t mux_lock;   /* protects the muxer, recording_time and the output stream
+                                   statistics shared with the encoder threads */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -602,11 +627,14 @@ extern int qp_hist;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
 extern AVIOContext *progress_avio;
+extern AVIOContext *stats_json_avio;
+extern int64_t stats_period;
 extern float max_error_rate;
 extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern int filter_frame_threads;
 extern int vstats_version;
 
 extern const AVIOInterruptCB int_cb;
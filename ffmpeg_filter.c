@@ -442,6 +442,41 @@ static int insert_filter(AVFilterContext **last_filter, int *pad_idx,
     return 0;
 }
 
+static const struct {
+    enum AVPixelFormat pix_fmt;
+    const char *scaler;
+} hw_scalers[] = {
+    { AV_PIX_FMT_VAAPI, "scale_vaapi" },
+    { AV_PIX_FMT_CUDA,  "scale_npp"   },
+    { AV_PIX_FMT_QSV,   "scale_qsv"   },
+};
+
+/**
+ * Return the scaler working on the device the frames fed to the graph live
+ * on, or NULL if they are software frames or there is no such scaler.
+ */
+static const AVFilter *get_hw_scaler(FilterGraph *fg)
+{
+    enum AVPixelFormat pix_fmt = AV_PIX_FMT_NONE;
+    int i;
+
+    for (i = 0; i < fg->nb_inputs; i++) {
+        InputFilter *ifilter = fg->inputs[i];
+
+        if (ifilter->type != AVMEDIA_TYPE_VIDEO)
+            continue;
+        if (!ifilter->hw_frames_ctx ||
+            (pix_fmt != AV_PIX_FMT_NONE && ifilter->format != pix_fmt))
+            return NULL;
+        pix_fmt = ifilter->format;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(hw_scalers); i++)
+        if (hw_scalers[i].pix_fmt == pix_fmt)
+            return avfilter_get_by_name(hw_scalers[i].scaler);
+    return NULL;
+}
+
 static int configure_output_video_filter(FilterGraph *fg, OutputFilter *ofilter, AVFilterInOut *out)
 {
     char *pix_fmts;
@@ -464,18 +499,28 @@ static int configure_output_video_filter(FilterGraph *fg, OutputFilter *ofilter,
         char args[255];
         AVFilterContext *filter;
         AVDictionaryEntry *e = NULL;
+        const AVFilter *scaler = get_hw_scaler(fg);
 
-        snprintf(args, sizeof(args), "%d:%d",
-                 ofilter->width, ofilter->height);
+        snprintf(name, sizeof(name), "scaler_out_%d_%d",
+                 ost->file_index, ost->index);
 
-        while ((e = av_dict_get(ost->sws_dict, "", e,
-                                AV_DICT_IGNORE_SUFFIX))) {
-            av_strlcatf(args, sizeof(args), ":%s=%s", e->key, e->value);
+        if (scaler) {
+            /* keep hardware frames on their device instead of letting the
+             * graph download them for the software scaler */
+            snprintf(args, sizeof(args), "w=%d:h=%d",
+                     ofilter->width, ofilter->height);
+        } else {
+            scaler = avfilter_get_by_name("scale");
+            snprintf(args, sizeof(args), "%d:%d",
+                     ofilter->width, ofilter->height);
+
+            while ((e = av_dict_get(ost->sws_dict, "", e,
+                                    AV_DICT_IGNORE_SUFFIX))) {
+                av_strlcatf(args, sizeof(args), ":%s=%s", e->key, e->value);
+            }
         }
 
-        snprintf(name, sizeof(name), "scaler_out_%d_%d",
-                 ost->file_index, ost->index);
-        if ((ret = avfilter_graph_create_filter(&filter, avfilter_get_by_name("scale"),
+        if ((ret = avfilter_graph_create_filter(&filter, scaler,
                                                 name, args, NULL, fg->graph)) < 0)
             return ret;
         if ((ret = avfilter_link(last_filter, pad_idx, filter, 0)) < 0)
@@ -1002,6 +1047,7 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->stats = !!stats_json_avio;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -1009,6 +1055,8 @@ int configure_filtergraph(FilterGraph *fg)
         AVDictionaryEntry *e = NULL;
 
         fg->graph->nb_threads = filter_nbthreads;
+        if (filter_frame_threads)
+            fg->graph->thread_type |= AVFILTER_THREAD_FRAME;
 
         args[0] = 0;
         while ((e = av_dict_get(ost->sws_dict, "", e,
@@ -1041,6 +1089,8 @@ int configure_filtergraph(FilterGraph *fg)
             av_opt_set(fg->graph, "threads", e->value, 0);
     } else {
         fg->graph->nb_threads = filter_complex_nbthreads;
+        if (filter_frame_threads)
+            fg->graph->thread_type |= AVFILTER_THREAD_FRAME;
     }
 
     if ((ret = avfilter_graph_parse2(fg->graph, graph_desc, &inputs, &outputs)) < 0)
@@ -35,6 +35,7 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/fifo.h"
+#include "libavutil/hwcontext.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
@@ -115,12 +116,14 @@ int debug_ts          = 0;
 int exit_on_error     = 0;
 int abort_on_flags    = 0;
 int print_stats       = -1;
+int64_t stats_period  = 500000;
 int qp_hist           = 0;
 int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
 float max_error_rate  = 2.0/3;
 int filter_nbthreads = 0;
 int filter_complex_nbthreads = 0;
+int filter_frame_threads = 0;
 int vstats_version = 2;
 
 
@@ -452,6 +455,28 @@ static int opt_sdp_file(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_software_device(void *optctx, const char *opt, const char *arg)
+{
+    AVDictionary *opts = NULL;
+    int err;
+
+    err = av_dict_parse_string(&opts, arg, "=", ":", 0);
+    if (err < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid software device options '%s'\n", arg);
+        exit_program(1);
+    }
+
+    av_buffer_unref(&hw_device_ctx);
+    err = av_hwdevice_ctx_create(&hw_device_ctx, AV_HWDEVICE_TYPE_SOFTWARE,
+                                 NULL, opts, 0);
+    av_dict_free(&opts);
+    if (err < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to create a software device\n");
+        exit_program(1);
+    }
+    return 0;
+}
+
 #if CONFIG_VAAPI
 static int opt_vaapi_device(void *optctx, const char *opt, const char *arg)
 {
@@ -1404,6 +1429,8 @@ static OutputStream *new_output_stream(OptionsContext *o, AVFormatContext *oc, e
     MATCH_PER_STREAM_OPT(max_muxing_queue_size, i, ost->max_muxing_queue_size, oc, st);
     ost->max_muxing_queue_size *= sizeof(AVPacket);
 
+    MATCH_PER_STREAM_OPT(enc_thread_queue_size, i, ost->enc_thread_queue_size, oc, st);
+
     if (oc->oformat->flags & AVFMT_GLOBALHEADER)
         ost->enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
@@ -1811,7 +1838,7 @@ static OutputStream *new_attachment_stream(OptionsContext *o, AVFormatContext *o
 {
     OutputStream *ost = new_output_stream(o, oc, AVMEDIA_TYPE_ATTACHMENT, source_index);
     ost->stream_copy = 1;
-    ost->finished    = 1;
+    atomic_store(&ost->finished, 1);
     return ost;
 }
 
@@ -2045,6 +2072,9 @@ static int open_output_file(OptionsContext *o, const char *filename)
     if (!of)
         exit_program(1);
     output_files[nb_output_files - 1] = of;
+#if HAVE_PTHREADS
+    pthread_mutex_init(&of->mux_lock, NULL);
+#endif
 
     of->ost_index      = nb_output_streams;
     of->recording_time = o->recording_time;
@@ -3288,6 +3318,23 @@ static int opt_progress(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_stats_json(void *optctx, const char *opt, const char *arg)
+{
+    AVIOContext *avio = NULL;
+    int ret;
+
+    if (!strcmp(arg, "-"))
+        arg = "pipe:";
+    ret = avio_open2(&avio, arg, AVIO_FLAG_WRITE, &int_cb, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open stats URL \"%s\": %s\n",
+               arg, av_err2str(ret));
+        return ret;
+    }
+    stats_json_avio = avio;
+    return 0;
+}
+
 #define OFFSET(x) offsetof(OptionsContext, x)
 const OptionDef options[] = {
     /* main options */
@@ -3366,6 +3413,10 @@ const OptionDef options[] = {
       "add timings for each task" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
+    { "stats_json",     HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_stats_json },
+      "write detailed statistics as JSON lines", "url" },
+    { "stats_period",   HAS_ARG | OPT_TIME | OPT_EXPERT,             { &stats_period },
+      "set the period at which progress and statistics are reported", "time" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
       "enable or disable interaction on standard input" },
     { "timelimit",      HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_timelimit },
@@ -3430,6 +3481,8 @@ const OptionDef options[] = {
         "set stream filtergraph", "filter_graph" },
     { "filter_threads",  HAS_ARG | OPT_INT,                          { &filter_nbthreads },
         "number of non-complex filter threads" },
+    { "filter_frame_threads", OPT_BOOL,                              { &filter_frame_threads },
+        "run the filters of a graph concurrently" },
     { "filter_script",  HAS_ARG | OPT_STRING | OPT_SPEC | OPT_OUTPUT, { .off = OFFSET(filter_scripts) },
         "read stream filtergraph description from a file", "filename" },
     { "reinit_filter",  HAS_ARG | OPT_INT | OPT_SPEC | OPT_INPUT,    { .off = OFFSET(reinit_filters) },
@@ -3648,6 +3701,8 @@ const OptionDef options[] = {
 
     { "max_muxing_queue_size", HAS_ARG | OPT_INT | OPT_SPEC | OPT_EXPERT | OPT_OUTPUT, { .off = OFFSET(max_muxing_queue_size) },
         "maximum number of packets that can be buffered while waiting for all streams to initialize", "packets" },
+    { "enc_thread_queue_size", HAS_ARG | OPT_INT | OPT_SPEC | OPT_EXPERT | OPT_OUTPUT, { .off = OFFSET(enc_thread_queue_size) },
+        "encode the stream in a dedicated thread, fed through a queue of this many frames", "frames" },
 
     /* data codec support */
     { "dcodec", HAS_ARG | OPT_DATA | OPT_PERFILE | OPT_EXPERT | OPT_INPUT | OPT_OUTPUT, { .func_arg = opt_data_codec },
@@ -3655,6 +3710,10 @@ const OptionDef options[] = {
     { "dn", OPT_BOOL | OPT_VIDEO | OPT_OFFSET | OPT_INPUT | OPT_OUTPUT, { .off = OFFSET(data_disable) },
         "disable data" },
 
+    { "software_device", HAS_ARG | OPT_EXPERT, { .func_arg = opt_software_device },
+        "set up a software (system memory) hardware device for filters, "
+        "with optional transfer_cost and map_cost", "options" },
+
 #if CONFIG_VAAPI
     { "vaapi_device", HAS_ARG | OPT_EXPERT, { .func_arg = opt_vaapi_device },
         "set VAAPI hardware device (DRM path or X11 display name)", "device" },
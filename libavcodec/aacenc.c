@@ -506,6 +506,132 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/**
+ * Run the psychoacoustic analysis, the quantizer search and the coding tool
+ * decisions for one channel element. The elements of a frame do not depend
+ * on each other at this stage, so they are processed as slice thread jobs,
+ * each on the context of the thread running it.
+ */
+static int analyze_element(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    AACEncContext *s0 = avctx->priv_data;
+    AACEncContext *s  = s0->thread[threadnr];
+    AACEncElement *el = &s0->elements[jobnr];
+    FFPsyWindowInfo *wi = (FFPsyWindowInfo *)arg + el->start_ch;
+    ChannelElement *cpe = &s0->cpe[jobnr];
+    SingleChannelElement *sce;
+    const float *coeffs[2];
+    int start_ch = el->start_ch;
+    int tag      = s0->chan_map[jobnr + 1];
+    int chans    = tag == TYPE_CPE ? 2 : 1;
+    int ch, w;
+
+    s->random_state = el->random_state;
+    s->psy.cutoff   = el->psy_cutoff;
+    el->tns_mode = el->is_mode = el->pred_mode = 0;
+
+    cpe->common_window = 0;
+    memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
+    memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
+    for (ch = 0; ch < chans; ch++) {
+        sce = &cpe->ch[ch];
+        coeffs[ch] = sce->coeffs;
+        sce->ics.predictor_present = 0;
+        sce->ics.ltp.present = 0;
+        memset(sce->ics.ltp.used, 0, sizeof(sce->ics.ltp.used));
+        memset(sce->ics.prediction_used, 0, sizeof(sce->ics.prediction_used));
+        memset(&sce->tns, 0, sizeof(TemporalNoiseShaping));
+        for (w = 0; w < 128; w++)
+            if (sce->band_type[w] > RESERVED_BT)
+                sce->band_type[w] = 0;
+    }
+    s->psy.bitres.alloc = -1;
+    s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
+    el->psy_alloc = s->psy.bitres.alloc;
+    if (s->psy.bitres.alloc > 0)
+        s->psy.bitres.alloc /= chans;
+    s->cur_type = tag;
+    for (ch = 0; ch < chans; ch++) {
+        s->cur_channel = start_ch + ch;
+        if (s->options.pns && s->coder->mark_pns)
+            s->coder->mark_pns(s, avctx, &cpe->ch[ch]);
+        s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
+    }
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (w = 0; w < wi[0].num_windows; w++) {
+            if (wi[0].grouping[w] != wi[1].grouping[w]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
+        sce = &cpe->ch[ch];
+        s->cur_channel = start_ch + ch;
+        if (s->options.tns && s->coder->search_for_tns)
+            s->coder->search_for_tns(s, sce);
+        if (s->options.tns && s->coder->apply_tns_filt)
+            s->coder->apply_tns_filt(s, sce);
+        if (sce->tns.present)
+            el->tns_mode = 1;
+        if (s->options.pns && s->coder->search_for_pns)
+            s->coder->search_for_pns(s, avctx, sce);
+    }
+    s->cur_channel = start_ch;
+    if (s->options.intensity_stereo) { /* Intensity Stereo */
+        if (s->coder->search_for_is)
+            s->coder->search_for_is(s, avctx, cpe);
+        if (cpe->is_mode) el->is_mode = 1;
+        apply_intensity_stereo(cpe);
+    }
+    if (s->options.pred) { /* Prediction */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            s->cur_channel = start_ch + ch;
+            if (s->options.pred && s->coder->search_for_pred)
+                s->coder->search_for_pred(s, sce);
+            if (cpe->ch[ch].ics.predictor_present) el->pred_mode = 1;
+        }
+        if (s->coder->adjust_common_pred)
+            s->coder->adjust_common_pred(s, cpe);
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            s->cur_channel = start_ch + ch;
+            if (s->options.pred && s->coder->apply_main_pred)
+                s->coder->apply_main_pred(s, sce);
+        }
+        s->cur_channel = start_ch;
+    }
+    if (s->options.mid_side) { /* Mid/Side stereo */
+        if (s->options.mid_side == -1 && s->coder->search_for_ms)
+            s->coder->search_for_ms(s, cpe);
+        else if (cpe->common_window)
+            memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
+        apply_mid_side_stereo(cpe);
+    }
+    adjust_frame_information(cpe, chans);
+    if (s->options.ltp) { /* LTP */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            s->cur_channel = start_ch + ch;
+            if (s->coder->search_for_ltp)
+                s->coder->search_for_ltp(s, sce, cpe->common_window);
+            if (sce->ics.ltp.present) el->pred_mode = 1;
+        }
+        s->cur_channel = start_ch;
+        if (s->coder->adjust_common_ltp)
+            s->coder->adjust_common_ltp(s, cpe);
+    }
+
+    el->random_state = s->random_state;
+    el->psy_cutoff   = s->psy.cutoff;
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
@@ -639,117 +765,33 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & AV_CODEC_FLAG_BITEXACT))
             put_bitstream_info(s, LIBAVCODEC_IDENT);
+        for (i = 0; i < s->nb_threads; i++) {
+            s->thread[i]->lambda = s->lambda;
+            s->thread[i]->psy.bitres.bits = s->last_frame_pb_count / s->channels;
+        }
+        for (i = 0; i < s->chan_map[0]; i++)
+            s->elements[i].psy_cutoff = s->psy.cutoff;
+        avctx->execute2(avctx, analyze_element, windows, NULL, s->chan_map[0]);
+        s->psy.cutoff = s->elements[s->chan_map[0] - 1].psy_cutoff;
+
         start_ch = 0;
         target_bits = 0;
         memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
-            FFPsyWindowInfo* wi = windows + start_ch;
-            const float *coeffs[2];
+            AACEncElement *el = &s->elements[i];
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
-            cpe->common_window = 0;
-            memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
-            memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (ch = 0; ch < chans; ch++) {
-                sce = &cpe->ch[ch];
-                coeffs[ch] = sce->coeffs;
-                sce->ics.predictor_present = 0;
-                sce->ics.ltp.present = 0;
-                memset(sce->ics.ltp.used, 0, sizeof(sce->ics.ltp.used));
-                memset(sce->ics.prediction_used, 0, sizeof(sce->ics.prediction_used));
-                memset(&sce->tns, 0, sizeof(TemporalNoiseShaping));
-                for (w = 0; w < 128; w++)
-                    if (sce->band_type[w] > RESERVED_BT)
-                        sce->band_type[w] = 0;
-            }
-            s->psy.bitres.alloc = -1;
-            s->psy.bitres.bits = s->last_frame_pb_count / s->channels;
-            s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
-            if (s->psy.bitres.alloc > 0) {
+            if (el->psy_alloc > 0) {
                 /* Lambda unused here on purpose, we need to take psy's unscaled allocation */
-                target_bits += s->psy.bitres.alloc
+                target_bits += el->psy_alloc
                     * (s->lambda / (avctx->global_quality ? avctx->global_quality : 120));
-                s->psy.bitres.alloc /= chans;
-            }
-            s->cur_type = tag;
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                if (s->options.pns && s->coder->mark_pns)
-                    s->coder->mark_pns(s, avctx, &cpe->ch[ch]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (w = 0; w < wi[0].num_windows; w++) {
-                    if (wi[0].grouping[w] != wi[1].grouping[w]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
-                sce = &cpe->ch[ch];
-                s->cur_channel = start_ch + ch;
-                if (s->options.tns && s->coder->search_for_tns)
-                    s->coder->search_for_tns(s, sce);
-                if (s->options.tns && s->coder->apply_tns_filt)
-                    s->coder->apply_tns_filt(s, sce);
-                if (sce->tns.present)
-                    tns_mode = 1;
-                if (s->options.pns && s->coder->search_for_pns)
-                    s->coder->search_for_pns(s, avctx, sce);
-            }
-            s->cur_channel = start_ch;
-            if (s->options.intensity_stereo) { /* Intensity Stereo */
-                if (s->coder->search_for_is)
-                    s->coder->search_for_is(s, avctx, cpe);
-                if (cpe->is_mode) is_mode = 1;
-                apply_intensity_stereo(cpe);
-            }
-            if (s->options.pred) { /* Prediction */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->search_for_pred)
-                        s->coder->search_for_pred(s, sce);
-                    if (cpe->ch[ch].ics.predictor_present) pred_mode = 1;
-                }
-                if (s->coder->adjust_common_pred)
-                    s->coder->adjust_common_pred(s, cpe);
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->apply_main_pred)
-                        s->coder->apply_main_pred(s, sce);
-                }
-                s->cur_channel = start_ch;
-            }
-            if (s->options.mid_side) { /* Mid/Side stereo */
-                if (s->options.mid_side == -1 && s->coder->search_for_ms)
-                    s->coder->search_for_ms(s, cpe);
-                else if (cpe->common_window)
-                    memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
-                apply_mid_side_stereo(cpe);
-            }
-            adjust_frame_information(cpe, chans);
-            if (s->options.ltp) { /* LTP */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->coder->search_for_ltp)
-                        s->coder->search_for_ltp(s, sce, cpe->common_window);
-                    if (sce->ics.ltp.present) pred_mode = 1;
-                }
-                s->cur_channel = start_ch;
-                if (s->coder->adjust_common_ltp)
-                    s->coder->adjust_common_ltp(s, cpe);
             }
+            tns_mode  |= el->tns_mode;
+            is_mode   |= el->is_mode;
+            pred_mode |= el->pred_mode;
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -852,9 +894,17 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
+    int i;
 
     av_log(avctx, AV_LOG_INFO, "Qavg: %.3f\n", s->lambda_sum / s->lambda_count);
 
+    for (i = 1; i < s->nb_threads; i++) {
+        if (s->thread[i])
+            ff_lpc_end(&s->thread[i]->lpc);
+        av_freep(&s->thread[i]);
+    }
+    av_freep(&s->thread);
+
     ff_mdct_end(&s->mdct1024);
     ff_mdct_end(&s->mdct128);
     ff_psy_end(&s->psy);
@@ -863,6 +913,7 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
     av_freep(&s->cpe);
+    av_freep(&s->elements);
     av_freep(&s->fdsp);
     ff_af_queue_close(&s->afq);
     return 0;
@@ -895,6 +946,7 @@ static av_cold int alloc_buffers(AVCodecContext *avctx, AACEncContext *s)
     int ch;
     FF_ALLOCZ_ARRAY_OR_GOTO(avctx, s->buffer.samples, s->channels, 3 * 1024 * sizeof(s->buffer.samples[0]), alloc_fail);
     FF_ALLOCZ_ARRAY_OR_GOTO(avctx, s->cpe, s->chan_map[0], sizeof(ChannelElement), alloc_fail);
+    FF_ALLOCZ_ARRAY_OR_GOTO(avctx, s->elements, s->chan_map[0], sizeof(AACEncElement), alloc_fail);
     FF_ALLOCZ_OR_GOTO(avctx, avctx->extradata, 5 + AV_INPUT_BUFFER_PADDING_SIZE, alloc_fail);
 
     for(ch = 0; ch < s->channels; ch++)
@@ -905,6 +957,33 @@ alloc_fail:
     return AVERROR(ENOMEM);
 }
 
+/**
+ * Set up one context per thread for the channel element analysis. The
+ * additional contexts share everything with the main one, except for the
+ * scratch buffers and the state written by the coders.
+ */
+static av_cold int alloc_thread_contexts(AVCodecContext *avctx, AACEncContext *s)
+{
+    int i, nb_threads = av_clip(avctx->thread_count, 1, s->chan_map[0]);
+
+    s->thread = av_mallocz_array(nb_threads, sizeof(*s->thread));
+    if (!s->thread)
+        return AVERROR(ENOMEM);
+    s->nb_threads = nb_threads;
+
+    s->thread[0] = s;
+    for (i = 1; i < nb_threads; i++) {
+        AACEncContext *t = av_malloc(sizeof(*t));
+        if (!t)
+            return AVERROR(ENOMEM);
+        memcpy(t, s, sizeof(*t));
+        ff_lpc_init(&t->lpc, 2*avctx->frame_size, TNS_MAX_ORDER, FF_LPC_TYPE_LEVINSON);
+        s->thread[i] = t;
+    }
+
+    return 0;
+}
+
 static av_cold void aac_encode_init_tables(void)
 {
     ff_aac_tableinit();
@@ -913,7 +992,7 @@ static av_cold void aac_encode_init_tables(void)
 static av_cold int aac_encode_init(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
-    int i, ret = 0;
+    int i, ch, ret = 0;
     const uint8_t *sizes[2];
     uint8_t grouping[AAC_MAX_CHANNELS];
     int lengths[2];
@@ -1029,6 +1108,11 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     s->psypp = ff_psy_preprocess_init(avctx);
     ff_lpc_init(&s->lpc, 2*avctx->frame_size, TNS_MAX_ORDER, FF_LPC_TYPE_LEVINSON);
     s->random_state = 0x1f2e3d4c;
+    for (i = 0, ch = 0; i < s->chan_map[0]; i++) {
+        s->elements[i].start_ch     = ch;
+        s->elements[i].random_state = s->random_state + i;
+        ch += s->chan_map[i + 1] == TYPE_CPE ? 2 : 1;
+    }
 
     s->abs_pow34   = abs_pow34_v;
     s->quant_bands = quantize_bands;
@@ -1039,6 +1123,9 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     if (HAVE_MIPSDSP)
         ff_aac_coder_init_mips(s);
 
+    if ((ret = alloc_thread_contexts(avctx, s)) < 0)
+        goto fail;
+
     if ((ret = ff_thread_once(&aac_table_init, &aac_encode_init_tables)) != 0)
         return AVERROR_UNKNOWN;
 
@@ -1089,7 +1176,8 @@ AVCodec ff_aac_encoder = {
     .defaults       = aac_encode_defaults,
     .supported_samplerates = mpeg4audio_sample_rates,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &aacenc_class,
@@ -89,6 +89,20 @@ typedef struct AACQuantizeBandCostCacheEntry {
     uint16_t generation;
 } AACQuantizeBandCostCacheEntry;
 
+/**
+ * Per channel element state of the analysis stage, which runs the
+ * elements of a frame concurrently
+ */
+typedef struct AACEncElement {
+    int start_ch;                                ///< index of the first channel of the element
+    int random_state;                            ///< PNS noise generator state
+    int psy_alloc;                               ///< bits allocated by the psy model, or -1
+    int psy_cutoff;                              ///< psy lowpass cutoff, as updated by the coder
+    int tns_mode;                                ///< set if TNS is used in the element
+    int is_mode;                                 ///< set if intensity stereo is used in the element
+    int pred_mode;                               ///< set if prediction or LTP is used in the element
+} AACEncElement;
+
 /**
  * AAC encoder context
  */
@@ -108,11 +122,14 @@ typedef struct AACEncContext {
     const uint8_t *chan_map;                     ///< channel configuration map
 
     ChannelElement *cpe;                         ///< channel elements
+    AACEncElement *elements;                     ///< analysis state of the channel elements
+    struct AACEncContext **thread;               ///< per-thread contexts, thread[0] is the main one
+    int nb_threads;                              ///< number of per-thread contexts
     FFPsyContext psy;
     struct FFPsyPreprocessContext* psypp;
     AACCoefficientsEncoder *coder;
     int cur_channel;                             ///< current channel for coder context
-    int random_state;
+    int random_state;                            ///< PNS noise generator state of the current element
     float lambda;
     int last_frame_pb_count;                     ///< number of bits for the previous frame
     float lambda_sum;                            ///< sum(lambda), for Qvg reporting
@@ -123,6 +123,7 @@ typedef struct AacPsyBand{
 typedef struct AacPsyChannel{
     AacPsyBand band[128];               ///< bands information
     AacPsyBand prev_band[128];          ///< bands information from the previous frame
+    float      min_snr[2][64];          ///< minimal SNR per band, raised when allowing holes
 
     float       win_energy;              ///< sliding average of channel energy
     float       iir_state[2];            ///< hi-pass IIR filter state
@@ -146,11 +147,10 @@ typedef struct AacPsyCoeffs{
 }AacPsyCoeffs;
 
 /**
- * 3GPP TS26.403-inspired psychoacoustic model specific data
+ * bit allocation state, kept separately for each channel group so that
+ * the groups of a frame can be analyzed independently of each other
  */
-typedef struct AacPsyContext{
-    int chan_bitrate;     ///< bitrate per channel
-    int frame_bits;       ///< average bits per frame
+typedef struct AacPsyGroup{
     int fill_level;       ///< bit reservoir fill level
     struct {
         float min;        ///< minimum allowed PE for bit factor calculation
@@ -158,8 +158,17 @@ typedef struct AacPsyContext{
         float previous;   ///< allowed PE of the previous frame
         float correction; ///< PE correction factor
     } pe;
+}AacPsyGroup;
+
+/**
+ * 3GPP TS26.403-inspired psychoacoustic model specific data
+ */
+typedef struct AacPsyContext{
+    int chan_bitrate;     ///< bitrate per channel
+    int frame_bits;       ///< average bits per frame
     AacPsyCoeffs psy_coef[2][64];
     AacPsyChannel *ch;
+    AacPsyGroup *group;   ///< bit allocation state of each channel group
     float global_quality; ///< normalized global quality taken from avctx
 }AacPsyContext;
 
@@ -321,11 +330,20 @@ static av_cold int psy_3gpp_init(FFPsyContext *ctx) {
 
     pctx->chan_bitrate = chan_bitrate;
     pctx->frame_bits   = FFMIN(2560, chan_bitrate * AAC_BLOCK_SIZE_LONG / ctx->avctx->sample_rate);
-    pctx->pe.min       =  8.0f * AAC_BLOCK_SIZE_LONG * bandwidth / (ctx->avctx->sample_rate * 2.0f);
-    pctx->pe.max       = 12.0f * AAC_BLOCK_SIZE_LONG * bandwidth / (ctx->avctx->sample_rate * 2.0f);
     ctx->bitres.size   = 6144 - pctx->frame_bits;
     ctx->bitres.size  -= ctx->bitres.size % 8;
-    pctx->fill_level   = ctx->bitres.size;
+
+    pctx->group = av_mallocz_array(ctx->num_groups, sizeof(AacPsyGroup));
+    if (!pctx->group) {
+        av_freep(&ctx->model_priv_data);
+        return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < ctx->num_groups; i++) {
+        AacPsyGroup *pgroup = &pctx->group[i];
+        pgroup->pe.min     =  8.0f * AAC_BLOCK_SIZE_LONG * bandwidth / (ctx->avctx->sample_rate * 2.0f);
+        pgroup->pe.max     = 12.0f * AAC_BLOCK_SIZE_LONG * bandwidth / (ctx->avctx->sample_rate * 2.0f);
+        pgroup->fill_level = ctx->bitres.size;
+    }
     minath = ath(3410 - 0.733 * ATH_ADD, ATH_ADD);
     for (j = 0; j < 2; j++) {
         AacPsyCoeffs *coeffs = pctx->psy_coef[j];
@@ -369,9 +387,14 @@ static av_cold int psy_3gpp_init(FFPsyContext *ctx) {
 
     pctx->ch = av_mallocz_array(ctx->avctx->channels, sizeof(AacPsyChannel));
     if (!pctx->ch) {
+        av_freep(&pctx->group);
         av_freep(&ctx->model_priv_data);
         return AVERROR(ENOMEM);
     }
+    for (i = 0; i < ctx->avctx->channels; i++)
+        for (j = 0; j < 2; j++)
+            for (g = 0; g < ctx->num_bands[j]; g++)
+                pctx->ch[i].min_snr[j][g] = pctx->psy_coef[j][g].min_snr;
 
     lame_window_init(pctx, ctx->avctx);
 
@@ -488,8 +511,8 @@ static av_unused FFPsyWindowInfo psy_3gpp_window(FFPsyContext *ctx,
 }
 
 /* 5.6.1.2 "Calculation of Bit Demand" */
-static int calc_bit_demand(AacPsyContext *ctx, float pe, int bits, int size,
-                           int short_window)
+static int calc_bit_demand(AacPsyContext *ctx, AacPsyGroup *pgroup, float pe,
+                           int bits, int size, int short_window)
 {
     const float bitsave_slope  = short_window ? PSY_3GPP_SAVE_SLOPE_S  : PSY_3GPP_SAVE_SLOPE_L;
     const float bitsave_add    = short_window ? PSY_3GPP_SAVE_ADD_S    : PSY_3GPP_SAVE_ADD_L;
@@ -499,10 +522,10 @@ static int calc_bit_demand(AacPsyContext *ctx, float pe, int bits, int size,
     const float clip_high      = short_window ? PSY_3GPP_CLIP_HI_S     : PSY_3GPP_CLIP_HI_L;
     float clipped_pe, bit_save, bit_spend, bit_factor, fill_level, forgetful_min_pe;
 
-    ctx->fill_level += ctx->frame_bits - bits;
-    ctx->fill_level  = av_clip(ctx->fill_level, 0, size);
-    fill_level = av_clipf((float)ctx->fill_level / size, clip_low, clip_high);
-    clipped_pe = av_clipf(pe, ctx->pe.min, ctx->pe.max);
+    pgroup->fill_level += ctx->frame_bits - bits;
+    pgroup->fill_level  = av_clip(pgroup->fill_level, 0, size);
+    fill_level = av_clipf((float)pgroup->fill_level / size, clip_low, clip_high);
+    clipped_pe = av_clipf(pe, pgroup->pe.min, pgroup->pe.max);
     bit_save   = (fill_level + bitsave_add) * bitsave_slope;
     assert(bit_save <= 0.3f && bit_save >= -0.05000001f);
     bit_spend  = (fill_level + bitspend_add) * bitspend_slope;
@@ -513,15 +536,15 @@ static int calc_bit_demand(AacPsyContext *ctx, float pe, int bits, int size,
      *      1 - bit_save + ((bit_spend + bit_save))...
      * Hopefully below is correct.
      */
-    bit_factor = 1.0f - bit_save + ((bit_spend - bit_save) / (ctx->pe.max - ctx->pe.min)) * (clipped_pe - ctx->pe.min);
+    bit_factor = 1.0f - bit_save + ((bit_spend - bit_save) / (pgroup->pe.max - pgroup->pe.min)) * (clipped_pe - pgroup->pe.min);
     /* NOTE: The reference encoder attempts to center pe max/min around the current pe.
      * Here we do that by slowly forgetting pe.min when pe stays in a range that makes
      * it unlikely (ie: above the mean)
      */
-    ctx->pe.max = FFMAX(pe, ctx->pe.max);
-    forgetful_min_pe = ((ctx->pe.min * PSY_PE_FORGET_SLOPE)
-        + FFMAX(ctx->pe.min, pe * (pe / ctx->pe.max))) / (PSY_PE_FORGET_SLOPE + 1);
-    ctx->pe.min = FFMIN(pe, forgetful_min_pe);
+    pgroup->pe.max = FFMAX(pe, pgroup->pe.max);
+    forgetful_min_pe = ((pgroup->pe.min * PSY_PE_FORGET_SLOPE)
+        + FFMAX(pgroup->pe.min, pe * (pe / pgroup->pe.max))) / (PSY_PE_FORGET_SLOPE + 1);
+    pgroup->pe.min = FFMIN(pe, forgetful_min_pe);
 
     /* NOTE: allocate a minimum of 1/8th average frame bits, to avoid
      *   reservoir starvation from producing zero-bit frames
@@ -646,8 +669,9 @@ static void psy_hp_filter(const float *firbuf, float *hpfsmpl, const float *psy_
 /**
  * Calculate band thresholds as suggested in 3GPP TS26.403
  */
-static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
-                                     const float *coefs, const FFPsyWindowInfo *wi)
+static void psy_3gpp_analyze_channel(FFPsyContext *ctx, AacPsyGroup *pgroup,
+                                     int channel, const float *coefs,
+                                     const FFPsyWindowInfo *wi)
 {
     AacPsyContext *pctx = (AacPsyContext*) ctx->model_priv_data;
     AacPsyChannel *pch  = &pctx->ch[channel];
@@ -657,7 +681,8 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
     float pe = pctx->chan_bitrate > 32000 ? 0.0f : FFMAX(50.0f, 100.0f - pctx->chan_bitrate * 100.0f / 32000.0f);
     const int      num_bands   = ctx->num_bands[wi->num_windows == 8];
     const uint8_t *band_sizes  = ctx->bands[wi->num_windows == 8];
-    AacPsyCoeffs  *coeffs      = pctx->psy_coef[wi->num_windows == 8];
+    const AacPsyCoeffs *coeffs = pctx->psy_coef[wi->num_windows == 8];
+    float         *min_snr     = pch->min_snr[wi->num_windows == 8];
     const float avoid_hole_thr = wi->num_windows == 8 ? PSY_3GPP_AH_THR_SHORT : PSY_3GPP_AH_THR_LONG;
     const int bandwidth        = ctx->cutoff ? ctx->cutoff : AAC_CUTOFF(ctx->avctx);
     const int cutoff           = bandwidth * 2048 / wi->num_windows / ctx->avctx->sample_rate;
@@ -695,7 +720,7 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
             active_lines += band->active_lines;
 
             /* 5.6.1.3.3 "Selection of the bands for avoidance of holes" */
-            if (spread_en[w+g] * avoid_hole_thr > band->energy || coeffs[g].min_snr > 1.0f)
+            if (spread_en[w+g] * avoid_hole_thr > band->energy || min_snr[g] > 1.0f)
                 band->avoid_holes = PSY_3GPP_AH_NONE;
             else
                 band->avoid_holes = PSY_3GPP_AH_INACTIVE;
@@ -718,10 +743,10 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
             desired_pe = PSY_3GPP_BITS_TO_PE(desired_bits); // reflect clipping
         }
 
-        pctx->pe.max = FFMAX(pe, pctx->pe.max);
-        pctx->pe.min = FFMIN(pe, pctx->pe.min);
+        pgroup->pe.max = FFMAX(pe, pgroup->pe.max);
+        pgroup->pe.min = FFMIN(pe, pgroup->pe.min);
     } else {
-        desired_bits = calc_bit_demand(pctx, pe, ctx->bitres.bits, ctx->bitres.size, wi->num_windows == 8);
+        desired_bits = calc_bit_demand(pctx, pgroup, pe, ctx->bitres.bits, ctx->bitres.size, wi->num_windows == 8);
         desired_pe = PSY_3GPP_BITS_TO_PE(desired_bits);
 
         /* NOTE: PE correction is kept simple. During initial testing it had very
@@ -729,10 +754,10 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
          *       back and do more testing later.
          */
         if (ctx->bitres.bits > 0)
-            desired_pe *= av_clipf(pctx->pe.previous / PSY_3GPP_BITS_TO_PE(ctx->bitres.bits),
+            desired_pe *= av_clipf(pgroup->pe.previous / PSY_3GPP_BITS_TO_PE(ctx->bitres.bits),
                                    0.85f, 1.15f);
     }
-    pctx->pe.previous = PSY_3GPP_BITS_TO_PE(desired_bits);
+    pgroup->pe.previous = PSY_3GPP_BITS_TO_PE(desired_bits);
     ctx->bitres.alloc = desired_bits;
 
     if (desired_pe < pe) {
@@ -745,7 +770,7 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
             for (g = 0; g < num_bands; g++) {
                 AacPsyBand *band = &pch->band[w+g];
 
-                band->thr = calc_reduced_thr_3gpp(band, coeffs[g].min_snr, reduction);
+                band->thr = calc_reduced_thr_3gpp(band, min_snr[g], reduction);
                 /* recalculate PE */
                 pe += calc_pe_3gpp(band);
                 a  += band->pe_const;
@@ -778,7 +803,7 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
                     AacPsyBand *band = &pch->band[w+g];
 
                     if (active_lines > 0.0f)
-                        band->thr = calc_reduced_thr_3gpp(band, coeffs[g].min_snr, reduction);
+                        band->thr = calc_reduced_thr_3gpp(band, min_snr[g], reduction);
                     pe += calc_pe_3gpp(band);
                     if (band->thr > 0.0f)
                         band->norm_fac = band->active_lines / band->thr;
@@ -804,8 +829,8 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
                         float thr = band->thr;
 
                         thr *= exp2f(delta_sfb_pe / band->active_lines);
-                        if (thr > coeffs[g].min_snr * band->energy && band->avoid_holes == PSY_3GPP_AH_INACTIVE)
-                            thr = FFMAX(band->thr, coeffs[g].min_snr * band->energy);
+                        if (thr > min_snr[g] * band->energy && band->avoid_holes == PSY_3GPP_AH_INACTIVE)
+                            thr = FFMAX(band->thr, min_snr[g] * band->energy);
                         band->thr = thr;
                     }
                 }
@@ -816,8 +841,8 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
             while (pe > desired_pe && g--) {
                 for (w = 0; w < wi->num_windows*16; w+= 16) {
                     AacPsyBand *band = &pch->band[w+g];
-                    if (band->avoid_holes != PSY_3GPP_AH_NONE && coeffs[g].min_snr < PSY_SNR_1DB) {
-                        coeffs[g].min_snr = PSY_SNR_1DB;
+                    if (band->avoid_holes != PSY_3GPP_AH_NONE && min_snr[g] < PSY_SNR_1DB) {
+                        min_snr[g] = PSY_SNR_1DB;
                         band->thr = band->energy * PSY_SNR_1DB;
                         pe += band->active_lines * 1.5f - band->pe;
                     }
@@ -845,17 +870,20 @@ static void psy_3gpp_analyze_channel(FFPsyContext *ctx, int channel,
 static void psy_3gpp_analyze(FFPsyContext *ctx, int channel,
                                    const float **coeffs, const FFPsyWindowInfo *wi)
 {
-    int ch;
+    AacPsyContext *pctx = (AacPsyContext*) ctx->model_priv_data;
     FFPsyChannelGroup *group = ff_psy_find_group(ctx, channel);
+    AacPsyGroup *pgroup = &pctx->group[group - ctx->group];
+    int ch;
 
     for (ch = 0; ch < group->num_ch; ch++)
-        psy_3gpp_analyze_channel(ctx, channel + ch, coeffs[ch], &wi[ch]);
+        psy_3gpp_analyze_channel(ctx, pgroup, channel + ch, coeffs[ch], &wi[ch]);
 }
 
 static av_cold void psy_3gpp_end(FFPsyContext *apc)
 {
     AacPsyContext *pctx = (AacPsyContext*) apc->model_priv_data;
     av_freep(&pctx->ch);
+    av_freep(&pctx->group);
     av_freep(&apc->model_priv_data);
 }
 
@@ -4504,6 +4504,9 @@ int av_new_packet(AVPacket *pkt, int size);
 /**
  * Reduce packet size, correctly zeroing padding
  *
+ * The padding is left alone if pkt->buf is not writable, as the bytes
+ * following the data may then be used by other references.
+ *
  * @param pkt packet
  * @param size new size
  */
@@ -4512,6 +4515,8 @@ void av_shrink_packet(AVPacket *pkt, int size);
 /**
  * Increase packet size, correctly zeroing padding
  *
+ * The data is moved to a new buffer if pkt->buf is not writable.
+ *
  * @param pkt packet
  * @param grow_by number of bytes by which to increase the size of the packet
  */
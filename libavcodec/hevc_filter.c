@@ -476,11 +476,11 @@ static int get_pcm(HEVCContext *s, int x, int y)
 static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
 {
     uint8_t *src;
-    int x, y;
-    int chroma, beta;
-    int32_t c_tc[2], tc[2];
-    uint8_t no_p[2] = { 0 };
-    uint8_t no_q[2] = { 0 };
+    int x, y, i, nb;
+    int chroma, beta[2];
+    int32_t c_tc[4], tc[4];
+    uint8_t no_p[4] = { 0 };
+    uint8_t no_q[4] = { 0 };
 
     int log2_ctb_size = s->ps.sps->log2_ctb_size;
     int x_end, x_end2, y_end;
@@ -517,63 +517,102 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
     if (x_end2 != s->ps.sps->width)
         x_end2 -= 8;
     for (y = y0; y < y_end; y += 8) {
-        // vertical filtering luma
-        for (x = x0 ? x0 : 8; x < x_end; x += 8) {
-            const int bs0 = s->vertical_bs[(x +  y      * s->bs_width) >> 2];
-            const int bs1 = s->vertical_bs[(x + (y + 4) * s->bs_width) >> 2];
-            if (bs0 || bs1) {
-                const int qp = (get_qPy(s, x - 1, y)     + get_qPy(s, x, y)     + 1) >> 1;
-
-                beta = betatable[av_clip(qp + beta_offset, 0, MAX_QP)];
-
-                tc[0]   = bs0 ? TC_CALC(qp, bs0) : 0;
-                tc[1]   = bs1 ? TC_CALC(qp, bs1) : 0;
-                src     = &s->frame->data[LUMA][y * s->frame->linesize[LUMA] + (x << s->ps.sps->pixel_shift)];
-                if (pcmf) {
-                    no_p[0] = get_pcm(s, x - 1, y);
-                    no_p[1] = get_pcm(s, x - 1, y + 4);
-                    no_q[0] = get_pcm(s, x, y);
-                    no_q[1] = get_pcm(s, x, y + 4);
-                    s->hevcdsp.hevc_v_loop_filter_luma_c(src,
-                                                         s->frame->linesize[LUMA],
-                                                         beta, tc, no_p, no_q);
-                } else
-                    s->hevcdsp.hevc_v_loop_filter_luma(src,
-                                                       s->frame->linesize[LUMA],
-                                                       beta, tc, no_p, no_q);
+        // vertical filtering luma, two edges per call when possible
+        for (x = x0 ? x0 : 8; x < x_end; x += 8 * nb) {
+            int filter = 0;
+
+            nb = !pcmf && s->hevcdsp.hevc_v_loop_filter_luma_x2 &&
+                 x + 8 < x_end ? 2 : 1;
+            for (i = 0; i < nb; i++) {
+                const int xs  = x + 8 * i;
+                const int bs0 = s->vertical_bs[(xs +  y      * s->bs_width) >> 2];
+                const int bs1 = s->vertical_bs[(xs + (y + 4) * s->bs_width) >> 2];
+
+                // a segment without any tc and beta is left unchanged
+                beta[i]       = 0;
+                tc[2 * i]     = 0;
+                tc[2 * i + 1] = 0;
+                if (bs0 || bs1) {
+                    const int qp = (get_qPy(s, xs - 1, y)     + get_qPy(s, xs, y)     + 1) >> 1;
+
+                    beta[i] = betatable[av_clip(qp + beta_offset, 0, MAX_QP)];
+
+                    tc[2 * i]     = bs0 ? TC_CALC(qp, bs0) : 0;
+                    tc[2 * i + 1] = bs1 ? TC_CALC(qp, bs1) : 0;
+                    filter        = 1;
+                }
             }
+            if (!filter)
+                continue;
+
+            src = &s->frame->data[LUMA][y * s->frame->linesize[LUMA] + (x << s->ps.sps->pixel_shift)];
+            if (pcmf) {
+                no_p[0] = get_pcm(s, x - 1, y);
+                no_p[1] = get_pcm(s, x - 1, y + 4);
+                no_q[0] = get_pcm(s, x, y);
+                no_q[1] = get_pcm(s, x, y + 4);
+                s->hevcdsp.hevc_v_loop_filter_luma_c(src,
+                                                     s->frame->linesize[LUMA],
+                                                     beta[0], tc, no_p, no_q);
+            } else if (nb == 2)
+                s->hevcdsp.hevc_v_loop_filter_luma_x2(src,
+                                                      s->frame->linesize[LUMA],
+                                                      beta, tc, no_p, no_q);
+            else
+                s->hevcdsp.hevc_v_loop_filter_luma(src,
+                                                   s->frame->linesize[LUMA],
+                                                   beta[0], tc, no_p, no_q);
         }
 
         if(!y)
              continue;
 
-        // horizontal filtering luma
-        for (x = x0 ? x0 - 8 : 0; x < x_end2; x += 8) {
-            const int bs0 = s->horizontal_bs[( x      + y * s->bs_width) >> 2];
-            const int bs1 = s->horizontal_bs[((x + 4) + y * s->bs_width) >> 2];
-            if (bs0 || bs1) {
-                const int qp = (get_qPy(s, x, y - 1)     + get_qPy(s, x, y)     + 1) >> 1;
-
-                tc_offset   = x >= x0 ? cur_tc_offset : left_tc_offset;
-                beta_offset = x >= x0 ? cur_beta_offset : left_beta_offset;
-
-                beta = betatable[av_clip(qp + beta_offset, 0, MAX_QP)];
-                tc[0]   = bs0 ? TC_CALC(qp, bs0) : 0;
-                tc[1]   = bs1 ? TC_CALC(qp, bs1) : 0;
-                src     = &s->frame->data[LUMA][y * s->frame->linesize[LUMA] + (x << s->ps.sps->pixel_shift)];
-                if (pcmf) {
-                    no_p[0] = get_pcm(s, x, y - 1);
-                    no_p[1] = get_pcm(s, x + 4, y - 1);
-                    no_q[0] = get_pcm(s, x, y);
-                    no_q[1] = get_pcm(s, x + 4, y);
-                    s->hevcdsp.hevc_h_loop_filter_luma_c(src,
-                                                         s->frame->linesize[LUMA],
-                                                         beta, tc, no_p, no_q);
-                } else
-                    s->hevcdsp.hevc_h_loop_filter_luma(src,
-                                                       s->frame->linesize[LUMA],
-                                                       beta, tc, no_p, no_q);
+        // horizontal filtering luma, two segments per call when possible
+        for (x = x0 ? x0 - 8 : 0; x < x_end2; x += 8 * nb) {
+            int filter = 0;
+
+            nb = !pcmf && s->hevcdsp.hevc_h_loop_filter_luma_x2 &&
+                 x + 8 < x_end2 ? 2 : 1;
+            for (i = 0; i < nb; i++) {
+                const int xs  = x + 8 * i;
+                const int bs0 = s->horizontal_bs[( xs      + y * s->bs_width) >> 2];
+                const int bs1 = s->horizontal_bs[((xs + 4) + y * s->bs_width) >> 2];
+
+                beta[i]       = 0;
+                tc[2 * i]     = 0;
+                tc[2 * i + 1] = 0;
+                if (bs0 || bs1) {
+                    const int qp = (get_qPy(s, xs, y - 1)     + get_qPy(s, xs, y)     + 1) >> 1;
+
+                    tc_offset   = xs >= x0 ? cur_tc_offset : left_tc_offset;
+                    beta_offset = xs >= x0 ? cur_beta_offset : left_beta_offset;
+
+                    beta[i]       = betatable[av_clip(qp + beta_offset, 0, MAX_QP)];
+                    tc[2 * i]     = bs0 ? TC_CALC(qp, bs0) : 0;
+                    tc[2 * i + 1] = bs1 ? TC_CALC(qp, bs1) : 0;
+                    filter        = 1;
+                }
             }
+            if (!filter)
+                continue;
+
+            src = &s->frame->data[LUMA][y * s->frame->linesize[LUMA] + (x << s->ps.sps->pixel_shift)];
+            if (pcmf) {
+                no_p[0] = get_pcm(s, x, y - 1);
+                no_p[1] = get_pcm(s, x + 4, y - 1);
+                no_q[0] = get_pcm(s, x, y);
+                no_q[1] = get_pcm(s, x + 4, y);
+                s->hevcdsp.hevc_h_loop_filter_luma_c(src,
+                                                     s->frame->linesize[LUMA],
+                                                     beta[0], tc, no_p, no_q);
+            } else if (nb == 2)
+                s->hevcdsp.hevc_h_loop_filter_luma_x2(src,
+                                                      s->frame->linesize[LUMA],
+                                                      beta, tc, no_p, no_q);
+            else
+                s->hevcdsp.hevc_h_loop_filter_luma(src,
+                                                   s->frame->linesize[LUMA],
+                                                   beta[0], tc, no_p, no_q);
         }
     }
 
@@ -584,30 +623,47 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
 
             // vertical filtering chroma
             for (y = y0; y < y_end; y += (8 * v)) {
-                for (x = x0 ? x0 : 8 * h; x < x_end; x += (8 * h)) {
-                    const int bs0 = s->vertical_bs[(x +  y            * s->bs_width) >> 2];
-                    const int bs1 = s->vertical_bs[(x + (y + (4 * v)) * s->bs_width) >> 2];
-
-                    if ((bs0 == 2) || (bs1 == 2)) {
-                        const int qp0 = (get_qPy(s, x - 1, y)           + get_qPy(s, x, y)           + 1) >> 1;
-                        const int qp1 = (get_qPy(s, x - 1, y + (4 * v)) + get_qPy(s, x, y + (4 * v)) + 1) >> 1;
-
-                        c_tc[0] = (bs0 == 2) ? chroma_tc(s, qp0, chroma, tc_offset) : 0;
-                        c_tc[1] = (bs1 == 2) ? chroma_tc(s, qp1, chroma, tc_offset) : 0;
-                        src       = &s->frame->data[chroma][(y >> s->ps.sps->vshift[chroma]) * s->frame->linesize[chroma] + ((x >> s->ps.sps->hshift[chroma]) << s->ps.sps->pixel_shift)];
-                        if (pcmf) {
-                            no_p[0] = get_pcm(s, x - 1, y);
-                            no_p[1] = get_pcm(s, x - 1, y + (4 * v));
-                            no_q[0] = get_pcm(s, x, y);
-                            no_q[1] = get_pcm(s, x, y + (4 * v));
-                            s->hevcdsp.hevc_v_loop_filter_chroma_c(src,
-                                                                   s->frame->linesize[chroma],
-                                                                   c_tc, no_p, no_q);
-                        } else
-                            s->hevcdsp.hevc_v_loop_filter_chroma(src,
-                                                                 s->frame->linesize[chroma],
-                                                                 c_tc, no_p, no_q);
+                for (x = x0 ? x0 : 8 * h; x < x_end; x += (8 * h) * nb) {
+                    int filter = 0;
+
+                    nb = !pcmf && s->hevcdsp.hevc_v_loop_filter_chroma_x2 &&
+                         x + 8 * h < x_end ? 2 : 1;
+                    for (i = 0; i < nb; i++) {
+                        const int xs  = x + 8 * h * i;
+                        const int bs0 = s->vertical_bs[(xs +  y            * s->bs_width) >> 2];
+                        const int bs1 = s->vertical_bs[(xs + (y + (4 * v)) * s->bs_width) >> 2];
+
+                        c_tc[2 * i]     = 0;
+                        c_tc[2 * i + 1] = 0;
+                        if ((bs0 == 2) || (bs1 == 2)) {
+                            const int qp0 = (get_qPy(s, xs - 1, y)           + get_qPy(s, xs, y)           + 1) >> 1;
+                            const int qp1 = (get_qPy(s, xs - 1, y + (4 * v)) + get_qPy(s, xs, y + (4 * v)) + 1) >> 1;
+
+                            c_tc[2 * i]     = (bs0 == 2) ? chroma_tc(s, qp0, chroma, tc_offset) : 0;
+                            c_tc[2 * i + 1] = (bs1 == 2) ? chroma_tc(s, qp1, chroma, tc_offset) : 0;
+                            filter          = 1;
+                        }
                     }
+                    if (!filter)
+                        continue;
+
+                    src = &s->frame->data[chroma][(y >> s->ps.sps->vshift[chroma]) * s->frame->linesize[chroma] + ((x >> s->ps.sps->hshift[chroma]) << s->ps.sps->pixel_shift)];
+                    if (pcmf) {
+                        no_p[0] = get_pcm(s, x - 1, y);
+                        no_p[1] = get_pcm(s, x - 1, y + (4 * v));
+                        no_q[0] = get_pcm(s, x, y);
+                        no_q[1] = get_pcm(s, x, y + (4 * v));
+                        s->hevcdsp.hevc_v_loop_filter_chroma_c(src,
+                                                               s->frame->linesize[chroma],
+                                                               c_tc, no_p, no_q);
+                    } else if (nb == 2)
+                        s->hevcdsp.hevc_v_loop_filter_chroma_x2(src,
+                                                                s->frame->linesize[chroma],
+                                                                c_tc, no_p, no_q);
+                    else
+                        s->hevcdsp.hevc_v_loop_filter_chroma(src,
+                                                             s->frame->linesize[chroma],
+                                                             c_tc, no_p, no_q);
                 }
 
                 if(!y)
@@ -618,29 +674,47 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
                 x_end2 = x_end;
                 if (x_end != s->ps.sps->width)
                     x_end2 = x_end - 8 * h;
-                for (x = x0 ? x0 - 8 * h : 0; x < x_end2; x += (8 * h)) {
-                    const int bs0 = s->horizontal_bs[( x          + y * s->bs_width) >> 2];
-                    const int bs1 = s->horizontal_bs[((x + 4 * h) + y * s->bs_width) >> 2];
-                    if ((bs0 == 2) || (bs1 == 2)) {
-                        const int qp0 = bs0 == 2 ? (get_qPy(s, x,           y - 1) + get_qPy(s, x,           y) + 1) >> 1 : 0;
-                        const int qp1 = bs1 == 2 ? (get_qPy(s, x + (4 * h), y - 1) + get_qPy(s, x + (4 * h), y) + 1) >> 1 : 0;
-
-                        c_tc[0]   = bs0 == 2 ? chroma_tc(s, qp0, chroma, tc_offset)     : 0;
-                        c_tc[1]   = bs1 == 2 ? chroma_tc(s, qp1, chroma, cur_tc_offset) : 0;
-                        src       = &s->frame->data[chroma][(y >> s->ps.sps->vshift[1]) * s->frame->linesize[chroma] + ((x >> s->ps.sps->hshift[1]) << s->ps.sps->pixel_shift)];
-                        if (pcmf) {
-                            no_p[0] = get_pcm(s, x,           y - 1);
-                            no_p[1] = get_pcm(s, x + (4 * h), y - 1);
-                            no_q[0] = get_pcm(s, x,           y);
-                            no_q[1] = get_pcm(s, x + (4 * h), y);
-                            s->hevcdsp.hevc_h_loop_filter_chroma_c(src,
-                                                                   s->frame->linesize[chroma],
-                                                                   c_tc, no_p, no_q);
-                        } else
-                            s->hevcdsp.hevc_h_loop_filter_chroma(src,
-                                                                 s->frame->linesize[chroma],
-                                                                 c_tc, no_p, no_q);
+                for (x = x0 ? x0 - 8 * h : 0; x < x_end2; x += (8 * h) * nb) {
+                    int filter = 0;
+
+                    nb = !pcmf && s->hevcdsp.hevc_h_loop_filter_chroma_x2 &&
+                         x + 8 * h < x_end2 ? 2 : 1;
+                    for (i = 0; i < nb; i++) {
+                        const int xs  = x + 8 * h * i;
+                        const int bs0 = s->horizontal_bs[( xs          + y * s->bs_width) >> 2];
+                        const int bs1 = s->horizontal_bs[((xs + 4 * h) + y * s->bs_width) >> 2];
+
+                        c_tc[2 * i]     = 0;
+                        c_tc[2 * i + 1] = 0;
+                        if ((bs0 == 2) || (bs1 == 2)) {
+                            const int qp0 = bs0 == 2 ? (get_qPy(s, xs,           y - 1) + get_qPy(s, xs,           y) + 1) >> 1 : 0;
+                            const int qp1 = bs1 == 2 ? (get_qPy(s, xs + (4 * h), y - 1) + get_qPy(s, xs + (4 * h), y) + 1) >> 1 : 0;
+
+                            c_tc[2 * i]     = bs0 == 2 ? chroma_tc(s, qp0, chroma, tc_offset)     : 0;
+                            c_tc[2 * i + 1] = bs1 == 2 ? chroma_tc(s, qp1, chroma, cur_tc_offset) : 0;
+                            filter          = 1;
+                        }
                     }
+                    if (!filter)
+                        continue;
+
+                    src = &s->frame->data[chroma][(y >> s->ps.sps->vshift[1]) * s->frame->linesize[chroma] + ((x >> s->ps.sps->hshift[1]) << s->ps.sps->pixel_shift)];
+                    if (pcmf) {
+                        no_p[0] = get_pcm(s, x,           y - 1);
+                        no_p[1] = get_pcm(s, x + (4 * h), y - 1);
+                        no_q[0] = get_pcm(s, x,           y);
+                        no_q[1] = get_pcm(s, x + (4 * h), y);
+                        s->hevcdsp.hevc_h_loop_filter_chroma_c(src,
+                                                               s->frame->linesize[chroma],
+                                                               c_tc, no_p, no_q);
+                    } else if (nb == 2)
+                        s->hevcdsp.hevc_h_loop_filter_chroma_x2(src,
+                                                                s->frame->linesize[chroma],
+                                                                c_tc, no_p, no_q);
+                    else
+                        s->hevcdsp.hevc_h_loop_filter_chroma(src,
+                                                             s->frame->linesize[chroma],
+                                                             c_tc, no_p, no_q);
                 }
             }
         }
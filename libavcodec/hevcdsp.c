@@ -239,7 +239,11 @@ void ff_hevc_dsp_init(HEVCDSPContext *hevcdsp, int bit_depth)
     hevcdsp->hevc_h_loop_filter_luma_c   = FUNC(hevc_h_loop_filter_luma, depth);   \
     hevcdsp->hevc_v_loop_filter_luma_c   = FUNC(hevc_v_loop_filter_luma, depth);   \
     hevcdsp->hevc_h_loop_filter_chroma_c = FUNC(hevc_h_loop_filter_chroma, depth); \
-    hevcdsp->hevc_v_loop_filter_chroma_c = FUNC(hevc_v_loop_filter_chroma, depth)
+    hevcdsp->hevc_v_loop_filter_chroma_c = FUNC(hevc_v_loop_filter_chroma, depth); \
+    hevcdsp->hevc_h_loop_filter_luma_x2   = NULL;                                  \
+    hevcdsp->hevc_v_loop_filter_luma_x2   = NULL;                                  \
+    hevcdsp->hevc_h_loop_filter_chroma_x2 = NULL;                                  \
+    hevcdsp->hevc_v_loop_filter_chroma_x2 = NULL
 int i = 0;
 
     switch (bit_depth) {
@@ -120,6 +120,25 @@ typedef struct HEVCDSPContext {
     void (*hevc_v_loop_filter_chroma_c)(uint8_t *pix, ptrdiff_t stride,
                                         int32_t *tc, uint8_t *no_p,
                                         uint8_t *no_q);
+
+    /**
+     * Filter the two edge segments at pix and pix + 8 pixels in one call,
+     * with beta[i] and tc[2 * i], tc[2 * i + 1] for segment i. Only set when
+     * faster than two calls of the functions above, NULL otherwise.
+     * The no_p and no_q flags must be 0.
+     */
+    void (*hevc_h_loop_filter_luma_x2)(uint8_t *pix, ptrdiff_t stride,
+                                       int *beta, int32_t *tc,
+                                       uint8_t *no_p, uint8_t *no_q);
+    void (*hevc_v_loop_filter_luma_x2)(uint8_t *pix, ptrdiff_t stride,
+                                       int *beta, int32_t *tc,
+                                       uint8_t *no_p, uint8_t *no_q);
+    void (*hevc_h_loop_filter_chroma_x2)(uint8_t *pix, ptrdiff_t stride,
+                                         int32_t *tc, uint8_t *no_p,
+                                         uint8_t *no_q);
+    void (*hevc_v_loop_filter_chroma_x2)(uint8_t *pix, ptrdiff_t stride,
+                                         int32_t *tc, uint8_t *no_p,
+                                         uint8_t *no_q);
 } HEVCDSPContext;
 
 void ff_hevc_dsp_init(HEVCDSPContext *hpc, int bit_depth);
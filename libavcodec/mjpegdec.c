@@ -686,10 +686,11 @@ unk_pixfmt:
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0 || code > 16) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -698,47 +699,48 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb,
+                        int16_t *block, int *last_dc,
                         int dc_index, int ac_index, uint16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * quant_matrix[0] + s->last_dc[component];
+    val = val * quant_matrix[0] + *last_dc;
     val = FFMIN(val, 32767);
-    s->last_dc[component] = val;
+    *last_dc = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
             code &= 0xf;
         if (code) {
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
 
             if (i > 63) {
                 av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -748,24 +750,24 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
             block[j] = level * quant_matrix[i];
         }
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
 
-static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
-                                 int component, int dc_index,
+static int decode_dc_progressive(MJpegDecodeContext *s, GetBitContext *gb,
+                                 int16_t *block, int *last_dc, int dc_index,
                                  uint16_t *quant_matrix, int Al)
 {
     int val;
     s->bdsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = (val * (quant_matrix[0] << Al)) + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = (val * (quant_matrix[0] << Al)) + *last_dc;
+    *last_dc = val;
     block[0] = val;
     return 0;
 }
@@ -1027,7 +1029,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int nb_components, int p
 
                 PREDICT(pred, topleft[i], top[i], left[i], modified_predictor);
 
-                dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                 if(dc == 0xFFFFF)
                     return -1;
 
@@ -1139,7 +1141,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for(j=0; j<n; j++) {
                         int pred, dc;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1210,7 +1212,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1279,28 +1281,20 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
-static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
-                             int Al, const uint8_t *mb_bitmask,
-                             int mb_bitmask_size,
-                             const AVFrame *reference)
+/* decode the MCUs from start to end of a baseline or progressive DC scan */
+static int mjpeg_decode_scan_mcus(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int16_t *block, int *last_dc,
+                                  int nb_components, int Ah, int Al,
+                                  GetBitContext *mb_bitmask_gb,
+                                  const AVFrame *reference,
+                                  int start, int end, int handle_restarts)
 {
-    int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
+    int i, mcu, mb_x, mb_y, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
     uint8_t *data[MAX_COMPONENTS];
     const uint8_t *reference_data[MAX_COMPONENTS];
     int linesize[MAX_COMPONENTS];
-    GetBitContext mb_bitmask_gb = {0}; // initialize to silence gcc warning
     int bytes_per_pixel = 1 + (s->bits > 8);
 
-    if (mb_bitmask) {
-        if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
-            av_log(s->avctx, AV_LOG_ERROR, "mb_bitmask_size mismatches\n");
-            return AVERROR_INVALIDDATA;
-        }
-        init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
-    }
-
-    s->restart_count = 0;
-
     av_pix_fmt_get_chroma_sub_sample(s->avctx->pix_fmt, &chroma_h_shift,
                                      &chroma_v_shift);
     chroma_width  = AV_CEIL_RSHIFT(s->width,  chroma_h_shift);
@@ -1311,95 +1305,230 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         data[c] = s->picture_ptr->data[c];
         reference_data[c] = reference ? reference->data[c] : NULL;
         linesize[c] = s->linesize[c];
-        s->coefs_finished[c] |= 1;
     }
 
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
-            const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
+    mb_x = start % s->mb_width;
+    mb_y = start / s->mb_width;
+    for (mcu = start; mcu < end; mcu++) {
+        const int copy_mb = mb_bitmask_gb && !get_bits1(mb_bitmask_gb);
 
-            if (s->restart_interval && !s->restart_count)
-                s->restart_count = s->restart_interval;
+        if (handle_restarts && s->restart_interval && !s->restart_count)
+            s->restart_count = s->restart_interval;
+
+        if (get_bits_left(gb) < 0) {
+            av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
+                   -get_bits_left(gb));
+            return AVERROR_INVALIDDATA;
+        }
+        for (i = 0; i < nb_components; i++) {
+            uint8_t *ptr;
+            int n, h, v, x, y, c, j;
+            int block_offset;
+            n = s->nb_blocks[i];
+            c = s->comp_index[i];
+            h = s->h_scount[i];
+            v = s->v_scount[i];
+            x = 0;
+            y = 0;
+            for (j = 0; j < n; j++) {
+                block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
+                                 (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
+
+                if (s->interlaced && s->bottom_field)
+                    block_offset += linesize[c] >> 1;
+                if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? chroma_width  : s->width)
+                    && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? chroma_height : s->height)) {
+                    ptr = data[c] + block_offset;
+                } else
+                    ptr = NULL;
+                if (!s->progressive) {
+                    if (copy_mb) {
+                        if (ptr)
+                            mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
+                                            linesize[c], s->avctx->lowres);
 
-            if (get_bits_left(&s->gb) < 0) {
-                av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
-                       -get_bits_left(&s->gb));
-                return AVERROR_INVALIDDATA;
-            }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
-                                     (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? chroma_width  : s->width)
-                        && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? chroma_height : s->height)) {
-                        ptr = data[c] + block_offset;
-                    } else
-                        ptr = NULL;
-                    if (!s->progressive) {
-                        if (copy_mb) {
-                            if (ptr)
-                                mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
-                                                linesize[c], s->avctx->lowres);
-
-                        } else {
-                            s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            if (ptr) {
-                                s->idsp.idct_put(ptr, linesize[c], s->block);
-                                if (s->bits & 7)
-                                    shift_output(s, ptr, linesize[c]);
-                            }
-                        }
                     } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        int16_t *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_sindex[i]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_sindex[i]],
-                                                       Al) < 0) {
+                        s->bdsp.clear_block(block);
+                        if (decode_block(s, gb, block, &last_dc[i],
+                                         s->dc_index[i], s->ac_index[i],
+                                         s->quant_matrixes[s->quant_sindex[i]]) < 0) {
                             av_log(s->avctx, AV_LOG_ERROR,
                                    "error y=%d x=%d\n", mb_y, mb_x);
                             return AVERROR_INVALIDDATA;
                         }
+                        if (ptr) {
+                            s->idsp.idct_put(ptr, linesize[c], block);
+                            if (s->bits & 7)
+                                shift_output(s, ptr, linesize[c]);
+                        }
                     }
-                    ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
+                } else {
+                    int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                     (h * mb_x + x);
+                    int16_t *block = s->blocks[c][block_idx];
+                    if (Ah)
+                        block[0] += get_bits1(gb) *
+                                    s->quant_matrixes[s->quant_sindex[i]][0] << Al;
+                    else if (decode_dc_progressive(s, gb, block, &last_dc[i],
+                                                   s->dc_index[i],
+                                                   s->quant_matrixes[s->quant_sindex[i]],
+                                                   Al) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
                     }
                 }
+                ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+                ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                        mb_x, mb_y, x, y, c, s->bottom_field,
+                        (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+                if (++x == h) {
+                    x = 0;
+                    y++;
+                }
             }
+        }
 
+        if (handle_restarts)
             handle_rstn(s, nb_components);
+
+        if (++mb_x == s->mb_width) {
+            mb_x = 0;
+            mb_y++;
         }
     }
     return 0;
 }
 
+typedef struct ScanThreadArg {
+    int nb_components, Ah, Al;
+    int offset;         ///< byte offset of the first restart interval
+    int nb_intervals;
+    int nb_jobs;
+    int end_bits;       ///< bit position of the end of the last interval
+} ScanThreadArg;
+
+static int decode_restart_intervals(AVCodecContext *avctx, void *arg,
+                                    int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    ScanThreadArg *sa     = arg;
+    int first   = jobnr       * sa->nb_intervals / sa->nb_jobs;
+    int last    = (jobnr + 1) * sa->nb_intervals / sa->nb_jobs;
+    int nb_mcus = s->mb_width * s->mb_height;
+    int size    = s->gb.size_in_bits >> 3;
+    int i, k, ret;
+    LOCAL_ALIGNED_16(int16_t, block, [64]);
+
+    for (k = first; k < last; k++) {
+        GetBitContext gb;
+        int last_dc[MAX_COMPONENTS];
+        int start = k ? s->restart_offsets[k - 1] : sa->offset;
+        int end   = k < s->nb_restart_offsets ? s->restart_offsets[k] : size;
+
+        if ((ret = init_get_bits8(&gb, s->gb.buffer + start, end - start)) < 0)
+            return ret;
+        for (i = 0; i < sa->nb_components; i++)
+            last_dc[i] = 4 << s->bits;
+
+        ret = mjpeg_decode_scan_mcus(s, &gb, block, last_dc, sa->nb_components,
+                                     sa->Ah, sa->Al, NULL, NULL,
+                                     k * s->restart_interval,
+                                     FFMIN((k + 1) * s->restart_interval, nb_mcus), 0);
+        if (ret < 0)
+            return ret;
+        if (k == sa->nb_intervals - 1)
+            sa->end_bits = start * 8 + get_bits_count(&gb);
+    }
+    return 0;
+}
+
+/**
+ * Decode the independent restart intervals of a scan in parallel, using
+ * their positions recorded by ff_mjpeg_find_marker().
+ * @return 0 if the scan has been decoded, 1 if it has to be decoded serially
+ *         or a negative error code
+ */
+static int mjpeg_decode_scan_threaded(MJpegDecodeContext *s, int nb_components,
+                                      int Ah, int Al)
+{
+    AVCodecContext *avctx = s->avctx;
+    ScanThreadArg sa;
+    int *rets;
+    int i, nb_mcus, ret = 0;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) || avctx->thread_count <= 1 ||
+        !s->restart_interval || s->gb.buffer != s->buffer)
+        return 1;
+
+    nb_mcus         = s->mb_width * s->mb_height;
+    sa.nb_intervals = (nb_mcus + s->restart_interval - 1) / s->restart_interval;
+    /* fall back to serial decoding if restart markers are missing or
+     * spurious, some encoders also terminate the last interval with one */
+    if (sa.nb_intervals < 2 ||
+        s->nb_restart_offsets < sa.nb_intervals - 1 ||
+        s->nb_restart_offsets > sa.nb_intervals)
+        return 1;
+    sa.offset = get_bits_count(&s->gb) >> 3;
+    for (i = 0; i < s->nb_restart_offsets; i++)
+        if (s->restart_offsets[i] <= (i ? s->restart_offsets[i - 1] : sa.offset))
+            return 1;
+
+    sa.nb_components = nb_components;
+    sa.Ah            = Ah;
+    sa.Al            = Al;
+    sa.nb_jobs       = FFMIN(sa.nb_intervals, 4 * avctx->thread_count);
+    sa.end_bits      = 0;
+
+    rets = av_malloc_array(sa.nb_jobs, sizeof(*rets));
+    if (!rets)
+        return AVERROR(ENOMEM);
+    avctx->execute2(avctx, decode_restart_intervals, &sa, rets, sa.nb_jobs);
+    for (i = 0; i < sa.nb_jobs; i++)
+        if (rets[i] < 0) {
+            ret = rets[i];
+            break;
+        }
+    av_free(rets);
+
+    if (sa.end_bits > get_bits_count(&s->gb))
+        skip_bits_long(&s->gb, sa.end_bits - get_bits_count(&s->gb));
+    return ret;
+}
+
+static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
+                             int Al, const uint8_t *mb_bitmask,
+                             int mb_bitmask_size,
+                             const AVFrame *reference)
+{
+    GetBitContext mb_bitmask_gb = {0}; // initialize to silence gcc warning
+    int i, ret;
+
+    if (mb_bitmask) {
+        if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
+            av_log(s->avctx, AV_LOG_ERROR, "mb_bitmask_size mismatches\n");
+            return AVERROR_INVALIDDATA;
+        }
+        init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
+    }
+
+    s->restart_count = 0;
+
+    for (i = 0; i < nb_components; i++)
+        s->coefs_finished[s->comp_index[i]] |= 1;
+
+    if (!mb_bitmask) {
+        ret = mjpeg_decode_scan_threaded(s, nb_components, Ah, Al);
+        if (ret <= 0)
+            return ret;
+    }
+
+    return mjpeg_decode_scan_mcus(s, &s->gb, s->block, s->last_dc,
+                                  nb_components, Ah, Al,
+                                  mb_bitmask ? &mb_bitmask_gb : NULL, reference,
+                                  0, s->mb_width * s->mb_height, 1);
+}
+
 static int mjpeg_decode_scan_progressive_ac(MJpegDecodeContext *s, int ss,
                                             int se, int Ah, int Al)
 {
@@ -1995,6 +2124,8 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
             }                                         \
         } while (0)
 
+        s->nb_restart_offsets = 0;
+
         if (s->avctx->codec_id == AV_CODEC_ID_THP) {
             ptr = buf_end;
             copy_data_segment(0);
@@ -2023,6 +2154,17 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (s->avctx->active_thread_type & FF_THREAD_SLICE) {
+                        /* the marker is kept, the next interval starts after it */
+                        int *offsets = av_fast_realloc(s->restart_offsets,
+                                                       &s->restart_offsets_size,
+                                                       (s->nb_restart_offsets + 1) *
+                                                       sizeof(*s->restart_offsets));
+                        if (!offsets)
+                            return AVERROR(ENOMEM);
+                        s->restart_offsets = offsets;
+                        s->restart_offsets[s->nb_restart_offsets++] =
+                            (dst - s->buffer) + (ptr - src);
                     }
                 }
             }
@@ -2529,6 +2671,8 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
+    av_freep(&s->restart_offsets);
+    s->restart_offsets_size = 0;
 
     for (i = 0; i < 3; i++) {
         for (j = 0; j < 4; j++)
@@ -2574,7 +2718,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE |
@@ -110,6 +110,9 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_offsets;       ///< offsets of the restart intervals in the unescaped scan, slice threading only
+    unsigned int restart_offsets_size;
+    int nb_restart_offsets;
 
     int buggy_avid;
     int cs_itu601;
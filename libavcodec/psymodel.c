@@ -37,6 +37,7 @@ av_cold int ff_psy_init(FFPsyContext *ctx, AVCodecContext *avctx, int num_lens,
     ctx->avctx = avctx;
     ctx->ch        = av_mallocz_array(sizeof(ctx->ch[0]), avctx->channels * 2);
     ctx->group     = av_mallocz_array(sizeof(ctx->group[0]), num_groups);
+    ctx->num_groups = num_groups;
     ctx->bands     = av_malloc_array (sizeof(ctx->bands[0]),      num_lens);
     ctx->num_bands = av_malloc_array (sizeof(ctx->num_bands[0]),  num_lens);
     ctx->cutoff    = avctx->cutoff;
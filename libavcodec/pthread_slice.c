@@ -37,11 +37,13 @@
 
 typedef int (action_func)(AVCodecContext *c, void *arg);
 typedef int (action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr);
+typedef void (main_func)(AVCodecContext *c);
 
 typedef struct SliceThreadContext {
     pthread_t *workers;
     action_func *func;
     action_func2 *func2;
+    main_func *mainfunc;
     void *args;
     int *rets;
     int job_count;
@@ -160,6 +162,12 @@ static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, i
     c->current_execute++;
     pthread_cond_broadcast(&c->current_job_cond);
 
+    if (c->mainfunc) {
+        pthread_mutex_unlock(&c->current_job_lock);
+        c->mainfunc(avctx);
+        pthread_mutex_lock(&c->current_job_lock);
+    }
+
     thread_park_workers(c, avctx->thread_count);
 
     return 0;
@@ -169,9 +177,29 @@ static int thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg
 {
     SliceThreadContext *c = avctx->internal->thread_ctx;
     c->func2 = func2;
+    c->mainfunc = NULL;
     return thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
 
+int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx, action_func2* func2,
+                                          main_func *mainfunc, void *arg, int *ret, int job_count)
+{
+    SliceThreadContext *c = avctx->internal->thread_ctx;
+    int err;
+
+    if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1) {
+        err = avcodec_default_execute2(avctx, func2, arg, ret, job_count);
+        mainfunc(avctx);
+        return err;
+    }
+
+    c->func2 = func2;
+    c->mainfunc = mainfunc;
+    err = thread_execute(avctx, NULL, arg, ret, job_count, 0);
+    c->mainfunc = NULL;
+    return err;
+}
+
 int ff_slice_thread_init(AVCodecContext *avctx)
 {
     int i;
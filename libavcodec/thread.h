@@ -135,6 +135,16 @@ int ff_thread_ref_frame(ThreadFrame *dst, ThreadFrame *src);
 int ff_thread_init(AVCodecContext *s);
 void ff_thread_free(AVCodecContext *s);
 
+/**
+ * Execute func2 for job_count jobs on the slice threads, like
+ * AVCodecContext.execute2(), while the calling thread runs mainfunc.
+ * The call returns once both mainfunc and all the jobs have completed.
+ * Without slice threading, the jobs are run first, then mainfunc.
+ */
+int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx,
+        int (*func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr),
+        void (*mainfunc)(AVCodecContext *c), void *arg, int *ret, int job_count);
+
 int ff_alloc_entries(AVCodecContext *avctx, int count);
 void ff_reset_entries(AVCodecContext *avctx);
 void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n);
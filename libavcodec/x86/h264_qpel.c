@@ -56,21 +56,27 @@ void ff_ ## OPNAME ## _h264_qpel8_h_lowpass_ssse3(uint8_t *dst, const uint8_t *s
 void ff_ ## OPNAME ## _h264_qpel4_h_lowpass_l2_mmxext(uint8_t *dst, const uint8_t *src, const uint8_t *src2, int dstStride, int src2Stride);\
 void ff_ ## OPNAME ## _h264_qpel8_h_lowpass_l2_mmxext(uint8_t *dst, const uint8_t *src, const uint8_t *src2, int dstStride, int src2Stride);\
 void ff_ ## OPNAME ## _h264_qpel8_h_lowpass_l2_ssse3(uint8_t *dst, const uint8_t *src, const uint8_t *src2, int dstStride, int src2Stride);\
+void ff_ ## OPNAME ## _h264_qpel16_h_lowpass_avx2(uint8_t *dst, const uint8_t *src, int dstStride, int srcStride);\
+void ff_ ## OPNAME ## _h264_qpel16_h_lowpass_l2_avx2(uint8_t *dst, const uint8_t *src, const uint8_t *src2, int dstStride, int src2Stride);\
 void ff_ ## OPNAME ## _h264_qpel4_v_lowpass_mmxext(uint8_t *dst, const uint8_t *src, int dstStride, int srcStride);\
 void ff_ ## OPNAME ## _h264_qpel8or16_v_lowpass_op_mmxext(uint8_t *dst, const uint8_t *src, int dstStride, int srcStride, int h);\
 void ff_ ## OPNAME ## _h264_qpel8or16_v_lowpass_sse2(uint8_t *dst, const uint8_t *src, int dstStride, int srcStride, int h);\
+void ff_ ## OPNAME ## _h264_qpel16_v_lowpass_avx2(uint8_t *dst, const uint8_t *src, int dstStride, int srcStride);\
 void ff_ ## OPNAME ## _h264_qpel4_hv_lowpass_v_mmxext(const uint8_t *src, int16_t *tmp, int srcStride);\
 void ff_ ## OPNAME ## _h264_qpel4_hv_lowpass_h_mmxext(int16_t *tmp, uint8_t *dst, int dstStride);\
 void ff_ ## OPNAME ## _h264_qpel8or16_hv1_lowpass_op_mmxext(const uint8_t *src, int16_t *tmp, int srcStride, int size);\
 void ff_ ## OPNAME ## _h264_qpel8or16_hv1_lowpass_op_sse2(const uint8_t *src, int16_t *tmp, int srcStride, int size);\
 void ff_ ## OPNAME ## _h264_qpel8or16_hv2_lowpass_op_mmxext(uint8_t *dst, int16_t *tmp, int dstStride, int unused, int h);\
 void ff_ ## OPNAME ## _h264_qpel8or16_hv2_lowpass_ssse3(uint8_t *dst, int16_t *tmp, int dstStride, int tmpStride, int size);\
+void ff_ ## OPNAME ## _h264_qpel16_hv2_lowpass_avx2(uint8_t *dst, int16_t *tmp, int dstStride);\
 void ff_ ## OPNAME ## _pixels4_l2_shift5_mmxext(uint8_t *dst, const int16_t *src16, const uint8_t *src8, int dstStride, int src8Stride, int h);\
 void ff_ ## OPNAME ## _pixels8_l2_shift5_mmxext(uint8_t *dst, const int16_t *src16, const uint8_t *src8, int dstStride, int src8Stride, int h);
 
 DEF_QPEL(avg)
 DEF_QPEL(put)
 
+void ff_put_h264_qpel16_hv1_lowpass_avx2(const uint8_t *src, int16_t *tmp, int srcStride);
+
 static av_always_inline void ff_put_h264_qpel8or16_hv1_lowpass_mmxext(int16_t *tmp, const uint8_t *src, int tmpStride, int srcStride, int size)
 {
     int w = (size + 8) >> 2;
@@ -236,6 +242,15 @@ static av_always_inline void ff_ ## OPNAME ## h264_qpel16_hv_lowpass_ ## MMX(uin
 #define ff_put_h264_qpel8or16_hv2_lowpass_sse2 ff_put_h264_qpel8or16_hv2_lowpass_mmxext
 #define ff_avg_h264_qpel8or16_hv2_lowpass_sse2 ff_avg_h264_qpel8or16_hv2_lowpass_mmxext
 
+#define ff_put_pixels16_l2_avx2 ff_put_pixels16_l2_mmxext
+#define ff_avg_pixels16_l2_avx2 ff_avg_pixels16_l2_mmxext
+
+#define QPEL_H264_HV_AVX2(OPNAME, OP, MMX)\
+static av_always_inline void ff_ ## OPNAME ## h264_qpel16_hv_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp, const uint8_t *src, int dstStride, int tmpStride, int srcStride){\
+    ff_put_h264_qpel16_hv1_lowpass_ ## MMX(src - 2*srcStride - 2, tmp, srcStride);\
+    ff_ ## OPNAME ## h264_qpel16_hv2_lowpass_ ## MMX(dst, tmp, dstStride);\
+}\
+
 #define H264_MC(OPNAME, SIZE, MMX, ALIGN) \
 H264_MC_C(OPNAME, SIZE, MMX, ALIGN)\
 H264_MC_V(OPNAME, SIZE, MMX, ALIGN)\
@@ -386,6 +401,10 @@ QPEL(put_, 16,XMM, 16)\
 QPEL(avg_, 8, XMM, 16)\
 QPEL(avg_, 16,XMM, 16)\
 
+#define H264_MC_16(QPEL, YMM)\
+QPEL(put_, 16,YMM, 32)\
+QPEL(avg_, 16,YMM, 32)\
+
 QPEL_H264(put_,        PUT_OP, mmxext)
 QPEL_H264(avg_, AVG_MMXEXT_OP, mmxext)
 QPEL_H264_V_XMM(put_,       PUT_OP, sse2)
@@ -396,12 +415,17 @@ QPEL_H264_H_XMM(put_,       PUT_OP, ssse3)
 QPEL_H264_H_XMM(avg_,AVG_MMXEXT_OP, ssse3)
 QPEL_H264_HV_XMM(put_,       PUT_OP, ssse3)
 QPEL_H264_HV_XMM(avg_,AVG_MMXEXT_OP, ssse3)
+QPEL_H264_HV_AVX2(put_,       PUT_OP, avx2)
+QPEL_H264_HV_AVX2(avg_,AVG_MMXEXT_OP, avx2)
 
 H264_MC_4816(mmxext)
 H264_MC_816(H264_MC_V, sse2)
 H264_MC_816(H264_MC_HV, sse2)
 H264_MC_816(H264_MC_H, ssse3)
 H264_MC_816(H264_MC_HV, ssse3)
+H264_MC_16(H264_MC_V, avx2)
+H264_MC_16(H264_MC_H, avx2)
+H264_MC_16(H264_MC_HV, avx2)
 
 
 //10bit
@@ -423,6 +447,10 @@ void ff_ ## OP ## _h264_qpel ## NUM ## _ ## TYPE ## _ ## DEPTH ## _ ## OPT \
     LUMA_MC_OP(put, 16, DEPTH, TYPE, OPT) \
     LUMA_MC_OP(avg, 16, DEPTH, TYPE, OPT)
 
+#define LUMA_MC_16(DEPTH, TYPE, OPT) \
+    LUMA_MC_OP(put, 16, DEPTH, TYPE, OPT) \
+    LUMA_MC_OP(avg, 16, DEPTH, TYPE, OPT)
+
 LUMA_MC_ALL(10, mc00, mmxext)
 LUMA_MC_ALL(10, mc10, mmxext)
 LUMA_MC_ALL(10, mc20, mmxext)
@@ -463,6 +491,23 @@ LUMA_MC_816(10, mc13, sse2)
 LUMA_MC_816(10, mc23, sse2)
 LUMA_MC_816(10, mc33, sse2)
 
+LUMA_MC_16(10, mc00, avx2)
+LUMA_MC_16(10, mc10, avx2)
+LUMA_MC_16(10, mc20, avx2)
+LUMA_MC_16(10, mc30, avx2)
+LUMA_MC_16(10, mc01, avx2)
+LUMA_MC_16(10, mc11, avx2)
+LUMA_MC_16(10, mc21, avx2)
+LUMA_MC_16(10, mc31, avx2)
+LUMA_MC_16(10, mc02, avx2)
+LUMA_MC_16(10, mc12, avx2)
+LUMA_MC_16(10, mc22, avx2)
+LUMA_MC_16(10, mc32, avx2)
+LUMA_MC_16(10, mc03, avx2)
+LUMA_MC_16(10, mc13, avx2)
+LUMA_MC_16(10, mc23, avx2)
+LUMA_MC_16(10, mc33, avx2)
+
 #define QPEL16_OPMC(OP, MC, MMX)\
 void ff_ ## OP ## _h264_qpel16_ ## MC ## _10_ ## MMX(uint8_t *dst, const uint8_t *src, ptrdiff_t stride){\
     ff_ ## OP ## _h264_qpel8_ ## MC ## _10_ ## MMX(dst   , src   , stride);\
@@ -529,6 +574,12 @@ QPEL16(mmxext)
         c->avg_h264_qpel_pixels_tab[1][x + y * 4] = avg_h264_qpel8_mc  ## x ## y ## _ ## CPU; \
     } while (0)
 
+#define H264_QPEL16_FUNCS(x, y, CPU)                                                          \
+    do {                                                                                      \
+        c->put_h264_qpel_pixels_tab[0][x + y * 4] = put_h264_qpel16_mc ## x ## y ## _ ## CPU; \
+        c->avg_h264_qpel_pixels_tab[0][x + y * 4] = avg_h264_qpel16_mc ## x ## y ## _ ## CPU; \
+    } while (0)
+
 #define H264_QPEL_FUNCS_10(x, y, CPU)                                                               \
     do {                                                                                            \
         c->put_h264_qpel_pixels_tab[0][x + y * 4] = ff_put_h264_qpel16_mc ## x ## y ## _10_ ## CPU; \
@@ -630,5 +681,30 @@ av_cold void ff_h264qpel_init_x86(H264QpelContext *c, int bit_depth)
             H264_QPEL_FUNCS_10(3, 0, sse2);
         }
     }
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        if (!high_bit_depth) {
+            H264_QPEL16_FUNCS(0, 1, avx2);
+            H264_QPEL16_FUNCS(0, 2, avx2);
+            H264_QPEL16_FUNCS(0, 3, avx2);
+            H264_QPEL16_FUNCS(1, 0, avx2);
+            H264_QPEL16_FUNCS(1, 1, avx2);
+            H264_QPEL16_FUNCS(1, 2, avx2);
+            H264_QPEL16_FUNCS(1, 3, avx2);
+            H264_QPEL16_FUNCS(2, 0, avx2);
+            H264_QPEL16_FUNCS(2, 1, avx2);
+            H264_QPEL16_FUNCS(2, 2, avx2);
+            H264_QPEL16_FUNCS(2, 3, avx2);
+            H264_QPEL16_FUNCS(3, 0, avx2);
+            H264_QPEL16_FUNCS(3, 1, avx2);
+            H264_QPEL16_FUNCS(3, 2, avx2);
+            H264_QPEL16_FUNCS(3, 3, avx2);
+        }
+
+        if (bit_depth == 10) {
+            SET_QPEL_FUNCS(put_h264_qpel, 0, 16, 10_avx2, ff_);
+            SET_QPEL_FUNCS(avg_h264_qpel, 0, 16, 10_avx2, ff_);
+        }
+    }
 #endif
 }
@@ -33,16 +33,16 @@ cextern pw_16
 cextern pw_1
 cextern pb_0
 
-pad10: times 8 dw 10*1023
-pad20: times 8 dw 20*1023
-pad30: times 8 dw 30*1023
-depad: times 4 dd 32*20*1023 + 512
-depad2: times 8 dw 20*1023 + 16*1022 + 16
-unpad: times 8 dw 16*1022/32 ; needs to be mod 16
+pad10: times 16 dw 10*1023
+pad20: times 16 dw 20*1023
+pad30: times 16 dw 30*1023
+depad: times 8 dd 32*20*1023 + 512
+depad2: times 16 dw 20*1023 + 16*1022 + 16
+unpad: times 16 dw 16*1022/32 ; needs to be mod 16
 
-tap1: times 4 dw  1, -5
-tap2: times 4 dw 20, 20
-tap3: times 4 dw -5,  1
+tap1: times 8 dw  1, -5
+tap2: times 8 dw 20, 20
+tap3: times 8 dw -5,  1
 
 SECTION .text
 
@@ -101,12 +101,20 @@ INIT_MMX mmxext
 %1 put, 4
 INIT_XMM sse2
 %1 put, 8
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+%1 put, 16
+%endif
 
 %define OP_MOV AVG_MOV
 INIT_MMX mmxext
 %1 avg, 4
 INIT_XMM sse2
 %1 avg, 8
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+%1 avg, 16
+%endif
 %endmacro
 
 %macro MCAxA_OP 7
@@ -150,15 +158,16 @@ cglobal %1_h264_qpel%4_%2_10, %5,%6 + 2,%7
 %endif
 %endmacro
 
-;cpu, put/avg, mc, 4/8, ...
+;cpu, put/avg, mc, 4/8/16, ...
 %macro cglobal_mc 6
 %assign i %3*2
-%if ARCH_X86_32 || cpuflag(sse2)
+%if mmsize < 32 && (ARCH_X86_32 || cpuflag(sse2))
 MCAxA_OP %1, %2, %3, i, %4,%5,%6
 %endif
 
 cglobal %1_h264_qpel%3_%2_10, %4,%5,%6
-%if UNIX64 == 0 ; no prologue or epilogue for UNIX64
+; no prologue or epilogue for UNIX64, except for vzeroupper with ymm registers
+%if UNIX64 == 0 || mmsize == 32
     call stub_%1_h264_qpel%3_%2_10 %+ SUFFIX
     RET
 %endif
@@ -212,6 +221,19 @@ cglobal %1_h264_qpel16_mc00_10, 3,4
     dec r3d
     jg .loop
     REP_RET
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+cglobal %1_h264_qpel16_mc00_10, 3,4
+    lea  r3, [r2*3]
+%rep 3
+    COPY4
+    lea  r0, [r0+r2*4]
+    lea  r1, [r1+r2*4]
+%endrep
+    COPY4
+    RET
+%endif
 %endmacro
 
 %define OP_MOV mova
@@ -233,6 +255,10 @@ INIT_XMM ssse3, cache64
 %1 put, 8
 INIT_XMM sse2
 %1 put, 8
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+%1 put, 16
+%endif
 
 %define OP_MOV AVG_MOV
 INIT_MMX mmxext
@@ -243,6 +269,10 @@ INIT_XMM ssse3, cache64
 %1 avg, 8
 INIT_XMM sse2
 %1 avg, 8
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+%1 avg, 16
+%endif
 %endmacro
 
 %macro MC20 2
@@ -256,7 +286,7 @@ cglobal_mc %1, mc20, %2, 3,4,9
     %define p16 [pw_16]
 %endif
 .nextrow:
-%if %0 == 4
+%if %0 == 4 || mmsize == 32
     movu     m2, [r1-4]
     movu     m3, [r1-2]
     movu     m4, [r1+0]
@@ -331,7 +361,7 @@ cglobal_mc %1, mc10, %2, 3,5,9
     %define p16 [pw_16]
 %endif
 .nextrow:
-%if %0 == 4
+%if %0 == 4 || mmsize == 32
     movu     m2, [r1-4]
     movu     m3, [r1-2]
     movu     m4, [r1+0]
@@ -413,6 +443,17 @@ SWAP 0,1,2,3,4,5
 %assign i i+1
 %endrep
 
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+RESET_MM_PERMUTATION
+%assign i 0
+%rep 6
+V_FILT m0, m1, m2, m3, m4, m5, m6, m7, 16, i
+SWAP 0,1,2,3,4,5
+%assign i i+1
+%endrep
+%endif
+
 %macro MC02 2
 cglobal_mc %1, mc02, %2, 3,4,8
     PRELOAD_V
@@ -522,6 +563,17 @@ SWAP 0,1,2,3,4,5
 %assign i i+1
 %endrep
 
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+RESET_MM_PERMUTATION
+%assign i 0
+%rep 6
+H_FILT_AVG 16, i
+SWAP 0,1,2,3,4,5
+%assign i i+1
+%endrep
+%endif
+
 %macro MC11 2
 ; this REALLY needs x86_64
 cglobal_mc %1, mc11, %2, 3,6,8
@@ -608,12 +660,18 @@ MC MC33
 %endmacro
 
 %macro HV 1
-%if mmsize==16
+%if mmsize==32
+%define PAD 28
+%define COUNT 2
+%define STEP 10 ; overlap the two passes to not read past the 21 input columns
+%elif mmsize==16
 %define PAD 12
 %define COUNT 2
+%define STEP mmsize
 %else
 %define PAD 4
 %define COUNT 3
+%define STEP mmsize
 %endif
 put_hv%1_10:
     neg      r2           ; This actually saves instructions
@@ -643,9 +701,12 @@ put_hv%1_10:
     FILT_VNRD m0, m1, m2, m3, m4, m5, m6, m7
     psubw    m0, [pad20]
     movu     [r4+i*mmsize*3], m0
-    add      r4, mmsize
-    lea      r1, [r1+r2*8+mmsize]
-%if %1==8
+    add      r4, STEP
+    lea      r1, [r1+r2*8+STEP]
+%if %1==16
+    lea      r1, [r1+r2*8]
+%endif
+%if %1>=8
     lea      r1, [r1+r2*4]
 %endif
     dec      r3d
@@ -658,6 +719,10 @@ INIT_MMX mmxext
 HV 4
 INIT_XMM sse2
 HV 8
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+HV 16
+%endif
 
 %macro H_LOOP 1
 %if num_mmregs > 8
@@ -722,6 +787,10 @@ INIT_MMX mmxext
 H_LOOP 4
 INIT_XMM sse2
 H_LOOP 8
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+H_LOOP 16
+%endif
 
 %macro MC22 2
 cglobal_mc %1, mc22, %2, 3,7,12
@@ -851,6 +920,10 @@ INIT_MMX mmxext
 H_NRD 4
 INIT_XMM sse2
 H_NRD 8
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+H_NRD 16
+%endif
 
 %macro MC21 2
 cglobal_mc %1, mc21, %2, 3,7,12
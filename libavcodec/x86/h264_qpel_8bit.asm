@@ -860,3 +860,171 @@ INIT_XMM ssse3
 QPEL16_H_LOWPASS_L2_OP put
 QPEL16_H_LOWPASS_L2_OP avg
 %endif
+
+%if HAVE_AVX2_EXTERNAL
+; 16-pixel wide filters for AVX2, each row is widened to 16 words in one ymm
+; register; m6 and m7 hold pw_5 and pw_16 where used
+
+; dst, src, tmp1, tmp2
+%macro FILT_H16 4
+    pmovzxbw      %1, [%2+0]
+    pmovzxbw      %3, [%2+1]
+    pmovzxbw      %4, [%2-1]
+    paddw         %1, %3
+    pmovzxbw      %3, [%2+2]
+    paddw         %4, %3
+    psllw         %1, 2
+    psubw         %1, %4
+    pmovzxbw      %3, [%2-2]
+    pmovzxbw      %4, [%2+3]
+    pmullw        %1, m6
+    paddw         %3, %4
+    paddw         %3, m7
+    paddw         %1, %3
+    psraw         %1, 5
+%endmacro
+
+; src, srcStride
+%macro LOAD_V16 2
+    pmovzxbw      m0, [%1]
+    pmovzxbw      m1, [%1+%2]
+    lea           %1, [%1+2*%2]
+    pmovzxbw      m2, [%1]
+    pmovzxbw      m3, [%1+%2]
+    lea           %1, [%1+2*%2]
+    pmovzxbw      m4, [%1]
+    add           %1, %2
+%endmacro
+
+; src, srcStride; filters the rows in m0-m5 into m6 without the final shift
+%macro FILT_V16 2
+    pmovzxbw      m5, [%1]
+    paddw         m6, m2, m3
+    paddw         m7, m1, m4
+    psllw         m6, 2
+    psubw         m6, m7
+    pmullw        m6, [pw_5]
+    paddw         m7, m0, m5
+    paddw         m6, m7
+    paddw         m6, [pw_16]
+    add           %1, %2
+    SWAP           0, 1, 2, 3, 4, 5
+%endmacro
+
+; packs the 16 words in %1 into the bytes of its low half
+%macro PACK16 1
+    packuswb      %1, %1
+    vpermq        %1, %1, q3120
+%endmacro
+
+%macro QPEL16_H_LOWPASS_OP_AVX2 1
+cglobal %1_h264_qpel16_h_lowpass, 4,5,8 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    mova          m6, [pw_5]
+    mova          m7, [pw_16]
+    mov          r4d, 16
+.loop:
+    FILT_H16      m0, r1, m1, m2
+    PACK16        m0
+    op_%1        xm0, [r0], xm1
+    add           r0, r2
+    add           r1, r3
+    dec          r4d
+    jg         .loop
+    RET
+
+cglobal %1_h264_qpel16_h_lowpass_l2, 5,6,8 ; dst, src, src2, dstStride, src2Stride
+    movsxdifnidn  r3, r3d
+    movsxdifnidn  r4, r4d
+    mova          m6, [pw_5]
+    mova          m7, [pw_16]
+    mov          r5d, 16
+.loop:
+    FILT_H16      m0, r1, m1, m2
+    PACK16        m0
+    pavgb        xm0, [r2]
+    op_%1        xm0, [r0], xm1
+    add           r0, r3
+    add           r1, r3
+    add           r2, r4
+    dec          r5d
+    jg         .loop
+    RET
+%endmacro
+
+INIT_YMM avx2
+QPEL16_H_LOWPASS_OP_AVX2 put
+QPEL16_H_LOWPASS_OP_AVX2 avg
+
+%macro QPEL16_V_LOWPASS_OP_AVX2 1
+cglobal %1_h264_qpel16_v_lowpass, 4,4,8 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    sub           r1, r3
+    sub           r1, r3
+    LOAD_V16      r1, r3
+%rep 16
+    FILT_V16      r1, r3
+    psraw         m6, 5
+    PACK16        m6
+    op_%1        xm6, [r0], xm7
+    add           r0, r2
+%endrep
+    RET
+%endmacro
+
+INIT_YMM avx2
+QPEL16_V_LOWPASS_OP_AVX2 put
+QPEL16_V_LOWPASS_OP_AVX2 avg
+
+; src points to the top-left of the 21x21 input block, tmp has a stride of
+; 24 words like in the sse2 version, columns 0-23 are written
+cglobal put_h264_qpel16_hv1_lowpass, 3,4,8 ; src, tmp, srcStride
+    movsxdifnidn  r2, r2d
+    mov           r3, r0
+%assign j 0
+%rep 2
+    lea           r0, [r3+j*8]
+    LOAD_V16      r0, r2
+%assign i 0
+%rep 16
+    FILT_V16      r0, r2
+    movu [r1+i*48+j*16], m6
+%assign i i+1
+%endrep
+%assign j j+1
+%endrep
+    RET
+
+%macro QPEL16_HV2_LOWPASS_OP_AVX2 1
+cglobal %1_h264_qpel16_hv2_lowpass, 3,4,8 ; dst, tmp, dstStride
+    movsxdifnidn  r2, r2d
+    mov          r3d, 16
+.loop:
+    movu          m0, [r1]
+    paddw         m0, [r1+10]
+    movu          m1, [r1+2]
+    paddw         m1, [r1+8]
+    movu          m2, [r1+4]
+    paddw         m2, [r1+6]
+    psubw         m0, m1
+    psraw         m0, 2
+    psubw         m0, m1
+    paddsw        m0, m2
+    psraw         m0, 2
+    paddw         m0, m2
+    psraw         m0, 6
+    PACK16        m0
+    op_%1        xm0, [r0], xm1
+    add           r1, 48
+    add           r0, r2
+    dec          r3d
+    jg         .loop
+    RET
+%endmacro
+
+INIT_YMM avx2
+QPEL16_HV2_LOWPASS_OP_AVX2 put
+QPEL16_HV2_LOWPASS_OP_AVX2 avg
+%endif ; HAVE_AVX2_EXTERNAL
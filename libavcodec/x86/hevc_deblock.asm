@@ -28,10 +28,11 @@ SECTION_RODATA
 
 cextern pw_1023
 %define pw_pixel_max_10 pw_1023
-pw_pixel_max_12: times 8 dw ((1 << 12)-1)
+pw_pixel_max_12: times 16 dw ((1 << 12)-1)
 pw_m2:           times 8 dw -2
 pd_1 :           times 4 dd  1
 
+cextern pw_2
 cextern pw_4
 cextern pw_8
 cextern pw_m1
@@ -869,3 +870,475 @@ LOOP_FILTER_LUMA
 INIT_XMM avx
 LOOP_FILTER_LUMA
 %endif
+
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+;-----------------------------------------------------------------------------
+; The _x2 functions filter two consecutive edge segments of 8 lines. Each
+; 128-bit lane holds one segment, so each group of 4 lines, which shares its
+; filtering decisions, is one qword.
+;-----------------------------------------------------------------------------
+
+; in: tc of the 4 line groups in [tcq]
+; out: %1 with the tc of each group in all its words
+%macro LOAD_TC_X2 2 ; dst, bit depth
+    pmovzxdq         %1, [tcq]
+    pshuflw          %1, %1, 0
+    pshufhw          %1, %1, 0
+%if %2 > 8
+    psllw            %1, %2 - 8
+%endif
+%endmacro
+
+; %1: combination of lines 0 and 3 of each group in all its words
+; %2: per line values, clobbered
+%macro LINES_0_3 3 ; op, dst, src
+    pshuflw          %2, %3, q3333
+    pshufhw          %2, %2, q3333
+    pshuflw          %3, %3, 0
+    pshufhw          %3, %3, 0
+    %1               %2, %3
+%endmacro
+
+; in: p1, p0, q0, q1 in %2..%5 and tcs in [tcq]. Output in %3 and %4
+%macro CHROMA_DEBLOCK_BODY_X2 5
+    LOAD_TC_X2       m8, %1
+    psubw            m9, %4, %3; q0 - p0
+    psllw            m9, 2
+    paddw            m9, %2
+    psubw            m9, %5; ((q0 - p0) << 2) + p1 - q1
+    paddw            m9, [pw_4]
+    psraw            m9, 3
+    pxor            m10, m10
+    psubw           m10, m8
+    pminsw           m9, m8
+    pmaxsw           m9, m10; av_clip(delta0, -tc, tc)
+    paddw            %3, m9; p0 + delta0
+    psubw            %4, m9; q0 - delta0
+%endmacro
+
+; the new value of %1 computed in %2, clipped to %1 +- 2 * tc (m15, m14)
+%macro STRONG_CLIP 2
+    psubw            %2, %1
+    pmaxsw           %2, m14
+    pminsw           %2, m15
+    paddw            %2, %1
+%endmacro
+
+; input in m0 ... m7, betas in [betaq] tcs in [tcq]. Output in m1...m6
+; All decisions are vector masks, which keeps the two lanes independent.
+%macro LUMA_DEBLOCK_BODY_X2 1
+    vpbroadcastw    xm14, [betaq]
+    vpbroadcastw    xm15, [betaq + 4]
+    vinserti128     m14, m14, xm15, 1
+%if %1 > 8
+    psllw           m14, %1 - 8
+%endif
+    LOAD_TC_X2      m15, %1
+
+    paddw            m8, m1, m3
+    psubw            m8, m2
+    psubw            m8, m2
+    pabsw            m8, m8; dp
+    paddw            m9, m4, m6
+    psubw            m9, m5
+    psubw            m9, m5
+    pabsw            m9, m9; dq
+    paddw           m12, m8, m9; d
+
+    ; weak filter nd_p/q masks
+    psraw           m10, m14, 1
+    paddw           m10, m14
+    psraw           m10, 3; (beta + (beta >> 1)) >> 3
+    LINES_0_3     paddw, m11, m8
+    pcmpgtw         m11, m10, m11; dp0 + dp3 < ..., nd_p mask
+    LINES_0_3     paddw, m8, m9
+    pcmpgtw         m10, m8; dq0 + dq3 < ..., nd_q mask
+
+    ; filtering mask and (d0 << 1) < beta_2, (d3 << 1) < beta_2
+    pshuflw          m8, m12, q3333
+    pshufhw          m8, m8, q3333
+    pshuflw         m12, m12, 0
+    pshufhw         m12, m12, 0
+    paddw            m9, m8, m12
+    pcmpgtw          m9, m14, m9; d0 + d3 < beta
+    pmaxsw           m8, m12
+    paddw            m8, m8
+    psraw           m12, m14, 2
+    pcmpgtw         m12, m8
+
+    ; abs(p3 - p0) + abs(q3 - q0) < beta_3
+    psubw            m8, m0, m3
+    pabsw            m8, m8
+    psubw           m13, m7, m4
+    pabsw           m13, m13
+    paddw            m8, m13
+    LINES_0_3    pmaxsw, m13, m8
+    psraw           m14, 3
+    pcmpgtw         m14, m13
+    pand            m12, m14
+
+    ; abs(p0 - q0) < tc25
+    psubw            m8, m3, m4
+    pabsw            m8, m8
+    LINES_0_3    pmaxsw, m13, m8
+    psllw           m14, m15, 2
+    pavgw           m14, m15; tc25 = ((tc * 5 + 1) >> 1)
+    pcmpgtw         m14, m13
+    pand            m12, m14
+    pand            m12, m9; strong mask
+    ptest            m9, m9
+    jz .bypassluma
+    pandn            m9, m12, m9; weak mask
+    ptest            m9, m9
+    jz .strongfilter
+
+    ; delta0 = (9 * (q0 - p0) - 3 * (q1 - p1) + 8) >> 4, computed as
+    ; (4 * (q0 - p0) + ((q0 - p0 - 3 * (q1 - p1)) >> 1) + 4) >> 3
+    ; so that it does not overflow at 12 bits
+    psubw            m8, m4, m3; q0 - p0
+    psubw           m13, m5, m2; q1 - p1
+    psubw           m14, m8, m13
+    psubw           m14, m13
+    psubw           m14, m13
+    psraw           m14, 1
+    psllw            m8, 2
+    paddw            m8, m14
+    paddw            m8, [pw_4]
+    psraw            m8, 3; delta0
+    pabsw           m13, m8
+    psllw           m14, m15, 3
+    paddw           m14, m15
+    paddw           m14, m15; 10 * tc
+    pcmpgtw         m14, m13
+    pand             m9, m14; abs(delta0) < 10 * tc
+    pand            m10, m9
+    pand            m11, m9
+    pxor            m13, m13
+    psubw           m13, m15
+    pminsw           m8, m15
+    pmaxsw           m8, m13; av_clip(delta0, -tc, tc)
+    psraw           m15, 1; tc_2
+    pxor            m13, m13
+    psubw           m13, m15; -tc_2
+
+    pavgw           m14, m1, m3; (p2 + p0 + 1) >> 1
+    psubw           m14, m2
+    paddw           m14, m8
+    psraw           m14, 1
+    pminsw          m14, m15
+    pmaxsw          m14, m13; av_clip(deltap1, -tc_2, tc_2)
+    paddw           m14, m2
+    vpblendvb        m2, m2, m14, m11; p1'
+
+    pavgw           m14, m6, m4; (q2 + q0 + 1) >> 1
+    psubw           m14, m5
+    psubw           m14, m8
+    psraw           m14, 1
+    pminsw          m14, m15
+    pmaxsw          m14, m13; av_clip(deltaq1, -tc_2, tc_2)
+    paddw           m14, m5
+    vpblendvb        m5, m5, m14, m10; q1'
+
+    paddw           m14, m3, m8
+    vpblendvb        m3, m3, m14, m9; p0'
+    psubw           m14, m4, m8
+    vpblendvb        m4, m4, m14, m9; q0'
+
+.strongfilter:
+    ptest           m12, m12
+    jz .store
+    LOAD_TC_X2      m15, %1
+    paddw           m15, m15; 2 * tc
+    pxor            m14, m14
+    psubw           m14, m15; -2 * tc
+
+    paddw            m8, m2, m3
+    paddw            m8, m4; p1 + p0 + q0
+    paddw            m9, m8, m1; p2 + p1 + p0 + q0
+    paddw           m10, m8, m8
+    paddw           m10, m1
+    paddw           m10, m5
+    paddw           m10, [pw_4]
+    psraw           m10, 3; (p2 + 2*p1 + 2*p0 + 2*q0 + q1 + 4) >> 3
+    STRONG_CLIP      m3, m10; p0'
+    paddw            m9, [pw_2]
+    psraw            m9, 2; (p2 + p1 + p0 + q0 + 2) >> 2
+    STRONG_CLIP      m2, m9; p1'
+    paddw           m11, m0, m1
+    paddw           m11, m11
+    paddw           m11, m1
+    paddw           m11, m8
+    paddw           m11, [pw_4]
+    psraw           m11, 3; (2*p3 + 3*p2 + p1 + p0 + q0 + 4) >> 3
+    STRONG_CLIP      m1, m11; p2'
+    vpblendvb        m1, m1, m11, m12
+
+    paddw            m8, m3, m4
+    paddw            m8, m5; p0 + q0 + q1
+    paddw           m11, m8, m8
+    paddw           m11, m2
+    paddw           m11, m6
+    paddw           m11, [pw_4]
+    psraw           m11, 3; (p1 + 2*p0 + 2*q0 + 2*q1 + q2 + 4) >> 3
+    STRONG_CLIP      m4, m11; q0'
+    vpblendvb        m2, m2, m9, m12
+    paddw            m9, m8, m6
+    paddw            m9, [pw_2]
+    psraw            m9, 2; (p0 + q0 + q1 + q2 + 2) >> 2
+    STRONG_CLIP      m5, m9; q1'
+    paddw           m13, m7, m6
+    paddw           m13, m13
+    paddw           m13, m6
+    paddw           m13, m8
+    paddw           m13, [pw_4]
+    psraw           m13, 3; (2*q3 + 3*q2 + q1 + q0 + p0 + 4) >> 3
+    STRONG_CLIP      m6, m13; q2'
+    vpblendvb        m3, m3, m10, m12
+    vpblendvb        m4, m4, m11, m12
+    vpblendvb        m5, m5, m9, m12
+    vpblendvb        m6, m6, m13, m12
+%endmacro
+
+; 8 rows of 8 pixels across both edges, from pixq - 4 pixels, transposed to
+; the columns p3 ... q3 in m0 ... m7
+%macro LOAD_V_X2 1
+    sub            pixq, 4 * ((%1 + 7) / 8)
+    lea     src3strideq, [3 * strideq]
+    mov           pix0q, pixq
+    add            pixq, src3strideq
+%if %1 == 8
+    pmovzxbw         m0, [pix0q]
+    pmovzxbw         m1, [pix0q +     strideq]
+    pmovzxbw         m2, [pix0q + 2 * strideq]
+    pmovzxbw         m3, [pixq]
+    pmovzxbw         m4, [pixq  +     strideq]
+    pmovzxbw         m5, [pixq  + 2 * strideq]
+    pmovzxbw         m6, [pixq  + src3strideq]
+    pmovzxbw         m7, [pixq  + 4 * strideq]
+%else
+    movu             m0, [pix0q]
+    movu             m1, [pix0q +     strideq]
+    movu             m2, [pix0q + 2 * strideq]
+    movu             m3, [pixq]
+    movu             m4, [pixq  +     strideq]
+    movu             m5, [pixq  + 2 * strideq]
+    movu             m6, [pixq  + src3strideq]
+    movu             m7, [pixq  + 4 * strideq]
+%endif
+    TRANSPOSE8x8W     0, 1, 2, 3, 4, 5, 6, 7, 8
+%endmacro
+
+; 8 rows of p3 ... q3 of both edges, from rows in m0 ... m7
+%macro STORE_V_X2 1
+%if %1 == 8
+    packuswb         m0, m1
+    packuswb         m2, m3
+    packuswb         m4, m5
+    packuswb         m6, m7
+    vpermq           m0, m0, q3120
+    vpermq           m2, m2, q3120
+    vpermq           m4, m4, q3120
+    vpermq           m6, m6, q3120
+    movu                      [pix0q], xm0
+    vextracti128 [pix0q +     strideq], m0, 1
+    movu         [pix0q + 2 * strideq], xm2
+    vextracti128              [pixq ], m2, 1
+    movu         [pixq  +     strideq], xm4
+    vextracti128 [pixq  + 2 * strideq], m4, 1
+    movu         [pixq  + src3strideq], xm6
+    vextracti128 [pixq  + 4 * strideq], m6, 1
+%else
+    movu                      [pix0q], m0
+    movu         [pix0q +     strideq], m1
+    movu         [pix0q + 2 * strideq], m2
+    movu                       [pixq], m3
+    movu         [pixq  +     strideq], m4
+    movu         [pixq  + 2 * strideq], m5
+    movu         [pixq  + src3strideq], m6
+    movu         [pixq  + 4 * strideq], m7
+%endif
+%endmacro
+
+; p1 ... q1 of both edges from the rows of p3 ... q3 in m%2. At 8 bits
+; each lane holds two rows, %3 is the address of the first
+%macro STORE_V_CHROMA_ROW 3 ; bit depth, src, row address
+%if %1 == 8
+    psrldq          m%2, 2
+    movd     [%3 + 2], xm%2
+    pextrd   [%3 + strideq + 2], xm%2, 2
+    vextracti128   xm8, m%2, 1
+    movd    [%3 + 10], xm8
+    pextrd  [%3 + strideq + 10], xm8, 2
+%else
+    psrldq          m%2, 4
+    movq     [%3 + 4], xm%2
+    vextracti128   xm8, m%2, 1
+    movq    [%3 + 20], xm8
+%endif
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_hevc_v_loop_filter_chroma_x2(uint8_t *_pix, ptrdiff_t _stride, int32_t *tc,
+;                                      uint8_t *_no_p, uint8_t *_no_q);
+;-----------------------------------------------------------------------------
+%macro LOOP_FILTER_CHROMA_X2 1
+cglobal hevc_v_loop_filter_chroma_x2_%1, 3, 5, 11, pix, stride, tc, pix0, src3stride
+    LOAD_V_X2        %1
+    CHROMA_DEBLOCK_BODY_X2 %1, m2, m3, m4, m5
+%if %1 == 8
+    TRANSPOSE8x8W     0, 1, 2, 3, 4, 5, 6, 7, 8
+    packuswb         m0, m1
+    packuswb         m2, m3
+    packuswb         m4, m5
+    packuswb         m6, m7
+    STORE_V_CHROMA_ROW %1, 0, pix0q
+    lea           pix0q, [pix0q + 2 * strideq]
+    STORE_V_CHROMA_ROW %1, 2, pix0q
+    lea           pix0q, [pixq + strideq]
+    STORE_V_CHROMA_ROW %1, 4, pix0q
+    lea           pix0q, [pixq + src3strideq]
+    STORE_V_CHROMA_ROW %1, 6, pix0q
+%else
+    pxor             m8, m8
+    CLIPW            m3, m8, [pw_pixel_max_%1]
+    CLIPW            m4, m8, [pw_pixel_max_%1]
+    TRANSPOSE8x8W     0, 1, 2, 3, 4, 5, 6, 7, 8
+    STORE_V_CHROMA_ROW %1, 0, pix0q
+    STORE_V_CHROMA_ROW %1, 1, pix0q + strideq
+    STORE_V_CHROMA_ROW %1, 2, pix0q + 2 * strideq
+    STORE_V_CHROMA_ROW %1, 3, pixq
+    STORE_V_CHROMA_ROW %1, 4, pixq + strideq
+    STORE_V_CHROMA_ROW %1, 5, pixq + 2 * strideq
+    STORE_V_CHROMA_ROW %1, 6, pixq + src3strideq
+    STORE_V_CHROMA_ROW %1, 7, pixq + 4 * strideq
+%endif
+    RET
+
+;-----------------------------------------------------------------------------
+; void ff_hevc_h_loop_filter_chroma_x2(uint8_t *_pix, ptrdiff_t _stride, int32_t *tc,
+;                                      uint8_t *_no_p, uint8_t *_no_q);
+;-----------------------------------------------------------------------------
+cglobal hevc_h_loop_filter_chroma_x2_%1, 3, 4, 11, pix, stride, tc, pix0
+    mov           pix0q, pixq
+    sub           pix0q, strideq
+    sub           pix0q, strideq
+%if %1 == 8
+    pmovzxbw         m0, [pix0q];    p1
+    pmovzxbw         m1, [pix0q+strideq]; p0
+    pmovzxbw         m2, [pixq];    q0
+    pmovzxbw         m3, [pixq+strideq]; q1
+%else
+    movu             m0, [pix0q];    p1
+    movu             m1, [pix0q+strideq]; p0
+    movu             m2, [pixq];    q0
+    movu             m3, [pixq+strideq]; q1
+%endif
+    CHROMA_DEBLOCK_BODY_X2 %1, m0, m1, m2, m3
+%if %1 == 8
+    packuswb         m1, m2
+    vpermq           m1, m1, q3120
+    movu [pix0q+strideq], xm1
+    vextracti128 [pixq], m1, 1
+%else
+    pxor             m5, m5
+    CLIPW            m1, m5, [pw_pixel_max_%1]
+    CLIPW            m2, m5, [pw_pixel_max_%1]
+    movu [pix0q+strideq], m1
+    movu         [pixq], m2
+%endif
+    RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_hevc_v_loop_filter_luma_x2(uint8_t *_pix, ptrdiff_t _stride, int *beta,
+;                                    int32_t *tc, uint8_t *_no_p, uint8_t *_no_q);
+;-----------------------------------------------------------------------------
+%macro LOOP_FILTER_LUMA_X2 1
+cglobal hevc_v_loop_filter_luma_x2_%1, 4, 6, 16, pix, stride, beta, tc, pix0, src3stride
+    LOAD_V_X2        %1
+    LUMA_DEBLOCK_BODY_X2 %1
+.store:
+%if %1 > 8
+    pxor             m8, m8
+    CLIPW            m1, m8, [pw_pixel_max_%1]
+    CLIPW            m2, m8, [pw_pixel_max_%1]
+    CLIPW            m3, m8, [pw_pixel_max_%1]
+    CLIPW            m4, m8, [pw_pixel_max_%1]
+    CLIPW            m5, m8, [pw_pixel_max_%1]
+    CLIPW            m6, m8, [pw_pixel_max_%1]
+%endif
+    TRANSPOSE8x8W     0, 1, 2, 3, 4, 5, 6, 7, 8
+    STORE_V_X2       %1
+.bypassluma:
+    RET
+
+;-----------------------------------------------------------------------------
+; void ff_hevc_h_loop_filter_luma_x2(uint8_t *_pix, ptrdiff_t _stride, int *beta,
+;                                    int32_t *tc, uint8_t *_no_p, uint8_t *_no_q);
+;-----------------------------------------------------------------------------
+cglobal hevc_h_loop_filter_luma_x2_%1, 4, 6, 16, pix, stride, beta, tc, pix0, src3stride
+    lea     src3strideq, [3 * strideq]
+    mov           pix0q, pixq
+    sub           pix0q, src3strideq
+    sub           pix0q, strideq
+%if %1 == 8
+    pmovzxbw         m0, [pix0q];               p3
+    pmovzxbw         m1, [pix0q +     strideq]; p2
+    pmovzxbw         m2, [pix0q + 2 * strideq]; p1
+    pmovzxbw         m3, [pix0q + src3strideq]; p0
+    pmovzxbw         m4, [pixq];                q0
+    pmovzxbw         m5, [pixq  +     strideq]; q1
+    pmovzxbw         m6, [pixq  + 2 * strideq]; q2
+    pmovzxbw         m7, [pixq  + src3strideq]; q3
+%else
+    movu             m0, [pix0q];               p3
+    movu             m1, [pix0q +     strideq]; p2
+    movu             m2, [pix0q + 2 * strideq]; p1
+    movu             m3, [pix0q + src3strideq]; p0
+    movu             m4, [pixq];                q0
+    movu             m5, [pixq  +     strideq]; q1
+    movu             m6, [pixq  + 2 * strideq]; q2
+    movu             m7, [pixq  + src3strideq]; q3
+%endif
+    LUMA_DEBLOCK_BODY_X2 %1
+.store:
+%if %1 == 8
+    packuswb         m1, m2
+    packuswb         m3, m4
+    packuswb         m5, m6
+    vpermq           m1, m1, q3120
+    vpermq           m3, m3, q3120
+    vpermq           m5, m5, q3120
+    movu         [pix0q +     strideq], xm1
+    vextracti128 [pix0q + 2 * strideq], m1, 1
+    movu         [pix0q + src3strideq], xm3
+    vextracti128              [pixq ], m3, 1
+    movu         [pixq  +     strideq], xm5
+    vextracti128 [pixq  + 2 * strideq], m5, 1
+%else
+    pxor             m8, m8
+    CLIPW            m1, m8, [pw_pixel_max_%1]
+    CLIPW            m2, m8, [pw_pixel_max_%1]
+    CLIPW            m3, m8, [pw_pixel_max_%1]
+    CLIPW            m4, m8, [pw_pixel_max_%1]
+    CLIPW            m5, m8, [pw_pixel_max_%1]
+    CLIPW            m6, m8, [pw_pixel_max_%1]
+    movu         [pix0q +     strideq], m1
+    movu         [pix0q + 2 * strideq], m2
+    movu         [pix0q + src3strideq], m3
+    movu                       [pixq], m4
+    movu         [pixq  +     strideq], m5
+    movu         [pixq  + 2 * strideq], m6
+%endif
+.bypassluma:
+    RET
+%endmacro
+
+INIT_YMM avx2
+LOOP_FILTER_CHROMA_X2  8
+LOOP_FILTER_CHROMA_X2 10
+LOOP_FILTER_CHROMA_X2 12
+LOOP_FILTER_LUMA_X2    8
+LOOP_FILTER_LUMA_X2   10
+LOOP_FILTER_LUMA_X2   12
+%endif
@@ -0,0 +1,818 @@
+;******************************************************************************
+;* SIMD optimized HEVC intra prediction
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pw_1to32:  dw  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16
+           dw 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32
+pw_31to0:  dw 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16
+           dw 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0
+pd_1to32:  dd  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16
+           dd 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32
+pd_31to0:  dd 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16
+           dd 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0
+
+pb_transpose_4x4: db 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15
+
+; intra_pred_angle indexed by mode, inv_angle indexed by mode - 11
+intra_pred_angle: db   0,   0,  32,  26,  21,  17,  13,   9,   5,   2,   0,  -2
+                  db  -5,  -9, -13, -17, -21, -26, -32, -26, -21, -17, -13,  -9
+                  db  -5,  -2,   0,   2,   5,   9,  13,  17,  21,  26,  32
+inv_angle: dw -4096, -1638, -910, -630, -482, -390, -315, -256
+           dw  -315,  -390, -482, -630, -910, -1638, -4096
+
+cextern pw_1
+cextern pw_1023
+cextern pw_1024
+cextern pw_4095
+
+SECTION .text
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+
+; The planar prediction is computed one row at a time as
+; (acc + (size - 1 - x) * left[y]) >> (log2_size + 1), with acc starting at
+; (x + 1) * top[size] + (size - 1) * top[x] + left[size] + size and
+; incremented by left[size] - top[x] for each row. 8-bit pixels are
+; processed as words, 10/12-bit ones as dwords.
+
+; %1-%3: accumulator, increment and weight registers, %4: register index,
+; %5: log2_size, %6: bit_depth
+%macro PLANAR_INIT 6
+%if %6 == 8
+    pmovzxbw       m%2, [topq+%4*mmsize/2]
+    pmullw         m%1, m12, [pw_1to32+%4*mmsize]
+    psllw          m15, m%2, %5
+    psubw          m15, m%2
+    paddw          m%1, m15
+    paddw          m%1, m14
+    psubw          m%2, m13, m%2
+    movu           m%3, [pw_31to0+(32-(1<<%5))*2+%4*mmsize]
+%else
+    pmovzxwd       m%2, [topq+%4*mmsize/2]
+    pmulld         m%1, m12, [pd_1to32+%4*mmsize]
+    pslld          m15, m%2, %5
+    psubd          m15, m%2
+    paddd          m%1, m15
+    paddd          m%1, m14
+    psubd          m%2, m13, m%2
+    movu           m%3, [pd_31to0+(32-(1<<%5))*4+%4*mmsize]
+%endif
+%endmacro
+
+; %1: destination, %2-%4: accumulator, increment and weight registers,
+; %5: log2_size, %6: bit_depth, m12: left[y]
+%macro PLANAR_ROW 6
+%if %6 == 8
+    pmullw         m%1, m%4, m12
+    paddw          m%1, m%2
+    psrlw          m%1, %5+1
+    paddw          m%2, m%3
+%else
+    pmaddwd        m%1, m%4, m12
+    paddd          m%1, m%2
+    psrld          m%1, %5+1
+    paddd          m%2, m%3
+%endif
+%endmacro
+
+; void ff_hevc_pred_planar_NxN(uint8_t *src, const uint8_t *top,
+;                              const uint8_t *left, ptrdiff_t stride)
+%macro PRED_PLANAR 3 ; size, log2_size, bit_depth
+%if %3 == 8
+    %assign %%nregs (%1 * 2 + mmsize - 1) / mmsize
+%else
+    %assign %%nregs (%1 * 4 + mmsize - 1) / mmsize
+%endif
+cglobal hevc_pred_planar_%1x%1_%3, 4, 5, 16, src, top, left, stride, cnt
+%if %3 == 8
+    movzx          cntd, byte [topq+%1]
+    movd           xm12, cntd
+    movzx          cntd, byte [leftq+%1]
+    movd           xm13, cntd
+    add            cntd, %1
+    movd           xm14, cntd
+    vpbroadcastw    m12, xm12                   ; top[size]
+    vpbroadcastw    m13, xm13                   ; left[size]
+    vpbroadcastw    m14, xm14                   ; left[size] + size
+%else
+    add         strideq, strideq
+    movzx          cntd, word [topq+%1*2]
+    movd           xm12, cntd
+    movzx          cntd, word [leftq+%1*2]
+    movd           xm13, cntd
+    add            cntd, %1
+    movd           xm14, cntd
+    vpbroadcastd    m12, xm12
+    vpbroadcastd    m13, xm13
+    vpbroadcastd    m14, xm14
+%endif
+    PLANAR_INIT      0, 4,  8, 0, %2, %3
+%if %%nregs > 1
+    PLANAR_INIT      1, 5,  9, 1, %2, %3
+%endif
+%if %%nregs > 2
+    PLANAR_INIT      2, 6, 10, 2, %2, %3
+    PLANAR_INIT      3, 7, 11, 3, %2, %3
+%endif
+    mov            cntd, %1
+.loop:
+%if %3 == 8
+    pmovzxbw       xm12, [leftq]
+    vpbroadcastw    m12, xm12
+%else
+    vpbroadcastw    m12, [leftq]
+%endif
+    PLANAR_ROW      13, 0, 4,  8, %2, %3
+%if %%nregs > 1
+    PLANAR_ROW      14, 1, 5,  9, %2, %3
+%endif
+%if %3 == 8
+%if %1 == 4
+    packuswb        m13, m13
+    movd         [srcq], m13
+%elif %1 == 8
+    packuswb        m13, m13
+    movq         [srcq], m13
+%elif %1 == 16
+    packuswb        m13, m13
+    vpermq          m13, m13, q3120
+    movu         [srcq], xm13
+%else
+    packuswb        m13, m14
+    vpermq          m13, m13, q3120
+    movu         [srcq], m13
+%endif
+%else ; %3 > 8
+%if %1 == 4
+    packusdw        m13, m13
+    movq         [srcq], m13
+%elif %1 == 8
+    packusdw        m13, m13
+    vpermq          m13, m13, q3120
+    movu         [srcq], xm13
+%else
+    packusdw        m13, m14
+    vpermq          m13, m13, q3120
+    movu         [srcq], m13
+%if %1 == 32
+    PLANAR_ROW      13, 2, 6, 10, %2, %3
+    PLANAR_ROW      14, 3, 7, 11, %2, %3
+    packusdw        m13, m14
+    vpermq          m13, m13, q3120
+    movu      [srcq+32], m13
+%endif
+%endif
+%endif
+    add            srcq, strideq
+    add           leftq, (%3 + 7) / 8
+    dec            cntd
+    jg .loop
+    RET
+%endmacro
+
+INIT_XMM avx2
+PRED_PLANAR  4, 2, 8
+PRED_PLANAR  8, 3, 8
+PRED_PLANAR  4, 2, 16
+INIT_YMM avx2
+PRED_PLANAR 16, 4, 8
+PRED_PLANAR 32, 5, 8
+PRED_PLANAR  8, 3, 16
+PRED_PLANAR 16, 4, 16
+PRED_PLANAR 32, 5, 16
+
+; sum top[0..size-1] and left[0..size-1] and store the dc value in dcd
+%macro DC_SUM 3 ; size, log2_size, bit_depth
+%if %3 == 8
+%if %1 == 4
+    movd            xm0, [topq]
+    movd            xm1, [leftq]
+    punpckldq       xm0, xm1
+%elif %1 == 8
+    movq            xm0, [topq]
+    movhps          xm0, [leftq]
+%elif %1 == 16
+    movu            xm0, [topq]
+    movu            xm1, [leftq]
+%else
+    movu             m0, [topq]
+    movu             m1, [leftq]
+%endif
+    pxor             m2, m2
+%if %1 == 32
+    psadbw           m0, m2
+    psadbw           m1, m2
+    paddw            m0, m1
+    vextracti128    xm1, m0, 1
+    paddw           xm0, xm1
+%else
+    psadbw          xm0, xm2
+%if %1 == 16
+    psadbw          xm1, xm2
+    paddw           xm0, xm1
+%endif
+%endif
+%if %1 > 4
+    movhlps         xm1, xm0
+    paddw           xm0, xm1
+%endif
+%else ; %3 > 8
+%if %1 == 4
+    movq            xm0, [topq]
+    movhps          xm0, [leftq]
+%elif %1 == 8
+    movu            xm0, [topq]
+    paddw           xm0, [leftq]
+%elif %1 == 16
+    movu             m0, [topq]
+    paddw            m0, [leftq]
+%else
+    movu             m0, [topq]
+    paddw            m0, [topq+32]
+    paddw            m0, [leftq]
+    paddw            m0, [leftq+32]
+%endif
+%if %1 >= 16
+    pmaddwd          m0, [pw_1]
+    vextracti128    xm1, m0, 1
+    paddd           xm0, xm1
+%else
+    pmaddwd         xm0, [pw_1]
+%endif
+    movhlps         xm1, xm0
+    paddd           xm0, xm1
+    pshuflw         xm1, xm0, q1032
+    paddd           xm0, xm1
+%endif
+    movd            dcd, xm0
+    add             dcd, %1
+    shr             dcd, %2+1
+%endmacro
+
+%macro DC_FILL 2 ; size, bit_depth
+    movd            xm0, dcd
+%if %2 == 8
+    vpbroadcastb     m0, xm0
+%else
+    vpbroadcastw     m0, xm0
+%endif
+    mov            tmpq, srcq
+    mov            cntd, %1
+.fill%1:
+%if %1 * %2 == 32
+    movd         [tmpq], xm0
+%elif %1 * %2 == 64
+    movq         [tmpq], xm0
+%elif %1 * %2 == 128
+    movu         [tmpq], xm0
+%else
+    movu         [tmpq], m0
+%if %1 * %2 == 512
+    movu      [tmpq+32], m0
+%endif
+%endif
+    add            tmpq, strideq
+    dec            cntd
+    jg .fill%1
+%endmacro
+
+; luma blocks smaller than 32x32 get their first row and column filtered:
+; (top[x] + 3 * dc + 2) >> 2, (left[y] + 3 * dc + 2) >> 2 and
+; (left[0] + 2 * dc + top[0] + 2) >> 2 for the top-left pixel
+%macro DC_FILTER 2 ; size, bit_depth
+    test         c_idxd, c_idxd
+    jnz .end
+    lea            tmpd, [dcq*3+2]
+    movd            xm1, tmpd
+    vpbroadcastw     m1, xm1
+%if %2 == 8
+%if %1 == 16
+    pmovzxbw         m2, [topq]
+    pmovzxbw         m3, [leftq]
+    paddw            m2, m1
+    paddw            m3, m1
+    psrlw            m2, 2
+    psrlw            m3, 2
+    packuswb         m2, m3
+    vpermq           m2, m2, q3120
+    movu         [srcq], xm2
+    vextracti128    xm3, m2, 1
+%else
+    pmovzxbw        xm2, [topq]
+    pmovzxbw        xm3, [leftq]
+    paddw           xm2, xm1
+    paddw           xm3, xm1
+    psrlw           xm2, 2
+    psrlw           xm3, 2
+    packuswb        xm2, xm3
+%if %1 == 4
+    movd         [srcq], xm2
+%else
+    movq         [srcq], xm2
+%endif
+%endif
+%else ; %2 > 8
+%if %1 == 4
+    movq            xm2, [topq]
+    movq            xm3, [leftq]
+%elif %1 == 8
+    movu            xm2, [topq]
+    movu            xm3, [leftq]
+%else
+    movu             m2, [topq]
+    movu             m3, [leftq]
+%endif
+    paddw            m2, m1
+    paddw            m3, m1
+    psrlw            m2, 2
+    psrlw            m3, 2
+%if %1 == 4
+    movq         [srcq], xm2
+%elif %1 == 8
+    movu         [srcq], xm2
+%else
+    movu         [srcq], m2
+    vextracti128    xm2, m3, 1
+%endif
+%endif
+    mov            tmpq, srcq
+%assign %%y 1
+%rep %1 - 1
+    add            tmpq, strideq
+%if %2 == 8
+%if %1 == 16
+    pextrb       [tmpq], xm3, %%y
+%else
+    pextrb       [tmpq], xm2, %%y + 8
+%endif
+%else
+%if %%y < 8
+    pextrw       [tmpq], xm3, %%y
+%else
+    pextrw       [tmpq], xm2, %%y - 8
+%endif
+%endif
+%assign %%y %%y + 1
+%endrep
+%if %2 == 8
+    movzx          tmpd, byte [topq]
+    movzx          cntd, byte [leftq]
+%else
+    movzx          tmpd, word [topq]
+    movzx          cntd, word [leftq]
+%endif
+    add            tmpd, cntd
+    lea            tmpd, [tmpq+dcq*2+2]
+    shr            tmpd, 2
+%if %2 == 8
+    mov          [srcq], tmpb
+%else
+    mov          [srcq], tmpw
+%endif
+%endmacro
+
+%macro PRED_DC_SIZE 3 ; size, log2_size, bit_depth
+    DC_SUM          %1, %2, %3
+    DC_FILL         %1, %3
+%if %1 < 32
+    DC_FILTER       %1, %3
+%endif
+%endmacro
+
+; void ff_hevc_pred_dc(uint8_t *src, const uint8_t *top, const uint8_t *left,
+;                      ptrdiff_t stride, int log2_size, int c_idx)
+%macro PRED_DC 1 ; bit_depth
+cglobal hevc_pred_dc_%1, 6, 9, 4, src, top, left, stride, log2_size, c_idx, dc, tmp, cnt
+%if %1 > 8
+    add         strideq, strideq
+%endif
+    cmp      log2_sized, 3
+    jl .size4
+    je .size8
+    cmp      log2_sized, 4
+    je .size16
+    PRED_DC_SIZE    32, 5, %1
+    RET
+.size16:
+    PRED_DC_SIZE    16, 4, %1
+    RET
+.size8:
+    PRED_DC_SIZE     8, 3, %1
+    RET
+.size4:
+    PRED_DC_SIZE     4, 2, %1
+.end:
+    RET
+%endmacro
+
+INIT_YMM avx2
+PRED_DC 8
+PRED_DC 16
+
+; transpose an 8x8 block of pixels from %1 (row stride %2) to %3 (row
+; stride %4, %5 = 3 * %4), %6: temporary register
+%macro TRANSPOSE_8x8B 6
+    movq            xm0, [%1+0*%2]
+    movq            xm1, [%1+1*%2]
+    movq            xm2, [%1+2*%2]
+    movq            xm3, [%1+3*%2]
+    movq            xm4, [%1+4*%2]
+    movq            xm5, [%1+5*%2]
+    movq            xm6, [%1+6*%2]
+    movq            xm7, [%1+7*%2]
+    punpcklbw       xm0, xm1
+    punpcklbw       xm2, xm3
+    punpcklbw       xm4, xm5
+    punpcklbw       xm6, xm7
+    punpckhwd       xm1, xm0, xm2
+    punpcklwd       xm0, xm2
+    punpckhwd       xm3, xm4, xm6
+    punpcklwd       xm4, xm6
+    punpckhdq       xm2, xm0, xm4
+    punpckldq       xm0, xm4
+    punpckhdq       xm5, xm1, xm3
+    punpckldq       xm1, xm3
+    movq           [%3], xm0
+    movhps      [%3+%4], xm0
+    movq      [%3+%4*2], xm2
+    movhps      [%3+%5], xm2
+    lea              %6, [%3+%4*4]
+    movq           [%6], xm1
+    movhps      [%6+%4], xm1
+    movq      [%6+%4*2], xm5
+    movhps      [%6+%5], xm5
+%endmacro
+
+%macro TRANSPOSE_8x8W 6
+    movu            xm0, [%1+0*%2]
+    movu            xm1, [%1+1*%2]
+    movu            xm2, [%1+2*%2]
+    movu            xm3, [%1+3*%2]
+    movu            xm4, [%1+4*%2]
+    movu            xm5, [%1+5*%2]
+    movu            xm6, [%1+6*%2]
+    movu            xm7, [%1+7*%2]
+    punpckhwd       xm8, xm0, xm1
+    punpcklwd       xm0, xm1
+    punpckhwd       xm9, xm2, xm3
+    punpcklwd       xm2, xm3
+    punpckhwd      xm10, xm4, xm5
+    punpcklwd       xm4, xm5
+    punpckhwd      xm11, xm6, xm7
+    punpcklwd       xm6, xm7
+    punpckhdq       xm1, xm0, xm2
+    punpckldq       xm0, xm2
+    punpckhdq       xm3, xm4, xm6
+    punpckldq       xm4, xm6
+    punpckhdq       xm5, xm8, xm9
+    punpckldq       xm8, xm9
+    punpckhdq       xm7, xm10, xm11
+    punpckldq      xm10, xm11
+    punpcklqdq      xm2, xm0, xm4
+    punpckhqdq      xm0, xm4
+    punpcklqdq      xm4, xm1, xm3
+    punpckhqdq      xm1, xm3
+    punpcklqdq      xm3, xm8, xm10
+    punpckhqdq      xm8, xm10
+    punpcklqdq      xm6, xm5, xm7
+    punpckhqdq      xm5, xm7
+    movu           [%3], xm2
+    movu        [%3+%4], xm0
+    movu      [%3+%4*2], xm4
+    movu        [%3+%5], xm1
+    lea              %6, [%3+%4*4]
+    movu           [%6], xm3
+    movu        [%6+%4], xm8
+    movu      [%6+%4*2], xm6
+    movu        [%6+%5], xm5
+%endmacro
+
+; one row of 10/12-bit pixels, u + (((v - u) * fact + 16) >> 5) is
+; computed with pmulhrsw and fact << 10 in m2
+%macro ANGULAR_ROW_16 2 ; size, offset
+%if %1 == 4
+    movq             m0, [topq+idxq*2+%2]
+    movq             m1, [topq+idxq*2+%2+2]
+%else
+    movu             m0, [topq+idxq*2+%2]
+    movu             m1, [topq+idxq*2+%2+2]
+%endif
+    psubw            m1, m0
+    pmulhrsw         m1, m2
+    paddw            m0, m1
+%if %1 == 4
+    movq      [dstq+%2], m0
+%else
+    movu      [dstq+%2], m0
+%endif
+%endmacro
+
+; Vertical modes are predicted directly into src. Horizontal modes are the
+; same computation with top and left swapped, so they are predicted into a
+; buffer on the stack which is then transposed into src.
+;
+; void ff_hevc_pred_angular_NxN(uint8_t *src, const uint8_t *top,
+;                               const uint8_t *left, ptrdiff_t stride,
+;                               int c_idx, int mode)
+%macro PRED_ANGULAR 3 ; size, log2_size, bit_depth
+%if %3 == 8
+    %assign %%px 1
+%else
+    %assign %%px 2
+%endif
+; ref_tmp[0] is at rsp + 128, the transposition buffer at rsp + 256
+cglobal hevc_pred_angular_%1x%1_%3, 6, 13, 16, 256 + %1 * %1 * %%px, \
+                                    src, top, left, stride, c_idx, mode, \
+                                    angle, pos, dst, dststride, idx, fact, cnt
+    movsxdifnidn  modeq, moded
+    lea            posq, [intra_pred_angle]
+    movsx        angled, byte [posq+modeq]
+%if %%px == 2
+    add         strideq, strideq
+%endif
+    mov            dstq, srcq
+    mov      dststrideq, strideq
+    cmp           moded, 18
+    jge .vertical
+    xchg           topq, leftq
+    lea            dstq, [rsp+256]
+    mov      dststrided, %1 * %%px
+.vertical:
+    ; from here on, topq is the main reference and leftq the side one
+    test         angled, angled
+    jns .predict
+    mov            posd, angled
+    shl            posd, %2
+    sar            posd, 5
+    cmp            posd, -1
+    jge .predict
+    ; extend the main reference with the side one projected onto it
+%if %1 * %%px == 4
+    ; a full register would read past the 2 * size pixels of top
+    movq             m0, [topq-1]
+    movq     [rsp+128], m0
+%else
+%assign %%off 0
+%rep ((%1 + 1) * %%px + mmsize - 1) / mmsize
+    movu             m0, [topq-%%px+%%off]
+    movu [rsp+128+%%off], m0
+%assign %%off %%off + mmsize
+%endrep
+%endif
+    lea            idxq, [inv_angle]
+    movsx         factd, word [idxq+modeq*2-11*2]
+    movsxd         posq, posd
+.project:
+    mov            idxd, posd
+    imul           idxd, factd
+    add            idxd, 128
+    sar            idxd, 8
+    movsxd         idxq, idxd
+%if %%px == 1
+    movzx          cntd, byte [leftq+idxq-1]
+    mov [rsp+128+posq], cntb
+%else
+    movzx          cntd, word [leftq+idxq*2-2]
+    mov [rsp+128+posq*2], cntw
+%endif
+    inc            posq
+    jnz .project
+    lea            topq, [rsp+128+%%px]
+.predict:
+    mov            posd, angled
+    mov            cntd, %1
+%if %%px == 1
+    mova             m4, [pw_1024]
+%endif
+.loop:
+    mov            idxd, posd
+    sar            idxd, 5
+    movsxd         idxq, idxd
+    mov           factd, posd
+    and           factd, 31
+    ; rows on whole pixel positions are copied, interpolating them would read
+    ; one pixel past the end of top for the last row of angle 32
+    jz .copy
+%if %%px == 1
+    imul          factd, 255
+    add           factd, 32                     ; 32 - fact | fact << 8
+    movd            xm2, factd
+    vpbroadcastw     m2, xm2
+%if %1 == 4
+    movd             m0, [topq+idxq]
+    movd             m1, [topq+idxq+1]
+%elif %1 == 8
+    movq             m0, [topq+idxq]
+    movq             m1, [topq+idxq+1]
+%else
+    movu             m0, [topq+idxq]
+    movu             m1, [topq+idxq+1]
+    punpckhbw        m3, m0, m1
+    pmaddubsw        m3, m2
+    pmulhrsw         m3, m4
+%endif
+    punpcklbw        m0, m1
+    pmaddubsw        m0, m2
+    pmulhrsw         m0, m4
+%if %1 == 4
+    packuswb         m0, m0
+    movd         [dstq], m0
+%elif %1 == 8
+    packuswb         m0, m0
+    movq         [dstq], m0
+%else
+    packuswb         m0, m3
+    movu         [dstq], m0
+%endif
+%else ; %%px == 2
+    shl           factd, 10
+    movd            xm2, factd
+    vpbroadcastw     m2, xm2
+    ANGULAR_ROW_16  %1, 0
+%if %1 == 32
+    ANGULAR_ROW_16  %1, 32
+%endif
+%endif
+.next:
+    add            dstq, dststrideq
+    add            posd, angled
+    dec            cntd
+    jg .loop
+    jmp .rows_done
+.copy:
+%if %1 * %%px == 4
+    movd             m0, [topq+idxq*%%px]
+    movd         [dstq], m0
+%elif %1 * %%px == 8
+    movq             m0, [topq+idxq*%%px]
+    movq         [dstq], m0
+%else
+    movu             m0, [topq+idxq*%%px]
+    movu         [dstq], m0
+%if %1 * %%px == 64
+    movu             m1, [topq+idxq*%%px+32]
+    movu      [dstq+32], m1
+%endif
+%endif
+    jmp .next
+.rows_done:
+
+%if %1 < 32
+    ; the pure vertical/horizontal luma modes get the gradient of the side
+    ; reference added to their first column
+    test         c_idxd, c_idxd
+    jnz .transpose
+    cmp           moded, 10
+    je .filter
+    cmp           moded, 26
+    jne .transpose
+.filter:
+    mov            idxq, dststrideq
+    shl            idxq, %2
+    sub            dstq, idxq
+%if %%px == 1
+    movzx         factd, byte [leftq-1]
+    movd            xm1, factd
+    movzx         factd, byte [topq]
+    movd            xm2, factd
+    vpbroadcastw     m1, xm1
+    vpbroadcastw     m2, xm2
+    pmovzxbw         m0, [leftq]
+    psubw            m0, m1
+    psraw            m0, 1
+    paddw            m0, m2
+%if %1 == 16
+    pmovzxbw         m3, [leftq+8]
+    psubw            m3, m1
+    psraw            m3, 1
+    paddw            m3, m2
+    packuswb         m0, m3
+%else
+    packuswb         m0, m0
+%endif
+%else
+    vpbroadcastw     m1, [leftq-2]
+    vpbroadcastw     m2, [topq]
+%if %1 == 4
+    movq             m0, [leftq]
+%else
+    movu             m0, [leftq]
+%endif
+    psubw            m0, m1
+    psraw            m0, 1
+    paddw            m0, m2
+    pxor             m1, m1
+    pmaxsw           m0, m1
+%if %3 == 10
+    pminsw           m0, [pw_1023]
+%else
+    pminsw           m0, [pw_4095]
+%endif
+%if %1 == 16
+    vextracti128    xm1, m0, 1
+%endif
+%endif
+%assign %%y 0
+%rep %1
+%if %%px == 1
+    pextrb       [dstq], xm0, %%y
+%elif %%y < 8
+    pextrw       [dstq], xm0, %%y
+%else
+    pextrw       [dstq], xm1, %%y - 8
+%endif
+    add            dstq, dststrideq
+%assign %%y %%y + 1
+%endrep
+.transpose:
+%endif
+    cmp           moded, 18
+    jge .end
+    DEFINE_ARGS src, blk, out, stride, stride3, tile, ccnt, rcnt, tmp
+%if %1 == 4
+%if %%px == 1
+    movu             m0, [rsp+256]
+    pshufb           m0, [pb_transpose_4x4]
+    movd         [srcq], m0
+    pextrd [srcq+strideq], m0, 1
+    lea            srcq, [srcq+strideq*2]
+    pextrd       [srcq], m0, 2
+    pextrd [srcq+strideq], m0, 3
+%else
+    movq             m0, [rsp+256]
+    movq             m1, [rsp+264]
+    movq             m2, [rsp+272]
+    movq             m3, [rsp+280]
+    punpcklwd        m0, m1
+    punpcklwd        m2, m3
+    punpckhdq        m1, m0, m2
+    punpckldq        m0, m2
+    movq         [srcq], m0
+    movhps [srcq+strideq], m0
+    lea            srcq, [srcq+strideq*2]
+    movq         [srcq], m1
+    movhps [srcq+strideq], m1
+%endif
+%else ; %1 >= 8
+    lea        stride3q, [strideq*3]
+    lea            blkq, [rsp+256]
+    mov           ccntd, %1 / 8
+.tcol:
+    mov           tileq, blkq
+    mov            outq, srcq
+    mov           rcntd, %1 / 8
+.trow:
+%if %%px == 1
+    TRANSPOSE_8x8B tileq, %1, outq, strideq, stride3q, tmpq
+%else
+    TRANSPOSE_8x8W tileq, %1 * 2, outq, strideq, stride3q, tmpq
+%endif
+    add           tileq, 8 * %1 * %%px
+    add            outq, 8 * %%px
+    dec           rcntd
+    jg .trow
+    add            blkq, 8 * %%px
+    lea            srcq, [srcq+strideq*8]
+    dec           ccntd
+    jg .tcol
+%endif
+.end:
+    RET
+%endmacro
+
+INIT_XMM avx2
+PRED_ANGULAR  4, 2, 8
+PRED_ANGULAR  8, 3, 8
+PRED_ANGULAR 16, 4, 8
+PRED_ANGULAR  4, 2, 10
+PRED_ANGULAR  8, 3, 10
+PRED_ANGULAR  4, 2, 12
+PRED_ANGULAR  8, 3, 12
+INIT_YMM avx2
+PRED_ANGULAR 32, 5, 8
+PRED_ANGULAR 16, 4, 10
+PRED_ANGULAR 32, 5, 10
+PRED_ANGULAR 16, 4, 12
+PRED_ANGULAR 32, 5, 12
+
+%endif ; ARCH_X86_64 && HAVE_AVX2_EXTERNAL
@@ -58,6 +58,28 @@ LFL_FUNCS(uint8_t,   8, avx)
 LFL_FUNCS(uint8_t,  10, avx)
 LFL_FUNCS(uint8_t,  12, avx)
 
+#define LFC_X2_FUNCS(depth, opt) \
+void ff_hevc_h_loop_filter_chroma_x2_ ## depth ## _ ## opt(uint8_t *pix, ptrdiff_t stride, int *tc, uint8_t *no_p, uint8_t *no_q); \
+void ff_hevc_v_loop_filter_chroma_x2_ ## depth ## _ ## opt(uint8_t *pix, ptrdiff_t stride, int *tc, uint8_t *no_p, uint8_t *no_q);
+
+#define LFL_X2_FUNCS(depth, opt) \
+void ff_hevc_h_loop_filter_luma_x2_ ## depth ## _ ## opt(uint8_t *pix, ptrdiff_t stride, int *beta, int *tc, uint8_t *no_p, uint8_t *no_q); \
+void ff_hevc_v_loop_filter_luma_x2_ ## depth ## _ ## opt(uint8_t *pix, ptrdiff_t stride, int *beta, int *tc, uint8_t *no_p, uint8_t *no_q);
+
+LFC_X2_FUNCS( 8, avx2)
+LFC_X2_FUNCS(10, avx2)
+LFC_X2_FUNCS(12, avx2)
+LFL_X2_FUNCS( 8, avx2)
+LFL_X2_FUNCS(10, avx2)
+LFL_X2_FUNCS(12, avx2)
+
+#define LF_X2_INIT(depth, opt) do {                                                          \
+    c->hevc_h_loop_filter_luma_x2   = ff_hevc_h_loop_filter_luma_x2_ ## depth ## _ ## opt;   \
+    c->hevc_v_loop_filter_luma_x2   = ff_hevc_v_loop_filter_luma_x2_ ## depth ## _ ## opt;   \
+    c->hevc_h_loop_filter_chroma_x2 = ff_hevc_h_loop_filter_chroma_x2_ ## depth ## _ ## opt; \
+    c->hevc_v_loop_filter_chroma_x2 = ff_hevc_v_loop_filter_chroma_x2_ ## depth ## _ ## opt; \
+} while (0)
+
 #define IDCT_DC_FUNCS(W, opt) \
 void ff_hevc_idct_ ## W ## _dc_8_ ## opt(int16_t *coeffs); \
 void ff_hevc_idct_ ## W ## _dc_10_ ## opt(int16_t *coeffs); \
@@ -785,6 +807,8 @@ void ff_hevc_dsp_init_x86(HEVCDSPContext *c, const int bit_depth)
             c->idct_dc[2] = ff_hevc_idct_16x16_dc_8_avx2;
             c->idct_dc[3] = ff_hevc_idct_32x32_dc_8_avx2;
             if (ARCH_X86_64) {
+                LF_X2_INIT(8, avx2);
+
                 c->put_hevc_epel[7][0][0] = ff_hevc_put_hevc_pel_pixels32_8_avx2;
                 c->put_hevc_epel[8][0][0] = ff_hevc_put_hevc_pel_pixels48_8_avx2;
                 c->put_hevc_epel[9][0][0] = ff_hevc_put_hevc_pel_pixels64_8_avx2;
@@ -945,6 +969,8 @@ void ff_hevc_dsp_init_x86(HEVCDSPContext *c, const int bit_depth)
             c->idct_dc[2] = ff_hevc_idct_16x16_dc_10_avx2;
             c->idct_dc[3] = ff_hevc_idct_32x32_dc_10_avx2;
             if (ARCH_X86_64) {
+                LF_X2_INIT(10, avx2);
+
                 c->put_hevc_epel[5][0][0] = ff_hevc_put_hevc_pel_pixels16_10_avx2;
                 c->put_hevc_epel[6][0][0] = ff_hevc_put_hevc_pel_pixels24_10_avx2;
                 c->put_hevc_epel[7][0][0] = ff_hevc_put_hevc_pel_pixels32_10_avx2;
@@ -1143,6 +1169,8 @@ void ff_hevc_dsp_init_x86(HEVCDSPContext *c, const int bit_depth)
         if (EXTERNAL_AVX2_FAST(cpu_flags)) {
             c->idct_dc[2] = ff_hevc_idct_16x16_dc_12_avx2;
             c->idct_dc[3] = ff_hevc_idct_32x32_dc_12_avx2;
+            if (ARCH_X86_64)
+                LF_X2_INIT(12, avx2);
 
             SAO_BAND_INIT(12, avx2);
             SAO_EDGE_INIT(12, avx2);
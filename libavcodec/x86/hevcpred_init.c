@@ -0,0 +1,91 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/hevcpred.h"
+
+#define PRED_PLANAR_FUNC(size, depth, opt)                                    \
+void ff_hevc_pred_planar_ ## size ## x ## size ## _ ## depth ## _ ## opt(     \
+    uint8_t *src, const uint8_t *top, const uint8_t *left, ptrdiff_t stride);
+
+#define PRED_ANGULAR_FUNC(size, depth, opt)                                   \
+void ff_hevc_pred_angular_ ## size ## x ## size ## _ ## depth ## _ ## opt(    \
+    uint8_t *src, const uint8_t *top, const uint8_t *left, ptrdiff_t stride,  \
+    int c_idx, int mode);
+
+#define PRED_DC_FUNC(depth, opt)                                              \
+void ff_hevc_pred_dc_ ## depth ## _ ## opt(uint8_t *src, const uint8_t *top,  \
+                                           const uint8_t *left,               \
+                                           ptrdiff_t stride, int log2_size,   \
+                                           int c_idx);
+
+#define PRED_PLANAR_FUNCS(depth, opt) \
+    PRED_PLANAR_FUNC( 4, depth, opt)  \
+    PRED_PLANAR_FUNC( 8, depth, opt)  \
+    PRED_PLANAR_FUNC(16, depth, opt)  \
+    PRED_PLANAR_FUNC(32, depth, opt)
+
+#define PRED_ANGULAR_FUNCS(depth, opt) \
+    PRED_ANGULAR_FUNC( 4, depth, opt)  \
+    PRED_ANGULAR_FUNC( 8, depth, opt)  \
+    PRED_ANGULAR_FUNC(16, depth, opt)  \
+    PRED_ANGULAR_FUNC(32, depth, opt)
+
+PRED_PLANAR_FUNCS(8,  avx2)
+PRED_PLANAR_FUNCS(16, avx2)
+PRED_DC_FUNC(8,  avx2)
+PRED_DC_FUNC(16, avx2)
+PRED_ANGULAR_FUNCS(8,  avx2)
+PRED_ANGULAR_FUNCS(10, avx2)
+PRED_ANGULAR_FUNCS(12, avx2)
+
+#define SET_PRED_FUNCS(depth, pdepth, opt)                                    \
+    do {                                                                      \
+        hpc->pred_planar[0]  = ff_hevc_pred_planar_4x4_ ## pdepth ## _ ## opt;   \
+        hpc->pred_planar[1]  = ff_hevc_pred_planar_8x8_ ## pdepth ## _ ## opt;   \
+        hpc->pred_planar[2]  = ff_hevc_pred_planar_16x16_ ## pdepth ## _ ## opt; \
+        hpc->pred_planar[3]  = ff_hevc_pred_planar_32x32_ ## pdepth ## _ ## opt; \
+        hpc->pred_dc         = ff_hevc_pred_dc_ ## pdepth ## _ ## opt;           \
+        hpc->pred_angular[0] = ff_hevc_pred_angular_4x4_ ## depth ## _ ## opt;   \
+        hpc->pred_angular[1] = ff_hevc_pred_angular_8x8_ ## depth ## _ ## opt;   \
+        hpc->pred_angular[2] = ff_hevc_pred_angular_16x16_ ## depth ## _ ## opt; \
+        hpc->pred_angular[3] = ff_hevc_pred_angular_32x32_ ## depth ## _ ## opt; \
+    } while (0)
+
+av_cold void ff_hevc_pred_init_x86(HEVCPredContext *hpc, int bit_depth)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (ARCH_X86_64 && EXTERNAL_AVX2_FAST(cpu_flags)) {
+        switch (bit_depth) {
+        case 8:
+            SET_PRED_FUNCS(8, 8, avx2);
+            break;
+        case 10:
+            SET_PRED_FUNCS(10, 16, avx2);
+            break;
+        case 12:
+            SET_PRED_FUNCS(12, 16, avx2);
+            break;
+        }
+    }
+}
@@ -26,6 +26,7 @@
 #include "audio.h"
 #include "avfilter.h"
 #include "internal.h"
+#include "thread.h"
 
 #define BUFFER_ALIGN 0
 
@@ -35,12 +36,10 @@ AVFrame *ff_null_get_audio_buffer(AVFilterLink *link, int nb_samples)
     return ff_get_audio_buffer(link->dst->outputs[0], nb_samples);
 }
 
-AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
+static AVFrame *pool_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
-    AVFrame *frame = NULL;
     int channels = link->channels;
-
-    av_assert0(channels == av_get_channel_layout_nb_channels(link->channel_layout) || !av_get_channel_layout_nb_channels(link->channel_layout));
+    AVFrame *frame;
 
     if (!link->frame_pool) {
         link->frame_pool = ff_frame_pool_audio_init(av_buffer_allocz, channels,
@@ -71,6 +70,21 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
     }
 
     frame = ff_frame_pool_get(link->frame_pool);
+    if (frame && link->src->graph->stats)
+        ff_filter_stats_pool_frame(link, frame);
+    return frame;
+}
+
+AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
+{
+    AVFrame *frame = NULL;
+    int channels = link->channels;
+
+    av_assert0(channels == av_get_channel_layout_nb_channels(link->channel_layout) || !av_get_channel_layout_nb_channels(link->channel_layout));
+
+    ff_graph_frame_thread_lock(link->dst->graph);
+    frame = pool_get_audio_buffer(link, nb_samples);
+    ff_graph_frame_thread_unlock(link->dst->graph);
     if (!frame)
         return NULL;
 
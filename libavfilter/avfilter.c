@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <time.h>
+
 #include "libavutil/atomic.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
@@ -33,6 +35,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -42,6 +45,7 @@
 #include "filters.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 
 #include "libavutil/ffversion.h"
 const char av_filter_ffversion[] = "FFmpeg version " FFMPEG_VERSION;
@@ -190,7 +194,75 @@ int avfilter_link_get_channels(AVFilterLink *link)
 
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
+    ff_graph_frame_thread_lock(filter->graph);
     filter->ready = FFMAX(filter->ready, priority);
+    ff_graph_frame_thread_notify(filter->graph);
+    ff_graph_frame_thread_unlock(filter->graph);
+}
+
+static int64_t thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
+/**
+ * Release the graph lock while running the callbacks of a filter on a
+ * frame threading worker, unless the filter state is shared with the
+ * application, and start timing the callbacks if the graph collects
+ * statistics.
+ */
+static void filter_release_graph(AVFilterContext *filter)
+{
+    if (filter->graph->stats) {
+        filter->internal->wall_start = av_gettime_relative();
+        filter->internal->cpu_start  = thread_cpu_time();
+    }
+    if (!(filter->filter->flags_internal & FF_FILTER_FLAG_GRAPH_LOCKED))
+        ff_graph_frame_thread_unlock(filter->graph);
+}
+
+static void filter_acquire_graph(AVFilterContext *filter)
+{
+    if (!(filter->filter->flags_internal & FF_FILTER_FLAG_GRAPH_LOCKED))
+        ff_graph_frame_thread_lock(filter->graph);
+    if (filter->graph->stats) {
+        filter->internal->wall_time += av_gettime_relative() - filter->internal->wall_start;
+        filter->internal->cpu_time  += thread_cpu_time()     - filter->internal->cpu_start;
+    }
+}
+
+void ff_filter_stats_pool_frame(AVFilterLink *link, const AVFrame *frame)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        link->src->internal->pool_bytes += frame->buf[i]->size;
+}
+
+int avfilter_get_stats(AVFilterContext *filter, AVFilterStats *stats)
+{
+    unsigned i;
+
+    if (!filter->graph || !filter->graph->stats)
+        return AVERROR(EINVAL);
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i])
+            stats->frames_in += filter->inputs[i]->frame_count_out;
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            stats->frames_out += filter->outputs[i]->frame_count_in;
+    stats->wall_time  = filter->internal->wall_time;
+    stats->cpu_time   = filter->internal->cpu_time;
+    stats->max_queued = filter->internal->max_queued;
+    stats->pool_bytes = filter->internal->pool_bytes;
+    return 0;
 }
 
 /**
@@ -210,6 +282,7 @@ void ff_avfilter_link_set_in_status(AVFilterLink *link, int status, int64_t pts)
 {
     if (link->status_in == status)
         return;
+    ff_graph_frame_thread_lock(link->dst->graph);
     av_assert0(!link->status_in);
     link->status_in = status;
     link->status_in_pts = pts;
@@ -217,10 +290,12 @@ void ff_avfilter_link_set_in_status(AVFilterLink *link, int status, int64_t pts)
     link->frame_blocked_in = 0;
     filter_unblock(link->dst);
     ff_filter_set_ready(link->dst, 200);
+    ff_graph_frame_thread_unlock(link->dst->graph);
 }
 
 void ff_avfilter_link_set_out_status(AVFilterLink *link, int status, int64_t pts)
 {
+    ff_graph_frame_thread_lock(link->dst->graph);
     av_assert0(!link->frame_wanted_out);
     av_assert0(!link->status_out);
     link->status_out = status;
@@ -228,6 +303,7 @@ void ff_avfilter_link_set_out_status(AVFilterLink *link, int status, int64_t pts
         ff_update_link_current_pts(link, pts);
     filter_unblock(link->dst);
     ff_filter_set_ready(link->src, 200);
+    ff_graph_frame_thread_unlock(link->dst->graph);
 }
 
 void avfilter_link_set_closed(AVFilterLink *link, int closed)
@@ -402,10 +478,8 @@ void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
     }
 }
 
-int ff_request_frame(AVFilterLink *link)
+static int request_frame(AVFilterLink *link)
 {
-    FF_TPRINTF_START(NULL, request_frame); ff_tlog_link(NULL, link, 1);
-
     av_assert1(!link->dst->filter->activate);
     if (link->status_out)
         return link->status_out;
@@ -427,6 +501,18 @@ int ff_request_frame(AVFilterLink *link)
     return 0;
 }
 
+int ff_request_frame(AVFilterLink *link)
+{
+    int ret;
+
+    FF_TPRINTF_START(NULL, request_frame); ff_tlog_link(NULL, link, 1);
+
+    ff_graph_frame_thread_lock(link->dst->graph);
+    ret = request_frame(link);
+    ff_graph_frame_thread_unlock(link->dst->graph);
+    return ret;
+}
+
 static int ff_request_frame_to_filter(AVFilterLink *link)
 {
     int ret = -1;
@@ -434,9 +520,11 @@ static int ff_request_frame_to_filter(AVFilterLink *link)
     FF_TPRINTF_START(NULL, request_frame_to_filter); ff_tlog_link(NULL, link, 1);
     /* Assume the filter is blocked, let the method clear it if not */
     link->frame_blocked_in = 1;
-    if (link->srcpad->request_frame)
+    if (link->srcpad->request_frame) {
+        filter_release_graph(link->src);
         ret = link->srcpad->request_frame(link);
-    else if (link->src->inputs[0])
+        filter_acquire_graph(link->src);
+    } else if (link->src->inputs[0])
         ret = ff_request_frame(link->src->inputs[0]);
     if (ret < 0) {
         if (ret != AVERROR(EAGAIN) && ret != link->status_in)
@@ -1101,23 +1189,27 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     if (!(filter_frame = dst->filter_frame))
         filter_frame = default_filter_frame;
 
-    if (dst->needs_writable) {
-        ret = ff_inlink_make_frame_writable(link, &frame);
-        if (ret < 0)
-            goto fail;
-    }
-
     ff_inlink_process_commands(link, frame);
     dstctx->is_disabled = !ff_inlink_evaluate_timeline_at_frame(link, frame);
 
     if (dstctx->is_disabled &&
         (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
         filter_frame = default_filter_frame;
+
+    filter_release_graph(dstctx);
+    if (dst->needs_writable) {
+        ret = ff_inlink_make_frame_writable(link, &frame);
+        if (ret < 0)
+            goto fail;
+    }
+
     ret = filter_frame(link, frame);
+    filter_acquire_graph(dstctx);
     link->frame_count_out++;
     return ret;
 
 fail:
+    filter_acquire_graph(dstctx);
     av_frame_free(&frame);
     return ret;
 }
@@ -1157,15 +1249,21 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         }
     }
 
+    ff_graph_frame_thread_lock(link->dst->graph);
     link->frame_blocked_in = link->frame_wanted_out = 0;
     link->frame_count_in++;
     filter_unblock(link->dst);
     ret = ff_framequeue_add(&link->fifo, frame);
     if (ret < 0) {
+        ff_graph_frame_thread_unlock(link->dst->graph);
         av_frame_free(&frame);
         return ret;
     }
+    if (link->dst->graph->stats)
+        link->dst->internal->max_queued = FFMAX(link->dst->internal->max_queued,
+                                                ff_framequeue_queued_frames(&link->fifo));
     ff_filter_set_ready(link->dst, 300);
+    ff_graph_frame_thread_unlock(link->dst->graph);
     return 0;
 
 error:
@@ -1473,14 +1571,19 @@ int ff_filter_activate(AVFilterContext *filter)
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     filter->ready = 0;
-    ret = filter->filter->activate ? filter->filter->activate(filter) :
-          ff_filter_activate_default(filter);
+    if (filter->filter->activate) {
+        filter_release_graph(filter);
+        ret = filter->filter->activate(filter);
+        filter_acquire_graph(filter);
+    } else {
+        ret = ff_filter_activate_default(filter);
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
 }
 
-int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
+static int inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
 {
     *rpts = link->current_pts;
     if (ff_framequeue_queued_frames(&link->fifo))
@@ -1495,16 +1598,37 @@ int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts
     return 1;
 }
 
+int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
+{
+    int ret;
+
+    ff_graph_frame_thread_lock(link->dst->graph);
+    ret = inlink_acknowledge_status(link, rstatus, rpts);
+    ff_graph_frame_thread_unlock(link->dst->graph);
+    return ret;
+}
+
 int ff_inlink_check_available_frame(AVFilterLink *link)
 {
-    return ff_framequeue_queued_frames(&link->fifo) > 0;
+    int ret;
+
+    ff_graph_frame_thread_lock(link->dst->graph);
+    ret = ff_framequeue_queued_frames(&link->fifo) > 0;
+    ff_graph_frame_thread_unlock(link->dst->graph);
+    return ret;
 }
 
 int ff_inlink_check_available_samples(AVFilterLink *link, unsigned min)
 {
-    uint64_t samples = ff_framequeue_queued_samples(&link->fifo);
+    uint64_t samples;
+    int ret;
+
     av_assert1(min);
-    return samples >= min || (link->status_in && samples);
+    ff_graph_frame_thread_lock(link->dst->graph);
+    samples = ff_framequeue_queued_samples(&link->fifo);
+    ret = samples >= min || (link->status_in && samples);
+    ff_graph_frame_thread_unlock(link->dst->graph);
+    return ret;
 }
 
 static void consume_update(AVFilterLink *link, const AVFrame *frame)
@@ -1520,10 +1644,16 @@ int ff_inlink_consume_frame(AVFilterLink *link, AVFrame **rframe)
     AVFrame *frame;
 
     *rframe = NULL;
-    if (!ff_inlink_check_available_frame(link))
+    ff_graph_frame_thread_lock(link->dst->graph);
+    if (!ff_inlink_check_available_frame(link)) {
+        ff_graph_frame_thread_unlock(link->dst->graph);
         return 0;
+    }
     frame = ff_framequeue_take(&link->fifo);
     consume_update(link, frame);
+    /* room was made in the queue, the source may be runnable again */
+    ff_graph_frame_thread_notify(link->dst->graph);
+    ff_graph_frame_thread_unlock(link->dst->graph);
     *rframe = frame;
     return 1;
 }
@@ -1536,14 +1666,21 @@ int ff_inlink_consume_samples(AVFilterLink *link, unsigned min, unsigned max,
 
     av_assert1(min);
     *rframe = NULL;
-    if (!ff_inlink_check_available_samples(link, min))
+    ff_graph_frame_thread_lock(link->dst->graph);
+    if (!ff_inlink_check_available_samples(link, min)) {
+        ff_graph_frame_thread_unlock(link->dst->graph);
         return 0;
+    }
     if (link->status_in)
         min = FFMIN(min, ff_framequeue_queued_samples(&link->fifo));
     ret = take_samples(link, min, link->max_samples, &frame);
-    if (ret < 0)
+    if (ret < 0) {
+        ff_graph_frame_thread_unlock(link->dst->graph);
         return ret;
+    }
     consume_update(link, frame);
+    ff_graph_frame_thread_notify(link->dst->graph);
+    ff_graph_frame_thread_unlock(link->dst->graph);
     *rframe = frame;
     return 1;
 }
@@ -1599,8 +1736,11 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
 
 int ff_inlink_process_commands(AVFilterLink *link, const AVFrame *frame)
 {
-    AVFilterCommand *cmd = link->dst->command_queue;
+    AVFilterCommand *cmd;
 
+    /* the queue is filled by avfilter_graph_queue_command() */
+    ff_graph_frame_thread_lock(link->dst->graph);
+    cmd = link->dst->command_queue;
     while(cmd && cmd->time <= frame->pts * av_q2d(link->time_base)){
         av_log(link->dst, AV_LOG_DEBUG,
                "Processing command time:%f command:%s arg:%s\n",
@@ -1609,6 +1749,7 @@ int ff_inlink_process_commands(AVFilterLink *link, const AVFrame *frame)
         ff_command_queue_pop(link->dst);
         cmd= link->dst->command_queue;
     }
+    ff_graph_frame_thread_unlock(link->dst->graph);
     return 0;
 }
 
@@ -1632,10 +1773,12 @@ int ff_inlink_evaluate_timeline_at_frame(AVFilterLink *link, const AVFrame *fram
 
 void ff_inlink_request_frame(AVFilterLink *link)
 {
+    ff_graph_frame_thread_lock(link->dst->graph);
     av_assert1(!link->status_in);
     av_assert1(!link->status_out);
     link->frame_wanted_out = 1;
     ff_filter_set_ready(link->src, 100);
+    ff_graph_frame_thread_unlock(link->dst->graph);
 }
 
 const AVClass *avfilter_get_class(void)
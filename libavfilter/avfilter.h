@@ -317,6 +317,17 @@ typedef struct AVFilter {
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
 
+/**
+ * Process different filters of the graph concurrently, each filter being
+ * activated on a worker thread as soon as it has work to do. Frames are
+ * passed between the workers through the regular link queues, whose depth
+ * is bounded by the scheduler.
+ *
+ * This is only honored for AVFilterGraph.thread_type and requires more
+ * than one thread.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
+
 typedef struct AVFilterInternal AVFilterInternal;
 
 /** An instance of a filter */
@@ -896,6 +907,13 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Collect statistics on the filters of the graph, which can be read
+     * with avfilter_get_stats(). Must be set before the graph is
+     * configured.
+     */
+    int stats;
+
     /**
      * Private fields
      *
@@ -1145,9 +1163,36 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
 int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, int flags, double ts);
 
 
+/**
+ * Statistics collected on a filter instance when AVFilterGraph.stats is set.
+ *
+ * The times only account for the callbacks of the filter itself, and not
+ * for the time its frames spend waiting in the queues of its inputs.
+ */
+typedef struct AVFilterStats {
+    int64_t frames_in;  ///< number of frames consumed from the inputs
+    int64_t frames_out; ///< number of frames sent on the outputs
+    int64_t wall_time;  ///< wall clock time spent processing, in microseconds
+    int64_t cpu_time;   ///< CPU time spent processing, in microseconds, 0 if unsupported
+    int64_t max_queued; ///< highest number of frames queued on one input
+    int64_t pool_bytes; ///< size of the buffers obtained from the frame pools of the outputs
+} AVFilterStats;
+
+/**
+ * Get the statistics collected on a filter.
+ *
+ * @param filter  a filter of a graph with AVFilterGraph.stats set
+ * @param stats   filled with the statistics of the filter
+ * @return  >= 0 on success, AVERROR(EINVAL) if the graph does not collect
+ *          statistics
+ */
+int avfilter_get_stats(AVFilterContext *filter, AVFilterStats *stats);
+
 /**
  * Dump a graph into a human-readable string representation.
  *
+ * If the graph collects statistics, they are printed below each filter.
+ *
  * @param graph    the graph to dump
  * @param options  formatting options; currently ignored
  * @return  a string, or NULL in case of memory allocation failure;
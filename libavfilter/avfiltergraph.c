@@ -47,12 +47,15 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, FLAGS },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
+    { "stats",       "Collect statistics on the filters", OFFSET(stats),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, FLAGS },
     { NULL },
 };
 
@@ -77,6 +80,49 @@ int ff_graph_thread_init(AVFilterGraph *graph)
 }
 #endif
 
+#if !HAVE_PTHREADS
+int ff_graph_frame_thread_init(AVFilterGraph *graph)
+{
+    graph->thread_type &= ~AVFILTER_THREAD_FRAME;
+    return 0;
+}
+
+void ff_graph_frame_thread_free(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_frame_thread_lock(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_frame_thread_unlock(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_frame_thread_notify(AVFilterGraph *graph)
+{
+}
+
+int ff_graph_frame_thread_wait(AVFilterGraph *graph)
+{
+    return AVERROR(EAGAIN);
+}
+
+int ff_graph_frame_thread_error(AVFilterGraph *graph)
+{
+    return 0;
+}
+
+void ff_graph_frame_thread_wait_idle(AVFilterGraph *graph)
+{
+}
+
+int ff_graph_frame_thread_active(AVFilterGraph *graph)
+{
+    return 0;
+}
+#endif
+
 AVFilterGraph *avfilter_graph_alloc(void)
 {
     AVFilterGraph *ret = av_mallocz(sizeof(*ret));
@@ -119,6 +165,8 @@ void avfilter_graph_free(AVFilterGraph **graph)
     if (!*graph)
         return;
 
+    ff_graph_frame_thread_free(*graph);
+
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
@@ -420,6 +468,39 @@ static int can_merge_formats(AVFilterFormats *a_arg,
     }
 }
 
+static int count_hwaccel_formats(const AVFilterFormats *fmts)
+{
+    int i, nb = 0;
+
+    for (i = 0; i < fmts->nb_formats; i++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmts->formats[i]);
+        nb += desc && (desc->flags & AV_PIX_FMT_FLAG_HWACCEL);
+    }
+    return nb;
+}
+
+static AVBufferRef *find_hw_device(AVFilterGraph *graph, AVFilterLink *link)
+{
+    int i;
+
+    if (link->dst->hw_device_ctx)
+        return link->dst->hw_device_ctx;
+    if (link->src->hw_device_ctx)
+        return link->src->hw_device_ctx;
+    for (i = 0; i < graph->nb_filters; i++)
+        if (graph->filters[i]->hw_device_ctx)
+            return graph->filters[i]->hw_device_ctx;
+    return NULL;
+}
+
+static int merge_link_formats(AVFilterLink *link)
+{
+    av_assert0(link-> in_formats->refcount > 0);
+    av_assert0(link->out_formats->refcount > 0);
+    return ff_merge_formats(link->in_formats, link->out_formats, link->type) ?
+           0 : AVERROR(ENOSYS);
+}
+
 /**
  * Perform one round of query_formats() and merging formats lists on the
  * filter graph.
@@ -434,6 +515,7 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
 {
     int i, j, ret;
     int scaler_count = 0, resampler_count = 0;
+    int hwupload_count = 0, hwdownload_count = 0;
     int count_queried = 0;        /* successful calls to query_formats() */
     int count_merged = 0;         /* successful merge of formats lists */
     int count_already_merged = 0; /* lists already merged */
@@ -508,11 +590,13 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
 #undef MERGE_DISPATCH
 
             if (convert_needed) {
-                AVFilterContext *convert;
+                AVFilterContext *convert, *upload_scaler = NULL;
+                AVFilterContext **scaler = &convert;
                 AVFilter *filter;
                 AVFilterLink *inlink, *outlink;
                 char scale_args[256];
                 char inst_name[30];
+                int src_hw, dst_hw;
 
                 if (graph->disable_auto_convert) {
                     av_log(log_ctx, AV_LOG_ERROR,
@@ -525,6 +609,66 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                 /* couldn't merge format lists. auto-insert conversion filter */
                 switch (link->type) {
                 case AVMEDIA_TYPE_VIDEO:
+                    /* Frames in device memory cannot be handled by the
+                     * software scaler: when only one side of the link works
+                     * on hardware frames, move them across with hwdownload or
+                     * hwupload instead. Links where both sides accept the
+                     * same hardware format never get here, so the frames
+                     * stay on their device. */
+                    src_hw = count_hwaccel_formats(link->in_formats);
+                    dst_hw = count_hwaccel_formats(link->out_formats);
+                    if (src_hw == link->in_formats->nb_formats &&
+                        dst_hw <  link->out_formats->nb_formats) {
+                        if (!(filter = avfilter_get_by_name("hwdownload"))) {
+                            av_log(log_ctx, AV_LOG_ERROR, "'hwdownload' filter "
+                                   "not present, cannot download hardware frames.\n");
+                            return AVERROR(EINVAL);
+                        }
+                        av_log(log_ctx, AV_LOG_VERBOSE, "Downloading hardware frames "
+                               "between the filters '%s' and '%s'.\n",
+                               link->src->name, link->dst->name);
+
+                        snprintf(inst_name, sizeof(inst_name), "auto_hwdownload_%d",
+                                 hwdownload_count++);
+                        if ((ret = avfilter_graph_create_filter(&convert, filter,
+                                                                inst_name, NULL, NULL,
+                                                                graph)) < 0)
+                            return ret;
+                        break;
+                    } else if (dst_hw == link->out_formats->nb_formats &&
+                               src_hw <  link->in_formats->nb_formats) {
+                        AVBufferRef *device = find_hw_device(graph, link);
+
+                        if (!device) {
+                            av_log(log_ctx, AV_LOG_ERROR, "The filter '%s' needs "
+                                   "hardware frames but there is no hardware device "
+                                   "to upload the output of '%s' to.\n",
+                                   link->dst->name, link->src->name);
+                            return AVERROR(EINVAL);
+                        }
+                        if (!(filter = avfilter_get_by_name("hwupload"))) {
+                            av_log(log_ctx, AV_LOG_ERROR, "'hwupload' filter "
+                                   "not present, cannot upload frames.\n");
+                            return AVERROR(EINVAL);
+                        }
+
+                        snprintf(inst_name, sizeof(inst_name), "auto_hwupload_%d",
+                                 hwupload_count++);
+                        if ((ret = avfilter_graph_create_filter(&convert, filter,
+                                                                inst_name, NULL, NULL,
+                                                                graph)) < 0)
+                            return ret;
+                        convert->hw_device_ctx = av_buffer_ref(device);
+                        if (!convert->hw_device_ctx)
+                            return AVERROR(ENOMEM);
+
+                        /* the device may not accept the software format of
+                         * the source, so let a scaler pick one it does; it
+                         * passes the frames through when no conversion is
+                         * needed */
+                        scaler = &upload_scaler;
+                    }
+
                     if (!(filter = avfilter_get_by_name("scale"))) {
                         av_log(log_ctx, AV_LOG_ERROR, "'scale' filter "
                                "not present, cannot convert pixel formats.\n");
@@ -534,7 +678,7 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                     snprintf(inst_name, sizeof(inst_name), "auto_scaler_%d",
                              scaler_count++);
 
-                    if ((ret = avfilter_graph_create_filter(&convert, filter,
+                    if ((ret = avfilter_graph_create_filter(scaler, filter,
                                                             inst_name, graph->scale_sws_opts, NULL,
                                                             graph)) < 0)
                         return ret;
@@ -567,8 +711,24 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                 if ((ret = filter_query_formats(convert)) < 0)
                     return ret;
 
+                if (upload_scaler) {
+                    if ((ret = avfilter_insert_filter(convert->inputs[0],
+                                                      upload_scaler, 0, 0)) < 0)
+                        return ret;
+                    if ((ret = filter_query_formats(upload_scaler)) < 0)
+                        return ret;
+                    if ((ret = merge_link_formats(upload_scaler->outputs[0])) < 0) {
+                        av_log(log_ctx, AV_LOG_ERROR, "The hardware device cannot "
+                               "take any software format the scaler can output.\n");
+                        return ret;
+                    }
+                    convert = upload_scaler;
+                }
+
                 inlink  = convert->inputs[0];
                 outlink = convert->outputs[0];
+                if (upload_scaler)
+                    outlink = outlink->dst->outputs[0];
                 av_assert0( inlink-> in_formats->refcount > 0);
                 av_assert0( inlink->out_formats->refcount > 0);
                 av_assert0(outlink-> in_formats->refcount > 0);
@@ -1275,19 +1435,20 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if ((ret = ff_graph_frame_thread_init(graphctx)) < 0) {
+        av_log(log_ctx, AV_LOG_ERROR, "Error initializing frame threading.\n");
+        return ret;
+    }
 
     return 0;
 }
 
-int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
+static int graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
     int i, r = AVERROR(ENOSYS);
 
-    if (!graph)
-        return r;
-
     if ((flags & AVFILTER_CMD_FLAG_ONE) && !(flags & AVFILTER_CMD_FLAG_FAST)) {
-        r = avfilter_graph_send_command(graph, target, cmd, arg, res, res_len, flags | AVFILTER_CMD_FLAG_FAST);
+        r = graph_send_command(graph, target, cmd, arg, res, res_len, flags | AVFILTER_CMD_FLAG_FAST);
         if (r != AVERROR(ENOSYS))
             return r;
     }
@@ -1309,12 +1470,25 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
     return r;
 }
 
-int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
-    int i;
+    int r;
 
-    if(!graph)
-        return 0;
+    if (!graph)
+        return AVERROR(ENOSYS);
+
+    /* commands are processed outside of any activation */
+    ff_graph_frame_thread_lock(graph);
+    ff_graph_frame_thread_wait_idle(graph);
+    r = graph_send_command(graph, target, cmd, arg, res, res_len, flags);
+    ff_graph_frame_thread_unlock(graph);
+
+    return r;
+}
+
+static int graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+{
+    int i;
 
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
@@ -1340,6 +1514,20 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
     return 0;
 }
 
+int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+{
+    int ret;
+
+    if(!graph)
+        return 0;
+
+    ff_graph_frame_thread_lock(graph);
+    ret = graph_queue_command(graph, target, command, arg, flags, ts);
+    ff_graph_frame_thread_unlock(graph);
+
+    return ret;
+}
+
 static void heap_bubble_up(AVFilterGraph *graph,
                            AVFilterLink *link, int index)
 {
@@ -1395,9 +1583,11 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     int64_t frame_count;
     int r;
 
+    ff_graph_frame_thread_lock(graph);
     while (graph->sink_links_count) {
         oldest = graph->sink_links[0];
         if (oldest->dst->filter->activate) {
+            ff_graph_frame_thread_unlock(graph);
             /* For now, buffersink is the only filter implementing activate. */
             return av_buffersink_get_frame_flags(oldest->dst, NULL,
                                                  AV_BUFFERSINK_FLAG_PEEK);
@@ -1414,8 +1604,10 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
                              oldest->age_index);
         oldest->age_index = -1;
     }
-    if (!graph->sink_links_count)
+    if (!graph->sink_links_count) {
+        ff_graph_frame_thread_unlock(graph);
         return AVERROR_EOF;
+    }
     av_assert1(!oldest->dst->filter->activate);
     av_assert1(oldest->age_index >= 0);
     frame_count = oldest->frame_count_out;
@@ -1425,9 +1617,12 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
             !oldest->frame_wanted_out && !oldest->frame_blocked_in &&
             !oldest->status_in)
             ff_request_frame(oldest);
-        else if (r < 0)
+        else if (r < 0) {
+            ff_graph_frame_thread_unlock(graph);
             return r;
+        }
     }
+    ff_graph_frame_thread_unlock(graph);
     return 0;
 }
 
@@ -1437,6 +1632,8 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
     unsigned i;
 
     av_assert0(graph->nb_filters);
+    if (ff_graph_frame_thread_active(graph))
+        return ff_graph_frame_thread_wait(graph);
     filter = graph->filters[0];
     for (i = 1; i < graph->nb_filters; i++)
         if (graph->filters[i]->ready > filter->ready)
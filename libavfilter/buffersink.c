@@ -37,6 +37,7 @@
 #include "buffersink.h"
 #include "filters.h"
 #include "internal.h"
+#include "thread.h"
 
 typedef struct BufferSinkContext {
     const AVClass *class;
@@ -116,15 +117,25 @@ static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags, i
     }
 }
 
+static int get_frame_locked(AVFilterContext *ctx, AVFrame *frame, int flags, int samples)
+{
+    int ret;
+
+    ff_graph_frame_thread_lock(ctx->graph);
+    ret = get_frame_internal(ctx, frame, flags, samples);
+    ff_graph_frame_thread_unlock(ctx->graph);
+    return ret;
+}
+
 int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
 {
-    return get_frame_internal(ctx, frame, flags, ctx->inputs[0]->min_samples);
+    return get_frame_locked(ctx, frame, flags, ctx->inputs[0]->min_samples);
 }
 
 int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
                                                   AVFrame *frame, int nb_samples)
 {
-    return get_frame_internal(ctx, frame, 0, nb_samples);
+    return get_frame_locked(ctx, frame, 0, nb_samples);
 }
 
 AVBufferSinkParams *av_buffersink_params_alloc(void)
@@ -351,6 +362,7 @@ AVFilter ff_vsink_buffer = {
 
     .query_formats = vsink_query_formats,
     .activate    = activate,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_LOCKED,
     .inputs      = avfilter_vsink_buffer_inputs,
     .outputs     = NULL,
 };
@@ -372,6 +384,7 @@ AVFilter ff_asink_abuffer = {
 
     .query_formats = asink_query_formats,
     .activate    = activate,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_LOCKED,
     .inputs      = avfilter_asink_abuffer_inputs,
     .outputs     = NULL,
 };
@@ -33,11 +33,16 @@
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/samplefmt.h"
+
+#define FF_INTERNAL_FIELDS 1
+#include "framequeue.h"
+
 #include "audio.h"
 #include "avfilter.h"
 #include "buffersrc.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 #include "video.h"
 
 typedef struct BufferSourceContext {
@@ -160,23 +165,44 @@ int attribute_align_arg av_buffersrc_add_frame_flags(AVFilterContext *ctx, AVFra
         return AVERROR(EINVAL);
     }
 
-    if (!(flags & AV_BUFFERSRC_FLAG_KEEP_REF) || !frame)
-        return av_buffersrc_add_frame_internal(ctx, frame, flags);
+    if (!(flags & AV_BUFFERSRC_FLAG_KEEP_REF) || !frame) {
+        ff_graph_frame_thread_lock(ctx->graph);
+        ret = av_buffersrc_add_frame_internal(ctx, frame, flags);
+        ff_graph_frame_thread_unlock(ctx->graph);
+        return ret;
+    }
 
     if (!(copy = av_frame_alloc()))
         return AVERROR(ENOMEM);
     ret = av_frame_ref(copy, frame);
-    if (ret >= 0)
+    if (ret >= 0) {
+        ff_graph_frame_thread_lock(ctx->graph);
         ret = av_buffersrc_add_frame_internal(ctx, copy, flags);
+        ff_graph_frame_thread_unlock(ctx->graph);
+    }
 
     av_frame_free(&copy);
     return ret;
 }
 
-static int push_frame(AVFilterGraph *graph)
+static int push_frame(AVFilterGraph *graph, AVFilterLink *outlink)
 {
     int ret;
 
+    if (ff_graph_frame_thread_active(graph)) {
+        /* The workers take care of the processing, only wait for the
+           filters downstream to keep up. */
+        while (ff_framequeue_queued_frames(&outlink->fifo) >=
+               FF_FRAME_THREAD_QUEUE_SIZE) {
+            ret = ff_graph_frame_thread_wait(graph);
+            if (ret == AVERROR(EAGAIN))
+                break;
+            if (ret < 0)
+                return ret;
+        }
+        return ff_graph_frame_thread_error(graph);
+    }
+
     while (1) {
         ret = ff_filter_graph_run_once(graph);
         if (ret == AVERROR(EAGAIN))
@@ -200,7 +226,7 @@ static int av_buffersrc_add_frame_internal(AVFilterContext *ctx,
         s->eof = 1;
         ff_avfilter_link_set_in_status(ctx->outputs[0], AVERROR_EOF, AV_NOPTS_VALUE);
         if ((flags & AV_BUFFERSRC_FLAG_PUSH)) {
-            ret = push_frame(ctx->graph);
+            ret = push_frame(ctx->graph, ctx->outputs[0]);
             if (ret < 0)
                 return ret;
         }
@@ -259,7 +285,7 @@ static int av_buffersrc_add_frame_internal(AVFilterContext *ctx,
         return ret;
 
     if ((flags & AV_BUFFERSRC_FLAG_PUSH)) {
-        ret = push_frame(ctx->graph);
+        ret = push_frame(ctx->graph, ctx->outputs[0]);
         if (ret < 0)
             return ret;
     }
@@ -509,6 +535,7 @@ AVFilter ff_vsrc_buffer = {
     .uninit    = uninit,
 
     .inputs    = NULL,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_LOCKED,
     .outputs   = avfilter_vsrc_buffer_outputs,
     .priv_class = &buffer_class,
 };
@@ -534,6 +561,7 @@ AVFilter ff_asrc_abuffer = {
     .uninit    = uninit,
 
     .inputs    = NULL,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_LOCKED,
     .outputs   = avfilter_asrc_abuffer_outputs,
     .priv_class = &abuffer_class,
 };
@@ -66,6 +66,7 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
 
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
+        AVFilterStats stats;
         unsigned max_src_name = 0, max_dst_name = 0;
         unsigned max_in_name  = 0, max_out_name = 0;
         unsigned max_in_fmt   = 0, max_out_fmt  = 0;
@@ -148,6 +149,14 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
         av_bprintf(buf, "+");
         av_bprint_chars(buf, '-', width);
         av_bprintf(buf, "+\n");
+        if (avfilter_get_stats(filter, &stats) >= 0) {
+            av_bprint_chars(buf, ' ', in_indent);
+            av_bprintf(buf, "frames in:%"PRId64" out:%"PRId64" wall:%.3fs cpu:%.3fs "
+                       "max queued:%"PRId64" pool:%"PRId64"kB\n",
+                       stats.frames_in, stats.frames_out,
+                       stats.wall_time / 1000000.0, stats.cpu_time / 1000000.0,
+                       stats.max_queued, stats.pool_bytes >> 10);
+        }
         av_bprintf(buf, "\n");
     }
 }
@@ -159,7 +168,8 @@ char *avfilter_graph_dump(AVFilterGraph *graph, const char *options)
 
     av_bprint_init(&buf, 0, 0);
     avfilter_graph_dump_to_buf(&buf, graph);
-    av_bprint_init(&buf, buf.len + 1, buf.len + 1);
+    /* the statistics may change while the graph is running */
+    av_bprint_init(&buf, buf.len + 1, AV_BPRINT_SIZE_UNLIMITED);
     avfilter_graph_dump_to_buf(&buf, graph);
     av_bprint_finalize(&buf, &dump);
     return dump;
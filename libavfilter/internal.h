@@ -149,12 +149,26 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+    void *frame_thread;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+    int busy;   ///< being activated by a frame threading worker
+
+    /* statistics, when AVFilterGraph.stats is set */
+    int64_t wall_time, cpu_time;
+    int64_t wall_start, cpu_start;
+    int64_t max_queued;
+    int64_t pool_bytes;
 };
 
+/**
+ * Account a frame obtained from the frame pool of link to the statistics of
+ * its source filter.
+ */
+void ff_filter_stats_pool_frame(AVFilterLink *link, const AVFrame *frame);
+
 /**
  * Tell if an integer is contained in the provided -1-terminated list of integers.
  * This is useful for determining (for instance) if an AVPixelFormat is in an
@@ -392,8 +406,18 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter state is shared with the application through a public API
+ * (buffer sources and sinks). With frame threading, its callbacks always
+ * run with the graph lock held.
+ */
+#define FF_FILTER_FLAG_GRAPH_LOCKED (1 << 1)
+
 /**
  * Run one round of processing on a filter graph.
+ *
+ * With frame threading, the filters are activated by the worker threads and
+ * this waits for one of them to complete an activation instead.
  */
 int ff_filter_graph_run_once(AVFilterGraph *graph);
 
@@ -23,11 +23,15 @@
 
 #include "config.h"
 
+#include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
 #include "libavutil/mem.h"
 #include "libavutil/thread.h"
 
+#define FF_INTERNAL_FIELDS 1
+#include "framequeue.h"
+
 #include "avfilter.h"
 #include "internal.h"
 #include "thread.h"
@@ -222,3 +226,329 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+#if HAVE_PTHREADS
+typedef struct FrameThreadContext {
+    AVFilterGraph *graph;
+
+    int nb_workers;
+    pthread_t *workers;
+
+    /* protects the scheduling state of the whole graph: links, frame
+       queues, filters ready status and the fields below; it is taken
+       recursively, lock_depth counts the levels held by the owner */
+    pthread_mutex_t lock;
+    int lock_depth;
+    pthread_cond_t work_cond;       ///< a filter may have become runnable
+    pthread_cond_t progress_cond;   ///< an activation completed
+
+    unsigned progress;
+    int nb_busy;
+    int error;
+    int done;
+
+    /* slice threading is shared by all the workers */
+    pthread_mutex_t execute_lock;
+    avfilter_execute_func *execute;
+} FrameThreadContext;
+
+static void frame_thread_lock(FrameThreadContext *c)
+{
+    pthread_mutex_lock(&c->lock);
+    c->lock_depth++;
+}
+
+static void frame_thread_unlock(FrameThreadContext *c)
+{
+    c->lock_depth--;
+    pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * Wait on one of the conditions of the graph. Waiting releases the lock
+ * only once, so the caller must not hold it recursively: the other threads
+ * could never take it.
+ */
+static void frame_thread_cond_wait(FrameThreadContext *c, pthread_cond_t *cond)
+{
+    av_assert0(c->lock_depth == 1);
+    c->lock_depth = 0;
+    pthread_cond_wait(cond, &c->lock);
+    c->lock_depth = 1;
+}
+
+/* Must be called with the lock held. */
+static int frame_thread_is_worker(FrameThreadContext *c)
+{
+    pthread_t self = pthread_self();
+    int i;
+
+    for (i = 0; i < c->nb_workers; i++)
+        if (pthread_equal(c->workers[i], self))
+            return 1;
+    return 0;
+}
+
+static int outputs_full(AVFilterContext *filter)
+{
+    unsigned i;
+
+    if (!filter->nb_outputs)
+        return 0;
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (ff_framequeue_queued_frames(&filter->outputs[i]->fifo) <
+            FF_FRAME_THREAD_QUEUE_SIZE)
+            return 0;
+    return 1;
+}
+
+/**
+ * Select the filter to activate next: the ready filter with the highest
+ * priority that is not already being activated, skipping the filters whose
+ * outputs are all full as long as some other thread can make the queues
+ * drain.
+ */
+static AVFilterContext *pick_filter(FrameThreadContext *c)
+{
+    AVFilterGraph *graph = c->graph;
+    AVFilterContext *best = NULL, *blocked = NULL;
+    unsigned i;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (!filter->ready || filter->internal->busy)
+            continue;
+        if (outputs_full(filter)) {
+            if (!blocked || filter->ready > blocked->ready)
+                blocked = filter;
+        } else if (!best || filter->ready > best->ready) {
+            best = filter;
+        }
+    }
+    if (!best && !c->nb_busy)
+        best = blocked;
+    return best;
+}
+
+static void* attribute_align_arg frame_worker(void *v)
+{
+    FrameThreadContext *c = v;
+    AVFilterContext *filter;
+    int ret;
+
+    frame_thread_lock(c);
+    while (!c->done) {
+        if (!(filter = pick_filter(c))) {
+            frame_thread_cond_wait(c, &c->work_cond);
+            continue;
+        }
+
+        filter->internal->busy = 1;
+        c->nb_busy++;
+        ret = ff_filter_activate(filter);
+        filter->internal->busy = 0;
+        c->nb_busy--;
+
+        if (ret < 0 && ret != AVERROR(EAGAIN) && !c->error)
+            c->error = ret;
+        c->progress++;
+        pthread_cond_broadcast(&c->progress_cond);
+        pthread_cond_broadcast(&c->work_cond);
+    }
+    frame_thread_unlock(c);
+
+    return NULL;
+}
+
+static int frame_thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                                void *arg, int *ret, int nb_jobs)
+{
+    FrameThreadContext *c = ctx->graph->internal->frame_thread;
+    int err;
+
+    pthread_mutex_lock(&c->execute_lock);
+    err = c->execute(ctx, func, arg, ret, nb_jobs);
+    pthread_mutex_unlock(&c->execute_lock);
+
+    return err;
+}
+
+static void frame_thread_uninit(FrameThreadContext *c)
+{
+    int i;
+
+    frame_thread_lock(c);
+    c->done = 1;
+    pthread_cond_broadcast(&c->work_cond);
+    frame_thread_unlock(c);
+
+    for (i = 0; i < c->nb_workers; i++)
+        pthread_join(c->workers[i], NULL);
+
+    pthread_cond_destroy(&c->progress_cond);
+    pthread_cond_destroy(&c->work_cond);
+    pthread_mutex_destroy(&c->execute_lock);
+    pthread_mutex_destroy(&c->lock);
+    av_freep(&c->workers);
+}
+
+int ff_graph_frame_thread_init(AVFilterGraph *graph)
+{
+    FrameThreadContext *c;
+    pthread_mutexattr_t attr;
+    int i, ret = 0, nb_workers = graph->nb_threads;
+
+    if (!(graph->thread_type & AVFILTER_THREAD_FRAME) ||
+        graph->internal->frame_thread)
+        return 0;
+
+    if (!nb_workers)
+        nb_workers = av_cpu_count() + 1;
+    if (nb_workers <= 1 || graph->nb_filters < 2)
+        return 0;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->workers = av_mallocz_array(nb_workers, sizeof(*c->workers));
+    if (!c->workers) {
+        av_free(c);
+        return AVERROR(ENOMEM);
+    }
+    c->graph = graph;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&c->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&c->execute_lock, NULL);
+    pthread_cond_init(&c->work_cond, NULL);
+    pthread_cond_init(&c->progress_cond, NULL);
+
+    if (graph->internal->thread_execute) {
+        c->execute = graph->internal->thread_execute;
+        graph->internal->thread_execute = frame_thread_execute;
+        for (i = 0; i < graph->nb_filters; i++)
+            if (graph->filters[i]->internal->execute == c->execute)
+                graph->filters[i]->internal->execute = frame_thread_execute;
+    }
+    graph->internal->frame_thread = c;
+
+    /* the workers array is read under the lock by frame_thread_is_worker() */
+    frame_thread_lock(c);
+    for (i = 0; i < nb_workers; i++) {
+        if ((ret = pthread_create(&c->workers[i], NULL, frame_worker, c)))
+            break;
+        c->nb_workers++;
+    }
+    frame_thread_unlock(c);
+    if (ret) {
+        ff_graph_frame_thread_free(graph);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+void ff_graph_frame_thread_free(AVFilterGraph *graph)
+{
+    FrameThreadContext *c = graph->internal->frame_thread;
+    int i;
+
+    if (!c)
+        return;
+
+    frame_thread_uninit(c);
+
+    if (c->execute) {
+        graph->internal->thread_execute = c->execute;
+        for (i = 0; i < graph->nb_filters; i++)
+            if (graph->filters[i]->internal->execute == frame_thread_execute)
+                graph->filters[i]->internal->execute = c->execute;
+    }
+    av_freep(&graph->internal->frame_thread);
+}
+
+void ff_graph_frame_thread_lock(AVFilterGraph *graph)
+{
+    FrameThreadContext *c = graph ? graph->internal->frame_thread : NULL;
+
+    if (c)
+        frame_thread_lock(c);
+}
+
+void ff_graph_frame_thread_unlock(AVFilterGraph *graph)
+{
+    FrameThreadContext *c = graph ? graph->internal->frame_thread : NULL;
+
+    if (c)
+        frame_thread_unlock(c);
+}
+
+void ff_graph_frame_thread_notify(AVFilterGraph *graph)
+{
+    FrameThreadContext *c = graph ? graph->internal->frame_thread : NULL;
+
+    if (c)
+        pthread_cond_broadcast(&c->work_cond);
+}
+
+int ff_graph_frame_thread_error(AVFilterGraph *graph)
+{
+    FrameThreadContext *c = graph->internal->frame_thread;
+    int ret;
+
+    if (!c)
+        return 0;
+    ret = c->error;
+    c->error = 0;
+    return ret;
+}
+
+int ff_graph_frame_thread_wait(AVFilterGraph *graph)
+{
+    FrameThreadContext *c = graph->internal->frame_thread;
+    unsigned progress = c->progress;
+    unsigned i;
+
+    if (c->error)
+        return ff_graph_frame_thread_error(graph);
+
+    if (!c->nb_busy) {
+        for (i = 0; i < graph->nb_filters; i++)
+            if (graph->filters[i]->ready)
+                break;
+        if (i == graph->nb_filters)
+            return AVERROR(EAGAIN);
+    }
+
+    while (progress == c->progress)
+        frame_thread_cond_wait(c, &c->progress_cond);
+
+    return ff_graph_frame_thread_error(graph);
+}
+
+void ff_graph_frame_thread_wait_idle(AVFilterGraph *graph)
+{
+    FrameThreadContext *c = graph->internal->frame_thread;
+    int self;
+
+    if (!c)
+        return;
+    /* a worker calling this from a filter callback (e.g. sendcmd) does not
+       run filter code while it waits, and keeps the lock until it is done */
+    self = frame_thread_is_worker(c);
+    c->nb_busy -= self;
+    if (self)
+        pthread_cond_broadcast(&c->progress_cond);
+    while (c->nb_busy)
+        frame_thread_cond_wait(c, &c->progress_cond);
+    c->nb_busy += self;
+}
+
+int ff_graph_frame_thread_active(AVFilterGraph *graph)
+{
+    return graph && graph->internal->frame_thread;
+}
+#endif /* HAVE_PTHREADS */
@@ -25,4 +25,63 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Start the frame threading workers if AVFILTER_THREAD_FRAME is set in
+ * graph->thread_type. Must be called once the graph is configured.
+ */
+int ff_graph_frame_thread_init(AVFilterGraph *graph);
+
+/**
+ * Number of frames a link may hold before frame threading stops activating
+ * its source filter.
+ */
+#define FF_FRAME_THREAD_QUEUE_SIZE 4
+
+/**
+ * Stop the frame threading workers, if any.
+ */
+void ff_graph_frame_thread_free(AVFilterGraph *graph);
+
+/**
+ * Lock and unlock the graph scheduling state (links, frame queues, ready
+ * status) against the frame threading workers. The lock is recursive.
+ * These are no-ops if frame threading is not active.
+ */
+void ff_graph_frame_thread_lock(AVFilterGraph *graph);
+void ff_graph_frame_thread_unlock(AVFilterGraph *graph);
+
+/**
+ * Wake up the workers after a filter became ready. Must be called with
+ * the graph lock held.
+ */
+void ff_graph_frame_thread_notify(AVFilterGraph *graph);
+
+/**
+ * Wait for the workers to complete at least one filter activation. Must be
+ * called with the graph lock held exactly once.
+ *
+ * @return 0 on progress, AVERROR(EAGAIN) if no filter is ready nor being
+ *         activated, or an error returned by a filter activation
+ */
+int ff_graph_frame_thread_wait(AVFilterGraph *graph);
+
+/**
+ * Return and clear the first error returned by a filter activation on a
+ * worker since the last call, 0 if none. Must be called with the graph lock
+ * held.
+ */
+int ff_graph_frame_thread_error(AVFilterGraph *graph);
+
+/**
+ * Wait until no worker is running any filter code. As long as the caller
+ * keeps holding the graph lock afterwards, no filter will be activated.
+ * Must be called with the graph lock held exactly once.
+ */
+void ff_graph_frame_thread_wait_idle(AVFilterGraph *graph);
+
+/**
+ * @return non-zero if frame threading is active on the graph
+ */
+int ff_graph_frame_thread_active(AVFilterGraph *graph);
+
 #endif /* AVFILTER_THREAD_H */
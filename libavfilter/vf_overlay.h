@@ -0,0 +1,53 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_OVERLAY_H
+#define AVFILTER_OVERLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum OverlayBlendRow {
+    OVERLAY_BLEND_ROW_444,      ///< plane not subsampled
+    OVERLAY_BLEND_ROW_422,      ///< plane horizontally subsampled
+    OVERLAY_BLEND_ROW_420,      ///< plane horizontally and vertically subsampled
+    OVERLAY_BLEND_ROW_NB
+};
+
+typedef struct OverlayDSPContext {
+    /**
+     * Blend w pixels of an overlay plane row onto a main plane row which
+     * has no alpha channel and a pixel step of 1.
+     *
+     * @param d         main plane row
+     * @param s         overlay plane row
+     * @param a         overlay alpha row matching s; for the 420 variant the
+     *                  row at a + alinesize is read as well
+     * @param w         number of pixels of s to blend
+     * @param alinesize linesize of the overlay alpha plane
+     * @return number of pixels blended, the caller handles the remaining ones
+     */
+    int (*blend_row[OVERLAY_BLEND_ROW_NB])(uint8_t *d, const uint8_t *s,
+                                           const uint8_t *a, int w,
+                                           ptrdiff_t alinesize);
+} OverlayDSPContext;
+
+void ff_overlay_dsp_init(OverlayDSPContext *dsp);
+void ff_overlay_dsp_init_x86(OverlayDSPContext *dsp);
+
+#endif /* AVFILTER_OVERLAY_H */
@@ -300,6 +300,8 @@ static int config_props(AVFilterLink *outlink)
             av_opt_set_int(*s, "sws_flags", scale->flags, 0);
             av_opt_set_int(*s, "param0", scale->param[0], 0);
             av_opt_set_int(*s, "param1", scale->param[1], 0);
+            if (!i)
+                av_opt_set_int(*s, "threads", ff_filter_get_nb_threads(ctx), 0);
             if (scale->in_range != AVCOL_RANGE_UNSPECIFIED)
                 av_opt_set_int(*s, "src_range",
                                scale->in_range == AVCOL_RANGE_JPEG, 0);
@@ -400,6 +402,28 @@ static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, s
                          out,out_stride);
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int scale_band(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ScaleContext *scale = ctx->priv;
+    ThreadData *td = arg;
+    const uint8_t *in[4];
+    uint8_t *out[4];
+    int i, ret;
+
+    for (i = 0; i < 4; i++) {
+        in[i]  = td->in->data[i];
+        out[i] = td->out->data[i];
+    }
+
+    ret = sws_scale_band(scale->sws, in, td->in->linesize,
+                         out, td->out->linesize, jobnr, nb_jobs);
+    return ret < 0 ? ret : 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     ScaleContext *scale = link->dst->priv;
@@ -517,7 +541,13 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
             scale_slice(link, out, in, scale->sws, slice_start, slice_h, 1, 0);
         }
     }else{
-        scale_slice(link, out, in, scale->sws, 0, link->h, 1, 0);
+        const int nb_jobs = FFMIN(sws_get_band_count(scale->sws),
+                                  ff_filter_get_nb_threads(link->dst));
+        if (nb_jobs > 1) {
+            ThreadData td = { .in = in, .out = out };
+            link->dst->internal->execute(link->dst, scale_band, &td, NULL, nb_jobs);
+        } else
+            scale_slice(link, out, in, scale->sws, 0, link->h, 1, 0);
     }
 
     av_frame_free(&in);
@@ -637,6 +667,7 @@ AVFilter ff_vf_scale = {
     .inputs          = avfilter_vf_scale_inputs,
     .outputs         = avfilter_vf_scale_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
 
 static const AVClass scale2ref_class = {
@@ -689,4 +720,5 @@ AVFilter ff_vf_scale2ref = {
     .inputs          = avfilter_vf_scale2ref_inputs,
     .outputs         = avfilter_vf_scale2ref_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -31,6 +31,7 @@
 
 #include "avfilter.h"
 #include "internal.h"
+#include "thread.h"
 #include "video.h"
 
 #define BUFFER_ALIGN 32
@@ -41,27 +42,13 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
     return ff_get_video_buffer(link->dst->outputs[0], w, h);
 }
 
-AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
+static AVFrame *pool_get_video_buffer(AVFilterLink *link, int w, int h)
 {
     int pool_width = 0;
     int pool_height = 0;
     int pool_align = 0;
     enum AVPixelFormat pool_format = AV_PIX_FMT_NONE;
-
-    if (link->hw_frames_ctx &&
-        ((AVHWFramesContext*)link->hw_frames_ctx->data)->format == link->format) {
-        int ret;
-        AVFrame *frame = av_frame_alloc();
-
-        if (!frame)
-            return NULL;
-
-        ret = av_hwframe_get_buffer(link->hw_frames_ctx, frame, 0);
-        if (ret < 0)
-            av_frame_free(&frame);
-
-        return frame;
-    }
+    AVFrame *frame;
 
     if (!link->frame_pool) {
         link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
@@ -86,7 +73,38 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
         }
     }
 
-    return ff_frame_pool_get(link->frame_pool);
+    frame = ff_frame_pool_get(link->frame_pool);
+    if (frame && link->src->graph->stats)
+        ff_filter_stats_pool_frame(link, frame);
+    return frame;
+}
+
+AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
+{
+    AVFrame *frame;
+
+    if (link->hw_frames_ctx &&
+        ((AVHWFramesContext*)link->hw_frames_ctx->data)->format == link->format) {
+        int ret;
+
+        frame = av_frame_alloc();
+        if (!frame)
+            return NULL;
+
+        ret = av_hwframe_get_buffer(link->hw_frames_ctx, frame, 0);
+        if (ret < 0)
+            av_frame_free(&frame);
+
+        return frame;
+    }
+
+    /* the pool may be reinitialized, which must not race with the filters
+       running on other frame threading workers */
+    ff_graph_frame_thread_lock(link->dst->graph);
+    frame = pool_get_video_buffer(link, w, h);
+    ff_graph_frame_thread_unlock(link->dst->graph);
+
+    return frame;
 }
 
 AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h)
@@ -0,0 +1,107 @@
+;*****************************************************************************
+;* x86-optimized functions for overlay filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA
+
+pw_128: times 8 dw 128
+pw_255: times 8 dw 255
+pw_257: times 8 dw 257
+
+SECTION .text
+
+; in: m0 = overlay, m1 = main, m2 = alpha, unpacked to words
+; out: m0 = packed FAST_DIV255(main * (255 - alpha) + overlay * alpha)
+%macro BLEND 0
+    mova            m3, [pw_255]
+    psubw           m3, m2
+    pmullw          m0, m2
+    pmullw          m1, m3
+    paddw           m0, m1
+    paddw           m0, [pw_128]
+    pmulhuw         m0, [pw_257]
+    packuswb        m0, m0
+%endmacro
+
+; int ff_overlay_row_%1(uint8_t *d, const uint8_t *s, const uint8_t *a,
+;                       int w, ptrdiff_t alinesize)
+%macro OVERLAY_ROW 1 ; 444, 422 or 420
+cglobal overlay_row_%1, 5, 6, 6, d, s, a, w, alinesize, x
+    movsxdifnidn    wq, wd
+    and             wq, ~(mmsize/2 - 1)
+    jz .end
+    add             dq, wq
+    add             sq, wq
+%if %1 == 444
+    add             aq, wq
+%else
+    lea             aq, [aq + wq*2]
+%if %1 == 420
+    add     alinesizeq, aq
+%endif
+%endif
+    mov             xq, wq
+    neg             xq
+    pxor            m4, m4
+
+.loop:
+    movh            m0, [sq + xq]
+    movh            m1, [dq + xq]
+    punpcklbw       m0, m4
+    punpcklbw       m1, m4
+%if %1 == 444
+    movh            m2, [aq + xq]
+    punpcklbw       m2, m4
+%else
+    movu            m2, [aq + xq*2]
+    mova            m3, m2
+    psrlw           m3, 8
+    pand            m2, [pw_255]
+%if %1 == 422
+    paddw           m3, m2          ; a[0] + a[1]
+    psrlw           m3, 1
+    paddw           m2, m3
+    psrlw           m2, 1           ; (a[0] + ((a[0] + a[1]) >> 1)) >> 1
+%else
+    paddw           m2, m3
+    movu            m5, [alinesizeq + xq*2]
+    mova            m3, m5
+    psrlw           m3, 8
+    pand            m5, [pw_255]
+    paddw           m2, m5
+    paddw           m2, m3
+    psrlw           m2, 2           ; 2x2 alpha average
+%endif
+%endif
+    BLEND
+    movh     [dq + xq], m0
+    add             xq, mmsize/2
+    jl .loop
+
+.end:
+    mov            eax, wd
+    RET
+%endmacro
+
+INIT_XMM sse2
+OVERLAY_ROW 444
+OVERLAY_ROW 422
+OVERLAY_ROW 420
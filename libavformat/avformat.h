@@ -1474,6 +1474,7 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Wait for packet data before writing a header, and add bitstream filters as requested by the muxer
+#define AVFMT_FLAG_SHARE_IO_BUFFER 0x400000 ///< Let packets reference the input buffer instead of copying their data. Demuxing only, ignored with a custom AVIOContext.
 
     /**
      * Maximum size of the data read from input for determining
@@ -2324,6 +2325,23 @@ int av_find_best_stream(AVFormatContext *ic,
  */
 int av_read_frame(AVFormatContext *s, AVPacket *pkt);
 
+/**
+ * Read several frames of a stream at once.
+ *
+ * This is equivalent to calling av_read_frame() up to nb_pkts times, but the
+ * per call bookkeeping is done only once, which matters for streams with a
+ * high packet rate. For non-seekable input, fewer packets are returned if
+ * reading more would require waiting for new data.
+ *
+ * @param pkts    array of at least nb_pkts packets, which are overwritten
+ *                and must each be freed with av_packet_unref() by the caller
+ * @param nb_pkts maximum number of packets to read, must be positive
+ * @return the number of packets read, which are stored at the start of pkts,
+ *         or < 0 on error or end of file. An error which occurs after some
+ *         packets were read is returned by the next call.
+ */
+int av_read_frames(AVFormatContext *s, AVPacket *pkts, int nb_pkts);
+
 /**
  * Seek to the keyframe at timestamp.
  * 'timestamp' in 'stream_index'.
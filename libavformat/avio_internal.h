@@ -24,6 +24,8 @@
 
 #include "libavutil/log.h"
 
+struct AVPacket;
+
 extern const AVClass ff_avio_class;
 
 int ffio_init_context(AVIOContext *s,
@@ -53,6 +55,29 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Allow packets to reference the I/O buffer of s, see
+ * ffio_read_packet_ref(). Once enabled, the buffer is only overwritten if
+ * no packet references it anymore, a new one is allocated otherwise.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if s was not opened by
+ *         ffio_fdopen() for reading
+ */
+int ffio_share_buffer(AVIOContext *s);
+
+/**
+ * Read size bytes from s into pkt without copying them, by making pkt
+ * reference the I/O buffer, if ffio_share_buffer() was called on s and
+ * the data is already buffered.
+ *
+ * The data of such packets is not writable and is followed by stream
+ * data rather than zeroes.
+ *
+ * @return size on success, 0 if nothing was read and the data must be
+ *         read with other functions, a negative error code on failure
+ */
+int ffio_read_packet_ref(AVIOContext *s, struct AVPacket *pkt, int size);
+
 /**
  * Read size bytes from AVIOContext into buf.
  * This reads at most 1 packet. If that is not enough fewer bytes will be
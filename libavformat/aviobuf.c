@@ -44,6 +44,16 @@
 
 typedef struct AVIOInternal {
     URLContext *h;
+
+    /**
+     * Set by ffio_share_buffer(). buffer_ref references s->buffer if it is
+     * allocated to be shared with packets, NULL otherwise. Such buffers come
+     * from buffer_pool, which holds buffers of buffer_pool_size bytes.
+     */
+    int share_buffer;
+    AVBufferRef *buffer_ref;
+    AVBufferPool *buffer_pool;
+    int buffer_pool_size;
 } AVIOInternal;
 
 static void *ff_avio_child_next(void *obj, void *prev)
@@ -77,6 +87,32 @@ const AVClass ff_avio_class = {
 
 static void fill_buffer(AVIOContext *s);
 static int url_resetbuf(AVIOContext *s, int flags);
+static int io_read_packet(void *opaque, uint8_t *buf, int buf_size);
+
+static AVIOInternal *shared_buffer_internal(AVIOContext *s)
+{
+    AVIOInternal *internal = s->opaque;
+
+    if (s->read_packet != io_read_packet || !internal->share_buffer)
+        return NULL;
+    return internal;
+}
+
+/**
+ * Free s->buffer, or only drop our reference to it if packets may be
+ * using it.
+ */
+static void free_buffer(AVIOContext *s)
+{
+    AVIOInternal *internal = shared_buffer_internal(s);
+
+    if (internal && internal->buffer_ref) {
+        av_buffer_unref(&internal->buffer_ref);
+        s->buffer = NULL;
+    } else {
+        av_freep(&s->buffer);
+    }
+}
 
 int ffio_init_context(AVIOContext *s,
                   unsigned char *buffer,
@@ -524,6 +560,8 @@ static void fill_buffer(AVIOContext *s)
     uint8_t *dst        = s->buf_end - s->buffer + max_buffer_size < s->buffer_size ?
                           s->buf_end : s->buffer;
     int len             = s->buffer_size - (dst - s->buffer);
+    AVIOInternal *internal = shared_buffer_internal(s);
+    AVBufferRef *new_buf = NULL;
 
     /* can't fill the buffer without read_packet, just set EOF if appropriate */
     if (!s->read_packet && s->buf_ptr >= s->buf_end)
@@ -553,6 +591,22 @@ static void fill_buffer(AVIOContext *s)
         len = s->orig_buffer_size;
     }
 
+    /* packets may still reference the data we would overwrite,
+       read into a new buffer in that case */
+    if (internal && dst == s->buffer &&
+        (!internal->buffer_ref || !av_buffer_is_writable(internal->buffer_ref))) {
+        if (internal->buffer_pool_size != s->buffer_size) {
+            av_buffer_pool_uninit(&internal->buffer_pool);
+            internal->buffer_pool = av_buffer_pool_init(s->buffer_size + AV_INPUT_BUFFER_PADDING_SIZE,
+                                                        av_buffer_allocz);
+            internal->buffer_pool_size = internal->buffer_pool ? s->buffer_size : 0;
+        }
+        if (internal->buffer_pool)
+            new_buf = av_buffer_pool_get(internal->buffer_pool);
+        if (new_buf)
+            dst = new_buf->data;
+    }
+
     if (s->read_packet)
         len = s->read_packet(s->opaque, dst, len);
     else
@@ -563,7 +617,15 @@ static void fill_buffer(AVIOContext *s)
         s->eof_reached = 1;
         if (len < 0)
             s->error = len;
+        av_buffer_unref(&new_buf);
     } else {
+        if (new_buf) {
+            free_buffer(s);
+            internal->buffer_ref = new_buf;
+            s->buffer = new_buf->data;
+            if (s->update_checksum)
+                s->checksum_ptr = s->buffer;
+        }
         s->pos += len;
         s->buf_ptr = dst;
         s->buf_end = dst + len;
@@ -687,6 +749,32 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
     }
 }
 
+int ffio_share_buffer(AVIOContext *s)
+{
+    if (s->read_packet != io_read_packet || s->write_flag)
+        return AVERROR(ENOSYS);
+    ((AVIOInternal *)s->opaque)->share_buffer = 1;
+    return 0;
+}
+
+int ffio_read_packet_ref(AVIOContext *s, AVPacket *pkt, int size)
+{
+    AVIOInternal *internal = shared_buffer_internal(s);
+
+    /* the padding must not change while the packet is in use either */
+    if (!internal || !internal->buffer_ref || size <= 0 ||
+        s->buf_end - s->buf_ptr < size + AV_INPUT_BUFFER_PADDING_SIZE)
+        return 0;
+
+    pkt->buf = av_buffer_ref(internal->buffer_ref);
+    if (!pkt->buf)
+        return AVERROR(ENOMEM);
+    pkt->data   = s->buf_ptr;
+    pkt->size   = size;
+    s->buf_ptr += size;
+    return size;
+}
+
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -973,9 +1061,9 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
         return AVERROR(ENOMEM);
 
     memcpy(buffer, s->buffer, filled);
-    av_free(s->buffer);
     s->buf_ptr = buffer + (s->buf_ptr - s->buffer);
     s->buf_end = buffer + (s->buf_end - s->buffer);
+    free_buffer(s);
     s->buffer = buffer;
     s->buffer_size = buf_size;
     if (checksum_ptr_offset >= 0)
@@ -990,7 +1078,7 @@ int ffio_set_buf_size(AVIOContext *s, int buf_size)
     if (!buffer)
         return AVERROR(ENOMEM);
 
-    av_free(s->buffer);
+    free_buffer(s);
     s->buffer = buffer;
     s->orig_buffer_size =
     s->buffer_size = buf_size;
@@ -1046,7 +1134,7 @@ int ffio_rewind_with_probe_data(AVIOContext *s, unsigned char **bufp, int buf_si
         buf_size = new_size;
     }
 
-    av_free(s->buffer);
+    free_buffer(s);
     s->buf_ptr = s->buffer = buf;
     s->buffer_size = alloc_size;
     s->pos = buf_size;
@@ -1105,8 +1193,9 @@ int avio_close(AVIOContext *s)
     internal = s->opaque;
     h        = internal->h;
 
+    free_buffer(s);
+    av_buffer_pool_uninit(&internal->buffer_pool);
     av_freep(&s->opaque);
-    av_freep(&s->buffer);
     if (s->write_flag)
         av_log(s, AV_LOG_DEBUG, "Statistics: %d seeks, %d writeouts\n", s->seek_count, s->writeout_count);
     else
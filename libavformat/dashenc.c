@@ -38,6 +38,7 @@
 #include "internal.h"
 #include "isom.h"
 #include "os_support.h"
+#include "uploadqueue.h"
 #include "url.h"
 
 // See ISO/IEC 23009-1:2014 5.3.9.4.4
@@ -59,6 +60,13 @@ typedef struct Segment {
     int n;
 } Segment;
 
+typedef struct Part {
+    int seg_index;
+    int64_t start;      ///< offset within the segment file
+    int length;
+    int duration;
+} Part;
+
 typedef struct OutputStream {
     AVFormatContext *ctx;
     int ctx_inited;
@@ -76,6 +84,15 @@ typedef struct OutputStream {
     char bandwidth_str[64];
 
     char codec_str[100];
+
+    /* current media segment */
+    char filename[1024], full_path[1024], temp_path[1024];
+    int64_t seg_start_pos;
+    /* chunks of the recent segments, written in streaming mode */
+    int64_t chunk_start_pos, chunk_start_dts;
+    int seg_chunks_duration;
+    int nb_parts, parts_size;
+    Part *parts;
 } OutputStream;
 
 typedef struct DASHContext {
@@ -98,8 +115,21 @@ typedef struct DASHContext {
     const char *media_seg_name;
     AVRational min_frame_rate, max_frame_rate;
     int ambiguous_frame_rate;
+    int streaming;
+    int64_t frag_duration;
+    int hls_playlist;
+    int upload_threads;
+    int upload_queue_size;
+    int upload_retries;
+    UploadQueue *upload_queue;
 } DASHContext;
 
+/* the directory of the manifest followed by media_<index>.m3u8 or master.m3u8 */
+#define HLS_PLAYLIST_NAME_SIZE (sizeof(((DASHContext *)NULL)->dirname) + 32)
+
+/* chunk duration used for the EXT-X-PART partial segments by default */
+#define DEFAULT_HLS_PART_DURATION 500000
+
 static int dash_write(void *opaque, uint8_t *buf, int buf_size)
 {
     OutputStream *os = opaque;
@@ -186,14 +216,16 @@ static void dash_free(AVFormatContext *s)
             av_write_trailer(os->ctx);
         if (os->ctx && os->ctx->pb)
             av_free(os->ctx->pb);
-        ff_format_io_close(s, &os->out);
+        ff_upload_close(c->upload_queue, s, &os->out);
         if (os->ctx)
             avformat_free_context(os->ctx);
         for (j = 0; j < os->nb_segments; j++)
             av_free(os->segments[j]);
         av_free(os->segments);
+        av_free(os->parts);
     }
     av_freep(&c->streams);
+    ff_upload_queue_free(&c->upload_queue);
 }
 
 static void output_segment_list(OutputStream *os, AVIOContext *out, DASHContext *c)
@@ -209,7 +241,13 @@ static void output_segment_list(OutputStream *os, AVIOContext *out, DASHContext
         avio_printf(out, "\t\t\t\t<SegmentTemplate timescale=\"%d\" ", timescale);
         if (!c->use_timeline)
             avio_printf(out, "duration=\"%"PRId64"\" ", c->last_duration);
-        avio_printf(out, "initialization=\"%s\" media=\"%s\" startNumber=\"%d\">\n", c->init_seg_name, c->media_seg_name, c->use_timeline ? start_number : 1);
+        avio_printf(out, "initialization=\"%s\" media=\"%s\" startNumber=\"%d\"", c->init_seg_name, c->media_seg_name, c->use_timeline ? start_number : 1);
+        if (c->streaming) {
+            // Each segment can be requested as soon as its first chunk is out
+            int64_t offset = FFMAX(c->min_seg_duration - c->frag_duration, 0);
+            avio_printf(out, " availabilityTimeOffset=\"%.3f\" availabilityTimeComplete=\"false\"", offset / (double)AV_TIME_BASE);
+        }
+        avio_printf(out, ">\n");
         if (c->use_timeline) {
             int64_t cur_time = 0;
             avio_printf(out, "\t\t\t\t\t<SegmentTimeline>\n");
@@ -438,6 +476,163 @@ static void format_date_now(char *buf, int size)
     }
 }
 
+static int open_hls_playlist(AVFormatContext *s, AVIOContext **out,
+                             const char *filename, char *temp_filename,
+                             int temp_size)
+{
+    DASHContext *c = s->priv_data;
+    const char *proto = avio_find_protocol_name(s->filename);
+    int use_rename = proto && !strcmp(proto, "file");
+    int ret;
+
+    snprintf(temp_filename, temp_size, use_rename ? "%s.tmp" : "%s", filename);
+    ret = ff_upload_open(c->upload_queue, s, out, temp_filename, NULL, UPLOAD_ORDERED);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to open %s for writing\n", temp_filename);
+        return ret;
+    }
+    avio_printf(*out, "#EXTM3U\n");
+    avio_printf(*out, "#EXT-X-VERSION:6\n");
+    return 0;
+}
+
+static int close_hls_playlist(AVFormatContext *s, AVIOContext **out,
+                              const char *filename, const char *temp_filename)
+{
+    DASHContext *c = s->priv_data;
+
+    avio_flush(*out);
+    ff_upload_close(c->upload_queue, s, out);
+    if (strcmp(filename, temp_filename))
+        return avpriv_io_move(temp_filename, filename);
+    return 0;
+}
+
+static void write_hls_parts(AVFormatContext *s, AVIOContext *out, int idx,
+                            int seg_index, const char *uri)
+{
+    DASHContext *c = s->priv_data;
+    OutputStream *os = &c->streams[idx];
+    AVRational tb = os->ctx->streams[0]->time_base;
+    int audio = s->streams[idx]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
+    int i, first = 1;
+
+    for (i = 0; i < os->nb_parts; i++) {
+        Part *part = &os->parts[i];
+        if (part->seg_index != seg_index)
+            continue;
+        avio_printf(out, "#EXT-X-PART:DURATION=%.3f,URI=\"%s\",BYTERANGE=\"%d@%"PRId64"\"%s\n",
+                    part->duration * av_q2d(tb), uri, part->length, part->start,
+                    first || audio ? ",INDEPENDENT=YES" : "");
+        first = 0;
+    }
+}
+
+static int write_hls_media_playlist(AVFormatContext *s, int idx, int final)
+{
+    DASHContext *c = s->priv_data;
+    OutputStream *os = &c->streams[idx];
+    AVRational tb = os->ctx->streams[0]->time_base;
+    AVIOContext *out;
+    char filename[HLS_PLAYLIST_NAME_SIZE], temp_filename[HLS_PLAYLIST_NAME_SIZE + 4];
+    int i, ret, start_index = 0, target_duration, part_target;
+
+    if (c->window_size)
+        start_index = FFMAX(os->nb_segments - c->window_size, 0);
+
+    target_duration = (c->min_seg_duration + AV_TIME_BASE - 1) / AV_TIME_BASE;
+    for (i = start_index; i < os->nb_segments; i++)
+        target_duration = FFMAX(target_duration,
+                                av_rescale_rnd(os->segments[i]->duration, tb.num,
+                                               tb.den, AV_ROUND_UP));
+    part_target = av_rescale_q(c->frag_duration, AV_TIME_BASE_Q, tb);
+    for (i = 0; i < os->nb_parts; i++)
+        part_target = FFMAX(part_target, os->parts[i].duration);
+
+    snprintf(filename, sizeof(filename), "%smedia_%d.m3u8", c->dirname, idx);
+    ret = open_hls_playlist(s, &out, filename, temp_filename, sizeof(temp_filename));
+    if (ret < 0)
+        return ret;
+    avio_printf(out, "#EXT-X-TARGETDURATION:%d\n", FFMAX(target_duration, 1));
+    if (c->streaming)
+        avio_printf(out, "#EXT-X-PART-INF:PART-TARGET=%.3f\n", part_target * av_q2d(tb));
+    avio_printf(out, "#EXT-X-MEDIA-SEQUENCE:%d\n",
+                os->segment_index - os->nb_segments + start_index);
+    avio_printf(out, "#EXT-X-MAP:URI=\"%s\"", os->initfile);
+    if (c->single_file)
+        avio_printf(out, ",BYTERANGE=\"%d@%"PRId64"\"", os->init_range_length, os->init_start_pos);
+    avio_printf(out, "\n");
+
+    for (i = start_index; i < os->nb_segments; i++) {
+        Segment *seg = os->segments[i];
+        const char *uri = c->single_file ? os->initfile : seg->file;
+        write_hls_parts(s, out, idx, os->segment_index - os->nb_segments + i, uri);
+        avio_printf(out, "#EXTINF:%.3f,\n", seg->duration * av_q2d(tb));
+        if (c->single_file)
+            avio_printf(out, "#EXT-X-BYTERANGE:%d@%"PRId64"\n", seg->range_length, seg->start_pos);
+        avio_printf(out, "%s\n", uri);
+    }
+    // Chunks of the segment being written
+    if (c->streaming && os->packets_written)
+        write_hls_parts(s, out, idx, os->segment_index,
+                        c->single_file ? os->initfile : os->filename);
+    if (final)
+        avio_printf(out, "#EXT-X-ENDLIST\n");
+
+    return close_hls_playlist(s, &out, filename, temp_filename);
+}
+
+static int write_hls_master_playlist(AVFormatContext *s)
+{
+    DASHContext *c = s->priv_data;
+    AVIOContext *out;
+    char filename[HLS_PLAYLIST_NAME_SIZE], temp_filename[HLS_PLAYLIST_NAME_SIZE + 4];
+    int i, ret, audio_index = -1;
+
+    snprintf(filename, sizeof(filename), "%smaster.m3u8", c->dirname);
+    ret = open_hls_playlist(s, &out, filename, temp_filename, sizeof(temp_filename));
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+            continue;
+        if (audio_index < 0)
+            audio_index = i;
+        if (c->has_video)
+            avio_printf(out, "#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"audio\",NAME=\"audio_%d\",DEFAULT=%s,AUTOSELECT=YES,URI=\"media_%d.m3u8\"\n",
+                        i, i == audio_index ? "YES" : "NO", i);
+    }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVCodecParameters *par = s->streams[i]->codecpar;
+        OutputStream *os = &c->streams[i];
+        int bit_rate = os->bit_rate;
+
+        if (c->has_video && par->codec_type != AVMEDIA_TYPE_VIDEO ||
+            !c->has_video && par->codec_type != AVMEDIA_TYPE_AUDIO)
+            continue;
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO && audio_index >= 0)
+            bit_rate += c->streams[audio_index].bit_rate;
+        avio_printf(out, "#EXT-X-STREAM-INF:BANDWIDTH=%d", bit_rate);
+        if (os->codec_str[0]) {
+            avio_printf(out, ",CODECS=\"%s", os->codec_str);
+            if (par->codec_type == AVMEDIA_TYPE_VIDEO && audio_index >= 0 &&
+                c->streams[audio_index].codec_str[0])
+                avio_printf(out, ",%s", c->streams[audio_index].codec_str);
+            avio_printf(out, "\"");
+        }
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+            avio_printf(out, ",RESOLUTION=%dx%d", par->width, par->height);
+            if (audio_index >= 0)
+                avio_printf(out, ",AUDIO=\"audio\"");
+        }
+        avio_printf(out, "\nmedia_%d.m3u8\n", i);
+    }
+
+    return close_hls_playlist(s, &out, filename, temp_filename);
+}
+
 static int write_manifest(AVFormatContext *s, int final)
 {
     DASHContext *c = s->priv_data;
@@ -453,7 +648,7 @@ static int write_manifest(AVFormatContext *s, int final)
         av_log(s, AV_LOG_ERROR, "Cannot use rename on non file protocol, this may lead to races and temporary partial files\n");
 
     snprintf(temp_filename, sizeof(temp_filename), use_rename ? "%s.tmp" : "%s", s->filename);
-    ret = s->io_open(s, &out, temp_filename, AVIO_FLAG_WRITE, NULL);
+    ret = ff_upload_open(c->upload_queue, s, &out, temp_filename, NULL, UPLOAD_ORDERED);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Unable to open %s for writing\n", temp_filename);
         return ret;
@@ -553,10 +748,17 @@ static int write_manifest(AVFormatContext *s, int final)
     avio_printf(out, "\t</Period>\n");
     avio_printf(out, "</MPD>\n");
     avio_flush(out);
-    ff_format_io_close(s, &out);
+    ff_upload_close(c->upload_queue, s, &out);
+
+    if (use_rename && (ret = avpriv_io_move(temp_filename, s->filename)) < 0)
+        return ret;
 
-    if (use_rename)
-        return avpriv_io_move(temp_filename, s->filename);
+    if (c->hls_playlist) {
+        for (i = 0; i < s->nb_streams; i++)
+            if ((ret = write_hls_media_playlist(s, i, final)) < 0)
+                return ret;
+        return write_hls_master_playlist(s);
+    }
 
     return 0;
 }
@@ -599,6 +801,13 @@ static int dash_init(AVFormatContext *s)
         c->use_template = 0;
     c->ambiguous_frame_rate = 0;
 
+    /* with a part per frame, the playlists would be rewritten for every frame */
+    if (c->streaming && c->hls_playlist && !c->frag_duration) {
+        c->frag_duration = DEFAULT_HLS_PART_DURATION;
+        if (c->min_seg_duration > 0)
+            c->frag_duration = FFMIN(c->frag_duration, c->min_seg_duration);
+    }
+
     av_strlcpy(c->dirname, s->filename, sizeof(c->dirname));
     ptr = strrchr(c->dirname, '/');
     if (ptr) {
@@ -625,6 +834,18 @@ static int dash_init(AVFormatContext *s)
     if (ret < 0)
         return ret;
 
+    if (c->upload_threads > 0) {
+        const char *proto = avio_find_protocol_name(s->filename);
+
+        if (proto && !strcmp(proto, "file"))
+            av_log(s, AV_LOG_WARNING, "upload_threads has no effect on local files\n");
+        else if (c->single_file)
+            av_log(s, AV_LOG_WARNING, "upload_threads is not supported with single_file\n");
+        else if ((ret = ff_upload_queue_alloc(&c->upload_queue, s, c->upload_threads,
+                                              c->upload_queue_size, c->upload_retries)) < 0)
+            return ret;
+    }
+
     for (i = 0; i < s->nb_streams; i++) {
         OutputStream *os = &c->streams[i];
         AVFormatContext *ctx;
@@ -663,7 +884,7 @@ static int dash_init(AVFormatContext *s)
             dash_fill_tmpl_params(os->initfile, sizeof(os->initfile), c->init_seg_name, i, 0, os->bit_rate, 0);
         }
         snprintf(filename, sizeof(filename), "%s%s", c->dirname, os->initfile);
-        ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, NULL);
+        ret = ff_upload_open(c->upload_queue, s, &os->out, filename, NULL, 0);
         if (ret < 0)
             return ret;
         os->init_start_pos = 0;
@@ -818,13 +1039,103 @@ static int update_stream_extradata(AVFormatContext *s, OutputStream *os,
     return 0;
 }
 
+static int flush_init_segment(AVFormatContext *s, OutputStream *os)
+{
+    DASHContext *c = s->priv_data;
+    int ret;
+
+    if ((ret = av_write_frame(os->ctx, NULL)) < 0)
+        return ret;
+    os->init_range_length = avio_tell(os->ctx->pb);
+    if (!c->single_file)
+        ff_upload_close(c->upload_queue, s, &os->out);
+    return 0;
+}
+
+static int start_segment(AVFormatContext *s, OutputStream *os, int stream)
+{
+    DASHContext *c = s->priv_data;
+    const char *proto = avio_find_protocol_name(s->filename);
+    // In streaming mode, the chunks are written directly to the final file
+    int use_rename = proto && !strcmp(proto, "file") && !c->streaming;
+    int ret;
+
+    os->seg_start_pos       = avio_tell(os->ctx->pb);
+    os->chunk_start_pos     = os->seg_start_pos;
+    os->seg_chunks_duration = 0;
+
+    if (c->single_file) {
+        os->filename[0] = '\0';
+        snprintf(os->full_path, sizeof(os->full_path), "%s%s", c->dirname, os->initfile);
+        return 0;
+    }
+
+    dash_fill_tmpl_params(os->filename, sizeof(os->filename), c->media_seg_name, stream, os->segment_index, os->bit_rate, os->start_pts);
+    snprintf(os->full_path, sizeof(os->full_path), "%s%s", c->dirname, os->filename);
+    snprintf(os->temp_path, sizeof(os->temp_path), use_rename ? "%s.tmp" : "%s", os->full_path);
+    // Chunks have to reach the server as they are written in streaming mode
+    ret = ff_upload_open(c->streaming ? NULL : c->upload_queue, s, &os->out,
+                         os->temp_path, NULL, 0);
+    if (ret < 0)
+        return ret;
+    write_styp(os->ctx->pb);
+    return 0;
+}
+
+/**
+ * Write the packets buffered by the mp4 muxer as a fragment and push it
+ * out, remembering its position for the HLS partial segments.
+ */
+static int flush_chunk(AVFormatContext *s, OutputStream *os, int duration)
+{
+    DASHContext *c = s->priv_data;
+    int64_t end;
+    Part *part;
+    int i, ret;
+
+    if ((ret = av_write_frame(os->ctx, NULL)) < 0)
+        return ret;
+    avio_flush(os->ctx->pb);
+    if (os->out)
+        avio_flush(os->out);
+    end = avio_tell(os->ctx->pb);
+    if (end == os->chunk_start_pos)
+        return 0;
+
+    // Only keep the chunks of the last few segments
+    for (i = 0; i < os->nb_parts && os->parts[i].seg_index < os->segment_index - 2; i++)
+        ;
+    if (i) {
+        os->nb_parts -= i;
+        memmove(os->parts, os->parts + i, os->nb_parts * sizeof(*os->parts));
+    }
+    if (os->nb_parts >= os->parts_size) {
+        os->parts_size = (os->parts_size + 1) * 2;
+        if ((ret = av_reallocp_array(&os->parts, os->parts_size,
+                                     sizeof(*os->parts))) < 0) {
+            os->parts_size = 0;
+            os->nb_parts = 0;
+            return ret;
+        }
+    }
+    part = &os->parts[os->nb_parts++];
+    part->seg_index = os->segment_index;
+    part->start     = os->chunk_start_pos - (c->single_file ? 0 : os->seg_start_pos);
+    part->length    = end - os->chunk_start_pos;
+    part->duration  = duration;
+
+    os->chunk_start_pos      = end;
+    os->seg_chunks_duration += duration;
+    return 0;
+}
+
 static int dash_flush(AVFormatContext *s, int final, int stream)
 {
     DASHContext *c = s->priv_data;
     int i, ret = 0;
 
     const char *proto = avio_find_protocol_name(s->filename);
-    int use_rename = proto && !strcmp(proto, "file");
+    int use_rename = proto && !strcmp(proto, "file") && !c->streaming;
 
     int cur_flush_segment_index = 0;
     if (stream >= 0)
@@ -832,8 +1143,6 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
 
     for (i = 0; i < s->nb_streams; i++) {
         OutputStream *os = &c->streams[i];
-        char filename[1024] = "", full_path[1024], temp_path[1024];
-        int64_t start_pos;
         int range_length, index_length = 0;
 
         if (!os->packets_written)
@@ -851,45 +1160,37 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
                 continue;
         }
 
-        if (!os->init_range_length) {
-            av_write_frame(os->ctx, NULL);
-            os->init_range_length = avio_tell(os->ctx->pb);
-            if (!c->single_file)
-                ff_format_io_close(s, &os->out);
-        }
-
-        start_pos = avio_tell(os->ctx->pb);
-
-        if (!c->single_file) {
-            dash_fill_tmpl_params(filename, sizeof(filename), c->media_seg_name, i, os->segment_index, os->bit_rate, os->start_pts);
-            snprintf(full_path, sizeof(full_path), "%s%s", c->dirname, filename);
-            snprintf(temp_path, sizeof(temp_path), use_rename ? "%s.tmp" : "%s", full_path);
-            ret = s->io_open(s, &os->out, temp_path, AVIO_FLAG_WRITE, NULL);
+        if (c->streaming) {
+            // The segment was opened with its first packet, only the
+            // last chunk is left
+            ret = flush_chunk(s, os, os->max_pts - os->start_pts - os->seg_chunks_duration);
             if (ret < 0)
                 break;
-            write_styp(os->ctx->pb);
         } else {
-            snprintf(full_path, sizeof(full_path), "%s%s", c->dirname, os->initfile);
+            if (!os->init_range_length &&
+                (ret = flush_init_segment(s, os)) < 0)
+                break;
+            if ((ret = start_segment(s, os, i)) < 0)
+                break;
+            av_write_frame(os->ctx, NULL);
+            avio_flush(os->ctx->pb);
         }
-
-        av_write_frame(os->ctx, NULL);
-        avio_flush(os->ctx->pb);
         os->packets_written = 0;
 
-        range_length = avio_tell(os->ctx->pb) - start_pos;
+        range_length = avio_tell(os->ctx->pb) - os->seg_start_pos;
         if (c->single_file) {
-            find_index_range(s, full_path, start_pos, &index_length);
+            find_index_range(s, os->full_path, os->seg_start_pos, &index_length);
         } else {
-            ff_format_io_close(s, &os->out);
+            ff_upload_close(c->upload_queue, s, &os->out);
 
             if (use_rename) {
-                ret = avpriv_io_move(temp_path, full_path);
+                ret = avpriv_io_move(os->temp_path, os->full_path);
                 if (ret < 0)
                     break;
             }
         }
-        add_segment(os, filename, os->start_pts, os->max_pts - os->start_pts, start_pos, range_length, index_length);
-        av_log(s, AV_LOG_VERBOSE, "Representation %d media segment %d written to: %s\n", i, os->segment_index, full_path);
+        add_segment(os, os->filename, os->start_pts, os->max_pts - os->start_pts, os->seg_start_pos, range_length, index_length);
+        av_log(s, AV_LOG_VERBOSE, "Representation %d media segment %d written to: %s\n", i, os->segment_index, os->full_path);
     }
 
     if (c->window_size || (final && c->remove_at_exit)) {
@@ -925,6 +1226,10 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
     int64_t seg_end_duration = (os->segment_index) * (int64_t) c->min_seg_duration;
     int ret;
 
+    /* report a failed background upload as soon as it is known */
+    if ((ret = ff_upload_queue_error(c->upload_queue)) < 0)
+        return ret;
+
     ret = update_stream_extradata(s, os, st->codecpar);
     if (ret < 0)
         return ret;
@@ -984,13 +1289,36 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
             os->start_pts = os->max_pts;
         else
             os->start_pts = pkt->pts;
+        if (c->streaming && os->init_range_length &&
+            (ret = start_segment(s, os, pkt->stream_index)) < 0)
+            return ret;
+        os->chunk_start_dts = pkt->dts;
+    } else if (c->streaming &&
+               av_compare_ts(pkt->dts - os->chunk_start_dts, st->time_base,
+                             c->frag_duration, AV_TIME_BASE_Q) >= 0) {
+        if ((ret = flush_chunk(s, os, pkt->dts - os->chunk_start_dts)) < 0)
+            return ret;
+        os->chunk_start_dts = pkt->dts;
+        if (c->hls_playlist &&
+            (ret = write_hls_media_playlist(s, pkt->stream_index, 0)) < 0)
+            return ret;
     }
     if (os->max_pts == AV_NOPTS_VALUE)
         os->max_pts = pkt->pts + pkt->duration;
     else
         os->max_pts = FFMAX(os->max_pts, pkt->pts + pkt->duration);
     os->packets_written++;
-    return ff_write_chained(os->ctx, 0, pkt, s, 0);
+    if ((ret = ff_write_chained(os->ctx, 0, pkt, s, 0)) < 0)
+        return ret;
+
+    // Write the init segment as soon as possible, so that the first
+    // segment can be streamed as well
+    if (c->streaming && !os->init_range_length) {
+        if ((ret = flush_init_segment(s, os)) < 0 ||
+            (ret = start_segment(s, os, pkt->stream_index)) < 0)
+            return ret;
+    }
+    return 0;
 }
 
 static int dash_write_trailer(AVFormatContext *s)
@@ -1014,17 +1342,26 @@ static int dash_write_trailer(AVFormatContext *s)
     dash_flush(s, 1, -1);
 
     if (c->remove_at_exit) {
-        char filename[1024];
+        char filename[FFMAX(sizeof(c->dirname) + sizeof(c->streams->initfile),
+                            HLS_PLAYLIST_NAME_SIZE)];
         int i;
         for (i = 0; i < s->nb_streams; i++) {
             OutputStream *os = &c->streams[i];
             snprintf(filename, sizeof(filename), "%s%s", c->dirname, os->initfile);
             unlink(filename);
+            if (c->hls_playlist) {
+                snprintf(filename, sizeof(filename), "%smedia_%d.m3u8", c->dirname, i);
+                unlink(filename);
+            }
+        }
+        if (c->hls_playlist) {
+            snprintf(filename, sizeof(filename), "%smaster.m3u8", c->dirname);
+            unlink(filename);
         }
         unlink(s->filename);
     }
 
-    return 0;
+    return ff_upload_queue_flush(c->upload_queue);
 }
 
 static int dash_check_bitstream(struct AVFormatContext *s, const AVPacket *avpkt)
@@ -1063,6 +1400,12 @@ static const AVOption options[] = {
     { "single_file_name", "DASH-templated name to be used for baseURL. Implies storing all segments in one file, accessed using byte ranges", OFFSET(single_file_name), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "init_seg_name", "DASH-templated name to used for the initialization segment", OFFSET(init_seg_name), AV_OPT_TYPE_STRING, {.str = "init-stream$RepresentationID$.m4s"}, 0, 0, E },
     { "media_seg_name", "DASH-templated name to used for the media segments", OFFSET(media_seg_name), AV_OPT_TYPE_STRING, {.str = "chunk-stream$RepresentationID$-$Number%05d$.m4s"}, 0, 0, E },
+    { "streaming", "Write the segments progressively, one chunk at a time, for low latency live streaming", OFFSET(streaming), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    { "frag_duration", "duration of the chunks in streaming mode (in microseconds), 0 for one chunk per frame, or 500 ms with hls_playlist", OFFSET(frag_duration), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT_MAX, E },
+    { "hls_playlist", "Also write HLS playlists referencing the segments", OFFSET(hls_playlist), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    { "upload_threads", "number of threads uploading the files in the background, 0 to write them synchronously", OFFSET(upload_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 16, E },
+    { "upload_queue_size", "maximum number of files waiting to be uploaded in the background", OFFSET(upload_queue_size), AV_OPT_TYPE_INT, { .i64 = 8 }, 1, INT_MAX, E },
+    { "upload_retries", "number of times a failed background upload is retried", OFFSET(upload_retries), AV_OPT_TYPE_INT, { .i64 = 2 }, 0, INT_MAX, E },
     { NULL },
 };
 
@@ -32,6 +32,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
@@ -46,6 +47,8 @@
 #define MPEG_TIME_BASE 90000
 #define MPEG_TIME_BASE_Q (AVRational){1, MPEG_TIME_BASE}
 
+#define MAX_PREFETCH 16
+
 /*
  * An apple http stream consists of a playlist with media segment files,
  * played sequentially. There may be several playlists with the same
@@ -77,6 +80,37 @@ struct segment {
 };
 
 struct rendition;
+struct playlist;
+
+enum PrefetchState {
+    PREFETCH_FREE,
+    PREFETCH_QUEUED,
+    PREFETCH_LOADING,
+    PREFETCH_DONE,
+};
+
+/*
+ * A segment (or a playlist reload) downloaded into memory by one of the
+ * prefetch threads of a playlist. The job fields are only changed by the
+ * reading thread while the state is FREE or QUEUED, the data fields are
+ * protected by the prefetch lock of the playlist.
+ */
+struct prefetch {
+    struct playlist *pls;
+    enum PrefetchState state;
+    int seq_no;
+    char *url;
+    AVDictionary *opts;
+    int64_t seek_offset;    /* offset to seek to after opening, for non-HTTP urls */
+    int64_t size;           /* bytes to read, -1 for the whole url */
+    uint8_t *buf;
+    unsigned int buf_size;
+    int data_len;
+    int read_offset;
+    int error;
+    int abort;
+    char *cookies;          /* cookies updated by the response */
+};
 
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
@@ -153,6 +187,20 @@ struct playlist {
      * playlist, if any. */
     int n_init_sections;
     struct segment **init_sections;
+
+#if HAVE_THREADS
+    /* Segments downloaded in advance by the prefetch threads, and the
+     * playlist reload running in the background */
+    pthread_t prefetch_threads[MAX_PREFETCH];
+    int n_prefetch_threads;
+    pthread_mutex_t prefetch_lock;
+    pthread_cond_t prefetch_job_cond;
+    pthread_cond_t prefetch_data_cond;
+    struct prefetch prefetch[MAX_PREFETCH];
+    struct prefetch playlist_prefetch;
+    struct prefetch *cur_prefetch;  /* the segment being read, if prefetched */
+    int prefetch_quit;
+#endif
 };
 
 /*
@@ -204,6 +252,7 @@ typedef struct HLSContext {
     char *http_proxy;                    ///< holds the address of the HTTP proxy server
     AVDictionary *avio_opts;
     int strict_std_compliance;
+    int prefetch_segments;
 } HLSContext;
 
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
@@ -237,11 +286,56 @@ static void free_init_section_list(struct playlist *pls)
     pls->n_init_sections = 0;
 }
 
+#if HAVE_THREADS
+static void prefetch_reset(struct prefetch *pf)
+{
+    av_freep(&pf->url);
+    av_dict_free(&pf->opts);
+    av_freep(&pf->cookies);
+    pf->state       = PREFETCH_FREE;
+    pf->seq_no      = -1;
+    pf->data_len    = 0;
+    pf->read_offset = 0;
+    pf->error       = 0;
+    pf->abort       = 0;
+}
+
+static void prefetch_stop(struct playlist *pls)
+{
+    int i;
+
+    if (!pls->n_prefetch_threads)
+        return;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    pls->prefetch_quit = 1;
+    pthread_cond_broadcast(&pls->prefetch_job_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+    for (i = 0; i < pls->n_prefetch_threads; i++)
+        pthread_join(pls->prefetch_threads[i], NULL);
+    pls->n_prefetch_threads = 0;
+
+    for (i = 0; i < MAX_PREFETCH; i++) {
+        prefetch_reset(&pls->prefetch[i]);
+        av_freep(&pls->prefetch[i].buf);
+    }
+    prefetch_reset(&pls->playlist_prefetch);
+    av_freep(&pls->playlist_prefetch.buf);
+    pls->cur_prefetch = NULL;
+    pthread_cond_destroy(&pls->prefetch_data_cond);
+    pthread_cond_destroy(&pls->prefetch_job_cond);
+    pthread_mutex_destroy(&pls->prefetch_lock);
+}
+#endif
+
 static void free_playlist_list(HLSContext *c)
 {
     int i;
     for (i = 0; i < c->n_playlists; i++) {
         struct playlist *pls = c->playlists[i];
+#if HAVE_THREADS
+        prefetch_stop(pls);
+#endif
         free_segment_list(pls);
         free_init_section_list(pls);
         av_freep(&pls->main_streams);
@@ -595,16 +689,9 @@ static void update_options(char **dest, const char *name, void *src)
         av_freep(dest);
 }
 
-static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary *opts, AVDictionary *opts2, int *is_http)
+static int check_url(const char *url, int *is_http)
 {
-    HLSContext *c = s->priv_data;
-    AVDictionary *tmp = NULL;
     const char *proto_name = NULL;
-    int ret;
-
-    av_dict_copy(&tmp, opts, 0);
-    av_dict_copy(&tmp, opts2, 0);
 
     if (av_strstart(url, "crypto", NULL)) {
         if (url[6] == '+' || url[6] == ':')
@@ -627,6 +714,25 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     else if (strcmp(proto_name, "file") || !strncmp(url, "file,", 5))
         return AVERROR_INVALIDDATA;
 
+    if (is_http)
+        *is_http = av_strstart(proto_name, "http", NULL);
+
+    return 0;
+}
+
+static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    AVDictionary *opts, AVDictionary *opts2, int *is_http)
+{
+    HLSContext *c = s->priv_data;
+    AVDictionary *tmp = NULL;
+    int ret;
+
+    if ((ret = check_url(url, is_http)) < 0)
+        return ret;
+
+    av_dict_copy(&tmp, opts, 0);
+    av_dict_copy(&tmp, opts2, 0);
+
     ret = s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
     if (ret >= 0) {
         // update cookies on http response with setcookies.
@@ -637,9 +743,6 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
 
     av_dict_free(&tmp);
 
-    if (is_http)
-        *is_http = av_strstart(proto_name, "http", NULL);
-
     return ret;
 }
 
@@ -857,6 +960,31 @@ enum ReadFromURLMode {
     READ_COMPLETE,
 };
 
+#if HAVE_THREADS
+static int prefetch_read(struct playlist *pls, uint8_t *buf, int buf_size)
+{
+    HLSContext *c = pls->parent->priv_data;
+    struct prefetch *pf = pls->cur_prefetch;
+    int ret;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    while (pf->read_offset == pf->data_len && pf->state != PREFETCH_DONE)
+        pthread_cond_wait(&pls->prefetch_data_cond, &pls->prefetch_lock);
+    ret = FFMIN(buf_size, pf->data_len - pf->read_offset);
+    if (ret > 0) {
+        memcpy(buf, pf->buf + pf->read_offset, ret);
+        pf->read_offset += ret;
+    } else {
+        ret = pf->error ? pf->error : AVERROR_EOF;
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    if (ret < 0 && ff_check_interrupt(c->interrupt_callback))
+        ret = AVERROR_EXIT;
+    return ret;
+}
+#endif
+
 static int read_from_url(struct playlist *pls, struct segment *seg,
                          uint8_t *buf, int buf_size,
                          enum ReadFromURLMode mode)
@@ -867,6 +995,20 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
+#if HAVE_THREADS
+    if (pls->cur_prefetch) {
+        int len = 0;
+        do {
+            ret = prefetch_read(pls, buf + len, buf_size - len);
+            if (ret > 0)
+                len += ret;
+        } while (mode == READ_COMPLETE && ret > 0 && len < buf_size);
+        if (len > 0)
+            ret = len;
+        if (mode == READ_COMPLETE && ret != buf_size)
+            av_log(NULL, AV_LOG_ERROR, "Could not read complete segment.\n");
+    } else
+#endif
     if (mode == READ_COMPLETE) {
         ret = avio_read(pls->input, buf, buf_size);
         if (ret != buf_size)
@@ -1237,6 +1379,328 @@ static int64_t default_reload_interval(struct playlist *pls)
                           pls->target_duration;
 }
 
+#if HAVE_THREADS
+/*
+ * Download a queued job. The url is opened through io_open like the other
+ * requests of the demuxer, so it must be safe to call from several threads;
+ * an aborted job stops at the next chunk read.
+ */
+static void prefetch_download(struct playlist *pls, struct prefetch *pf)
+{
+    AVFormatContext *s = pls->parent;
+    AVIOContext *in = NULL;
+    char *cookies = NULL;
+    uint8_t tmp[16384];
+    int64_t left = pf->size;
+    int ret;
+
+    ret = s->io_open(s, &in, pf->url, AVIO_FLAG_READ, &pf->opts);
+    if (ret >= 0)
+        update_options(&cookies, "cookies", in);
+    if (ret >= 0 && pf->seek_offset) {
+        int64_t seekret = avio_seek(in, pf->seek_offset, SEEK_SET);
+        if (seekret < 0)
+            ret = seekret;
+    }
+    while (ret >= 0 && left) {
+        ret = avio_read(in, tmp, left > 0 ? FFMIN(left, sizeof(tmp)) : sizeof(tmp));
+        if (ret <= 0)
+            break;
+        if (left > 0)
+            left -= ret;
+
+        pthread_mutex_lock(&pls->prefetch_lock);
+        if (pf->abort || pls->prefetch_quit) {
+            pthread_mutex_unlock(&pls->prefetch_lock);
+            ret = AVERROR_EXIT;
+            break;
+        }
+        if (pf->data_len + ret > pf->buf_size) {
+            uint8_t *buf = av_fast_realloc(pf->buf, &pf->buf_size,
+                                           FFMAX(pf->data_len + ret, pf->buf_size * 2));
+            if (!buf) {
+                pthread_mutex_unlock(&pls->prefetch_lock);
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            pf->buf = buf;
+        }
+        memcpy(pf->buf + pf->data_len, tmp, ret);
+        pf->data_len += ret;
+        pthread_cond_broadcast(&pls->prefetch_data_cond);
+        pthread_mutex_unlock(&pls->prefetch_lock);
+    }
+    ff_format_io_close(s, &in);
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    if (pf->abort) {
+        prefetch_reset(pf);
+        av_free(cookies);
+    } else {
+        pf->error   = ret == AVERROR_EOF ? 0 : FFMIN(ret, 0);
+        pf->cookies = cookies;
+        pf->state   = PREFETCH_DONE;
+    }
+    pthread_cond_broadcast(&pls->prefetch_data_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct playlist *pls = arg;
+    int i;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    while (!pls->prefetch_quit) {
+        /* playlist reloads first, then segments in playback order */
+        struct prefetch *pf = NULL;
+        if (pls->playlist_prefetch.state == PREFETCH_QUEUED)
+            pf = &pls->playlist_prefetch;
+        for (i = 0; i < MAX_PREFETCH && !pf; i++) {
+            struct prefetch *p = &pls->prefetch[i];
+            if (p->state == PREFETCH_QUEUED && (!pf || p->seq_no < pf->seq_no))
+                pf = p;
+        }
+        if (!pf) {
+            pthread_cond_wait(&pls->prefetch_job_cond, &pls->prefetch_lock);
+            continue;
+        }
+        pf->state = PREFETCH_LOADING;
+        pthread_mutex_unlock(&pls->prefetch_lock);
+        prefetch_download(pls, pf);
+        pthread_mutex_lock(&pls->prefetch_lock);
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+    return NULL;
+}
+
+static int prefetch_start(struct playlist *pls, int nb_threads)
+{
+    int i, ret;
+
+    if (pls->n_prefetch_threads)
+        return 0;
+
+    for (i = 0; i < MAX_PREFETCH; i++) {
+        pls->prefetch[i].pls    = pls;
+        pls->prefetch[i].seq_no = -1;
+    }
+    pls->playlist_prefetch.pls = pls;
+    pls->prefetch_quit = 0;
+    if ((ret = pthread_mutex_init(&pls->prefetch_lock, NULL)))
+        return AVERROR(ret);
+    if ((ret = pthread_cond_init(&pls->prefetch_job_cond, NULL))) {
+        pthread_mutex_destroy(&pls->prefetch_lock);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pls->prefetch_data_cond, NULL))) {
+        pthread_cond_destroy(&pls->prefetch_job_cond);
+        pthread_mutex_destroy(&pls->prefetch_lock);
+        return AVERROR(ret);
+    }
+    for (i = 0; i < nb_threads; i++) {
+        if ((ret = pthread_create(&pls->prefetch_threads[i], NULL,
+                                  prefetch_thread, pls))) {
+            av_log(pls->parent, AV_LOG_ERROR, "Failed to start prefetch thread\n");
+            break;
+        }
+        pls->n_prefetch_threads++;
+    }
+    if (!pls->n_prefetch_threads) {
+        pthread_cond_destroy(&pls->prefetch_data_cond);
+        pthread_cond_destroy(&pls->prefetch_job_cond);
+        pthread_mutex_destroy(&pls->prefetch_lock);
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+/* HTTP options used for segment and playlist requests */
+static void set_http_options(HLSContext *c, AVDictionary **opts)
+{
+    av_dict_set(opts, "user_agent", c->user_agent, 0);
+    av_dict_set(opts, "cookies", c->cookies, 0);
+    av_dict_set(opts, "headers", c->headers, 0);
+    av_dict_set(opts, "http_proxy", c->http_proxy, 0);
+    av_dict_set(opts, "seekable", "0", 0);
+}
+
+static int prefetch_queue_segment(HLSContext *c, struct playlist *pls,
+                                  struct prefetch *pf, int seq_no)
+{
+    struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+    int ret, is_http = 0;
+
+    if ((ret = check_url(seg->url, &is_http)) < 0)
+        return ret;
+    if (!(pf->url = av_strdup(seg->url)))
+        return AVERROR(ENOMEM);
+    av_dict_copy(&pf->opts, c->avio_opts, 0);
+    set_http_options(c, &pf->opts);
+    pf->size        = seg->size;
+    pf->seek_offset = 0;
+    if (seg->size >= 0) {
+        av_dict_set_int(&pf->opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(&pf->opts, "end_offset", seg->url_offset + seg->size, 0);
+        if (!is_http)
+            pf->seek_offset = seg->url_offset;
+    }
+    pf->seq_no = seq_no;
+    pf->state  = PREFETCH_QUEUED;
+    return 0;
+}
+
+/**
+ * Queue the downloads of the next segments of the playlist, drop the
+ * ones which are no longer needed, and make the current segment the one
+ * being read. Encrypted segments are not prefetched.
+ */
+static int prefetch_segments(HLSContext *c, struct playlist *pls)
+{
+    int window = FFMIN(c->prefetch_segments, MAX_PREFETCH);
+    int end    = FFMIN(pls->cur_seq_no + window, pls->start_seq_no + pls->n_segments);
+    int i, seq_no, ret = 0;
+
+    if ((ret = prefetch_start(pls, window)) < 0)
+        return ret;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    pls->cur_prefetch = NULL;
+    for (i = 0; i < MAX_PREFETCH; i++) {
+        struct prefetch *pf = &pls->prefetch[i];
+        if (pf->state == PREFETCH_FREE || pf->abort)
+            continue;
+        if (pf->seq_no >= pls->cur_seq_no && pf->seq_no < end) {
+            if (pf->seq_no == pls->cur_seq_no)
+                pls->cur_prefetch = pf;
+        } else if (pf->state == PREFETCH_LOADING) {
+            pf->abort = 1;
+        } else {
+            prefetch_reset(pf);
+        }
+    }
+    for (seq_no = pls->cur_seq_no; seq_no < end; seq_no++) {
+        struct prefetch *pf = NULL;
+        if (pls->segments[seq_no - pls->start_seq_no]->key_type != KEY_NONE)
+            break;
+        for (i = 0; i < MAX_PREFETCH; i++) {
+            if (pls->prefetch[i].state != PREFETCH_FREE && !pls->prefetch[i].abort &&
+                pls->prefetch[i].seq_no == seq_no)
+                break;
+            if (!pf && pls->prefetch[i].state == PREFETCH_FREE)
+                pf = &pls->prefetch[i];
+        }
+        if (i < MAX_PREFETCH)
+            continue;
+        if (!pf)
+            break;
+        if ((ret = prefetch_queue_segment(c, pls, pf, seq_no)) < 0) {
+            prefetch_reset(pf);
+            break;
+        }
+        if (seq_no == pls->cur_seq_no)
+            pls->cur_prefetch = pf;
+    }
+    pthread_cond_broadcast(&pls->prefetch_job_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    /* the current segment could not be queued, it is opened directly */
+    if (!pls->cur_prefetch && ret >= 0)
+        ret = AVERROR(EAGAIN);
+    return ret;
+}
+
+/* Keep the cookies set by a finished download, the caller holds the lock */
+static void prefetch_update_cookies(HLSContext *c, struct prefetch *pf)
+{
+    if (pf->cookies) {
+        av_free(c->cookies);
+        c->cookies  = pf->cookies;
+        pf->cookies = NULL;
+    }
+}
+
+static void prefetch_release(struct playlist *pls)
+{
+    pthread_mutex_lock(&pls->prefetch_lock);
+    if (pls->cur_prefetch->state == PREFETCH_LOADING) {
+        pls->cur_prefetch->abort = 1;
+    } else {
+        prefetch_update_cookies(pls->parent->priv_data, pls->cur_prefetch);
+        prefetch_reset(pls->cur_prefetch);
+    }
+    pls->cur_prefetch = NULL;
+    pthread_mutex_unlock(&pls->prefetch_lock);
+}
+
+/* Start downloading the playlist in the background once it is due for a reload */
+static void prefetch_playlist(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch *pf = &pls->playlist_prefetch;
+
+    if (pls->finished || !pls->n_prefetch_threads ||
+        av_gettime_relative() - pls->last_load_time < default_reload_interval(pls))
+        return;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    if (pf->state == PREFETCH_FREE && check_url(pls->url, NULL) >= 0 &&
+        (pf->url = av_strdup(pls->url))) {
+        set_http_options(c, &pf->opts);
+        pf->size  = -1;
+        pf->state = PREFETCH_QUEUED;
+        pthread_cond_broadcast(&pls->prefetch_job_cond);
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+}
+#endif
+
+/* Stop reading the current segment */
+static void close_segment(struct playlist *pls)
+{
+#if HAVE_THREADS
+    if (pls->cur_prefetch)
+        prefetch_release(pls);
+#endif
+    ff_format_io_close(pls->parent, &pls->input);
+}
+
+static int reload_playlist(HLSContext *c, struct playlist *pls)
+{
+#if HAVE_THREADS
+    struct prefetch *pf = &pls->playlist_prefetch;
+
+    if (pls->n_prefetch_threads) {
+        uint8_t *buf = NULL;
+        int len = 0, ret;
+
+        /* take the downloaded data, parsing may do network I/O of its own */
+        pthread_mutex_lock(&pls->prefetch_lock);
+        if (pf->state != PREFETCH_FREE) {
+            while (pf->state != PREFETCH_DONE)
+                pthread_cond_wait(&pls->prefetch_data_cond, &pls->prefetch_lock);
+            if (!pf->error) {
+                buf          = pf->buf;
+                len          = pf->data_len;
+                pf->buf      = NULL;
+                pf->buf_size = 0;
+            }
+            prefetch_update_cookies(c, pf);
+            prefetch_reset(pf);
+        }
+        pthread_mutex_unlock(&pls->prefetch_lock);
+
+        if (buf) {
+            AVIOContext in = { 0 };
+            ffio_init_context(&in, buf, len, 0, NULL, NULL, NULL, NULL);
+            ret = parse_playlist(c, pls->url, pls, &in);
+            av_free(buf);
+            return ret;
+        }
+    }
+#endif
+    return parse_playlist(c, pls->url, pls, NULL);
+}
+
 static int read_data(void *opaque, uint8_t *buf, int buf_size)
 {
     struct playlist *v = opaque;
@@ -1248,7 +1712,13 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
+#if HAVE_THREADS
+    if (v->n_prefetch_threads)
+        prefetch_playlist(c, v);
+    if (!v->input && !v->cur_prefetch) {
+#else
     if (!v->input) {
+#endif
         int64_t reload_interval;
         struct segment *seg;
 
@@ -1276,7 +1746,7 @@ restart:
 reload:
         if (!v->finished &&
             av_gettime_relative() - v->last_load_time >= reload_interval) {
-            if ((ret = parse_playlist(c, v->url, v, NULL)) < 0) {
+            if ((ret = reload_playlist(c, v)) < 0) {
                 av_log(v->parent, AV_LOG_WARNING, "Failed to reload playlist %d\n",
                        v->index);
                 return ret;
@@ -1311,6 +1781,14 @@ reload:
         if (ret)
             return ret;
 
+#if HAVE_THREADS
+        if (c->prefetch_segments > 0) {
+            ret = prefetch_segments(c, v);
+            if (ret < 0 && ret != AVERROR(EAGAIN))
+                return ret;
+        }
+        if (!v->cur_prefetch)
+#endif
         ret = open_input(c, v, seg);
         if (ret < 0) {
             if (ff_check_interrupt(c->interrupt_callback))
@@ -1332,6 +1810,11 @@ reload:
     }
 
     ret = read_from_url(v, current_segment(v), buf, buf_size, READ_NORMAL);
+    if (ret == AVERROR_EXIT)
+        return ret;
+    if (ret < 0 && just_opened)
+        av_log(v->parent, AV_LOG_WARNING, "Failed to open segment of playlist %d\n",
+               v->index);
     if (ret > 0) {
         if (just_opened && v->is_id3_timestamped != 0) {
             /* Intercept ID3 tags here, elementary audio streams are required
@@ -1341,7 +1824,7 @@ reload:
 
         return ret;
     }
-    ff_format_io_close(v->parent, &v->input);
+    close_segment(v);
     v->cur_seq_no++;
 
     c->cur_seq_no = v->cur_seq_no;
@@ -1474,7 +1957,8 @@ static int save_avio_options(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
     static const char *opts[] = {
-        "headers", "http_proxy", "user_agent", "user-agent", "cookies", NULL };
+        "headers", "http_proxy", "user_agent", "user-agent", "cookies",
+        "connection_pool", NULL };
     const char **opt = opts;
     uint8_t *buf;
     int ret = 0;
@@ -1842,8 +2326,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             }
             av_log(s, AV_LOG_INFO, "Now receiving playlist %d, segment %d\n", i, pls->cur_seq_no);
         } else if (first && !pls->cur_needed && pls->needed) {
-            if (pls->input)
-                ff_format_io_close(pls->parent, &pls->input);
+            close_segment(pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -2076,8 +2559,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
     for (i = 0; i < c->n_playlists; i++) {
         /* Reset reading */
         struct playlist *pls = c->playlists[i];
-        if (pls->input)
-            ff_format_io_close(pls->parent, &pls->input);
+        close_segment(pls);
         av_packet_unref(&pls->pkt);
         reset_packet(&pls->pkt);
         pls->pb.eof_reached = 0;
@@ -2126,6 +2608,8 @@ static int hls_probe(AVProbeData *p)
 static const AVOption hls_options[] = {
     {"live_start_index", "segment index to start live streams at (negative values are from the end)",
         OFFSET(live_start_index), AV_OPT_TYPE_INT, {.i64 = -3}, INT_MIN, INT_MAX, FLAGS},
+    {"prefetch_segments", "number of segments downloaded concurrently ahead of playback",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, MAX_PREFETCH, FLAGS},
     {NULL}
 };
 
@@ -46,6 +46,7 @@
 #include "avio_internal.h"
 #include "internal.h"
 #include "os_support.h"
+#include "uploadqueue.h"
 
 typedef enum {
   HLS_START_SEQUENCE_AS_START_NUMBER = 0,
@@ -161,6 +162,11 @@ typedef struct HLSContext {
     AVDictionary *vtt_format_options;
 
     char *method;
+    int http_persistent;
+    int upload_threads;
+    int upload_queue_size;
+    int upload_retries;
+    UploadQueue *upload_queue;
 
     double initial_prog_date_time;
     char current_segment_final_filename_fmt[1024]; // when renaming segments
@@ -318,9 +324,9 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls) {
         proto = avio_find_protocol_name(s->filename);
         if (hls->method || (proto && !av_strcasecmp(proto, "http"))) {
             av_dict_set(&options, "method", "DELETE", 0);
-            if ((ret = hls->avf->io_open(hls->avf, &out, path, AVIO_FLAG_WRITE, &options)) < 0)
+            if ((ret = ff_upload_open(hls->upload_queue, hls->avf, &out, path, &options, UPLOAD_ORDERED)) < 0)
                 goto fail;
-            ff_format_io_close(hls->avf, &out);
+            ff_upload_close(hls->upload_queue, hls->avf, &out);
         } else if (unlink(path) < 0) {
             av_log(hls, AV_LOG_ERROR, "failed to delete old segment %s: %s\n",
                                      path, strerror(errno));
@@ -339,11 +345,11 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls) {
 
             if (hls->method || (proto && !av_strcasecmp(proto, "http"))) {
                 av_dict_set(&options, "method", "DELETE", 0);
-                if ((ret = hls->avf->io_open(hls->avf, &out, sub_path, AVIO_FLAG_WRITE, &options)) < 0) {
+                if ((ret = ff_upload_open(hls->upload_queue, hls->avf, &out, sub_path, &options, UPLOAD_ORDERED)) < 0) {
                     av_free(sub_path);
                     goto fail;
                 }
-                ff_format_io_close(hls->avf, &out);
+                ff_upload_close(hls->upload_queue, hls->avf, &out);
             } else if (unlink(sub_path) < 0) {
                 av_log(hls, AV_LOG_ERROR, "failed to delete old segment %s: %s\n",
                                          sub_path, strerror(errno));
@@ -909,6 +915,9 @@ static void set_http_options(AVFormatContext *s, AVDictionary **options, HLSCont
         av_log(c, AV_LOG_WARNING, "No HTTP method set, hls muxer defaulting to method PUT.\n");
         av_dict_set(options, "method", "PUT", 0);
     }
+    /* avoid a new connection setup for every segment upload */
+    if (c->http_persistent && http_base_proto)
+        av_dict_set(options, "connection_pool", "1", AV_DICT_DONT_OVERWRITE);
 }
 
 static void write_m3u8_head_block(HLSContext *hls, AVIOContext *out, int version,
@@ -965,7 +974,7 @@ static int hls_window(AVFormatContext *s, int last)
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_rename ? "%s.tmp" : "%s", s->filename);
-    if ((ret = s->io_open(s, &out, temp_filename, AVIO_FLAG_WRITE, &options)) < 0)
+    if ((ret = ff_upload_open(hls->upload_queue, s, &out, temp_filename, &options, UPLOAD_ORDERED)) < 0)
         goto fail;
 
     for (en = hls->segments; en; en = en->next) {
@@ -1040,7 +1049,7 @@ static int hls_window(AVFormatContext *s, int last)
         avio_printf(out, "#EXT-X-ENDLIST\n");
 
     if( hls->vtt_m3u8_name ) {
-        if ((ret = s->io_open(s, &sub_out, hls->vtt_m3u8_name, AVIO_FLAG_WRITE, &options)) < 0)
+        if ((ret = ff_upload_open(hls->upload_queue, s, &sub_out, hls->vtt_m3u8_name, &options, UPLOAD_ORDERED)) < 0)
             goto fail;
         write_m3u8_head_block(hls, sub_out, version, target_duration, sequence);
 
@@ -1061,8 +1070,8 @@ static int hls_window(AVFormatContext *s, int last)
 
 fail:
     av_dict_free(&options);
-    ff_format_io_close(s, &out);
-    ff_format_io_close(s, &sub_out);
+    ff_upload_close(hls->upload_queue, s, &out);
+    ff_upload_close(hls->upload_queue, s, &sub_out);
     if (ret >= 0 && use_rename)
         ff_rename(temp_filename, s->filename, s);
     return ret;
@@ -1178,17 +1187,17 @@ static int hls_start(AVFormatContext *s)
             err = AVERROR(ENOMEM);
             goto fail;
         }
-        err = s->io_open(s, &oc->pb, filename, AVIO_FLAG_WRITE, &options);
+        err = ff_upload_open(c->upload_queue, s, &oc->pb, filename, &options, 0);
         av_free(filename);
         av_dict_free(&options);
         if (err < 0)
             return err;
     } else
-        if ((err = s->io_open(s, &oc->pb, oc->filename, AVIO_FLAG_WRITE, &options)) < 0)
+        if ((err = ff_upload_open(c->upload_queue, s, &oc->pb, oc->filename, &options, 0)) < 0)
             goto fail;
     if (c->vtt_basename) {
         set_http_options(s, &options, c);
-        if ((err = s->io_open(s, &vtt_oc->pb, vtt_oc->filename, AVIO_FLAG_WRITE, &options)) < 0)
+        if ((err = ff_upload_open(c->upload_queue, s, &vtt_oc->pb, vtt_oc->filename, &options, 0)) < 0)
             goto fail;
     }
     av_dict_free(&options);
@@ -1389,6 +1398,18 @@ static int hls_write_header(AVFormatContext *s)
         }
     }
 
+    if (hls->upload_threads > 0) {
+        const char *proto = avio_find_protocol_name(s->filename);
+
+        if (proto && !strcmp(proto, "file"))
+            av_log(s, AV_LOG_WARNING, "upload_threads has no effect on local files\n");
+        else if ((hls->flags & HLS_SINGLE_FILE) || hls->max_seg_size > 0)
+            av_log(s, AV_LOG_WARNING, "upload_threads is not supported with byte range segments\n");
+        else if ((ret = ff_upload_queue_alloc(&hls->upload_queue, s, hls->upload_threads,
+                                              hls->upload_queue_size, hls->upload_retries)) < 0)
+            goto fail;
+    }
+
     if ((ret = hls_start(s)) < 0)
         goto fail;
 
@@ -1435,7 +1456,7 @@ fail:
             avformat_free_context(hls->avf);
         if (hls->vtt_avf)
             avformat_free_context(hls->vtt_avf);
-
+        ff_upload_queue_free(&hls->upload_queue);
     }
     return ret;
 }
@@ -1450,6 +1471,10 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
     int ret, can_split = 1;
     int stream_index = 0;
 
+    /* report a failed background upload as soon as it is known */
+    if ((ret = ff_upload_queue_error(hls->upload_queue)) < 0)
+        return ret;
+
     if (hls->sequence - hls->nb_entries > hls->start_sequence && hls->init_time > 0) {
         /* reset end_pts, hls->recording_time at end of the init hls list */
         int init_list_dur = hls->init_time * hls->nb_entries * AV_TIME_BASE;
@@ -1510,9 +1535,9 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         hls->size = new_start_pos - hls->start_pos;
 
         if (!byterange_mode) {
-            ff_format_io_close(s, &oc->pb);
+            ff_upload_close(hls->upload_queue, s, &oc->pb);
             if (hls->vtt_avf) {
-                ff_format_io_close(s, &hls->vtt_avf->pb);
+                ff_upload_close(hls->upload_queue, s, &hls->vtt_avf->pb);
             }
         }
         if ((hls->flags & HLS_TEMP_FILE) && oc->filename[0]) {
@@ -1572,6 +1597,7 @@ static int hls_write_trailer(struct AVFormatContext *s)
     AVFormatContext *oc = hls->avf;
     AVFormatContext *vtt_oc = hls->vtt_avf;
     char *old_filename = av_strdup(hls->avf->filename);
+    int ret;
 
     if (!old_filename) {
         return AVERROR(ENOMEM);
@@ -1581,7 +1607,7 @@ static int hls_write_trailer(struct AVFormatContext *s)
     av_write_trailer(oc);
     if (oc->pb) {
         hls->size = avio_tell(hls->avf->pb) - hls->start_pos;
-        ff_format_io_close(s, &oc->pb);
+        ff_upload_close(hls->upload_queue, s, &oc->pb);
 
         if ((hls->flags & HLS_TEMP_FILE) && oc->filename[0]) {
             hls_rename_temp_file(s, oc);
@@ -1597,7 +1623,7 @@ static int hls_write_trailer(struct AVFormatContext *s)
         if (vtt_oc->pb)
             av_write_trailer(vtt_oc);
         hls->size = avio_tell(hls->vtt_avf->pb) - hls->start_pos;
-        ff_format_io_close(s, &vtt_oc->pb);
+        ff_upload_close(hls->upload_queue, s, &vtt_oc->pb);
     }
     av_freep(&hls->basename);
     av_freep(&hls->key_basename);
@@ -1612,10 +1638,13 @@ static int hls_write_trailer(struct AVFormatContext *s)
         avformat_free_context(vtt_oc);
     }
 
+    ret = ff_upload_queue_flush(hls->upload_queue);
+    ff_upload_queue_free(&hls->upload_queue);
+
     hls_free_segments(hls->segments);
     hls_free_segments(hls->old_segments);
     av_free(old_filename);
-    return 0;
+    return ret;
 }
 
 #define OFFSET(x) offsetof(HLSContext, x)
@@ -1659,6 +1688,10 @@ static const AVOption options[] = {
     {"event", "EVENT playlist", 0, AV_OPT_TYPE_CONST, {.i64 = PLAYLIST_TYPE_EVENT }, INT_MIN, INT_MAX, E, "pl_type" },
     {"vod", "VOD playlist", 0, AV_OPT_TYPE_CONST, {.i64 = PLAYLIST_TYPE_VOD }, INT_MIN, INT_MAX, E, "pl_type" },
     {"method", "set the HTTP method(default: PUT)", OFFSET(method), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,    E},
+    {"http_persistent", "reuse the HTTP connections between the uploads", OFFSET(http_persistent), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E},
+    {"upload_threads", "number of threads uploading the files in the background, 0 to write them synchronously", OFFSET(upload_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 16, E},
+    {"upload_queue_size", "maximum number of files waiting to be uploaded in the background", OFFSET(upload_queue_size), AV_OPT_TYPE_INT, {.i64 = 8}, 1, INT_MAX, E},
+    {"upload_retries", "number of times a failed background upload is retried", OFFSET(upload_retries), AV_OPT_TYPE_INT, {.i64 = 2}, 0, INT_MAX, E},
     {"hls_start_number_source", "set source of first number in sequence", OFFSET(start_sequence_source_type), AV_OPT_TYPE_INT, {.i64 = HLS_START_SEQUENCE_AS_START_NUMBER }, 0, HLS_START_SEQUENCE_AS_FORMATTED_DATETIME, E, "start_sequence_source_type" },
     {"generic", "start_number value (default)", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_START_SEQUENCE_AS_START_NUMBER }, INT_MIN, INT_MAX, E, "start_sequence_source_type" },
     {"epoch", "seconds since epoch", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_START_SEQUENCE_AS_SECONDS_SINCE_EPOCH }, INT_MIN, INT_MAX, E, "start_sequence_source_type" },
@@ -30,6 +30,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -51,6 +52,7 @@
 #define HTTP_MUTLI    2
 #define MAX_EXPIRY    19
 #define WHITESPACES " \n\t\r"
+#define POOL_DRAIN_SIZE (64 * 1024)
 typedef enum {
     LOWER_PROTO,
     READ_HEADERS,
@@ -58,6 +60,18 @@ typedef enum {
     FINISH
 }HandshakeState;
 
+/* A lower level connection that can be kept in the idle pool. */
+typedef struct HTTPPoolConn {
+    /* Only set while the connection is idle in the pool. */
+    URLContext *hd;
+    /* Interrupt callback of the context currently using the connection,
+     * the lower protocols are opened with one forwarding to it. */
+    AVIOInterruptCB int_cb;
+    char key[1024];
+    int64_t expires;
+    struct HTTPPoolConn *next;
+} HTTPPoolConn;
+
 typedef struct HTTPContext {
     const AVClass *class;
     URLContext *hd;
@@ -87,6 +101,8 @@ typedef struct HTTPContext {
     int end_chunked_post;
     /* A flag which indicates we have finished to read POST reply. */
     int end_header;
+    /* A flag which indicates the terminating chunk of the reply has been read. */
+    int end_chunked_reply;
     /* A flag which indicates if we use persistent connections. */
     int multiple_requests;
     uint8_t *post_data;
@@ -123,6 +139,10 @@ typedef struct HTTPContext {
     int is_multi_client;
     HandshakeState handshake_step;
     int is_connected_server;
+    int connection_pool;
+    int pool_idle_timeout;
+    int pool_max_idle;
+    HTTPPoolConn *pool_conn;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -141,6 +161,9 @@ static const AVOption options[] = {
     { "user-agent", "override User-Agent header", OFFSET(user_agent_deprecated), AV_OPT_TYPE_STRING, { .str = DEFAULT_USER_AGENT }, 0, 0, D },
 #endif
     { "multiple_requests", "use persistent connections", OFFSET(multiple_requests), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D | E },
+    { "connection_pool", "reuse idle connections shared by all HTTP contexts", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D | E },
+    { "pool_idle_timeout", "time in seconds an idle connection is kept in the pool", OFFSET(pool_idle_timeout), AV_OPT_TYPE_INT, { .i64 = 30 }, 0, INT_MAX / 1000000, D | E },
+    { "pool_max_idle", "maximum number of idle connections kept in the pool", OFFSET(pool_max_idle), AV_OPT_TYPE_INT, { .i64 = 16 }, 0, INT_MAX, D | E },
     { "post_data", "set custom HTTP post data", OFFSET(post_data), AV_OPT_TYPE_BINARY, .flags = D | E },
     { "mime_type", "export the MIME type", OFFSET(mime_type), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "cookies", "set cookies to be sent in applicable future requests, use newline delimited Set-Cookie HTTP field value syntax", OFFSET(cookies), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
@@ -181,6 +204,179 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+static AVMutex pool_lock;
+static AVOnce pool_once = AV_ONCE_INIT;
+/* idle connections, most recently used first */
+static HTTPPoolConn *pool_idle;
+
+static void pool_init(void)
+{
+    ff_mutex_init(&pool_lock, NULL);
+}
+
+static int pool_interrupt_cb(void *opaque)
+{
+    HTTPPoolConn *conn = opaque;
+    return ff_check_interrupt(&conn->int_cb);
+}
+
+static void pool_free_list(HTTPPoolConn *conn)
+{
+    while (conn) {
+        HTTPPoolConn *next = conn->next;
+        ffurl_closep(&conn->hd);
+        av_free(conn);
+        conn = next;
+    }
+}
+
+void ff_http_pool_free(void)
+{
+    HTTPPoolConn *idle;
+
+    ff_thread_once(&pool_once, pool_init);
+    ff_mutex_lock(&pool_lock);
+    idle      = pool_idle;
+    pool_idle = NULL;
+    ff_mutex_unlock(&pool_lock);
+    pool_free_list(idle);
+}
+
+/* Options of the lower protocols a connection can only be shared with
+ * contexts using the same values for. */
+static const char *const pool_key_options[] = {
+    "tls_verify", "verifyhost", "ca_file", "cafile", "cert_file", "key_file", NULL
+};
+
+/**
+ * Build the key identifying the connections to lower_url opened with options.
+ *
+ * @return 0 on success, AVERROR(ENAMETOOLONG) if it does not fit in key
+ */
+static int pool_make_key(char *key, int size, const char *lower_url,
+                         AVDictionary *options)
+{
+    size_t len = av_strlcpy(key, lower_url, size);
+    int i;
+
+    for (i = 0; pool_key_options[i] && len < size; i++) {
+        AVDictionaryEntry *e = av_dict_get(options, pool_key_options[i], NULL, 0);
+        if (e)
+            len += snprintf(key + len, size - len, "|%s=%s", e->key, e->value);
+    }
+    return len < size ? 0 : AVERROR(ENAMETOOLONG);
+}
+
+/* An idle connection has nothing to read, unless the peer closed it. */
+static int pool_conn_alive(URLContext *hd)
+{
+    struct pollfd p = { ffurl_get_file_handle(hd), POLLIN, 0 };
+
+    if (p.fd < 0)
+        return 0;
+    return poll(&p, 1, 0) == 0;
+}
+
+/**
+ * Take an idle connection to key out of the pool and make it the
+ * connection of h.
+ *
+ * @return 1 if a connection was found, 0 otherwise
+ */
+static int pool_get(URLContext *h, const char *key)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPPoolConn **p, *conn, *expired;
+    int64_t now;
+
+    ff_thread_once(&pool_once, pool_init);
+
+    for (;;) {
+        now     = av_gettime_relative();
+        conn    = NULL;
+        expired = NULL;
+
+        ff_mutex_lock(&pool_lock);
+        for (p = &pool_idle; *p; ) {
+            HTTPPoolConn *c = *p;
+            if (c->expires < now || (!conn && !strcmp(c->key, key))) {
+                *p = c->next;
+                if (c->expires < now) {
+                    c->next = expired;
+                    expired = c;
+                } else {
+                    c->next = NULL;
+                    conn    = c;
+                }
+            } else
+                p = &c->next;
+        }
+        ff_mutex_unlock(&pool_lock);
+        pool_free_list(expired);
+
+        if (!conn || pool_conn_alive(conn->hd))
+            break;
+        av_log(h, AV_LOG_DEBUG, "Pooled connection to %s was closed\n", key);
+        pool_free_list(conn);
+    }
+
+    if (!conn)
+        return 0;
+
+    av_log(h, AV_LOG_DEBUG, "Reusing pooled connection to %s\n", key);
+    conn->int_cb = h->interrupt_callback;
+    s->hd        = conn->hd;
+    conn->hd     = NULL;
+    s->pool_conn = conn;
+    return 1;
+}
+
+static void http_close_connection(HTTPContext *s)
+{
+    ffurl_closep(&s->hd);
+    av_freep(&s->pool_conn);
+}
+
+/**
+ * Connect h to lower_url, taking an idle connection from the pool if
+ * allowed.
+ *
+ * @return 1 if a pooled connection is used, 0 for a new connection,
+ *         a negative error code otherwise
+ */
+static int http_open_connection(URLContext *h, const char *lower_url,
+                                AVDictionary **options, int use_idle)
+{
+    HTTPContext *s = h->priv_data;
+    AVIOInterruptCB int_cb = h->interrupt_callback;
+    char key[sizeof(s->pool_conn->key)];
+    int err;
+
+    if (!s->connection_pool ||
+        pool_make_key(key, sizeof(key), lower_url, options ? *options : NULL) < 0)
+        return ffurl_open_whitelist(&s->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                                    &h->interrupt_callback, options,
+                                    h->protocol_whitelist, h->protocol_blacklist, h);
+
+    if (use_idle && pool_get(h, key))
+        return 1;
+
+    s->pool_conn = av_mallocz(sizeof(*s->pool_conn));
+    if (!s->pool_conn)
+        return AVERROR(ENOMEM);
+    av_strlcpy(s->pool_conn->key, key, sizeof(s->pool_conn->key));
+    s->pool_conn->int_cb = h->interrupt_callback;
+    int_cb.callback      = pool_interrupt_cb;
+    int_cb.opaque        = s->pool_conn;
+
+    err = ffurl_open_whitelist(&s->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                               &int_cb, options,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    if (err < 0)
+        av_freep(&s->pool_conn);
+    return err;
+}
+
 static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -188,7 +384,8 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err, location_changed = 0;
+    int port, use_proxy, err, location_changed = 0, reused = 0;
+    uint64_t off;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -227,15 +424,27 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
-        err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                                   &h->interrupt_callback, options,
-                                   h->protocol_whitelist, h->protocol_blacklist, h);
-        if (err < 0)
-            return err;
+        reused = http_open_connection(h, buf, options, 1);
+        if (reused < 0)
+            return reused;
     }
 
+    off           = s->off;
+    s->line_count = 0;
     err = http_connect(h, path, local_path, hoststr,
                        auth, proxyauth, &location_changed);
+    if (err < 0 && reused && !s->line_count &&
+        !ff_check_interrupt(&h->interrupt_callback)) {
+        /* the server dropped the pooled connection, retry on a new one */
+        av_log(h, AV_LOG_DEBUG, "Pooled connection failed, reconnecting\n");
+        http_close_connection(s);
+        s->off = off;
+        err = http_open_connection(h, buf, options, 0);
+        if (err < 0)
+            return err;
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
+    }
     if (err < 0)
         return err;
 
@@ -262,7 +471,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_connection(s);
             goto redo;
         } else
             goto fail;
@@ -270,7 +479,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_connection(s);
             goto redo;
         } else
             goto fail;
@@ -279,7 +488,7 @@ redo:
          s->http_code == 303 || s->http_code == 307) &&
         location_changed == 1) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        http_close_connection(s);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
         /* Restart the authentication process with the new target, which
@@ -293,7 +502,7 @@ redo:
 
 fail:
     if (s->hd)
-        ffurl_closep(&s->hd);
+        http_close_connection(s);
     if (location_changed < 0)
         return location_changed;
     return ff_http_averror(s->http_code, AVERROR(EIO));
@@ -887,6 +1096,9 @@ static int process_line(URLContext *h, char *line, int line_count,
             }
             av_log(h, AV_LOG_TRACE, "HTTP version string: %s\n", version);
         } else {
+            /* HTTP/1.0 servers close the connection after the reply */
+            if (!av_strncasecmp(p, "HTTP/1.0", 8))
+                s->willclose = 1;
             while (!av_isspace(*p) && *p != '\0')
                 p++;
             while (av_isspace(*p))
@@ -1072,7 +1284,8 @@ static int http_read_header(URLContext *h, int *new_location)
     char line[MAX_URL_SIZE];
     int err = 0;
 
-    s->chunksize = UINT64_MAX;
+    s->chunksize         = UINT64_MAX;
+    s->end_chunked_reply = 0;
 
     for (;;) {
         if ((err = http_get_line(s, line, sizeof(line))) < 0)
@@ -1173,7 +1386,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                            "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: ")) {
-        if (s->multiple_requests)
+        if (s->multiple_requests || s->connection_pool)
             len += av_strlcpy(headers + len, "Connection: keep-alive\r\n",
                               sizeof(headers) - len);
         else
@@ -1282,6 +1495,9 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
             char line[32];
             int err;
 
+            if (s->end_chunked_reply)
+                return 0;
+
             do {
                 if ((err = http_get_line(s, line, sizeof(line))) < 0)
                     return err;
@@ -1293,9 +1509,10 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
                    "Chunked encoding data size: %"PRIu64"'\n",
                     s->chunksize);
 
-            if (!s->chunksize)
+            if (!s->chunksize) {
+                s->end_chunked_reply = 1;
                 return 0;
-            else if (s->chunksize == UINT64_MAX) {
+            } else if (s->chunksize == UINT64_MAX) {
                 av_log(h, AV_LOG_ERROR, "Invalid chunk size %"PRIu64"\n",
                        s->chunksize);
                 return AVERROR(EINVAL);
@@ -1326,7 +1543,7 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
     }
     if (len > 0) {
         s->off += len;
-        if (s->chunksize > 0) {
+        if (s->chunksize > 0 && s->chunksize != UINT64_MAX) {
             av_assert0(s->chunksize >= len);
             s->chunksize -= len;
         }
@@ -1550,6 +1767,97 @@ static int http_shutdown(URLContext *h, int flags)
     return ret;
 }
 
+/**
+ * Read the rest of the current reply.
+ *
+ * @return 0 if the connection is left at the start of the next reply,
+ *         a negative value if it cannot be used for another request
+ */
+static int http_finish_reply(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint8_t buf[1024];
+    char line[256];
+    int new_location, ret, left = POOL_DRAIN_SIZE;
+
+    if (h->flags & AVIO_FLAG_WRITE) {
+        /* without chunked encoding the server cannot tell where the
+         * request body ends */
+        if (!s->chunked_post || !s->end_chunked_post)
+            return -1;
+        if (!s->end_header && (ret = http_read_header(h, &new_location)) < 0)
+            return ret;
+    }
+    if (s->willclose || !s->end_header)
+        return -1;
+
+    if (s->http_code != 204 && s->http_code != 304 &&
+        !(s->method && !av_strcasecmp(s->method, "HEAD"))) {
+        uint64_t target_end = s->end_off ? s->end_off : s->filesize;
+
+        if (s->chunksize == UINT64_MAX && target_end == UINT64_MAX)
+            return -1;
+        while (left > 0) {
+            ret = http_buf_read(h, buf, FFMIN(sizeof(buf), left));
+            if (s->chunksize == UINT64_MAX ? ret == AVERROR_EOF && s->off >= target_end :
+                                             !ret && s->end_chunked_reply)
+                break;
+            if (ret <= 0)
+                return -1;
+            left -= ret;
+        }
+        if (left <= 0)
+            return -1;
+        /* skip the trailer of a chunked reply */
+        if (s->end_chunked_reply) {
+            do {
+                if ((ret = http_get_line(s, line, sizeof(line))) < 0)
+                    return ret;
+            } while (*line);
+        }
+    }
+    return s->buf_ptr == s->buf_end ? 0 : -1;
+}
+
+/* Put the connection of h into the idle pool if it can be reused. */
+static void pool_release(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPPoolConn *conn = s->pool_conn, **p, *evicted = NULL;
+    int64_t now;
+    int n = 0;
+
+    if (s->pool_max_idle <= 0 || s->listen || http_finish_reply(h) < 0)
+        return;
+
+    now           = av_gettime_relative();
+    conn->hd      = s->hd;
+    conn->int_cb  = (AVIOInterruptCB){ NULL, NULL };
+    conn->expires = now + s->pool_idle_timeout * 1000000LL;
+    s->hd         = NULL;
+    s->pool_conn  = NULL;
+
+    ff_thread_once(&pool_once, pool_init);
+    ff_mutex_lock(&pool_lock);
+    conn->next = pool_idle;
+    pool_idle  = conn;
+    /* drop expired connections and the least recently used ones above
+     * the limit */
+    for (p = &pool_idle; *p; ) {
+        HTTPPoolConn *c = *p;
+        if (c->expires < now || n >= s->pool_max_idle) {
+            *p      = c->next;
+            c->next = evicted;
+            evicted = c;
+        } else {
+            n++;
+            p = &c->next;
+        }
+    }
+    ff_mutex_unlock(&pool_lock);
+    pool_free_list(evicted);
+}
+
 static int http_close(URLContext *h)
 {
     int ret = 0;
@@ -1564,8 +1872,10 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
+    if (s->pool_conn && s->hd)
+        pool_release(h);
     if (s->hd)
-        ffurl_closep(&s->hd);
+        http_close_connection(s);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -1574,6 +1884,7 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
+    HTTPPoolConn *old_pool_conn = s->pool_conn;
     uint64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
@@ -1604,7 +1915,8 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd        = NULL;
+    s->pool_conn = NULL;
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
@@ -1612,12 +1924,14 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         memcpy(s->buffer, old_buf, old_buf_size);
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
-        s->hd      = old_hd;
-        s->off     = old_off;
+        s->hd        = old_hd;
+        s->pool_conn = old_pool_conn;
+        s->off       = old_off;
         return ret;
     }
     av_dict_free(&options);
     ffurl_close(old_hd);
+    av_free(old_pool_conn);
     return off;
 }
 
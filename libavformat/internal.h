@@ -145,6 +145,12 @@ struct AVFormatInternal {
      * ID3v2 tag useful for MP3 demuxing
      */
     AVDictionary *id3v2_meta;
+
+    /**
+     * Error hit by av_read_frames() after some packets were read,
+     * returned by the next call.
+     */
+    int read_frames_error;
 };
 
 struct AVStreamInternal {
@@ -191,8 +197,21 @@ struct AVStreamInternal {
      * Whether the internal avctx needs to be updated from codecpar (after a late change to codecpar)
      */
     int need_context_update;
+
+    /**
+     * Timestamps of every FF_INDEX_SEARCH_STEP-th entry of
+     * AVStream.index_entries, so that av_index_search_timestamp() can
+     * narrow down the search of a large index without touching most of
+     * its cache lines. Only a hint: entries are checked before being
+     * relied upon, as demuxers may modify the index directly.
+     */
+    int64_t *index_search_ts;
+    unsigned int index_search_ts_allocated_size;
+    int nb_index_search_ts;             ///< number of valid timestamps
 };
 
+#define FF_INDEX_SEARCH_STEP 16
+
 #ifdef __GNUC__
 #define dynarray_add(tab, nb_ptr, elem)\
 do {\
@@ -261,6 +261,8 @@ typedef struct MOVContext {
     int decryption_key_len;
     int enable_drefs;
     int32_t movie_display_matrix[3][3]; ///< display matrix from mvhd
+    char *index_cache_dir;
+    struct MOVIndexCache *index_cache;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
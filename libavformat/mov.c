@@ -57,6 +57,7 @@
 #include "libavcodec/get_bits.h"
 #include "id3v1.h"
 #include "mov_chan.h"
+#include "mov_index_cache.h"
 #include "replaygain.h"
 
 #if CONFIG_ZLIB
@@ -1155,7 +1156,17 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     }
 
-    if ((ret = mov_read_default(c, pb, atom)) < 0)
+    if (c->index_cache_dir && (pb->seekable & AVIO_SEEKABLE_NORMAL)) {
+        ret = ff_mov_index_cache_open(c->fc, &c->index_cache, c->index_cache_dir,
+                                      pb, atom.size,
+                                      c->ignore_editlist | c->advanced_editlist << 1);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = mov_read_default(c, pb, atom);
+    ff_mov_index_cache_close(c->fc, &c->index_cache, ret >= 0);
+    if (ret < 0)
         return ret;
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
     /* so we don't parse the whole file if over a network */
@@ -3306,6 +3317,20 @@ static void mov_fix_index(MOVContext *mov, AVStream *st)
     msc->current_index = msc->index_ranges[0].start;
 }
 
+/**
+ * Building the index rewrites negative sample deltas, so tracks having some
+ * can neither be loaded from nor stored in the index cache.
+ */
+static int mov_stts_is_valid(MOVStreamContext *sc)
+{
+    unsigned int i;
+
+    for (i = 0; i < sc->stts_count; i++)
+        if (sc->stts_data[i].duration < 0)
+            return 0;
+    return 1;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -3369,6 +3394,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         int64_t dts_correction = 0;
         int rap_group_present = sc->rap_group_count && sc->rap_group;
         int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+        int use_index_cache = mov->index_cache && mov_stts_is_valid(sc);
+        unsigned int first_entry;
 
         current_dts -= sc->dts_shift;
         last_dts     = current_dts;
@@ -3384,6 +3411,16 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             return;
         }
         st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
+        first_entry = st->nb_index_entries;
+
+        if (use_index_cache &&
+            ff_mov_index_cache_load(mov->index_cache, st, sc->sample_count,
+                                    &stream_size) >= 0) {
+            if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+                for (i = first_entry; i < FFMIN(st->nb_index_entries, 99); i++)
+                    ff_rfps_add_frame(mov->fc, st, st->index_entries[i].timestamp);
+            goto index_built;
+        }
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -3486,6 +3523,10 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                 }
             }
         }
+        if (use_index_cache)
+            ff_mov_index_cache_add(mov->index_cache, st, first_entry,
+                                   sc->sample_count, stream_size);
+index_built:
         if (st->duration > 0)
             st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
     } else {
@@ -6585,6 +6626,8 @@ static const AVOption mov_options[] = {
     { "decryption_key", "The media decryption key (hex)", OFFSET(decryption_key), AV_OPT_TYPE_BINARY, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "enable_drefs", "Enable external track support.", OFFSET(enable_drefs), AV_OPT_TYPE_BOOL,
         {.i64 = 0}, 0, 1, FLAGS },
+    { "index_cache", "Directory in which to cache the sample index between opens.",
+        OFFSET(index_cache_dir), AV_OPT_TYPE_STRING, {.str = NULL}, .flags = FLAGS },
 
     { NULL },
 };
@@ -0,0 +1,415 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * mov sample index cache.
+ *
+ * File layout, all numbers big-endian:
+ *   8 bytes  "FFMOVIDX"
+ *   4 bytes  version
+ *   16 bytes key
+ * then for each track:
+ *   4 bytes  stream index
+ *   4 bytes  number of samples in the sample tables
+ *   4 bytes  number of index entries
+ *   8 bytes  total size of the samples
+ *   4 bytes  size of the entry data
+ *   entry data
+ *
+ * Each entry starts with a byte of ENTRY_* flags telling which fields differ
+ * from what is predicted from the previous entry, followed by the differing
+ * fields as variable length numbers in the ff_put_v() format.
+ */
+
+#include <stdint.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/file.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/murmur3.h"
+#include "libavcodec/bytestream.h"
+#include "avformat.h"
+#include "avio_internal.h"
+#include "internal.h"
+#include "mov_index_cache.h"
+
+#define CACHE_MAGIC         "FFMOVIDX"
+#define CACHE_VERSION       1
+#define CACHE_HEADER_SIZE   (8 + 4 + 16)
+#define TRACK_HEADER_SIZE   (4 + 4 + 4 + 8 + 4)
+#define MAX_MOOV_SIZE       (1 << 30)
+#define HASH_BUFFER_SIZE    (1 << 16)
+
+#define ENTRY_KEYFRAME      0x01 ///< AVINDEX_KEYFRAME is set
+#define ENTRY_SIZE          0x02 ///< size differs from the previous entry
+#define ENTRY_POS           0x04 ///< entry does not directly follow the previous one
+#define ENTRY_DURATION      0x08 ///< timestamp delta differs from the previous one
+#define ENTRY_DISTANCE      0x10 ///< min_distance is not 0 for keyframes, previous + 1 otherwise
+
+struct MOVIndexCache {
+    uint8_t key[16];
+    char *path;
+
+    /* existing cache file */
+    uint8_t *map;
+    size_t map_size;
+
+    /* tracks built while the cache file did not exist */
+    AVIOContext *out;
+    int nb_tracks;
+};
+
+static uint64_t zigzag_encode(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint64_t get_v(GetByteContext *gb)
+{
+    uint64_t val = 0;
+    int tmp;
+
+    do {
+        tmp = bytestream2_get_byte(gb);
+        val = (val << 7) + (tmp & 127);
+    } while (tmp & 128);
+
+    return val;
+}
+
+static int hash_moov(AVIOContext *pb, int64_t size, int salt, uint8_t key[16])
+{
+    struct AVMurMur3 *md;
+    uint8_t *buf;
+    uint8_t tmp[16];
+    int ret = 0;
+
+    md  = av_murmur3_alloc();
+    buf = av_malloc(HASH_BUFFER_SIZE);
+    if (!md || !buf) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    av_murmur3_init(md);
+    AV_WB32(tmp,      CACHE_VERSION);
+    AV_WB32(tmp +  4, salt);
+    AV_WB64(tmp +  8, avio_size(pb));
+    av_murmur3_update(md, tmp, sizeof(tmp));
+
+    while (size > 0) {
+        int len = avio_read(pb, buf, FFMIN(size, HASH_BUFFER_SIZE));
+        if (len <= 0) {
+            ret = len < 0 ? len : AVERROR_EOF;
+            goto end;
+        }
+        av_murmur3_update(md, buf, len);
+        size -= len;
+    }
+    av_murmur3_final(md, key);
+
+end:
+    av_free(md);
+    av_free(buf);
+    return ret;
+}
+
+static int check_file(AVFormatContext *s, MOVIndexCache *cache)
+{
+    int ret;
+
+    if (avio_check(cache->path, AVIO_FLAG_READ) < 0)
+        return AVERROR(ENOENT);
+
+    ret = av_file_map(cache->path, &cache->map, &cache->map_size, 0, s);
+    if (ret < 0)
+        return ret;
+
+    if (cache->map_size < CACHE_HEADER_SIZE || cache->map_size > INT_MAX ||
+        memcmp(cache->map, CACHE_MAGIC, 8) ||
+        AV_RB32(cache->map + 8) != CACHE_VERSION ||
+        memcmp(cache->map + 12, cache->key, 16)) {
+        av_log(s, AV_LOG_WARNING, "Ignoring invalid index cache %s\n",
+               cache->path);
+        av_file_unmap(cache->map, cache->map_size);
+        cache->map = NULL;
+        return AVERROR_INVALIDDATA;
+    }
+
+    return 0;
+}
+
+int ff_mov_index_cache_open(AVFormatContext *s, MOVIndexCache **pcache,
+                            const char *dir, AVIOContext *pb, int64_t size,
+                            int salt)
+{
+    MOVIndexCache *cache;
+    int64_t pos = avio_tell(pb);
+    char hex[33];
+    int i, ret;
+
+    *pcache = NULL;
+
+    if (size <= 0 || size > MAX_MOOV_SIZE)
+        return 0;
+
+    cache = av_mallocz(sizeof(*cache));
+    if (!cache)
+        return AVERROR(ENOMEM);
+
+    ret = hash_moov(pb, size, salt, cache->key);
+    if (avio_seek(pb, pos, SEEK_SET) < 0) {
+        av_free(cache);
+        return AVERROR(EIO);
+    }
+    if (ret < 0)
+        goto fail;
+
+    for (i = 0; i < 16; i++)
+        snprintf(hex + 2 * i, 3, "%02x", cache->key[i]);
+    cache->path = av_asprintf("%s/%s.ffidx", dir, hex);
+    if (!cache->path) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    if (check_file(s, cache) >= 0) {
+        av_log(s, AV_LOG_VERBOSE, "Using index cache %s\n", cache->path);
+    } else {
+        if ((ret = avio_open_dyn_buf(&cache->out)) < 0)
+            goto fail;
+        avio_write(cache->out, CACHE_MAGIC, 8);
+        avio_wb32(cache->out, CACHE_VERSION);
+        avio_write(cache->out, cache->key, 16);
+    }
+
+    *pcache = cache;
+    return 0;
+
+fail:
+    ff_mov_index_cache_close(s, &cache, 0);
+    if (ret == AVERROR(ENOMEM))
+        return ret;
+    // a moov atom which cannot be read is left to the demuxer
+    av_log(s, AV_LOG_WARNING, "Could not set up the index cache\n");
+    return 0;
+}
+
+static int load_entries(GetByteContext *gb, AVIndexEntry *e, unsigned int nb)
+{
+    int64_t pos = 0, timestamp = 0, duration = 0;
+    int size = 0, distance = -1;
+    unsigned int i;
+
+    for (i = 0; i < nb; i++) {
+        int flags;
+
+        if (bytestream2_get_bytes_left(gb) <= 0)
+            return AVERROR_INVALIDDATA;
+        flags = bytestream2_get_byte(gb);
+
+        pos += size;
+        if (flags & ENTRY_POS)
+            pos += zigzag_decode(get_v(gb));
+        if (flags & ENTRY_SIZE) {
+            uint64_t v = get_v(gb);
+            if (v > 0x3FFFFFFF)
+                return AVERROR_INVALIDDATA;
+            size = v;
+        }
+        if (flags & ENTRY_DURATION)
+            duration = zigzag_decode(get_v(gb));
+        timestamp += duration;
+        if (flags & ENTRY_DISTANCE) {
+            uint64_t v = get_v(gb);
+            if (v > INT_MAX)
+                return AVERROR_INVALIDDATA;
+            distance = v;
+        } else {
+            distance = flags & ENTRY_KEYFRAME ? 0 : distance + 1;
+        }
+
+        e[i].pos          = pos;
+        e[i].timestamp    = timestamp;
+        e[i].size         = size;
+        e[i].min_distance = distance;
+        e[i].flags        = flags & ENTRY_KEYFRAME ? AVINDEX_KEYFRAME : 0;
+    }
+
+    return bytestream2_get_bytes_left(gb) ? AVERROR_INVALIDDATA : 0;
+}
+
+int ff_mov_index_cache_load(MOVIndexCache *cache, AVStream *st,
+                            unsigned int sample_count, uint64_t *stream_size)
+{
+    GetByteContext gb;
+
+    if (!cache->map)
+        return AVERROR(ENOENT);
+
+    bytestream2_init(&gb, cache->map + CACHE_HEADER_SIZE,
+                     cache->map_size - CACHE_HEADER_SIZE);
+
+    while (bytestream2_get_bytes_left(&gb) >= TRACK_HEADER_SIZE) {
+        GetByteContext pgb;
+        unsigned int index  = bytestream2_get_be32u(&gb);
+        unsigned int count  = bytestream2_get_be32u(&gb);
+        unsigned int nb     = bytestream2_get_be32u(&gb);
+        uint64_t     ssize  = bytestream2_get_be64u(&gb);
+        unsigned int length = bytestream2_get_be32u(&gb);
+
+        if (length > bytestream2_get_bytes_left(&gb))
+            return AVERROR_INVALIDDATA;
+        bytestream2_init(&pgb, gb.buffer, length);
+        bytestream2_skipu(&gb, length);
+
+        if (index != st->index)
+            continue;
+        if (count != sample_count || nb > sample_count ||
+            load_entries(&pgb, st->index_entries + st->nb_index_entries, nb) < 0)
+            return AVERROR_INVALIDDATA;
+
+        st->nb_index_entries += nb;
+        *stream_size = ssize;
+        return 0;
+    }
+
+    return AVERROR(ENOENT);
+}
+
+void ff_mov_index_cache_add(MOVIndexCache *cache, AVStream *st,
+                            unsigned int first, unsigned int sample_count,
+                            uint64_t stream_size)
+{
+    AVIOContext *pb;
+    uint8_t *buf;
+    int64_t pos = 0, duration = 0;
+    int i, len, size = 0, distance = -1;
+
+    if (!cache->out || first > st->nb_index_entries ||
+        avio_open_dyn_buf(&pb) < 0)
+        return;
+
+    for (i = first; i < st->nb_index_entries; i++) {
+        const AVIndexEntry *e = &st->index_entries[i];
+        int64_t delta = e->timestamp - (i > first ? st->index_entries[i - 1].timestamp : 0);
+        int key       = !!(e->flags & AVINDEX_KEYFRAME);
+        int flags     = key ? ENTRY_KEYFRAME : 0;
+
+        if (e->pos != pos + size)
+            flags |= ENTRY_POS;
+        if (e->size != size)
+            flags |= ENTRY_SIZE;
+        if (delta != duration)
+            flags |= ENTRY_DURATION;
+        if (e->min_distance != (key ? 0 : distance + 1))
+            flags |= ENTRY_DISTANCE;
+
+        avio_w8(pb, flags);
+        if (flags & ENTRY_POS)
+            ff_put_v(pb, zigzag_encode(e->pos - (pos + size)));
+        if (flags & ENTRY_SIZE)
+            ff_put_v(pb, e->size);
+        if (flags & ENTRY_DURATION)
+            ff_put_v(pb, zigzag_encode(delta));
+        if (flags & ENTRY_DISTANCE)
+            ff_put_v(pb, e->min_distance);
+
+        pos      = e->pos;
+        size     = e->size;
+        duration = delta;
+        distance = e->min_distance;
+    }
+
+    len = avio_close_dyn_buf(pb, &buf);
+    if (!buf)
+        return;
+
+    avio_wb32(cache->out, st->index);
+    avio_wb32(cache->out, sample_count);
+    avio_wb32(cache->out, st->nb_index_entries - first);
+    avio_wb64(cache->out, stream_size);
+    avio_wb32(cache->out, len);
+    avio_write(cache->out, buf, len);
+    cache->nb_tracks++;
+
+    av_free(buf);
+}
+
+static void write_file(AVFormatContext *s, MOVIndexCache *cache,
+                       const uint8_t *buf, int len)
+{
+    AVIOContext *pb;
+    char *tmp;
+    int ret;
+
+    tmp = av_asprintf("%s.tmp", cache->path);
+    if (!tmp)
+        return;
+
+    ret = avio_open2(&pb, tmp, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not create index cache %s\n", tmp);
+        goto end;
+    }
+    avio_write(pb, buf, len);
+    avio_flush(pb);
+    ret = pb->error;
+    avio_closep(&pb);
+
+    if (ret < 0 || ff_rename(tmp, cache->path, s) < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not write index cache %s\n", tmp);
+        avpriv_io_delete(tmp);
+        goto end;
+    }
+    av_log(s, AV_LOG_VERBOSE, "Wrote index cache %s (%d bytes)\n",
+           cache->path, len);
+
+end:
+    av_free(tmp);
+}
+
+void ff_mov_index_cache_close(AVFormatContext *s, MOVIndexCache **pcache,
+                              int commit)
+{
+    MOVIndexCache *cache = *pcache;
+
+    if (!cache)
+        return;
+
+    if (cache->out) {
+        uint8_t *buf;
+        int len = avio_close_dyn_buf(cache->out, &buf);
+
+        if (commit && cache->nb_tracks && buf)
+            write_file(s, cache, buf, len);
+        av_free(buf);
+    }
+
+    if (cache->map)
+        av_file_unmap(cache->map, cache->map_size);
+    av_free(cache->path);
+    av_freep(pcache);
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * On-disk cache of the sample index built by the mov demuxer.
+ *
+ * The cache file of a movie is named after a hash of its 'moov' atom and of
+ * the file size, so that any change to the sample tables results in a miss.
+ * The index entries of each track are stored delta coded, typically taking
+ * 1 to 4 bytes per sample instead of sizeof(AVIndexEntry).
+ */
+
+#ifndef AVFORMAT_MOV_INDEX_CACHE_H
+#define AVFORMAT_MOV_INDEX_CACHE_H
+
+#include <stdint.h>
+
+#include "avformat.h"
+
+typedef struct MOVIndexCache MOVIndexCache;
+
+/**
+ * Look up the cache file for the 'moov' atom starting at the current
+ * position of pb. The atom is read to compute the key, then pb is seeked
+ * back to where it was. If a cache file exists it is mapped into memory.
+ *
+ * @param dir    directory holding the cache files
+ * @param size   size of the 'moov' atom payload
+ * @param salt   demuxer settings which affect the index, mixed into the key
+ * @return 0 on success, with *pcache left NULL if the cache cannot be used;
+ *         a negative error code on allocation failure or if pb could
+ *         not be restored
+ */
+int ff_mov_index_cache_open(AVFormatContext *s, MOVIndexCache **pcache,
+                            const char *dir, AVIOContext *pb, int64_t size,
+                            int salt);
+
+/**
+ * Fill the index of st from the cache. st->index_entries must have room
+ * for sample_count entries.
+ *
+ * @return 0 on success, a negative error code if the track is not cached
+ */
+int ff_mov_index_cache_load(MOVIndexCache *cache, AVStream *st,
+                            unsigned int sample_count, uint64_t *stream_size);
+
+/**
+ * Record the freshly built index of st, to be written out when the cache
+ * is closed. Does nothing if the cache file already exists.
+ *
+ * @param first  index of the first entry built from the sample tables, the
+ *               entries before it are not stored, matching what
+ *               ff_mov_index_cache_load() appends
+ */
+void ff_mov_index_cache_add(MOVIndexCache *cache, AVStream *st,
+                            unsigned int first, unsigned int sample_count,
+                            uint64_t stream_size);
+
+/**
+ * Free the cache, writing out the recorded tracks first if commit is set
+ * and the cache file did not exist yet.
+ */
+void ff_mov_index_cache_close(AVFormatContext *s, MOVIndexCache **pcache,
+                              int commit);
+
+#endif /* AVFORMAT_MOV_INDEX_CACHE_H */
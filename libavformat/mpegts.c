@@ -108,6 +108,25 @@ struct Program {
     int pmt_found;
 };
 
+/** number of TS packets returned at once for each program when splitting */
+#define SPLIT_PACKETS 7
+
+typedef struct SplitProgram {
+    int id;             ///< program number
+    int pmt_pid;
+    int pmt_found;
+    int active;         ///< listed in the last PAT
+    int stream_index;
+    /** pids to forward: PMT, PCR, elementary streams and ECMs */
+    uint8_t pids[NB_PID_MAX / 8];
+    /** PAT packet announcing only this program, continuity counter unset */
+    uint8_t pat[TS_PACKET_SIZE];
+    int pat_cc;
+    uint8_t buf[SPLIT_PACKETS * TS_PACKET_SIZE];
+    int nb_packets;
+    int64_t pos;        ///< position of the first buffered packet
+} SplitProgram;
+
 struct MpegTSContext {
     const AVClass *class;
     /* user data */
@@ -159,6 +178,18 @@ struct MpegTSContext {
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** discard_pid() result + 1 for each pid, 0 if not computed yet */
+    uint8_t discard_pid_cache[NB_PID_MAX];
+    /** whether each AVProgram had AVDISCARD_ALL when the cache was filled */
+    uint8_t *prg_discard_all;
+    unsigned int prg_discard_all_size;
+    int nb_prg_discard_all;
+
+    /** return the packets of each program on their own stream */
+    int split_programs;
+    SplitProgram *split;
+    int nb_split;
 };
 
 #define MPEGTS_OPTIONS \
@@ -191,6 +222,9 @@ static const AVOption raw_options[] = {
     { "compute_pcr",   "compute exact PCR for each transport stream packet",
           offsetof(MpegTSContext, mpeg2ts_compute_pcr), AV_OPT_TYPE_BOOL,
           { .i64 = 0 }, 0, 1,  AV_OPT_FLAG_DECODING_PARAM },
+    { "split_programs", "return the packets of each program on a separate stream",
+          offsetof(MpegTSContext, split_programs), AV_OPT_TYPE_BOOL,
+          { .i64 = 0 }, 0, 1,  AV_OPT_FLAG_DECODING_PARAM },
     { "ts_packetsize", "output option carrying the raw packet size",
       offsetof(MpegTSContext, raw_packet_size), AV_OPT_TYPE_INT,
       { .i64 = 0 }, 0, 0,
@@ -271,10 +305,16 @@ static void clear_avprogram(MpegTSContext *ts, unsigned int programid)
     prg->nb_stream_indexes = 0;
 }
 
+static void invalidate_discard_cache(MpegTSContext *ts)
+{
+    memset(ts->discard_pid_cache, 0, sizeof(ts->discard_pid_cache));
+}
+
 static void clear_program(MpegTSContext *ts, unsigned int programid)
 {
     int i;
 
+    invalidate_discard_cache(ts);
     clear_avprogram(ts, programid);
     for (i = 0; i < ts->nb_prg; i++)
         if (ts->prg[i].id == programid) {
@@ -287,11 +327,13 @@ static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    invalidate_discard_cache(ts);
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
 {
     struct Program *p;
+    invalidate_discard_cache(ts);
     if (av_reallocp_array(&ts->prg, ts->nb_prg + 1, sizeof(*ts->prg)) < 0) {
         ts->nb_prg = 0;
         return;
@@ -319,6 +361,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
             return;
 
     p->pids[p->nb_pids++] = pid;
+    invalidate_discard_cache(ts);
 }
 
 static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
@@ -383,6 +426,57 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Drop the cached discard_pid() results if the discard setting of a
+ * program changed since they were computed.
+ */
+static void check_program_discard(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i, changed = s->nb_programs != ts->nb_prg_discard_all;
+
+    if (changed) {
+        av_fast_malloc(&ts->prg_discard_all, &ts->prg_discard_all_size,
+                       s->nb_programs);
+        if (!ts->prg_discard_all) {
+            ts->nb_prg_discard_all = -1;
+            invalidate_discard_cache(ts);
+            return;
+        }
+        ts->nb_prg_discard_all = s->nb_programs;
+    }
+    for (i = 0; i < s->nb_programs; i++) {
+        uint8_t discard_all = s->programs[i]->discard == AVDISCARD_ALL;
+        if (ts->prg_discard_all[i] != discard_all) {
+            ts->prg_discard_all[i] = discard_all;
+            changed = 1;
+        }
+    }
+    if (changed)
+        invalidate_discard_cache(ts);
+}
+
+static int discard_pid_cached(MpegTSContext *ts, unsigned int pid)
+{
+    if (!ts->discard_pid_cache[pid])
+        ts->discard_pid_cache[pid] = discard_pid(ts, pid) + 1;
+    return ts->discard_pid_cache[pid] - 1;
+}
+
+/**
+ * Tell whether the packet with the given header bytes can be skipped
+ * without calling handle_packet(), that is if its pid has no filter or is
+ * only used by discarded programs.
+ */
+static av_always_inline int skip_packet(MpegTSContext *ts, const uint8_t *packet)
+{
+    int pid = AV_RB16(packet + 1) & 0x1fff;
+
+    if (!ts->pids[pid] && !(ts->auto_guess && packet[1] & 0x40))
+        return 1;
+    return pid && discard_pid_cached(ts, pid);
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -2256,7 +2350,7 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if (pid && discard_pid(ts, pid))
+    if (pid && discard_pid_cached(ts, pid))
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -2477,6 +2571,60 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Count the packets with a valid sync byte at the start of buf.
+ */
+static int count_synced_packets(const uint8_t *buf, int nb_packets)
+{
+    int i;
+
+    for (i = 0; i + 4 <= nb_packets; i += 4) {
+        if ((buf[0] ^ 0x47) | (buf[TS_PACKET_SIZE]     ^ 0x47) |
+            (buf[2 * TS_PACKET_SIZE] ^ 0x47) | (buf[3 * TS_PACKET_SIZE] ^ 0x47))
+            break;
+        buf += 4 * TS_PACKET_SIZE;
+    }
+    for (; i < nb_packets && buf[0] == 0x47; i++)
+        buf += TS_PACKET_SIZE;
+    return i;
+}
+
+/**
+ * Handle the packets already present in the I/O buffer without going
+ * through read_packet(), skipping the ones no filter wants before any
+ * further processing. Only used for 188 byte packets.
+ *
+ * @param packet_num number of packets handled so far, updated
+ * @return 0, or the handle_packet() error
+ */
+static int handle_buffered_packets(MpegTSContext *ts, int64_t nb_packets,
+                                   int64_t *packet_num)
+{
+    AVIOContext *pb = ts->stream->pb;
+    uint8_t *p = pb->buf_ptr;
+    int nb = count_synced_packets(p, (pb->buf_end - p) / TS_PACKET_SIZE);
+    int ret = 0;
+
+    if (nb_packets)
+        nb = FFMIN(nb, nb_packets - *packet_num - 1);
+
+    for (; nb > 0 && !ts->stop_parse; nb--) {
+        (*packet_num)++;
+        if (skip_packet(ts, p)) {
+            p += TS_PACKET_SIZE;
+            continue;
+        }
+        /* handle_packet() uses the position after the packet */
+        pb->buf_ptr = p + TS_PACKET_SIZE;
+        ret = handle_packet(ts, p);
+        p += TS_PACKET_SIZE;
+        if (ret != 0)
+            break;
+    }
+    pb->buf_ptr = p;
+    return ret;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -2485,6 +2633,8 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
     int64_t packet_num;
     int ret = 0;
 
+    check_program_discard(ts);
+
     if (avio_tell(s->pb) != ts->last_pos) {
         int i;
         av_log(ts->stream, AV_LOG_TRACE, "Skipping after seek\n");
@@ -2518,6 +2668,23 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        if (ts->raw_packet_size == TS_PACKET_SIZE && !s->pb->write_flag &&
+            s->pb->buf_end - s->pb->buf_ptr >= 2 * TS_PACKET_SIZE) {
+            packet_num--;
+            ret = handle_buffered_packets(ts, nb_packets, &packet_num);
+            if (ret != 0)
+                break;
+            /* stop conditions, or a packet which needs read_packet() */
+            packet_num++;
+            if (nb_packets != 0 && packet_num >= nb_packets ||
+                ts->stop_parse > 1) {
+                ret = AVERROR(EAGAIN);
+                break;
+            }
+            if (ts->stop_parse > 0)
+                break;
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -2608,6 +2775,258 @@ static void seek_back(AVFormatContext *s, AVIOContext *pb, int64_t pos) {
         av_log(s, (pb->seekable & AVIO_SEEKABLE_NORMAL) ? AV_LOG_ERROR : AV_LOG_INFO, "Unable to seek back to the start\n");
 }
 
+/* MPTS splitting: forward the raw packets of each program to its own stream */
+
+static SplitProgram *get_split_program(MpegTSContext *ts, int id)
+{
+    int i;
+
+    for (i = 0; i < ts->nb_split; i++)
+        if (ts->split[i].id == id)
+            return &ts->split[i];
+    return NULL;
+}
+
+static SplitProgram *add_split_program(MpegTSContext *ts, int id)
+{
+    SplitProgram *sp;
+    AVStream *st;
+
+    if (av_reallocp_array(&ts->split, ts->nb_split + 1, sizeof(*ts->split)) < 0) {
+        ts->nb_split = 0;
+        return NULL;
+    }
+    st = avformat_new_stream(ts->stream, NULL);
+    if (!st)
+        return NULL;
+    st->id = id;
+    avpriv_set_pts_info(st, 60, 1, 27000000);
+    st->codecpar->codec_type = AVMEDIA_TYPE_DATA;
+    st->codecpar->codec_id   = AV_CODEC_ID_MPEG2TS;
+
+    sp = &ts->split[ts->nb_split++];
+    memset(sp, 0, sizeof(*sp));
+    sp->id           = id;
+    sp->pmt_pid      = -1;
+    sp->stream_index = st->index;
+    return sp;
+}
+
+static void split_add_pid(SplitProgram *sp, int pid)
+{
+    /* the PAT is rewritten and null packets are dropped */
+    if (pid != PAT_PID && pid != 0x1fff)
+        sp->pids[pid >> 3] |= 1 << (pid & 7);
+}
+
+static void split_add_ca_pids(SplitProgram *sp, const uint8_t *p,
+                              const uint8_t *p_end)
+{
+    while (p_end - p >= 2) {
+        int tag = p[0], len = p[1];
+        p += 2;
+        if (len > p_end - p)
+            break;
+        if (tag == 0x09 && len >= 4) /* CA descriptor */
+            split_add_pid(sp, AV_RB16(p + 2) & 0x1fff);
+        p += len;
+    }
+}
+
+static void split_build_pat(SplitProgram *sp, int ts_id, int version)
+{
+    uint8_t *q = sp->pat;
+
+    memset(sp->pat, 0xff, sizeof(sp->pat));
+    *q++ = 0x47;
+    *q++ = 0x40; /* payload_unit_start_indicator, PAT_PID */
+    *q++ = 0x00;
+    *q++ = 0x10; /* payload only */
+    *q++ = 0x00; /* pointer_field */
+    *q++ = PAT_TID;
+    bytestream_put_be16(&q, 0xb000 | 13);
+    bytestream_put_be16(&q, ts_id);
+    *q++ = 0xc1 | (version << 1);
+    *q++ = 0; /* section_number */
+    *q++ = 0; /* last_section_number */
+    bytestream_put_be16(&q, sp->id);
+    bytestream_put_be16(&q, 0xe000 | sp->pmt_pid);
+    AV_WL32(q, av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1,
+                      sp->pat + 5, q - sp->pat - 5));
+}
+
+static void split_pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    SplitProgram *sp;
+    int i, pcr_pid, pid, len;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PMT_TID)
+        return;
+    sp = get_split_program(ts, h->id);
+    if (!sp || sp->pmt_pid != filter->pid)
+        return;
+
+    /* several programs may share the PMT pid, so do not skip_identical() */
+    pcr_pid = get16(&p, p_end);
+    len     = get16(&p, p_end);
+    if (pcr_pid < 0 || len < 0)
+        return;
+    len &= 0xfff;
+    if (len > p_end - p)
+        return;
+
+    memset(sp->pids, 0, sizeof(sp->pids));
+    split_add_pid(sp, sp->pmt_pid);
+    split_add_pid(sp, pcr_pid & 0x1fff);
+    split_add_ca_pids(sp, p, p + len);
+    p += len;
+    while (get8(&p, p_end) >= 0) {
+        pid = get16(&p, p_end);
+        len = get16(&p, p_end);
+        if (pid < 0 || len < 0)
+            break;
+        split_add_pid(sp, pid & 0x1fff);
+        len = FFMIN(len & 0xfff, p_end - p);
+        split_add_ca_pids(sp, p, p + len);
+        p += len;
+    }
+    sp->pmt_found = 1;
+
+    for (i = 0; i < ts->nb_split; i++)
+        if (ts->split[i].active && !ts->split[i].pmt_found)
+            return;
+    ts->stop_parse = 2;
+}
+
+static void split_pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    SplitProgram *sp;
+    int i, sid, pmt_pid;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PAT_TID)
+        return;
+    if (skip_identical(h, &filter->u.section_filter))
+        return;
+
+    if (!h->sec_num)
+        for (i = 0; i < ts->nb_split; i++)
+            ts->split[i].active = 0;
+    for (;;) {
+        sid = get16(&p, p_end);
+        if (sid < 0)
+            break;
+        pmt_pid = get16(&p, p_end);
+        if (pmt_pid < 0)
+            break;
+        pmt_pid &= 0x1fff;
+        if (sid == 0x0000 || pmt_pid == PAT_PID) /* NIT info */
+            continue;
+
+        sp = get_split_program(ts, sid);
+        if (!sp && !(sp = add_split_program(ts, sid)))
+            return;
+        if (sp->pmt_pid != pmt_pid) {
+            memset(sp->pids, 0, sizeof(sp->pids));
+            sp->pmt_pid   = pmt_pid;
+            sp->pmt_found = 0;
+            split_add_pid(sp, pmt_pid);
+        }
+        sp->active = 1;
+        split_build_pat(sp, h->id, h->version);
+
+        if (ts->pids[pmt_pid] &&
+            (ts->pids[pmt_pid]->type != MPEGTS_SECTION ||
+             ts->pids[pmt_pid]->u.section_filter.section_cb != split_pmt_cb))
+            mpegts_close_filter(ts, ts->pids[pmt_pid]);
+        if (!ts->pids[pmt_pid])
+            mpegts_open_section_filter(ts, pmt_pid, split_pmt_cb, ts, 1);
+    }
+}
+
+static void split_queue_packet(SplitProgram *sp, const uint8_t *data, int64_t pos)
+{
+    if (!sp->nb_packets)
+        sp->pos = pos;
+    memcpy(sp->buf + sp->nb_packets++ * TS_PACKET_SIZE, data, TS_PACKET_SIZE);
+}
+
+static int split_output_packet(SplitProgram *sp, AVPacket *pkt)
+{
+    int ret = av_new_packet(pkt, sp->nb_packets * TS_PACKET_SIZE);
+    if (ret < 0)
+        return ret;
+    memcpy(pkt->data, sp->buf, pkt->size);
+    pkt->stream_index = sp->stream_index;
+    pkt->pos          = sp->pos;
+    pkt->flags       |= AV_PKT_FLAG_KEY;
+    sp->nb_packets    = 0;
+    return 0;
+}
+
+/**
+ * Route each TS packet to the programs which reference its pid, without
+ * any PES processing. Only the PAT and PMTs are parsed, the PAT is
+ * replaced by one listing only the program of the stream.
+ */
+static int split_read_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    MpegTSContext *ts = s->priv_data;
+    const uint8_t *data;
+    uint8_t packet[TS_PACKET_SIZE];
+    int64_t pos;
+    int i, pid, ret;
+
+    for (;;) {
+        for (i = 0; i < ts->nb_split; i++)
+            if (ts->split[i].nb_packets == SPLIT_PACKETS)
+                return split_output_packet(&ts->split[i], pkt);
+
+        ret = read_packet(s, packet, ts->raw_packet_size, &data);
+        if (ret < 0) {
+            for (i = 0; i < ts->nb_split; i++)
+                if (ts->split[i].nb_packets)
+                    return split_output_packet(&ts->split[i], pkt);
+            return ret;
+        }
+        pos = avio_tell(s->pb) - TS_PACKET_SIZE;
+        pid = AV_RB16(data + 1) & 0x1fff;
+
+        if (ts->pids[pid])
+            handle_packet(ts, data);
+
+        for (i = 0; i < ts->nb_split; i++) {
+            SplitProgram *sp = &ts->split[i];
+            if (!sp->active ||
+                s->streams[sp->stream_index]->discard >= AVDISCARD_ALL)
+                continue;
+            if (pid == PAT_PID) {
+                if (!(data[1] & 0x40))
+                    continue;
+                sp->pat[3] = 0x10 | sp->pat_cc;
+                sp->pat_cc = (sp->pat_cc + 1) & 0xf;
+                split_queue_packet(sp, sp->pat, pos);
+            } else if (sp->pids[pid >> 3] & (1 << (pid & 7))) {
+                split_queue_packet(sp, data, pos);
+            }
+        }
+        finished_reading_packet(s, ts->raw_packet_size);
+    }
+}
+
 static int mpegts_read_header(AVFormatContext *s)
 {
     MpegTSContext *ts = s->priv_data;
@@ -2647,6 +3066,16 @@ static int mpegts_read_header(AVFormatContext *s)
 
         av_log(ts->stream, AV_LOG_TRACE, "tuning done\n");
 
+        s->ctx_flags |= AVFMTCTX_NOHEADER;
+    } else if (ts->split_programs) {
+        seek_back(s, pb, pos);
+
+        mpegts_open_section_filter(ts, PAT_PID, split_pat_cb, ts, 1);
+
+        handle_packets(ts, probesize / ts->raw_packet_size);
+        if (!ts->nb_split)
+            av_log(s, AV_LOG_WARNING, "No program found in the probed data\n");
+
         s->ctx_flags |= AVFMTCTX_NOHEADER;
     } else {
         AVStream *st;
@@ -2724,6 +3153,9 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
     uint8_t pcr_buf[12];
     const uint8_t *data;
 
+    if (ts->split_programs)
+        return split_read_packet(s, pkt);
+
     if (av_new_packet(pkt, TS_PACKET_SIZE) < 0)
         return AVERROR(ENOMEM);
     ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
@@ -2798,6 +3230,8 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prg_discard_all);
+    av_freep(&ts->split);
 
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
@@ -2908,6 +3342,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    check_program_discard(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
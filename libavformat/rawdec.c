@@ -34,14 +34,22 @@
 
 int ff_raw_read_partial_packet(AVFormatContext *s, AVPacket *pkt)
 {
+    int64_t pos = avio_tell(s->pb);
     int ret, size;
 
     size = RAW_PACKET_SIZE;
 
+    ret = ffio_read_packet_ref(s->pb, pkt, size);
+    if (ret) {
+        pkt->pos          = pos;
+        pkt->stream_index = 0;
+        return ret;
+    }
+
     if (av_new_packet(pkt, size) < 0)
         return AVERROR(ENOMEM);
 
-    pkt->pos= avio_tell(s->pb);
+    pkt->pos= pos;
     pkt->stream_index = 0;
     ret = ffio_read_partial(s->pb, pkt->data, size);
     if (ret < 0) {
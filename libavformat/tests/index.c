@@ -0,0 +1,272 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+#include "libavformat/internal.h"
+
+static const int search_flags[] = {
+    0,
+    AVSEEK_FLAG_BACKWARD,
+    AVSEEK_FLAG_ANY,
+    AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD,
+};
+
+static int64_t entry_timestamp(int i)
+{
+    return 3 * (int64_t)i + (i & 1);
+}
+
+/**
+ * Reference search: the last entry with a timestamp <= ts if searching
+ * backward, the first one with a timestamp >= ts otherwise, then the
+ * nearest keyframe in the search direction unless AVSEEK_FLAG_ANY is set.
+ */
+static int linear_search(const AVIndexEntry *entries, int nb_entries,
+                         int64_t ts, int flags)
+{
+    int backward = !!(flags & AVSEEK_FLAG_BACKWARD);
+    int m;
+
+    if (backward)
+        for (m = nb_entries - 1; m >= 0 && entries[m].timestamp > ts; m--)
+            ;
+    else
+        for (m = 0; m < nb_entries && entries[m].timestamp < ts; m++)
+            ;
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        while (m >= 0 && m < nb_entries &&
+               !(entries[m].flags & AVINDEX_KEYFRAME))
+            m += backward ? -1 : 1;
+
+    return m == nb_entries ? -1 : m;
+}
+
+static int check_searches(AVStream *st, AVLFG *lfg, int nb_searches, int linear)
+{
+    int64_t max_ts = st->index_entries[st->nb_index_entries - 1].timestamp + 2;
+    int i, j;
+
+    for (i = 0; i < nb_searches; i++) {
+        int64_t ts = av_lfg_get(lfg) % (max_ts + 4) - 2;
+        for (j = 0; j < FF_ARRAY_ELEMS(search_flags); j++) {
+            int ref = linear ?
+                      linear_search(st->index_entries, st->nb_index_entries,
+                                    ts, search_flags[j]) :
+                      ff_index_search_timestamp(st->index_entries,
+                                                st->nb_index_entries,
+                                                ts, search_flags[j]);
+            int res = av_index_search_timestamp(st, ts, search_flags[j]);
+            if (ref != res) {
+                printf("search of %"PRId64" with flags %d: got %d, expected %d\n",
+                       ts, search_flags[j], res, ref);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Create an index with runs of up to 40 entries sharing a timestamp, the
+ * way the mov demuxer may fill it directly, so that some runs span several
+ * entries of the sparse search table.
+ */
+static AVStream *add_duplicates(AVFormatContext *s, AVLFG *lfg, int nb)
+{
+    AVStream *st = avformat_new_stream(s, NULL);
+    int64_t ts = 0;
+    int i, run = 0;
+
+    if (!st)
+        return NULL;
+    st->index_entries = av_mallocz_array(nb, sizeof(*st->index_entries));
+    if (!st->index_entries)
+        return NULL;
+    st->index_entries_allocated_size = nb * sizeof(*st->index_entries);
+
+    for (i = 0; i < nb; i++) {
+        AVIndexEntry *e = &st->index_entries[i];
+        if (!run--) {
+            run = av_lfg_get(lfg) % 40;
+            ts += 2;
+        }
+        e->pos       = 1000 * (int64_t)i;
+        e->timestamp = ts;
+        e->size      = 1000;
+        e->flags     = av_lfg_get(lfg) % 5 ? 0 : AVINDEX_KEYFRAME;
+    }
+    st->nb_index_entries = nb;
+
+    return st;
+}
+
+static AVStream *add_entries(AVFormatContext *s, AVLFG *lfg, int nb, int shuffle)
+{
+    AVStream *st = avformat_new_stream(s, NULL);
+    int *order;
+    int i;
+
+    if (!st)
+        return NULL;
+    order = av_malloc_array(nb, sizeof(*order));
+    if (!order)
+        return NULL;
+
+    for (i = 0; i < nb; i++)
+        order[i] = i;
+    for (i = nb - 1; shuffle && i > 0; i--) {
+        int j = av_lfg_get(lfg) % (i + 1);
+        FFSWAP(int, order[i], order[j]);
+    }
+
+    for (i = 0; i < nb; i++) {
+        int k = order[i];
+        if (av_add_index_entry(st, 1000 * (int64_t)k, entry_timestamp(k), 1000,
+                               0, k % 7 ? 0 : AVINDEX_KEYFRAME) < 0) {
+            st = NULL;
+            break;
+        }
+    }
+
+    av_free(order);
+    return st;
+}
+
+static int test(void)
+{
+    AVFormatContext *s = avformat_alloc_context();
+    AVLFG lfg;
+    AVStream *st;
+    int nb, ret = 1;
+
+    if (!s)
+        return 1;
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    st = add_entries(s, &lfg, 20000, 1);
+    if (!st || st->nb_index_entries != 20000)
+        goto end;
+    printf("out of order insertion: %d entries\n", st->nb_index_entries);
+    if (check_searches(st, &lfg, 10000, 1))
+        goto end;
+    printf("search: ok\n");
+
+    /* Change the index behind the back of the search table, the way some
+     * demuxers do, and check that stale data is not used. */
+    nb = st->nb_index_entries;
+    memmove(st->index_entries + 1001, st->index_entries + 1000,
+            (nb - 1001) * sizeof(*st->index_entries));
+    st->index_entries[1000].timestamp--;
+    st->index_entries[1001].timestamp++;
+    if (check_searches(st, &lfg, 10000, 1))
+        goto end;
+    printf("search after direct modification: ok\n");
+
+    st->index_entries[5000].flags |= AVINDEX_DISCARD_FRAME;
+    st->index_entries[5008].flags |= AVINDEX_DISCARD_FRAME;
+    st->index_entries[5016].flags |= AVINDEX_DISCARD_FRAME;
+    if (check_searches(st, &lfg, 10000, 0))
+        goto end;
+    printf("search with discarded entries: ok\n");
+
+    st = add_duplicates(s, &lfg, 20000);
+    if (!st)
+        goto end;
+    if (check_searches(st, &lfg, 10000, 1))
+        goto end;
+    printf("search with duplicate timestamps: ok\n");
+
+    ret = 0;
+end:
+    avformat_free_context(s);
+    return ret;
+}
+
+static void benchmark(int nb)
+{
+    AVFormatContext *s = avformat_alloc_context();
+    int nb_searches = 1000000;
+    int64_t *wanted, t0, t1;
+    AVStream *st;
+    AVLFG lfg;
+    int i, sum = 0;
+
+    wanted = av_malloc_array(nb_searches, sizeof(*wanted));
+    if (!s || !wanted)
+        goto end;
+    av_lfg_init(&lfg, 1);
+
+    t0 = av_gettime_relative();
+    st = add_entries(s, &lfg, nb, 0);
+    t1 = av_gettime_relative();
+    if (!st)
+        goto end;
+    printf("%d in order insertions: %"PRId64" ms\n", nb, (t1 - t0) / 1000);
+
+    for (i = 0; i < nb_searches; i++)
+        wanted[i] = (((int64_t)av_lfg_get(&lfg) << 32) | av_lfg_get(&lfg)) %
+                    entry_timestamp(nb);
+    av_index_search_timestamp(st, 0, 0);
+
+    t0 = av_gettime_relative();
+    for (i = 0; i < nb_searches; i++)
+        sum += ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
+                                         wanted[i], 0);
+    t1 = av_gettime_relative();
+    printf("binary search: %"PRId64" ns/search\n",
+           (t1 - t0) * 1000 / nb_searches);
+
+    t0 = av_gettime_relative();
+    for (i = 0; i < nb_searches; i++)
+        sum -= av_index_search_timestamp(st, wanted[i], 0);
+    t1 = av_gettime_relative();
+    printf("two-level search: %"PRId64" ns/search\n",
+           (t1 - t0) * 1000 / nb_searches);
+    if (sum)
+        printf("search results differ\n");
+
+    avformat_free_context(s);
+    s = avformat_alloc_context();
+    if (!s)
+        goto end;
+    nb = FFMIN(nb, 100000);
+    t0 = av_gettime_relative();
+    add_entries(s, &lfg, nb, 1);
+    t1 = av_gettime_relative();
+    printf("%d out of order insertions: %"PRId64" ms\n", nb, (t1 - t0) / 1000);
+
+end:
+    av_free(wanted);
+    avformat_free_context(s);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-t")) {
+        benchmark(argc > 2 ? atoi(argv[2]) : 10000000);
+        return 0;
+    }
+    return test();
+}
@@ -26,6 +26,9 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
+
+#include <stdatomic.h>
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -77,6 +80,36 @@
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
 
+/**
+ * Receiving circular buffer, written by circular_buffer_task_rx() and read
+ * by udp_read() without locking. Each datagram is stored as its size, its
+ * receive time if timestamps are enabled, and its payload. The fields
+ * written by each side are kept on separate cache lines.
+ */
+typedef struct UDPRing {
+    /* written by the consumer */
+    atomic_uint head;           ///< read position
+    atomic_int waiting;         ///< set while the consumer may wait on cond
+    uint8_t pad0[64];
+
+    /* written by the producer */
+    atomic_uint tail;           ///< write position
+    atomic_uint overruns;       ///< number of datagrams dropped
+    atomic_uint high_water;     ///< highest number of bytes used
+    uint8_t pad1[64];
+
+    uint8_t *buf;
+    unsigned int size;          ///< one more than the usable size
+} UDPRing;
+
+#if HAVE_RECVMMSG && defined(SO_TIMESTAMPNS)
+#define UDP_TIMESTAMPS 1
+#define UDP_CONTROL_SIZE CMSG_SPACE(sizeof(struct timespec))
+#else
+#define UDP_TIMESTAMPS 0
+#define UDP_CONTROL_SIZE 0
+#endif
+
 typedef struct UDPContext {
     const AVClass *class;
     int udp_fd;
@@ -96,7 +129,10 @@ typedef struct UDPContext {
     /* Circular Buffer variables for use in UDP receive code */
     int circular_buffer_size;
     AVFifoBuffer *fifo;
+    UDPRing *ring;
     int circular_buffer_error;
+    int64_t fifo_overruns;
+    int fifo_high_water;
     int64_t bitrate; /* number of bits to send per second */
     int64_t burst_bits;
     int close_req;
@@ -113,6 +149,19 @@ typedef struct UDPContext {
     struct sockaddr_storage local_addr_storage;
     char *sources;
     char *block;
+
+    /* Batched I/O with recvmmsg() and sendmmsg() */
+    int batch_size;
+    int timestamps;
+    int64_t recv_time;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    uint8_t *batch_buf;
+    uint8_t *control_buf;
+    int batch_pos;              ///< next received datagram to return
+    int batch_count;            ///< number of received datagrams
+#endif
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -137,6 +186,11 @@ static const AVOption options[] = {
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",     "Number of datagrams per system call",             OFFSET(batch_size),     AV_OPT_TYPE_INT,    { .i64 = 1 },      1, 1024,    D|E },
+    { "timestamps",     "Get the kernel receive time of datagrams",        OFFSET(timestamps),     AV_OPT_TYPE_BOOL,   { .i64 = 0 },      0, 1,       D },
+    { "fifo_overruns",  "Number of datagrams dropped because the circular buffer was full", OFFSET(fifo_overruns), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "fifo_high_water", "Highest fill level of the circular buffer, in bytes", OFFSET(fifo_high_water), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "recv_time",      "Kernel receive time of the last datagram read, in microseconds since the epoch", OFFSET(recv_time), AV_OPT_TYPE_INT64, { .i64 = AV_NOPTS_VALUE }, INT64_MIN, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
     { NULL }
 };
 
@@ -495,59 +549,275 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+static int udp_alloc_batch(UDPContext *s, int is_output)
+{
+    int i;
+
+    s->msgs      = av_mallocz_array(s->batch_size, sizeof(*s->msgs));
+    s->iov       = av_mallocz_array(s->batch_size, sizeof(*s->iov));
+    s->batch_buf = av_malloc_array(s->batch_size, UDP_MAX_PKT_SIZE);
+    if (s->timestamps)
+        s->control_buf = av_mallocz_array(s->batch_size, UDP_CONTROL_SIZE);
+    if (!s->msgs || !s->iov || !s->batch_buf || (s->timestamps && !s->control_buf))
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->batch_size; i++) {
+        struct msghdr *hdr = &s->msgs[i].msg_hdr;
+
+        s->iov[i].iov_base = s->batch_buf + i * UDP_MAX_PKT_SIZE;
+        s->iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+        hdr->msg_iov       = &s->iov[i];
+        hdr->msg_iovlen    = 1;
+        if (is_output && !s->is_connected) {
+            hdr->msg_name    = &s->dest_addr;
+            hdr->msg_namelen = s->dest_addr_len;
+        }
+    }
+    return 0;
+}
+
+static void udp_free_batch(UDPContext *s)
+{
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+    av_freep(&s->batch_buf);
+    av_freep(&s->control_buf);
+}
+#endif
+
+#if HAVE_RECVMMSG
+/**
+ * Receive up to batch_size datagrams, only waiting for the first one.
+ *
+ * @return number of datagrams received or AVERROR
+ */
+static int udp_recv_batch(UDPContext *s)
+{
+    int i, ret;
+
+    for (i = 0; i < s->batch_size; i++) {
+        struct msghdr *hdr = &s->msgs[i].msg_hdr;
+
+        /* reset what the previous call changed */
+        s->iov[i].iov_len = UDP_MAX_PKT_SIZE;
+        if (s->timestamps) {
+            hdr->msg_control    = s->control_buf + i * UDP_CONTROL_SIZE;
+            hdr->msg_controllen = UDP_CONTROL_SIZE;
+        }
+    }
+    ret = recvmmsg(s->udp_fd, s->msgs, s->batch_size, MSG_WAITFORONE, NULL);
+    return ret < 0 ? ff_neterrno() : ret;
+}
+
+static int64_t udp_msg_time(struct msghdr *hdr)
+{
+#if UDP_TIMESTAMPS
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+        }
+    }
+#endif
+    return AV_NOPTS_VALUE;
+}
+#endif
+
+#if HAVE_SENDMMSG
+/**
+ * Send the first nb datagrams of the batch.
+ */
+static int udp_send_batch(UDPContext *s, int nb)
+{
+    int sent = 0, ret;
+
+    while (sent < nb) {
+        ret = sendmmsg(s->udp_fd, s->msgs + sent, nb - sent, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+            continue;
+        }
+        sent += ret;
+    }
+    return 0;
+}
+#endif
+
 #if HAVE_PTHREAD_CANCEL
+static int udp_ring_alloc(UDPContext *s)
+{
+    UDPRing *r = av_mallocz(sizeof(*s->ring));
+
+    if (!r)
+        return AVERROR(ENOMEM);
+    r->size = s->circular_buffer_size + 1;
+    r->buf  = av_malloc(r->size);
+    if (!r->buf) {
+        av_free(r);
+        return AVERROR(ENOMEM);
+    }
+    atomic_init(&r->head, 0);
+    atomic_init(&r->waiting, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->overruns, 0);
+    atomic_init(&r->high_water, 0);
+    s->ring = r;
+    return 0;
+}
+
+static void udp_ring_free(UDPContext *s)
+{
+    if (s->ring)
+        av_freep(&s->ring->buf);
+    av_freep(&s->ring);
+}
+
+static unsigned int udp_ring_write(UDPRing *r, unsigned int pos,
+                                   const uint8_t *src, unsigned int len)
+{
+    unsigned int len1 = FFMIN(len, r->size - pos);
+
+    memcpy(r->buf + pos, src, len1);
+    memcpy(r->buf, src + len1, len - len1);
+    pos += len;
+    return pos >= r->size ? pos - r->size : pos;
+}
+
+static unsigned int udp_ring_read(UDPRing *r, unsigned int pos,
+                                  uint8_t *dst, unsigned int len)
+{
+    unsigned int len1 = FFMIN(len, r->size - pos);
+
+    memcpy(dst, r->buf + pos, len1);
+    memcpy(dst + len1, r->buf, len - len1);
+    pos += len;
+    return pos >= r->size ? pos - r->size : pos;
+}
+
+/**
+ * Append a datagram to the circular buffer, preceded by its size and, if
+ * timestamps are enabled, its receive time. The datagram is not visible to
+ * the reader until udp_ring_publish() is called.
+ *
+ * @param ptail write position, updated
+ * @return 0 if the datagram was queued or dropped, AVERROR on overrun
+ */
+static int udp_queue_datagram(URLContext *h, unsigned int *ptail,
+                              const uint8_t *data, int len, int64_t recv_time)
+{
+    UDPContext *s = h->priv_data;
+    UDPRing *r = s->ring;
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned int space = head > *ptail ? head - *ptail - 1 : r->size - 1 - (*ptail - head);
+    int header_size = s->timestamps ? 12 : 4;
+    uint8_t header[12];
+
+    if (space < len + header_size) {
+        /* No Space left */
+        atomic_fetch_add_explicit(&r->overruns, 1, memory_order_relaxed);
+        if (s->overrun_nonfatal) {
+            av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                    "Surviving due to overrun_nonfatal option\n");
+            return 0;
+        } else {
+            av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                    "To avoid, increase fifo_size URL option. "
+                    "To survive in such case, use overrun_nonfatal option\n");
+            return AVERROR(EIO);
+        }
+    }
+    AV_WL32(header, len);
+    AV_WL64(header + 4, recv_time);
+    *ptail = udp_ring_write(r, *ptail, header, header_size);
+    *ptail = udp_ring_write(r, *ptail, data, len);
+    return 0;
+}
+
+/**
+ * Make the datagrams queued up to tail visible to the reader, and wake it
+ * up if it is waiting for them.
+ */
+static void udp_ring_publish(UDPContext *s, unsigned int tail)
+{
+    UDPRing *r = s->ring;
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned int used = tail >= head ? tail - head : r->size - (head - tail);
+
+    if (used > atomic_load_explicit(&r->high_water, memory_order_relaxed))
+        atomic_store_explicit(&r->high_water, used, memory_order_relaxed);
+
+    /* Sequentially consistent, so that either this thread sees waiting set
+     * or the reader sees the new tail before waiting on cond. */
+    atomic_store(&r->tail, tail);
+    if (atomic_load(&r->waiting)) {
+        pthread_mutex_lock(&s->mutex);
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+    }
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
     UDPContext *s = h->priv_data;
-    int old_cancelstate;
+    unsigned int tail = atomic_load_explicit(&s->ring->tail, memory_order_relaxed);
+    int old_cancelstate, err = 0;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        err = AVERROR(EIO);
         goto end;
     }
     while(1) {
         int len;
 
-        pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+#if HAVE_RECVMMSG
+        if (s->msgs)
+            len = udp_recv_batch(s);
+        else
+#endif
+        len = recv(s->udp_fd, s->tmp, sizeof(s->tmp), 0);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
         if (len < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+                err = ff_neterrno();
                 goto end;
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+
+#if HAVE_RECVMMSG
+        if (s->msgs) {
+            int i;
+            for (i = 0; i < len; i++) {
+                err = udp_queue_datagram(h, &tail, s->iov[i].iov_base, s->msgs[i].msg_len,
+                                         udp_msg_time(&s->msgs[i].msg_hdr));
+                if (err < 0)
+                    goto end;
             }
-        }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
+        } else
+#endif
+        if ((err = udp_queue_datagram(h, &tail, s->tmp, len, AV_NOPTS_VALUE)) < 0)
+            goto end;
+        udp_ring_publish(s, tail);
     }
 
 end:
+    /* the datagrams received before the error are still returned */
+    udp_ring_publish(s, tail);
+    pthread_mutex_lock(&s->mutex);
+    s->circular_buffer_error = err;
     pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->mutex);
     return NULL;
@@ -575,6 +845,9 @@ static void *circular_buffer_task_tx( void *_URLContext)
 
     for(;;) {
         int len;
+#if HAVE_SENDMMSG
+        int nb = 1;
+#endif
         const uint8_t *p;
         uint8_t tmp[4];
         int64_t timestamp;
@@ -596,6 +869,29 @@ static void *circular_buffer_task_tx( void *_URLContext)
         av_assert0(len >= 0);
         av_assert0(len <= sizeof(s->tmp));
 
+#if HAVE_SENDMMSG
+        if (s->msgs) {
+            /* Take the next datagrams along, as long as the bitrate allows
+             * sending them in the same burst. */
+            int64_t bits = len * 8;
+
+            av_fifo_generic_read(s->fifo, s->iov[0].iov_base, len, NULL);
+            s->iov[0].iov_len = len;
+            while (nb < s->batch_size && av_fifo_size(s->fifo) >= 4) {
+                int next;
+
+                av_fifo_generic_peek(s->fifo, tmp, 4, NULL);
+                next = AV_RL32(tmp);
+                if (s->bitrate && bits + next * 8 > s->burst_bits)
+                    break;
+                av_fifo_drain(s->fifo, 4);
+                av_fifo_generic_read(s->fifo, s->iov[nb].iov_base, next, NULL);
+                s->iov[nb++].iov_len = next;
+                bits += next * 8;
+            }
+            len = bits / 8;
+        } else
+#endif
         av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
 
         pthread_mutex_unlock(&s->mutex);
@@ -621,6 +917,19 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
+#if HAVE_SENDMMSG
+        if (s->msgs) {
+            int ret = udp_send_batch(s, nb);
+            if (ret < 0) {
+                pthread_mutex_lock(&s->mutex);
+                s->circular_buffer_error = ret;
+                pthread_mutex_unlock(&s->mutex);
+                return NULL;
+            }
+            len = 0;
+        }
+#endif
+
         p = s->tmp;
         while (len) {
             int ret;
@@ -788,11 +1097,36 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         }
         if (!is_output && av_find_info_tag(buf, sizeof(buf), "timeout", p))
             s->timeout = strtol(buf, NULL, 10);
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p))
+            s->batch_size = av_clip(strtol(buf, NULL, 10), 1, 1024);
+        if (!is_output && av_find_info_tag(buf, sizeof(buf), "timestamps", p)) {
+            char *endptr = NULL;
+            s->timestamps = strtol(buf, &endptr, 10);
+            /* assume if no digits were found it is a request to enable it */
+            if (buf == endptr)
+                s->timestamps = 1;
+        }
         if (is_output && av_find_info_tag(buf, sizeof(buf), "broadcast", p))
             s->is_broadcast = strtol(buf, NULL, 10);
     }
     /* handling needed to support options picking from both AVOption and URL */
     s->circular_buffer_size *= 188;
+    if (s->batch_size > 1 &&
+        (is_output ? !HAVE_SENDMMSG || !HAVE_PTHREAD_CANCEL || !s->circular_buffer_size
+                   : !HAVE_RECVMMSG)) {
+        av_log(h, AV_LOG_WARNING,
+               "'batch_size' option was set but it is not supported "
+               "on this build (%s is required)\n",
+               is_output ? "sendmmsg() and a fifo_size" : "recvmmsg()");
+        s->batch_size = 1;
+    }
+    if (s->timestamps && (is_output || !UDP_TIMESTAMPS)) {
+        if (!is_output)
+            av_log(h, AV_LOG_WARNING,
+                   "'timestamps' option was set but it is not supported "
+                   "on this build (recvmmsg() and SO_TIMESTAMPNS are required)\n");
+        s->timestamps = 0;
+    }
     if (flags & AVIO_FLAG_WRITE) {
         h->max_packet_size = s->pkt_size;
     } else {
@@ -934,6 +1268,16 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                 av_log(h, AV_LOG_WARNING, "attempted to set receive buffer to size %d but it only ended up set as %d", s->buffer_size, tmp);
         }
 
+#if UDP_TIMESTAMPS
+        if (s->timestamps) {
+            tmp = 1;
+            if (setsockopt(udp_fd, SOL_SOCKET, SO_TIMESTAMPNS, &tmp, sizeof(tmp)) < 0) {
+                log_net_error(h, AV_LOG_WARNING, "setsockopt(SO_TIMESTAMPNS)");
+                s->timestamps = 0;
+            }
+        }
+#endif
+
         /* make the socket non-blocking */
         ff_socket_nonblock(udp_fd, 1);
     }
@@ -951,11 +1295,16 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    if ((s->batch_size > 1 || s->timestamps) && udp_alloc_batch(s, is_output) < 0)
+        goto fail;
+#endif
+
 #if HAVE_PTHREAD_CANCEL
     /*
       Create thread in case of:
       1. Input and circular_buffer_size is set
-      2. Output and bitrate and circular_buffer_size is set
+      2. Output and bitrate or batch_size and circular_buffer_size is set
     */
 
     if (is_output && s->bitrate && !s->circular_buffer_size) {
@@ -963,11 +1312,18 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if ((!is_output && s->circular_buffer_size) ||
+        (is_output && (s->bitrate || s->batch_size > 1) && s->circular_buffer_size)) {
         int ret;
 
         /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
+        if (is_output) {
+            s->fifo = av_fifo_alloc(s->circular_buffer_size);
+            if (!s->fifo)
+                goto fail;
+        } else if (udp_ring_alloc(s) < 0) {
+            goto fail;
+        }
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -998,6 +1354,12 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    udp_ring_free(s);
+#endif
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    udp_free_batch(s);
+#endif
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -1022,48 +1384,93 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
 #if HAVE_PTHREAD_CANCEL
     int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
 
-    if (s->fifo) {
-        pthread_mutex_lock(&s->mutex);
+    if (s->ring) {
+        UDPRing *r = s->ring;
+
         do {
-            avail = av_fifo_size(s->fifo);
-            if (avail) { // >=size) {
-                uint8_t tmp[4];
+            unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+            if (head != atomic_load_explicit(&r->tail, memory_order_acquire)) {
+                uint8_t tmp[12];
 
-                av_fifo_generic_read(s->fifo, tmp, 4, NULL);
+                head = udp_ring_read(r, head, tmp, s->timestamps ? 12 : 4);
+                if (s->timestamps)
+                    s->recv_time = AV_RL64(tmp + 4);
                 avail= AV_RL32(tmp);
                 if(avail > size){
                     av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
                     avail= size;
                 }
 
-                av_fifo_generic_read(s->fifo, buf, avail, NULL);
-                av_fifo_drain(s->fifo, AV_RL32(tmp) - avail);
-                pthread_mutex_unlock(&s->mutex);
+                udp_ring_read(r, head, buf, avail);
+                head += AV_RL32(tmp);
+                if (head >= r->size)
+                    head -= r->size;
+                atomic_store_explicit(&r->head, head, memory_order_release);
+
+                s->fifo_overruns   = atomic_load_explicit(&r->overruns,   memory_order_relaxed);
+                s->fifo_high_water = atomic_load_explicit(&r->high_water, memory_order_relaxed);
                 return avail;
-            } else if(s->circular_buffer_error){
-                int err = s->circular_buffer_error;
-                pthread_mutex_unlock(&s->mutex);
-                return err;
-            } else if(nonblock) {
-                pthread_mutex_unlock(&s->mutex);
-                return AVERROR(EAGAIN);
             }
-            else {
+
+            pthread_mutex_lock(&s->mutex);
+            /* Sequentially consistent, see udp_ring_publish(). */
+            atomic_store(&r->waiting, 1);
+            if (head != atomic_load(&r->tail)) {
+                ret = 0;
+            } else if (s->circular_buffer_error) {
+                ret = s->circular_buffer_error;
+            } else if (nonblock) {
+                ret = AVERROR(EAGAIN);
+            } else {
                 /* FIXME: using the monotonic clock would be better,
                    but it does not exist on all supported platforms. */
                 int64_t t = av_gettime() + 100000;
                 struct timespec tv = { .tv_sec  =  t / 1000000,
                                        .tv_nsec = (t % 1000000) * 1000 };
-                if (pthread_cond_timedwait(&s->cond, &s->mutex, &tv) < 0) {
-                    pthread_mutex_unlock(&s->mutex);
-                    return AVERROR(errno == ETIMEDOUT ? EAGAIN : errno);
-                }
-                nonblock = 1;
+                ret = 0;
+                if (pthread_cond_timedwait(&s->cond, &s->mutex, &tv) < 0)
+                    ret = AVERROR(errno == ETIMEDOUT ? EAGAIN : errno);
             }
+            atomic_store(&r->waiting, 0);
+            pthread_mutex_unlock(&s->mutex);
+            if (ret < 0)
+                return ret;
+            nonblock = 1;
         } while( 1);
     }
 #endif
 
+#if HAVE_RECVMMSG
+    if (s->msgs) {
+        struct mmsghdr *msg;
+
+        if (s->batch_pos == s->batch_count) {
+            if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+                ret = ff_network_wait_fd(s->udp_fd, 0);
+                if (ret < 0)
+                    return ret;
+            }
+            ret = udp_recv_batch(s);
+            if (ret < 0)
+                return ret;
+            s->batch_pos   = 0;
+            s->batch_count = ret;
+        }
+
+        msg = &s->msgs[s->batch_pos];
+        ret = msg->msg_len;
+        if (ret > size) {
+            av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+            ret = size;
+        }
+        memcpy(buf, s->iov[s->batch_pos].iov_base, ret);
+        s->recv_time = udp_msg_time(&msg->msg_hdr);
+        s->batch_pos++;
+        return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 0);
         if (ret < 0)
@@ -1155,6 +1562,12 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    udp_ring_free(s);
+#endif
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    udp_free_batch(s);
+#endif
     return 0;
 }
 
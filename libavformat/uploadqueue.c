@@ -0,0 +1,319 @@
+/*
+ * Background upload of muxer output files
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#include "avio_internal.h"
+#include "internal.h"
+#include "uploadqueue.h"
+
+#define MAX_UPLOAD_THREADS 16
+
+typedef struct Upload {
+    char *url;
+    AVDictionary *options;
+    int flags;
+    /* file being written, until it is closed */
+    AVIOContext *pb;
+    uint8_t *data;
+    int size;
+    int running;
+    struct Upload *next;
+} Upload;
+
+struct UploadQueue {
+    AVFormatContext *s;
+    int max_queued, max_retries;
+    /* files opened and not closed yet */
+    Upload *open;
+    /* closed files, in the order they were closed */
+    Upload *queue;
+    int nb_queued;
+    int error;
+#if HAVE_THREADS
+    pthread_t threads[MAX_UPLOAD_THREADS];
+    int nb_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int quit;
+#endif
+};
+
+static void free_upload(Upload *u)
+{
+    av_freep(&u->url);
+    av_dict_free(&u->options);
+    av_freep(&u->data);
+    av_free(u);
+}
+
+#if HAVE_THREADS
+static int do_upload(UploadQueue *q, Upload *u)
+{
+    AVFormatContext *s = q->s;
+    AVIOContext *pb;
+    int attempt, ret;
+
+    for (attempt = 0; ; attempt++) {
+        AVDictionary *opts = NULL;
+
+        av_dict_copy(&opts, u->options, 0);
+        ret = s->io_open(s, &pb, u->url, AVIO_FLAG_WRITE, &opts);
+        av_dict_free(&opts);
+        if (ret >= 0) {
+            avio_write(pb, u->data, u->size);
+            avio_flush(pb);
+            ret = pb->error;
+            ff_format_io_close(s, &pb);
+        }
+        if (ret >= 0 || attempt >= q->max_retries ||
+            ff_check_interrupt(&s->interrupt_callback))
+            break;
+        av_log(s, AV_LOG_WARNING, "Failed to upload '%s': %s, retrying\n",
+               u->url, av_err2str(ret));
+        av_usleep(100000 << FFMIN(attempt, 4));
+    }
+    if (ret < 0)
+        av_log(s, AV_LOG_ERROR, "Failed to upload '%s': %s\n",
+               u->url, av_err2str(ret));
+    return ret;
+}
+
+/* Return the first upload that can be started, the caller holds the lock. */
+static Upload *next_upload(UploadQueue *q)
+{
+    Upload *u;
+
+    for (u = q->queue; u; u = u->next) {
+        if (u->running)
+            continue;
+        /* everything queued before has completed */
+        if (!(u->flags & UPLOAD_ORDERED) || u == q->queue)
+            return u;
+    }
+    return NULL;
+}
+
+static void *upload_thread(void *arg)
+{
+    UploadQueue *q = arg;
+    Upload *u, **p;
+    int ret;
+
+    pthread_mutex_lock(&q->lock);
+    for (;;) {
+        u = next_upload(q);
+        if (!u) {
+            if (q->quit && !q->queue)
+                break;
+            pthread_cond_wait(&q->cond, &q->lock);
+            continue;
+        }
+        u->running = 1;
+        pthread_mutex_unlock(&q->lock);
+
+        ret = do_upload(q, u);
+
+        pthread_mutex_lock(&q->lock);
+        if (ret < 0 && !q->error)
+            q->error = ret;
+        for (p = &q->queue; *p != u; p = &(*p)->next)
+            ;
+        *p = u->next;
+        q->nb_queued--;
+        free_upload(u);
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+#endif
+
+int ff_upload_queue_alloc(UploadQueue **pq, AVFormatContext *s, int nb_threads,
+                          int max_queued, int max_retries)
+{
+#if HAVE_THREADS
+    UploadQueue *q;
+    int i, ret;
+
+    q = av_mallocz(sizeof(*q));
+    if (!q)
+        return AVERROR(ENOMEM);
+    q->s           = s;
+    q->max_queued  = FFMAX(max_queued, 1);
+    q->max_retries = max_retries;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+
+    nb_threads = av_clip(nb_threads, 1, MAX_UPLOAD_THREADS);
+    for (i = 0; i < nb_threads; i++) {
+        ret = pthread_create(&q->threads[i], NULL, upload_thread, q);
+        if (ret) {
+            av_log(s, AV_LOG_ERROR, "Failed to start upload thread\n");
+            ff_upload_queue_free(&q);
+            return AVERROR(ret);
+        }
+        q->nb_threads++;
+    }
+    *pq = q;
+    return 0;
+#else
+    av_log(s, AV_LOG_ERROR, "Background uploads require threading support\n");
+    return AVERROR(ENOSYS);
+#endif
+}
+
+int ff_upload_open(UploadQueue *q, AVFormatContext *s, AVIOContext **pb,
+                   const char *url, AVDictionary **options, int flags)
+{
+    Upload *u;
+    int ret;
+
+    if (!q)
+        return s->io_open(s, pb, url, AVIO_FLAG_WRITE, options);
+
+    u = av_mallocz(sizeof(*u));
+    if (!u)
+        return AVERROR(ENOMEM);
+    u->flags = flags;
+    u->url   = av_strdup(url);
+    if (!u->url)
+        ret = AVERROR(ENOMEM);
+    else if (!options || (ret = av_dict_copy(&u->options, *options, 0)) >= 0)
+        ret = avio_open_dyn_buf(&u->pb);
+    if (ret < 0) {
+        free_upload(u);
+        return ret;
+    }
+    *pb     = u->pb;
+    u->next = q->open;
+    q->open = u;
+    return 0;
+}
+
+int ff_upload_close(UploadQueue *q, AVFormatContext *s, AVIOContext **pb)
+{
+    Upload *u, **p;
+
+    if (!*pb)
+        return 0;
+    for (p = q ? &q->open : NULL; p && *p && (*p)->pb != *pb; p = &(*p)->next)
+        ;
+    if (!p || !*p) {
+        ff_format_io_close(s, pb);
+        return 0;
+    }
+    u  = *p;
+    *p = u->next;
+
+    u->size = avio_close_dyn_buf(u->pb, &u->data);
+    u->pb   = NULL;
+    u->next = NULL;
+    *pb     = NULL;
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&q->lock);
+    /* a newer version of an ordered file replaces the one still waiting */
+    if (u->flags & UPLOAD_ORDERED) {
+        for (p = &q->queue; *p; ) {
+            Upload *old = *p;
+            if (!old->running && (old->flags & UPLOAD_ORDERED) &&
+                !strcmp(old->url, u->url)) {
+                *p = old->next;
+                q->nb_queued--;
+                free_upload(old);
+            } else
+                p = &old->next;
+        }
+    }
+    while (q->nb_queued >= q->max_queued)
+        pthread_cond_wait(&q->cond, &q->lock);
+    for (p = &q->queue; *p; p = &(*p)->next)
+        ;
+    *p = u;
+    q->nb_queued++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+#endif
+    return 0;
+}
+
+int ff_upload_queue_error(UploadQueue *q)
+{
+    int ret = 0;
+
+    if (!q)
+        return 0;
+#if HAVE_THREADS
+    pthread_mutex_lock(&q->lock);
+    ret = q->error;
+    pthread_mutex_unlock(&q->lock);
+#endif
+    return ret;
+}
+
+int ff_upload_queue_flush(UploadQueue *q)
+{
+    int ret = 0;
+
+    if (!q)
+        return 0;
+#if HAVE_THREADS
+    pthread_mutex_lock(&q->lock);
+    while (q->queue)
+        pthread_cond_wait(&q->cond, &q->lock);
+    ret = q->error;
+    pthread_mutex_unlock(&q->lock);
+#endif
+    return ret;
+}
+
+void ff_upload_queue_free(UploadQueue **pq)
+{
+    UploadQueue *q = *pq;
+    Upload *u;
+
+    if (!q)
+        return;
+#if HAVE_THREADS
+    pthread_mutex_lock(&q->lock);
+    q->quit = 1;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    while (q->nb_threads > 0)
+        pthread_join(q->threads[--q->nb_threads], NULL);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+#endif
+    while ((u = q->open)) {
+        uint8_t *buf;
+        q->open = u->next;
+        avio_close_dyn_buf(u->pb, &buf);
+        av_free(buf);
+        free_upload(u);
+    }
+    while ((u = q->queue)) {
+        q->queue = u->next;
+        free_upload(u);
+    }
+    av_freep(pq);
+}
@@ -0,0 +1,87 @@
+/*
+ * Background upload of muxer output files
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_UPLOADQUEUE_H
+#define AVFORMAT_UPLOADQUEUE_H
+
+#include "avformat.h"
+
+/**
+ * Files written by a segmenting muxer through an upload queue are
+ * collected in memory and written to their destination by worker threads
+ * once they are closed, so that a slow server does not stall the muxer.
+ */
+typedef struct UploadQueue UploadQueue;
+
+/**
+ * Do not start the upload before all the files closed earlier have been
+ * uploaded, e.g. for a playlist referencing them. A queued upload of the
+ * same URL with this flag that has not been started yet is dropped.
+ */
+#define UPLOAD_ORDERED 1
+
+/**
+ * Allocate an upload queue and start its worker threads.
+ *
+ * @param s           muxer context, the uploads are written with its io_open
+ *                    and io_close callbacks, called from the worker threads
+ * @param nb_threads  number of worker threads
+ * @param max_queued  maximum number of pending uploads, closing a file
+ *                    blocks while this many uploads are pending
+ * @param max_retries number of times a failed upload is retried
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_upload_queue_alloc(UploadQueue **q, AVFormatContext *s, int nb_threads,
+                          int max_queued, int max_retries);
+
+/**
+ * Open url for writing. If q is NULL, the file is opened with s->io_open,
+ * otherwise the data is buffered until ff_upload_close().
+ *
+ * @param flags UPLOAD_* flags
+ */
+int ff_upload_open(UploadQueue *q, AVFormatContext *s, AVIOContext **pb,
+                   const char *url, AVDictionary **options, int flags);
+
+/**
+ * Close a file opened with ff_upload_open() and queue its upload.
+ */
+int ff_upload_close(UploadQueue *q, AVFormatContext *s, AVIOContext **pb);
+
+/**
+ * Check for failed uploads without waiting for the pending ones.
+ *
+ * @return the error of the first failed upload, 0 if none failed so far
+ */
+int ff_upload_queue_error(UploadQueue *q);
+
+/**
+ * Wait for all the queued uploads to complete.
+ *
+ * @return the error of the first failed upload, 0 if all succeeded
+ */
+int ff_upload_queue_flush(UploadQueue *q);
+
+/**
+ * Wait for the queued uploads, stop the worker threads and free the queue.
+ */
+void ff_upload_queue_free(UploadQueue **q);
+
+#endif /* AVFORMAT_UPLOADQUEUE_H */
@@ -47,6 +47,7 @@
 #include "internal.h"
 #include "metadata.h"
 #if CONFIG_NETWORK
+#include "http.h"
 #include "network.h"
 #endif
 #include "riff.h"
@@ -288,11 +289,16 @@ static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
 
 int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
+    int ret;
+
     av_init_packet(pkt);
     pkt->data = NULL;
     pkt->size = 0;
     pkt->pos  = avio_tell(s);
 
+    ret = ffio_read_packet_ref(s, pkt, size);
+    if (ret)
+        return ret;
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -537,6 +543,10 @@ int avformat_open_input(AVFormatContext **ps, const char *filename,
         goto fail;
     s->probe_score = ret;
 
+    if ((s->flags & AVFMT_FLAG_SHARE_IO_BUFFER) && s->pb &&
+        !(s->flags & AVFMT_FLAG_CUSTOM_IO))
+        ffio_share_buffer(s->pb);
+
     if (!s->protocol_whitelist && s->pb && s->pb->protocol_whitelist) {
         s->protocol_whitelist = av_strdup(s->pb->protocol_whitelist);
         if (!s->protocol_whitelist) {
@@ -1502,10 +1512,9 @@ static int64_t ts_to_samples(AVStream *st, int64_t ts)
     return av_rescale(ts, st->time_base.num * st->codecpar->sample_rate, st->time_base.den);
 }
 
-static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
+static int read_frame_packet(AVFormatContext *s, AVPacket *pkt)
 {
     int ret = 0, i, got_packet = 0;
-    AVDictionary *metadata = NULL;
 
     av_init_packet(pkt);
 
@@ -1683,6 +1692,27 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     }
 
+    if (s->debug & FF_FDEBUG_TS)
+        av_log(s, AV_LOG_DEBUG,
+               "read_frame_internal stream=%d, pts=%s, dts=%s, "
+               "size=%d, duration=%"PRId64", flags=%d\n",
+               pkt->stream_index,
+               av_ts2str(pkt->pts),
+               av_ts2str(pkt->dts),
+               pkt->size, pkt->duration, pkt->flags);
+
+    return ret;
+}
+
+/**
+ * Propagate the changes made by the demuxer while reading packets to the
+ * public context. This is comparatively slow, so that it is done once per
+ * call by the public read functions.
+ */
+static void update_demux_context(AVFormatContext *s)
+{
+    AVDictionary *metadata = NULL;
+
     av_opt_get_dict_val(s, "metadata", AV_OPT_SEARCH_CHILDREN, &metadata);
     if (metadata) {
         s->event_flags |= AVFMT_EVENT_FLAG_METADATA_UPDATED;
@@ -1694,20 +1724,16 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #if FF_API_LAVF_AVCTX
     update_stream_avctx(s);
 #endif
+}
 
-    if (s->debug & FF_FDEBUG_TS)
-        av_log(s, AV_LOG_DEBUG,
-               "read_frame_internal stream=%d, pts=%s, dts=%s, "
-               "size=%d, duration=%"PRId64", flags=%d\n",
-               pkt->stream_index,
-               av_ts2str(pkt->pts),
-               av_ts2str(pkt->dts),
-               pkt->size, pkt->duration, pkt->flags);
-
+static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
+{
+    int ret = read_frame_packet(s, pkt);
+    update_demux_context(s);
     return ret;
 }
 
-int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+static int read_frame(AVFormatContext *s, AVPacket *pkt)
 {
     const int genpts = s->flags & AVFMT_FLAG_GENPTS;
     int eof = 0;
@@ -1718,7 +1744,7 @@ int av_read_frame(AVFormatContext *s, AVPacket *pkt)
         ret = s->internal->packet_buffer
               ? read_from_packet_buffer(&s->internal->packet_buffer,
                                         &s->internal->packet_buffer_end, pkt)
-              : read_frame_internal(s, pkt);
+              : read_frame_packet(s, pkt);
         if (ret < 0)
             return ret;
         goto return_packet;
@@ -1770,7 +1796,7 @@ int av_read_frame(AVFormatContext *s, AVPacket *pkt)
             }
         }
 
-        ret = read_frame_internal(s, pkt);
+        ret = read_frame_packet(s, pkt);
         if (ret < 0) {
             if (pktl && ret != AVERROR(EAGAIN)) {
                 eof = 1;
@@ -1802,6 +1828,51 @@ return_packet:
     return ret;
 }
 
+int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+{
+    int ret = read_frame(s, pkt);
+    update_demux_context(s);
+    return ret;
+}
+
+int av_read_frames(AVFormatContext *s, AVPacket *pkts, int nb_pkts)
+{
+    AVFormatInternal *internal = s->internal;
+    int nb = 0, ret = 0;
+
+    if (nb_pkts <= 0)
+        return AVERROR(EINVAL);
+
+    if (internal->read_frames_error < 0) {
+        ret = internal->read_frames_error;
+        internal->read_frames_error = 0;
+        return ret;
+    }
+
+    while (nb < nb_pkts) {
+        ret = read_frame(s, &pkts[nb]);
+        if (ret < 0)
+            break;
+        nb++;
+
+        /* Do not hold back the packets already read while waiting for
+         * more live input. */
+        if (s->pb && !(s->pb->seekable & AVIO_SEEKABLE_NORMAL) &&
+            s->pb->buf_ptr >= s->pb->buf_end &&
+            !internal->packet_buffer && !internal->parse_queue &&
+            !internal->raw_packet_buffer)
+            break;
+    }
+
+    update_demux_context(s);
+
+    if (!nb)
+        return ret;
+    if (ret < 0 && ret != AVERROR(EAGAIN))
+        internal->read_frames_error = ret;
+    return nb;
+}
+
 /* XXX: suppress the packet queue */
 static void flush_packet_queue(AVFormatContext *s)
 {
@@ -1861,6 +1932,7 @@ void ff_read_frame_flush(AVFormatContext *s)
     int i, j;
 
     flush_packet_queue(s);
+    s->internal->read_frames_error = 0;
 
     /* Reset read state for each stream. */
     for (i = 0; i < s->nb_streams; i++) {
@@ -1979,24 +2051,49 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
 int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags)
 {
+    AVStreamInternal *sti = st->internal;
+    int nb_entries = st->nb_index_entries;
+    int index;
+
     timestamp = wrap_timestamp(st, timestamp);
-    return ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
-                              &st->index_entries_allocated_size, pos,
-                              timestamp, size, distance, flags);
+    index = ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
+                               &st->index_entries_allocated_size, pos,
+                               timestamp, size, distance, flags);
+
+    // An insertion shifts all the entries after it.
+    if (index >= 0 && st->nb_index_entries != nb_entries)
+        sti->nb_index_search_ts = FFMIN(sti->nb_index_search_ts,
+                                        (index + FF_INDEX_SEARCH_STEP - 1) /
+                                        FF_INDEX_SEARCH_STEP);
+    return index;
 }
 
-int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
-                              int64_t wanted_timestamp, int flags)
+/**
+ * Whether an entry of timestamp ts lies before the one searched for by
+ * av_index_search_timestamp(): it returns the last entry with
+ * ts <= wanted_timestamp if backward is set, the first one with
+ * ts >= wanted_timestamp otherwise. This also holds with duplicate
+ * timestamps, which some demuxers store in their index.
+ */
+static av_always_inline int index_search_before(int64_t ts, int64_t wanted_timestamp,
+                                                int backward)
 {
-    int a, b, m;
-    int64_t timestamp;
-
-    a = -1;
-    b = nb_entries;
+    return backward ? ts <= wanted_timestamp : ts < wanted_timestamp;
+}
 
-    // Optimize appending index entries at the end.
-    if (b && entries[b - 1].timestamp < wanted_timestamp)
-        a = b - 1;
+/**
+ * Binary search of entries within (a, b). If ordered is not set, the search
+ * stops on any entry matching wanted_timestamp, as ff_add_index_entry()
+ * relies on to find its insert position.
+ */
+static av_always_inline int index_search_range(const AVIndexEntry *entries,
+                                               int nb_entries, int a, int b,
+                                               int64_t wanted_timestamp,
+                                               int flags, int ordered)
+{
+    int backward = !!(flags & AVSEEK_FLAG_BACKWARD);
+    int64_t timestamp;
+    int m;
 
     while (b - a > 1) {
         m         = (a + b) >> 1;
@@ -2004,30 +2101,61 @@ int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
         // Search for the next non-discarded packet.
         while ((entries[m].flags & AVINDEX_DISCARD_FRAME) && m < b && m < nb_entries - 1) {
             m++;
-            if (m == b && entries[m].timestamp >= wanted_timestamp) {
+            if (m == b && (ordered ? !index_search_before(entries[m].timestamp,
+                                                          wanted_timestamp, backward)
+                                   : entries[m].timestamp >= wanted_timestamp)) {
                 m = b - 1;
                 break;
             }
         }
 
         timestamp = entries[m].timestamp;
-        if (timestamp >= wanted_timestamp)
-            b = m;
-        if (timestamp <= wanted_timestamp)
-            a = m;
+        if (ordered) {
+            if (index_search_before(timestamp, wanted_timestamp, backward))
+                a = m;
+            else
+                b = m;
+        } else {
+            if (timestamp >= wanted_timestamp)
+                b = m;
+            if (timestamp <= wanted_timestamp)
+                a = m;
+        }
     }
-    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+    m = backward ? a : b;
 
     if (!(flags & AVSEEK_FLAG_ANY))
         while (m >= 0 && m < nb_entries &&
                !(entries[m].flags & AVINDEX_KEYFRAME))
-            m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+            m += backward ? -1 : 1;
 
     if (m == nb_entries)
         return -1;
     return m;
 }
 
+static av_always_inline int index_search_timestamp(const AVIndexEntry *entries,
+                                                   int nb_entries,
+                                                   int64_t wanted_timestamp,
+                                                   int flags, int ordered)
+{
+    int a = -1, b = nb_entries;
+
+    // Optimize appending index entries at the end.
+    if (b && entries[b - 1].timestamp < wanted_timestamp)
+        a = b - 1;
+
+    return index_search_range(entries, nb_entries, a, b,
+                              wanted_timestamp, flags, ordered);
+}
+
+int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
+                              int64_t wanted_timestamp, int flags)
+{
+    return index_search_timestamp(entries, nb_entries,
+                                  wanted_timestamp, flags, 0);
+}
+
 void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
 {
     int ist1, ist2;
@@ -2085,10 +2213,79 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
     }
 }
 
+/**
+ * Bring the sparse timestamp table of st up to date with its index.
+ *
+ * @return number of valid timestamps in the table, 0 if it is unusable
+ */
+static int update_index_search_ts(AVStream *st)
+{
+    AVStreamInternal *sti = st->internal;
+    int nb = (st->nb_index_entries + FF_INDEX_SEARCH_STEP - 1) / FF_INDEX_SEARCH_STEP;
+    int64_t *ts;
+    int i;
+
+    if (sti->nb_index_search_ts > nb)
+        sti->nb_index_search_ts = nb;
+    if (sti->nb_index_search_ts == nb)
+        return nb;
+
+    ts = av_fast_realloc(sti->index_search_ts, &sti->index_search_ts_allocated_size,
+                         nb * sizeof(*ts));
+    if (!ts)
+        return 0;
+    sti->index_search_ts = ts;
+
+    for (i = sti->nb_index_search_ts; i < nb; i++)
+        ts[i] = st->index_entries[i * FF_INDEX_SEARCH_STEP].timestamp;
+    sti->nb_index_search_ts = nb;
+
+    return nb;
+}
+
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
 {
-    return ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
-                                     wanted_timestamp, flags);
+    const AVIndexEntry *entries = st->index_entries;
+    int nb_entries = st->nb_index_entries;
+    const int64_t *ts;
+    int a, b, m, nb_ts;
+
+    if (nb_entries < 64 * FF_INDEX_SEARCH_STEP ||
+        entries[nb_entries - 1].timestamp < wanted_timestamp ||
+        !(nb_ts = update_index_search_ts(st)))
+        return index_search_timestamp(entries, nb_entries,
+                                      wanted_timestamp, flags, 1);
+
+    // Find the entries of the sparse table bracketing the result, with the
+    // same ordering as the final search so that duplicate timestamps do
+    // not make the bracket collapse onto an arbitrary one of them.
+    ts = st->internal->index_search_ts;
+    a  = -1;
+    b  = nb_ts;
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (index_search_before(ts[m], wanted_timestamp,
+                                flags & AVSEEK_FLAG_BACKWARD))
+            a = m;
+        else
+            b = m;
+    }
+    a = a < 0      ? -1         : a * FF_INDEX_SEARCH_STEP;
+    b = b >= nb_ts ? nb_entries : b * FF_INDEX_SEARCH_STEP;
+
+    // Use them as the initial bounds of the search if the index was not
+    // changed behind our back and they are regular entries.
+    if ((a >= 0 && (entries[a].timestamp != ts[a / FF_INDEX_SEARCH_STEP] ||
+                    entries[a].flags & AVINDEX_DISCARD_FRAME)) ||
+        (b < nb_entries && (entries[b].timestamp != ts[b / FF_INDEX_SEARCH_STEP] ||
+                            entries[b].flags & AVINDEX_DISCARD_FRAME))) {
+        st->internal->nb_index_search_ts = 0;
+        return index_search_timestamp(entries, nb_entries,
+                                      wanted_timestamp, flags, 1);
+    }
+
+    return index_search_range(entries, nb_entries, a, b,
+                              wanted_timestamp, flags, 1);
 }
 
 static int64_t ff_read_timestamp(AVFormatContext *s, int stream_index, int64_t *ppos, int64_t pos_limit,
@@ -4257,6 +4454,7 @@ static void free_stream(AVStream **pst)
         }
         av_bsf_free(&st->internal->extract_extradata.bsf);
         av_packet_free(&st->internal->extract_extradata.pkt);
+        av_freep(&st->internal->index_search_ts);
     }
     av_freep(&st->internal);
 
@@ -4849,6 +5047,9 @@ int avformat_network_init(void)
 int avformat_network_deinit(void)
 {
 #if CONFIG_NETWORK
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_pool_free();
+#endif
     ff_network_close();
     ff_tls_deinit();
     ff_network_inited_globally = 0;
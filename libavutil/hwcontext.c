@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include "buffer.h"
+#include "buffer_internal.h"
 #include "common.h"
 #include "hwcontext.h"
 #include "hwcontext_internal.h"
@@ -38,6 +39,7 @@ static const HWContextType *hw_table[] = {
 #if CONFIG_QSV
     &ff_hwcontext_type_qsv,
 #endif
+    &ff_hwcontext_type_software,
 #if CONFIG_VAAPI
     &ff_hwcontext_type_vaapi,
 #endif
@@ -627,9 +629,13 @@ int av_hwframe_map(AVFrame *dst, const AVFrame *src, int flags)
                        "found when attempting unmap.\n");
                 return AVERROR(EINVAL);
             }
-            hwmap = (HWMapDescriptor*)src->buf[0]->data;
-            av_frame_unref(dst);
-            return av_frame_ref(dst, hwmap->source);
+            // A software frame which merely carries the frames context
+            // was not made by a mapping, so it has to be mapped normally.
+            if (src->buf[0]->buffer->free == &ff_hwframe_unmap) {
+                hwmap = (HWMapDescriptor*)src->buf[0]->data;
+                av_frame_unref(dst);
+                return av_frame_ref(dst, hwmap->source);
+            }
         }
     }
 
@@ -0,0 +1,288 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "buffer.h"
+#include "common.h"
+#include "dict.h"
+#include "hwcontext.h"
+#include "hwcontext_internal.h"
+#include "hwcontext_software.h"
+#include "imgutils.h"
+#include "mem.h"
+#include "pixdesc.h"
+#include "pixfmt.h"
+#include "time.h"
+
+#define SOFTWARE_FRAME_ALIGNMENT 64
+
+typedef struct SoftwareDevicePriv {
+    /* usage counters, reported when the device is freed */
+    atomic_int nb_uploads;
+    atomic_int nb_downloads;
+    atomic_int nb_maps;
+} SoftwareDevicePriv;
+
+static int software_device_create(AVHWDeviceContext *ctx, const char *device,
+                                  AVDictionary *opts, int flags)
+{
+    AVSoftwareDeviceContext *hwctx = ctx->hwctx;
+    AVDictionaryEntry *ent;
+
+    ent = av_dict_get(opts, "transfer_cost", NULL, 0);
+    if (ent)
+        hwctx->transfer_cost = strtol(ent->value, NULL, 0);
+    ent = av_dict_get(opts, "map_cost", NULL, 0);
+    if (ent)
+        hwctx->map_cost = strtol(ent->value, NULL, 0);
+
+    if (hwctx->transfer_cost < 0 || hwctx->map_cost < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Invalid negative transfer or map cost.\n");
+        return AVERROR(EINVAL);
+    }
+
+    return 0;
+}
+
+static void software_device_uninit(AVHWDeviceContext *ctx)
+{
+    SoftwareDevicePriv *priv = ctx->internal->priv;
+
+    av_log(ctx, AV_LOG_VERBOSE, "Software device: %d uploads, "
+           "%d downloads, %d mappings.\n",
+           atomic_load(&priv->nb_uploads), atomic_load(&priv->nb_downloads),
+           atomic_load(&priv->nb_maps));
+}
+
+static int software_frames_get_constraints(AVHWDeviceContext *ctx,
+                                           const void *hwconfig,
+                                           AVHWFramesConstraints *constraints)
+{
+    const AVPixFmtDescriptor *desc = NULL;
+    int nb_formats = 0;
+
+    while ((desc = av_pix_fmt_desc_next(desc)))
+        if (!(desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+            nb_formats++;
+
+    constraints->valid_sw_formats = av_malloc_array(nb_formats + 1,
+                                                    sizeof(*constraints->valid_sw_formats));
+    if (!constraints->valid_sw_formats)
+        return AVERROR(ENOMEM);
+
+    nb_formats = 0;
+    while ((desc = av_pix_fmt_desc_next(desc)))
+        if (!(desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+            constraints->valid_sw_formats[nb_formats++] = av_pix_fmt_desc_get_id(desc);
+    constraints->valid_sw_formats[nb_formats] = AV_PIX_FMT_NONE;
+
+    constraints->valid_hw_formats = av_malloc_array(2, sizeof(*constraints->valid_hw_formats));
+    if (!constraints->valid_hw_formats)
+        return AVERROR(ENOMEM);
+
+    constraints->valid_hw_formats[0] = AV_PIX_FMT_SOFTWARE;
+    constraints->valid_hw_formats[1] = AV_PIX_FMT_NONE;
+
+    return 0;
+}
+
+static int software_frames_init(AVHWFramesContext *ctx)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(ctx->sw_format);
+    int size;
+
+    if (!desc || desc->flags & AV_PIX_FMT_FLAG_HWACCEL) {
+        av_log(ctx, AV_LOG_ERROR, "Pixel format '%s' is not supported\n",
+               av_get_pix_fmt_name(ctx->sw_format));
+        return AVERROR(ENOSYS);
+    }
+
+    if (!ctx->pool) {
+        size = av_image_get_buffer_size(ctx->sw_format, ctx->width, ctx->height,
+                                        SOFTWARE_FRAME_ALIGNMENT);
+        if (size < 0)
+            return size;
+
+        ctx->internal->pool_internal = av_buffer_pool_init(size, av_buffer_alloc);
+        if (!ctx->internal->pool_internal)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+static int software_get_buffer(AVHWFramesContext *ctx, AVFrame *frame)
+{
+    int err;
+
+    frame->buf[0] = av_buffer_pool_get(ctx->pool);
+    if (!frame->buf[0])
+        return AVERROR(ENOMEM);
+
+    err = av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data,
+                               ctx->sw_format, ctx->width, ctx->height,
+                               SOFTWARE_FRAME_ALIGNMENT);
+    if (err < 0)
+        return err;
+
+    frame->format = AV_PIX_FMT_SOFTWARE;
+    frame->width  = ctx->width;
+    frame->height = ctx->height;
+
+    return 0;
+}
+
+static int software_transfer_get_formats(AVHWFramesContext *ctx,
+                                         enum AVHWFrameTransferDirection dir,
+                                         enum AVPixelFormat **formats)
+{
+    enum AVPixelFormat *fmts;
+
+    fmts = av_malloc_array(2, sizeof(*fmts));
+    if (!fmts)
+        return AVERROR(ENOMEM);
+
+    fmts[0] = ctx->sw_format;
+    fmts[1] = AV_PIX_FMT_NONE;
+
+    *formats = fmts;
+
+    return 0;
+}
+
+static int software_transfer_data(AVHWFramesContext *ctx, AVFrame *dst,
+                                  const AVFrame *src)
+{
+    AVSoftwareDeviceContext *hwctx = ctx->device_ctx->hwctx;
+    int width  = FFMIN(dst->width,  src->width);
+    int height = FFMIN(dst->height, src->height);
+
+    av_image_copy(dst->data, dst->linesize,
+                  (const uint8_t **)src->data, src->linesize,
+                  ctx->sw_format, width, height);
+
+    if (hwctx->transfer_cost) {
+        int64_t size = av_image_get_buffer_size(ctx->sw_format, width, height, 1);
+        if (size > 0)
+            av_usleep(hwctx->transfer_cost * size >> 20);
+    }
+
+    return 0;
+}
+
+static int software_transfer_data_to(AVHWFramesContext *ctx, AVFrame *dst,
+                                     const AVFrame *src)
+{
+    SoftwareDevicePriv *priv = ctx->device_ctx->internal->priv;
+
+    if (src->format != ctx->sw_format)
+        return AVERROR(ENOSYS);
+
+    atomic_fetch_add(&priv->nb_uploads, 1);
+    return software_transfer_data(ctx, dst, src);
+}
+
+static int software_transfer_data_from(AVHWFramesContext *ctx, AVFrame *dst,
+                                       const AVFrame *src)
+{
+    SoftwareDevicePriv *priv = ctx->device_ctx->internal->priv;
+
+    if (dst->format != ctx->sw_format)
+        return AVERROR(ENOSYS);
+
+    atomic_fetch_add(&priv->nb_downloads, 1);
+    return software_transfer_data(ctx, dst, src);
+}
+
+/*
+ * Both mapping directions are zero-copy: the mapped frame points at the
+ * planes of the source frame, which is kept alive by the mapping.
+ */
+static int software_map_frame(AVHWFramesContext *hwfc, AVFrame *dst,
+                              const AVFrame *src, enum AVPixelFormat format,
+                              AVBufferRef *hw_frames_ref)
+{
+    AVSoftwareDeviceContext *hwctx = hwfc->device_ctx->hwctx;
+    SoftwareDevicePriv       *priv = hwfc->device_ctx->internal->priv;
+    int err, i;
+
+    err = ff_hwframe_map_create(hw_frames_ref, dst, src, NULL, NULL);
+    if (err < 0)
+        return err;
+
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
+        dst->data[i]     = src->data[i];
+        dst->linesize[i] = src->linesize[i];
+    }
+    dst->format = format;
+    dst->width  = src->width;
+    dst->height = src->height;
+
+    err = av_frame_copy_props(dst, src);
+    if (err < 0)
+        return err;
+
+    atomic_fetch_add(&priv->nb_maps, 1);
+    if (hwctx->map_cost)
+        av_usleep(hwctx->map_cost);
+
+    return 0;
+}
+
+static int software_map_from(AVHWFramesContext *hwfc, AVFrame *dst,
+                             const AVFrame *src, int flags)
+{
+    if (dst->format != AV_PIX_FMT_NONE && dst->format != hwfc->sw_format)
+        return AVERROR(ENOSYS);
+
+    return software_map_frame(hwfc, dst, src, hwfc->sw_format,
+                              src->hw_frames_ctx);
+}
+
+static int software_map_to(AVHWFramesContext *hwfc, AVFrame *dst,
+                           const AVFrame *src, int flags)
+{
+    if (src->format != hwfc->sw_format)
+        return AVERROR(ENOSYS);
+
+    return software_map_frame(hwfc, dst, src, hwfc->format,
+                              dst->hw_frames_ctx);
+}
+
+const HWContextType ff_hwcontext_type_software = {
+    .type                   = AV_HWDEVICE_TYPE_SOFTWARE,
+    .name                   = "software",
+
+    .device_hwctx_size      = sizeof(AVSoftwareDeviceContext),
+    .device_priv_size       = sizeof(SoftwareDevicePriv),
+
+    .device_create          = software_device_create,
+    .device_uninit          = software_device_uninit,
+    .frames_get_constraints = software_frames_get_constraints,
+    .frames_init            = software_frames_init,
+    .frames_get_buffer      = software_get_buffer,
+    .transfer_get_formats   = software_transfer_get_formats,
+    .transfer_data_to       = software_transfer_data_to,
+    .transfer_data_from     = software_transfer_data_from,
+    .map_to                 = software_map_to,
+    .map_from               = software_map_from,
+
+    .pix_fmts = (const enum AVPixelFormat[]){ AV_PIX_FMT_SOFTWARE, AV_PIX_FMT_NONE },
+};
@@ -0,0 +1,63 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_HWCONTEXT_SOFTWARE_H
+#define AVUTIL_HWCONTEXT_SOFTWARE_H
+
+/**
+ * @file
+ * An API-specific header for AV_HWDEVICE_TYPE_SOFTWARE.
+ *
+ * This device does not correspond to any real hardware: its frames are
+ * ordinary system memory, so it can be used to test and benchmark the
+ * hwcontext upload, download and mapping paths on any machine.
+ *
+ * Frames of this device have the format AV_PIX_FMT_SOFTWARE. Their data and
+ * linesize fields point at the image planes in AVHWFramesContext.sw_format
+ * layout, exactly as a software frame would. This API supports dynamic frame
+ * pools; AVHWFramesContext.pool must return AVBufferRefs large enough to hold
+ * an image of sw_format with the frames context dimensions, laid out as
+ * av_image_fill_arrays() would with an alignment of 64.
+ *
+ * When creating the device with av_hwdevice_ctx_create(), the device string
+ * is ignored, and the "transfer_cost" and "map_cost" options can be used to
+ * set the corresponding AVSoftwareDeviceContext fields.
+ */
+
+/**
+ * This struct is allocated as AVHWDeviceContext.hwctx
+ */
+typedef struct AVSoftwareDeviceContext {
+    /**
+     * Artificial cost of transferring data to or from a frame, in
+     * microseconds per MiB copied. The transfer functions sleep for the
+     * corresponding time to simulate a slow bus. 0 disables the delay.
+     */
+    int transfer_cost;
+    /**
+     * Artificial cost of mapping a frame, in microseconds per mapping.
+     * 0 disables the delay.
+     */
+    int map_cost;
+} AVSoftwareDeviceContext;
+
+/**
+ * AVHWFramesContext.hwctx is currently not used
+ */
+
+#endif /* AVUTIL_HWCONTEXT_SOFTWARE_H */
@@ -314,6 +314,14 @@ enum AVPixelFormat {
     AV_PIX_FMT_P016LE, ///< like NV12, with 16bpp per component, little-endian
     AV_PIX_FMT_P016BE, ///< like NV12, with 16bpp per component, big-endian
 
+    /**
+     * System memory frames of the software hwcontext device.
+     *
+     * data[] and linesize[] describe the frame as AVHWFramesContext.sw_format
+     * would, see hwcontext_software.h.
+     */
+    AV_PIX_FMT_SOFTWARE,
+
     AV_PIX_FMT_NB         ///< number of pixel formats, DO NOT USE THIS if you want to link with shared libav* because the number of formats might differ between versions
 };
 
@@ -52,6 +52,14 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
  */
 void av_thread_message_queue_free(AVThreadMessageQueue **mq);
 
+/**
+ * Return the current number of messages in the queue.
+ *
+ * @return the current number of messages or AVERROR(ENOSYS) if lavu was built
+ *         without thread support
+ */
+int av_thread_message_queue_nb_elems(AVThreadMessageQueue *mq);
+
 /**
  * Send a message on the queue.
  */
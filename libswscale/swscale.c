@@ -228,14 +228,16 @@ static void lumRangeFromJpeg16_c(int16_t *_dst, int width)
     if (DEBUG_SWSCALE_BUFFERS)                  \
         av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
-static int swscale(SwsContext *c, const uint8_t *src[],
-                   int srcStride[], int srcSliceY,
-                   int srcSliceH, uint8_t *dst[], int dstStride[])
+static int swscale_band(SwsContext *c, const uint8_t *src[],
+                        int srcStride[], int srcSliceY,
+                        int srcSliceH, uint8_t *dst[], int dstStride[],
+                        int dstSliceY, int dstSliceH)
 {
     /* load a few things into local vars to make the code more readable?
      * and faster */
     const int dstW                   = c->dstW;
     const int dstH                   = c->dstH;
+    const int dstSliceEnd            = dstSliceY + dstSliceH;
 
     const enum AVPixelFormat dstFormat = c->dstFormat;
     const int flags                  = c->flags;
@@ -337,7 +339,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -369,7 +371,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         hout_slice->width = dstW;
     }
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstSliceEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         int use_mmx_vfilter= c->use_mmx_vfilter;
 
@@ -531,6 +533,14 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     return dstY - lastDstY;
 }
 
+static int swscale(SwsContext *c, const uint8_t *src[],
+                   int srcStride[], int srcSliceY,
+                   int srcSliceH, uint8_t *dst[], int dstStride[])
+{
+    return swscale_band(c, src, srcStride, srcSliceY, srcSliceH,
+                        dst, dstStride, 0, c->dstH);
+}
+
 av_cold void ff_sws_init_range_convert(SwsContext *c)
 {
     c->lumConvertRange = NULL;
@@ -750,11 +760,18 @@ static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
  */
-int attribute_align_arg sws_scale(struct SwsContext *c,
-                                  const uint8_t * const srcSlice[],
-                                  const int srcStride[], int srcSliceY,
-                                  int srcSliceH, uint8_t *const dst[],
-                                  const int dstStride[])
+/**
+ * Common implementation of sws_scale() and sws_scale_band().
+ * A dstSliceH of 0 selects the regular sequential slice mode, otherwise
+ * the whole source image is scaled into the destination lines
+ * [dstSliceY, dstSliceY + dstSliceH).
+ */
+static int scale_internal(SwsContext *c,
+                          const uint8_t * const srcSlice[],
+                          const int srcStride[], int srcSliceY,
+                          int srcSliceH, uint8_t *const dst[],
+                          const int dstStride[], int dstSliceY,
+                          int dstSliceH)
 {
     int i, ret;
     const uint8_t *src2[4];
@@ -977,7 +994,11 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     /* reset slice direction at end of frame */
     if (srcSliceY_internal + srcSliceH == c->srcH)
         c->sliceDir = 0;
-    ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
+    if (dstSliceH)
+        ret = swscale_band(c, src2, srcStride2, srcSliceY_internal, srcSliceH,
+                           dst2, dstStride2, dstSliceY, dstSliceH);
+    else
+        ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
 
 
     if (c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
@@ -994,3 +1015,54 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     av_free(rgb0_tmp);
     return ret;
 }
+
+int attribute_align_arg sws_scale(struct SwsContext *c,
+                                  const uint8_t * const srcSlice[],
+                                  const int srcStride[], int srcSliceY,
+                                  int srcSliceH, uint8_t *const dst[],
+                                  const int dstStride[])
+{
+    return scale_internal(c, srcSlice, srcStride, srcSliceY, srcSliceH,
+                          dst, dstStride, 0, 0);
+}
+
+int sws_get_band_count(struct SwsContext *c)
+{
+    /* Everything that keeps state across output lines or works on the
+     * whole image at once has to stay on the sequential path. */
+    if (c->nb_band_ctx < 2 ||
+        c->swscale != swscale ||
+        c->cascaded_context[0] ||
+        c->srcXYZ || c->dstXYZ ||
+        c->dither == SWS_DITHER_ED ||
+        (c->src0Alpha && !c->dst0Alpha && isALPHA(c->dstFormat)))
+        return 1;
+
+    return c->nb_band_ctx;
+}
+
+int attribute_align_arg sws_scale_band(struct SwsContext *c,
+                                       const uint8_t * const srcSlice[],
+                                       const int srcStride[],
+                                       uint8_t *const dst[],
+                                       const int dstStride[],
+                                       int band, int nb_bands)
+{
+    const int align = 1 << c->chrDstVSubSample;
+    int start, end;
+
+    if (band < 0 || band >= nb_bands || nb_bands > sws_get_band_count(c))
+        return AVERROR(EINVAL);
+
+    if (nb_bands == 1)
+        return sws_scale(c, srcSlice, srcStride, 0, c->srcH, dst, dstStride);
+
+    start = (int)((int64_t)c->dstH *  band      / nb_bands) & ~(align - 1);
+    end   = band == nb_bands - 1 ? c->dstH :
+            (int)((int64_t)c->dstH * (band + 1) / nb_bands) & ~(align - 1);
+    if (end <= start)
+        return 0;
+
+    return scale_internal(c->band_ctx[band], srcSlice, srcStride, 0, c->srcH,
+                          dst, dstStride, start, end - start);
+}
@@ -218,6 +218,43 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Get the maximum number of bands the destination image can be split
+ * into with sws_scale_band().
+ *
+ * @param c the scaling context, initialized with the "threads" option
+ * @return  the number of bands, or 1 if the conversion cannot be split
+ *          (unscaled special converters, cascaded contexts, error
+ *          diffusion dithering, ...)
+ */
+int sws_get_band_count(struct SwsContext *c);
+
+/**
+ * Scale a complete source image into one horizontal band of the
+ * destination image.
+ *
+ * Calls for different bands of the same image may run concurrently, the
+ * union of all nb_bands bands is bit-exact with a single sws_scale() call
+ * covering the whole image. Band boundaries are aligned to the vertical
+ * chroma subsampling of the destination format.
+ *
+ * @param c         the scaling context
+ * @param srcSlice  the array containing the pointers to the planes of
+ *                  the complete source image
+ * @param srcStride the array containing the strides for each plane of
+ *                  the source image
+ * @param dst       the array containing the pointers to the planes of
+ *                  the complete destination image
+ * @param dstStride the array containing the strides for each plane of
+ *                  the destination image
+ * @param band      index of the band to scale, 0 <= band < nb_bands
+ * @param nb_bands  number of bands, at most sws_get_band_count(c)
+ * @return          the height of the output band or a negative error code
+ */
+int sws_scale_band(struct SwsContext *c, const uint8_t *const srcSlice[],
+                   const int srcStride[], uint8_t *const dst[],
+                   const int dstStride[], int band, int nb_bands);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
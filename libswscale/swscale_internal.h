@@ -321,6 +321,15 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* The band_* fields allow splitting the destination image into
+     * horizontal bands that are scaled independently, each band owning a
+     * full child context with its own line ring buffers, see
+     * sws_scale_band().
+     */
+    int nb_threads;               ///< Number of bands requested by the user (0 = number of CPUs).
+    struct SwsContext **band_ctx;
+    int nb_band_ctx;
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -850,6 +850,12 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 0; i < c->nb_band_ctx; i++)
+        sws_setColorspaceDetails(c->band_ctx[i], inv_table, srcRange,
+                                 table, dstRange,
+                                 brightness, contrast, saturation);
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -1146,8 +1152,8 @@ static enum AVPixelFormat alphaless_fmt(enum AVPixelFormat fmt)
     }
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int context_init(SwsContext *c, SwsFilter *srcFilter,
+                               SwsFilter *dstFilter)
 {
     int i;
     int usesVFilter, usesHFilter;
@@ -1828,6 +1834,56 @@ fail: // FIXME replace things by appropriate error codes
     return -1;
 }
 
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    SwsContext **band_ctx = NULL;
+    int nb_bands = c->nb_threads ? c->nb_threads : av_cpu_count();
+    int i, ret;
+
+    /* The band contexts are cloned before the parent is initialized, as
+     * initialization rewrites some of the user supplied options. */
+    if (nb_bands > 1 && !c->band_ctx) {
+        band_ctx = av_mallocz_array(nb_bands, sizeof(*band_ctx));
+        if (!band_ctx)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < nb_bands; i++) {
+            band_ctx[i] = sws_alloc_context();
+            if (!band_ctx[i]) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            if ((ret = av_opt_copy(band_ctx[i], c)) < 0)
+                goto fail;
+            band_ctx[i]->nb_threads = 1;
+        }
+    }
+
+    if ((ret = context_init(c, srcFilter, dstFilter)) < 0)
+        goto fail;
+
+    if (band_ctx && !c->cascaded_context[0]) {
+        for (i = 0; i < nb_bands; i++) {
+            if ((ret = sws_init_context(band_ctx[i], srcFilter, dstFilter)) < 0)
+                goto fail;
+            sws_setColorspaceDetails(band_ctx[i], c->srcColorspaceTable, c->srcRange,
+                                     c->dstColorspaceTable, c->dstRange,
+                                     c->brightness, c->contrast, c->saturation);
+        }
+        c->band_ctx    = band_ctx;
+        c->nb_band_ctx = nb_bands;
+        return ret;
+    }
+
+fail:
+    if (band_ctx) {
+        for (i = 0; i < nb_bands; i++)
+            sws_freeContext(band_ctx[i]);
+        av_free(band_ctx);
+    }
+    return ret;
+}
+
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
                                int dstW, int dstH, enum AVPixelFormat dstFormat,
                                int flags, const double *param)
@@ -2322,6 +2378,10 @@ void sws_freeContext(SwsContext *c)
     sws_freeContext(c->cascaded_context[1]);
     sws_freeContext(c->cascaded_context[2]);
     memset(c->cascaded_context, 0, sizeof(c->cascaded_context));
+    for (i = 0; i < c->nb_band_ctx; i++)
+        sws_freeContext(c->band_ctx[i]);
+    av_freep(&c->band_ctx);
+    c->nb_band_ctx = 0;
     av_freep(&c->cascaded_tmp[0]);
     av_freep(&c->cascaded1_tmp[0]);
 
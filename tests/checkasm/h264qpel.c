@@ -26,16 +26,22 @@
 #include "libavutil/intreadwrite.h"
 
 static const uint32_t pixel_mask[3] = { 0xffffffff, 0x01ff01ff, 0x03ff03ff };
+static const uint32_t pixel_lsb[2]  = { 0x01010101, 0x00010001 };
 
 #define SIZEOF_PIXEL ((bit_depth + 7) / 8)
 #define BUF_SIZE (2 * 16 * (16 + 3 + 4))
 
-#define randomize_buffers()                        \
+/* with extremes set, the source only holds 0 and the maximum pixel value,
+ * which drives the intermediates of the 2D filters to their limits */
+#define randomize_buffers(extremes)                \
     do {                                           \
         uint32_t mask = pixel_mask[bit_depth - 8]; \
         int k;                                     \
         for (k = 0; k < BUF_SIZE; k += 4) {        \
             uint32_t r = rnd() & mask;             \
+            if (extremes)                          \
+                r = (r & pixel_lsb[bit_depth > 8]) \
+                    * ((1 << bit_depth) - 1);      \
             AV_WN32A(buf0 + k, r);                 \
             AV_WN32A(buf1 + k, r);                 \
             r = rnd();                             \
@@ -49,12 +55,12 @@ static const uint32_t pixel_mask[3] = { 0xffffffff, 0x01ff01ff, 0x03ff03ff };
 
 void checkasm_check_h264qpel(void)
 {
-    LOCAL_ALIGNED_16(uint8_t, buf0, [BUF_SIZE]);
-    LOCAL_ALIGNED_16(uint8_t, buf1, [BUF_SIZE]);
-    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
-    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [BUF_SIZE]);
     H264QpelContext h;
-    int op, bit_depth, i, j;
+    int op, bit_depth, i, j, extremes;
     declare_func_emms(AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMXEXT, void, uint8_t *dst, const uint8_t *src, ptrdiff_t stride);
 
     for (op = 0; op < 2; op++) {
@@ -67,11 +73,13 @@ void checkasm_check_h264qpel(void)
                 int size = 16 >> i;
                 for (j = 0; j < 16; j++)
                     if (check_func(tab[i][j], "%s_h264_qpel_%d_mc%d%d_%d", op_name, size, j & 3, j >> 2, bit_depth)) {
-                        randomize_buffers();
-                        call_ref(dst0, src0, size * SIZEOF_PIXEL);
-                        call_new(dst1, src1, size * SIZEOF_PIXEL);
-                        if (memcmp(buf0, buf1, BUF_SIZE) || memcmp(dst0, dst1, BUF_SIZE))
-                            fail();
+                        for (extremes = 0; extremes < 2; extremes++) {
+                            randomize_buffers(extremes);
+                            call_ref(dst0, src0, size * SIZEOF_PIXEL);
+                            call_new(dst1, src1, size * SIZEOF_PIXEL);
+                            if (memcmp(buf0, buf1, BUF_SIZE) || memcmp(dst0, dst1, BUF_SIZE))
+                                fail();
+                        }
                         bench_new(dst1, src1, size * SIZEOF_PIXEL);
                     }
             }
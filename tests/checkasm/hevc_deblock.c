@@ -0,0 +1,274 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define BUF_STRIDE   (32 * 2)
+#define BUF_SIZE     (BUF_STRIDE * 16)
+
+#define TEST_RUNS 64
+
+static void set_pixel(uint8_t *buf, ptrdiff_t offset, int val, int bit_depth)
+{
+    val = av_clip_uintp2(val, bit_depth);
+    if (bit_depth > 8)
+        AV_WN16A(buf + offset, val);
+    else
+        buf[offset] = val;
+}
+
+static void randomize_buffer(uint8_t *buf, int bit_depth)
+{
+    int i;
+
+    for (i = 0; i < BUF_SIZE; i += SIZEOF_PIXEL)
+        set_pixel(buf, i, rnd() & ((1 << bit_depth) - 1), bit_depth);
+}
+
+/*
+ * Fill lines across an edge so that each group of 4 lines takes a
+ * different filtering decision: flat or sloped sides with a small step
+ * select the strong or the normal filter, noise mostly disables it.
+ */
+static void randomize_edge(uint8_t *pix, ptrdiff_t xstride, ptrdiff_t ystride,
+                           int lines, int bit_depth)
+{
+    int i, j, k;
+
+    for (j = 0; j < lines / 4; j++) {
+        int type  = rnd() % 4;
+        int base  = rnd() & ((1 << bit_depth) - 1);
+        int step  = ((int)(rnd() % 33) - 16) << (bit_depth - 8);
+        int slope = (int)(rnd() % 5) - 2;
+        int noise = type == 3 ? 4 << (bit_depth - 8) : 1;
+
+        if (!type)
+            continue;
+        for (i = 4 * j; i < 4 * j + 4; i++) {
+            uint8_t *line = pix + i * ystride;
+            for (k = -4; k < 4; k++) {
+                int val = base + (k >= 0) * step + (type == 2) * slope * k +
+                          (int)(rnd() % (2 * noise + 1)) - noise;
+                set_pixel(line, k * xstride, val, bit_depth);
+            }
+        }
+    }
+}
+
+/* two edge segments 8 pixels apart, as filtered by the _x2 functions */
+static void randomize_edges_x2(uint8_t *pix, int dir, int bit_depth)
+{
+    if (dir) {
+        randomize_edge(pix,                    SIZEOF_PIXEL, BUF_STRIDE, 8, bit_depth);
+        randomize_edge(pix + 8 * SIZEOF_PIXEL, SIZEOF_PIXEL, BUF_STRIDE, 8, bit_depth);
+    } else
+        randomize_edge(pix, BUF_STRIDE, SIZEOF_PIXEL, 16, bit_depth);
+}
+
+/*
+ * The no_p and no_q flags are left at 0: the decoder only sets them with the
+ * _c functions, which the SIMD versions ignore.
+ */
+static void check_deblock_luma(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    uint8_t *pix0, *pix1;
+    int32_t tc[2];
+    uint8_t no_p[2] = { 0 }, no_q[2] = { 0 };
+    int beta, dir, i, j;
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int beta, int32_t *tc,
+                 uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        void (*func)(uint8_t *, ptrdiff_t, int, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_luma : h->hevc_h_loop_filter_luma;
+        ptrdiff_t xstride = dir ? SIZEOF_PIXEL : BUF_STRIDE;
+        ptrdiff_t ystride = dir ? BUF_STRIDE : SIZEOF_PIXEL;
+        ptrdiff_t offset  = dir ? 4 * BUF_STRIDE + 8 * SIZEOF_PIXEL :
+                                  8 * BUF_STRIDE + 4 * SIZEOF_PIXEL;
+
+        pix0 = buf0 + offset;
+        pix1 = buf1 + offset;
+        if (check_func(func, "hevc_%s_loop_filter_luma_%d", dir ? "v" : "h", bit_depth)) {
+            for (i = 0; i < TEST_RUNS; i++) {
+                randomize_buffer(buf0, bit_depth);
+                randomize_edge(pix0, xstride, ystride, 8, bit_depth);
+                memcpy(buf1, buf0, BUF_SIZE);
+                beta = rnd() % 65;
+                for (j = 0; j < 2; j++)
+                    tc[j] = rnd() % 25;
+                call_ref(pix0, BUF_STRIDE, beta, tc, no_p, no_q);
+                call_new(pix1, BUF_STRIDE, beta, tc, no_p, no_q);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(pix1, BUF_STRIDE, beta, tc, no_p, no_q);
+        }
+    }
+}
+
+/* there is no C version of the _x2 functions, the reference filters each segment */
+static void check_deblock_luma_x2(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    uint8_t *pix0, *pix1;
+    int32_t tc[4];
+    uint8_t no_p[4] = { 0 }, no_q[4] = { 0 };
+    int beta[2], dir, i, j;
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int *beta, int32_t *tc,
+                 uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        void (*func)(uint8_t *, ptrdiff_t, int *, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_luma_x2 : h->hevc_h_loop_filter_luma_x2;
+        void (*ref)(uint8_t *, ptrdiff_t, int, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_luma_c : h->hevc_h_loop_filter_luma_c;
+        ptrdiff_t offset = dir ? 4 * BUF_STRIDE + 8 * SIZEOF_PIXEL :
+                                 8 * BUF_STRIDE + 4 * SIZEOF_PIXEL;
+
+        pix0 = buf0 + offset;
+        pix1 = buf1 + offset;
+        if (check_func(func, "hevc_%s_loop_filter_luma_x2_%d", dir ? "v" : "h", bit_depth)) {
+            for (i = 0; i < TEST_RUNS; i++) {
+                randomize_buffer(buf0, bit_depth);
+                randomize_edges_x2(pix0, dir, bit_depth);
+                memcpy(buf1, buf0, BUF_SIZE);
+                for (j = 0; j < 2; j++)
+                    beta[j] = rnd() % 65;
+                for (j = 0; j < 4; j++)
+                    tc[j] = rnd() % 25;
+                ref(pix0,                    BUF_STRIDE, beta[0], tc,     no_p, no_q);
+                ref(pix0 + 8 * SIZEOF_PIXEL, BUF_STRIDE, beta[1], tc + 2, no_p, no_q);
+                call_new(pix1, BUF_STRIDE, beta, tc, no_p, no_q);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(pix1, BUF_STRIDE, beta, tc, no_p, no_q);
+        }
+    }
+}
+
+static void check_deblock_chroma(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    uint8_t *pix0, *pix1;
+    int32_t tc[2];
+    uint8_t no_p[2] = { 0 }, no_q[2] = { 0 };
+    int dir, i, j;
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int32_t *tc,
+                 uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        void (*func)(uint8_t *, ptrdiff_t, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_chroma : h->hevc_h_loop_filter_chroma;
+        ptrdiff_t xstride = dir ? SIZEOF_PIXEL : BUF_STRIDE;
+        ptrdiff_t ystride = dir ? BUF_STRIDE : SIZEOF_PIXEL;
+        ptrdiff_t offset  = dir ? 4 * BUF_STRIDE + 8 * SIZEOF_PIXEL :
+                                  8 * BUF_STRIDE + 4 * SIZEOF_PIXEL;
+
+        pix0 = buf0 + offset;
+        pix1 = buf1 + offset;
+        if (check_func(func, "hevc_%s_loop_filter_chroma_%d", dir ? "v" : "h", bit_depth)) {
+            for (i = 0; i < TEST_RUNS; i++) {
+                randomize_buffer(buf0, bit_depth);
+                randomize_edge(pix0, xstride, ystride, 8, bit_depth);
+                memcpy(buf1, buf0, BUF_SIZE);
+                for (j = 0; j < 2; j++)
+                    tc[j] = rnd() % 25;
+                call_ref(pix0, BUF_STRIDE, tc, no_p, no_q);
+                call_new(pix1, BUF_STRIDE, tc, no_p, no_q);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(pix1, BUF_STRIDE, tc, no_p, no_q);
+        }
+    }
+}
+
+static void check_deblock_chroma_x2(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    uint8_t *pix0, *pix1;
+    int32_t tc[4];
+    uint8_t no_p[4] = { 0 }, no_q[4] = { 0 };
+    int dir, i, j;
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int32_t *tc,
+                 uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        void (*func)(uint8_t *, ptrdiff_t, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_chroma_x2 : h->hevc_h_loop_filter_chroma_x2;
+        void (*ref)(uint8_t *, ptrdiff_t, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_chroma_c : h->hevc_h_loop_filter_chroma_c;
+        ptrdiff_t offset = dir ? 4 * BUF_STRIDE + 8 * SIZEOF_PIXEL :
+                                 8 * BUF_STRIDE + 4 * SIZEOF_PIXEL;
+
+        pix0 = buf0 + offset;
+        pix1 = buf1 + offset;
+        if (check_func(func, "hevc_%s_loop_filter_chroma_x2_%d", dir ? "v" : "h", bit_depth)) {
+            for (i = 0; i < TEST_RUNS; i++) {
+                randomize_buffer(buf0, bit_depth);
+                randomize_edges_x2(pix0, dir, bit_depth);
+                memcpy(buf1, buf0, BUF_SIZE);
+                for (j = 0; j < 4; j++)
+                    tc[j] = rnd() % 25;
+                ref(pix0,                    BUF_STRIDE, tc,     no_p, no_q);
+                ref(pix0 + 8 * SIZEOF_PIXEL, BUF_STRIDE, tc + 2, no_p, no_q);
+                call_new(pix1, BUF_STRIDE, tc, no_p, no_q);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(pix1, BUF_STRIDE, tc, no_p, no_q);
+        }
+    }
+}
+
+void checkasm_check_hevc_deblock(void)
+{
+    int bit_depth;
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_deblock_luma(&h, bit_depth);
+        check_deblock_luma_x2(&h, bit_depth);
+    }
+    report("luma");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_deblock_chroma(&h, bit_depth);
+        check_deblock_chroma_x2(&h, bit_depth);
+    }
+    report("chroma");
+}
@@ -0,0 +1,175 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+
+#include "libavcodec/hevcpred.h"
+
+#include "checkasm.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define DST_STRIDE   (32 * 2)
+#define DST_SIZE     (DST_STRIDE * 32)
+/* the prediction functions take the stride in pixels */
+#define STRIDE       (DST_STRIDE / SIZEOF_PIXEL)
+/* like in the decoder, top and left point one pixel into their arrays;
+ * the edges end with the buffers so that over-reads are not hidden */
+#define EDGE_SIZE    ((2 * 32 + 1) * 2)
+#define EDGE_OFFSET  (EDGE_SIZE - (2 * 32 + 1) * SIZEOF_PIXEL)
+
+#define randomize_buffers(buf, size)                                   \
+    do {                                                               \
+        int j;                                                         \
+        for (j = 0; j < size; j += 4)                                  \
+            AV_WN32A(buf + j, rnd() & (bit_depth > 8 ?                 \
+                                       ((1 << bit_depth) - 1) * 0x10001U : \
+                                       0xffffffff));                   \
+    } while (0)
+
+#define randomize_edge(buf)                                            \
+    do {                                                               \
+        int j;                                                         \
+        for (j = 0; j < EDGE_SIZE; j += 2)                             \
+            AV_WN16(buf + j, rnd() & (bit_depth > 8 ?                  \
+                                      (1 << bit_depth) - 1 : 0xffff)); \
+    } while (0)
+
+static void randomize_edges(uint8_t *dst0, uint8_t *dst1,
+                            uint8_t *top_buf, uint8_t *left_buf, int bit_depth)
+{
+    randomize_buffers(dst0, DST_SIZE);
+    memcpy(dst1, dst0, DST_SIZE);
+    randomize_edge(top_buf);
+    randomize_edge(left_buf);
+    /* the top-left pixel is shared */
+    memcpy(left_buf + EDGE_OFFSET, top_buf + EDGE_OFFSET, SIZEOF_PIXEL);
+}
+
+static void check_pred_planar(HEVCPredContext *h, uint8_t *dst0, uint8_t *dst1,
+                              uint8_t *top_buf, uint8_t *left_buf, int bit_depth)
+{
+    const uint8_t *top  = top_buf  + EDGE_OFFSET + SIZEOF_PIXEL;
+    const uint8_t *left = left_buf + EDGE_OFFSET + SIZEOF_PIXEL;
+    int i;
+    declare_func(void, uint8_t *src, const uint8_t *top,
+                 const uint8_t *left, ptrdiff_t stride);
+
+    for (i = 0; i < 4; i++) {
+        int size = 4 << i;
+
+        if (check_func(h->pred_planar[i], "hevc_pred_planar_%dx%d_%d",
+                       size, size, bit_depth)) {
+            randomize_edges(dst0, dst1, top_buf, left_buf, bit_depth);
+            call_ref(dst0, top, left, STRIDE);
+            call_new(dst1, top, left, STRIDE);
+            if (memcmp(dst0, dst1, DST_SIZE))
+                fail();
+            bench_new(dst1, top, left, STRIDE);
+        }
+    }
+}
+
+static void check_pred_dc(HEVCPredContext *h, uint8_t *dst0, uint8_t *dst1,
+                          uint8_t *top_buf, uint8_t *left_buf, int bit_depth)
+{
+    const uint8_t *top  = top_buf  + EDGE_OFFSET + SIZEOF_PIXEL;
+    const uint8_t *left = left_buf + EDGE_OFFSET + SIZEOF_PIXEL;
+    int i, c_idx;
+    declare_func(void, uint8_t *src, const uint8_t *top, const uint8_t *left,
+                 ptrdiff_t stride, int log2_size, int c_idx);
+
+    for (i = 0; i < 4; i++) {
+        int size = 4 << i;
+
+        if (check_func(h->pred_dc, "hevc_pred_dc_%dx%d_%d", size, size, bit_depth)) {
+            for (c_idx = 0; c_idx < 2; c_idx++) {
+                randomize_edges(dst0, dst1, top_buf, left_buf, bit_depth);
+                call_ref(dst0, top, left, STRIDE, i + 2, c_idx);
+                call_new(dst1, top, left, STRIDE, i + 2, c_idx);
+                if (memcmp(dst0, dst1, DST_SIZE))
+                    fail();
+            }
+            bench_new(dst1, top, left, STRIDE, i + 2, 0);
+        }
+    }
+}
+
+static void check_pred_angular(HEVCPredContext *h, uint8_t *dst0, uint8_t *dst1,
+                               uint8_t *top_buf, uint8_t *left_buf, int bit_depth)
+{
+    const uint8_t *top  = top_buf  + EDGE_OFFSET + SIZEOF_PIXEL;
+    const uint8_t *left = left_buf + EDGE_OFFSET + SIZEOF_PIXEL;
+    int i, c_idx, mode;
+    declare_func(void, uint8_t *src, const uint8_t *top, const uint8_t *left,
+                 ptrdiff_t stride, int c_idx, int mode);
+
+    for (i = 0; i < 4; i++) {
+        int size = 4 << i;
+
+        if (check_func(h->pred_angular[i], "hevc_pred_angular_%dx%d_%d",
+                       size, size, bit_depth)) {
+            for (mode = 2; mode <= 34; mode++) {
+                for (c_idx = 0; c_idx < 2; c_idx++) {
+                    randomize_edges(dst0, dst1, top_buf, left_buf, bit_depth);
+                    call_ref(dst0, top, left, STRIDE, c_idx, mode);
+                    call_new(dst1, top, left, STRIDE, c_idx, mode);
+                    if (memcmp(dst0, dst1, DST_SIZE)) {
+                        fail();
+                        return;
+                    }
+                }
+            }
+            bench_new(dst1, top, left, STRIDE, 0, 14);
+        }
+    }
+}
+
+void checkasm_check_hevc_pred(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, top_buf,  [EDGE_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, left_buf, [EDGE_SIZE]);
+    int bit_depth;
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCPredContext h;
+
+        ff_hevc_pred_init(&h, bit_depth);
+        check_pred_planar(&h, dst0, dst1, top_buf, left_buf, bit_depth);
+    }
+    report("pred_planar");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCPredContext h;
+
+        ff_hevc_pred_init(&h, bit_depth);
+        check_pred_dc(&h, dst0, dst1, top_buf, left_buf, bit_depth);
+    }
+    report("pred_dc");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCPredContext h;
+
+        ff_hevc_pred_init(&h, bit_depth);
+        check_pred_angular(&h, dst0, dst1, top_buf, left_buf, bit_depth);
+    }
+    report("pred_angular");
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/vf_overlay.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+#define WIDTH 128
+#define ALINESIZE (WIDTH * 2 + 32)
+
+#define randomize_buffers(buf, size)            \
+    do {                                        \
+        int j;                                  \
+        for (j = 0; j < size; j += 4)           \
+            AV_WN32A(buf + j, rnd());           \
+    } while (0)
+
+static void check_blend_row(OverlayDSPContext *dsp, int idx, const char *name)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [WIDTH]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [WIDTH]);
+    LOCAL_ALIGNED_32(uint8_t, src,  [WIDTH]);
+    LOCAL_ALIGNED_32(uint8_t, alpha, [ALINESIZE * 2]);
+    static const int widths[] = { 1, 7, 8, 23, 64, 100 };
+    int i, j;
+
+    declare_func(int, uint8_t *d, const uint8_t *s, const uint8_t *a,
+                 int w, ptrdiff_t alinesize);
+
+    if (check_func(dsp->blend_row[idx], "overlay_row_%s", name)) {
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            int w = widths[i], ret0, ret1;
+
+            randomize_buffers(dst0, WIDTH);
+            randomize_buffers(src,  WIDTH);
+            randomize_buffers(alpha, ALINESIZE * 2);
+            // make sure the fully transparent and opaque cases are covered
+            for (j = 0; j < ALINESIZE * 2; j += 5)
+                alpha[j] = j & 1 ? 255 : 0;
+            memcpy(dst1, dst0, WIDTH);
+
+            ret0 = call_ref(dst0, src, alpha, w, ALINESIZE);
+            ret1 = call_new(dst1, src, alpha, w, ALINESIZE);
+            if (ret0 != w || ret1 < 0 || ret1 > w ||
+                memcmp(dst0, dst1, ret1))
+                fail();
+        }
+        bench_new(dst1, src, alpha, WIDTH, ALINESIZE);
+    }
+}
+
+void checkasm_check_overlay(void)
+{
+    OverlayDSPContext dsp;
+
+    ff_overlay_dsp_init(&dsp);
+
+    check_blend_row(&dsp, OVERLAY_BLEND_ROW_444, "444");
+    check_blend_row(&dsp, OVERLAY_BLEND_ROW_422, "422");
+    check_blend_row(&dsp, OVERLAY_BLEND_ROW_420, "420");
+
+    report("blend_row");
+}
@@ -156,6 +156,70 @@ fmtstdout(){
     ffmpeg -flags +bitexact -fflags +bitexact "$@" -f $fmt -
 }
 
+threads_cmp(){
+    nb_threads=$1
+    type=$2
+    shift 2
+    threads=1
+    out_1=$(ffmpeg "$@" -threads 1 -flags +bitexact -fflags +bitexact -f md5 -) || return
+    threads=$nb_threads
+    thread_type=$type
+    out_n=$(ffmpeg "$@" -threads $nb_threads -thread_type $type -flags +bitexact -fflags +bitexact -f md5 -) || return
+    if [ "$out_1" != "$out_n" ]; then
+        echo "output with 1 thread:  $out_1"
+        echo "output with $nb_threads $type threads: $out_n"
+        return 1
+    fi
+}
+
+index_cache_cmp(){
+    movfile="${outdir}/${test}.mov"
+    cachedir="${outdir}/${test}.cache"
+    cleanfiles=$movfile
+    rm -rf $cachedir && mkdir $cachedir || return
+    ffmpeg "$@" -flags +bitexact -fflags +bitexact -y $(target_path $movfile) || return
+    demux="-index_cache $(target_path $cachedir) -i $(target_path $movfile) -c copy -flags +bitexact -fflags +bitexact -f framecrc -"
+    out_1=$(ffmpeg $demux) || return
+    out_2=$(ffmpeg -v verbose $demux 2> $cachedir/log) || return
+    if ! grep -q "Using index cache" $cachedir/log; then
+        echo "index cache not used"
+        return 1
+    fi
+    rm -rf $cachedir
+    if [ "$out_1" != "$out_2" ]; then
+        echo "output without cache:"
+        echo "$out_1"
+        echo "output with cache:"
+        echo "$out_2"
+        return 1
+    fi
+}
+
+dashenc(){
+    dashdir="${outdir}/${test}.dash"
+    rm -rf $dashdir && mkdir $dashdir || return
+    ffmpeg "$@" -flags +bitexact -fflags +bitexact -f dash -y $(target_path $dashdir)/out.mpd || return
+    for file in $(ls $dashdir); do
+        case $file in
+            *.mpd|*.m3u8) echo "$file:"; cat $dashdir/$file ;;
+            *)            (cd $dashdir && do_md5sum $file) ;;
+        esac
+    done
+    rm -rf $dashdir
+}
+
+shareiobuf_cmp(){
+    out_1=$(framecrc "$@") || return
+    out_2=$(framecrc -fflags +shareiobuf "$@") || return
+    if [ "$out_1" != "$out_2" ]; then
+        echo "output with copied packets:"
+        echo "$out_1"
+        echo "output with shared packets:"
+        echo "$out_2"
+        return 1
+    fi
+}
+
 enc_dec_pcm(){
     out_fmt=$1
     dec_fmt=$2
@@ -259,7 +259,15 @@ FATE_AAC_ENCODE-$(call ENCMUX, AAC, ADTS) += $(FATE_AAC_ENCODE)
 
 FATE_AAC_BSF-$(call ALLYES, AAC_DEMUXER AAC_ADTSTOASC_BSF MATROSKA_MUXER) += fate-aac-autobsf-adtstoasc
 
+# the channel elements are encoded concurrently, the output must not depend on it
+FATE_AAC_ENCODE_THREADS-$(call ENCMUX, AAC, ADTS) += fate-aac-6ch-encode-threads
+fate-aac-6ch-encode-threads: tests/data/asynth-22050-6.wav
+fate-aac-6ch-encode-threads: CMD = threads_cmp 4 slice -i $(TARGET_PATH)/tests/data/asynth-22050-6.wav -c:a aac -b:a 192k -f adts
+fate-aac-6ch-encode-threads: CMP = null
+fate-aac-6ch-encode-threads: REF = /dev/null
+
+FATE_FFMPEG += $(FATE_AAC_ENCODE_THREADS-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_AAC_ALL) $(FATE_AAC_ENCODE-yes) $(FATE_AAC_BSF-yes)
 
-fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_BSF-yes)
+fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_ENCODE_THREADS-yes) $(FATE_AAC_BSF-yes)
 fate-aac-latm: $(FATE_AAC_LATM-yes)
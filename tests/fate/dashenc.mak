@@ -0,0 +1,6 @@
+# Low latency mode: the chunks of each segment are listed as HLS parts.
+FATE_DASHENC-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG4_ENCODER AC3_FIXED_ENCODER DASH_MUXER) += fate-dashenc-streaming
+fate-dashenc-streaming: CMD = dashenc -f lavfi -i testsrc=d=3:r=25:s=160x120 -f lavfi -i sine=d=3 -c:v mpeg4 -g 25 -c:a ac3_fixed -min_seg_duration 1000000 -streaming 1 -hls_playlist 1
+
+FATE_FFMPEG += $(FATE_DASHENC-yes)
+fate-dashenc: $(FATE_DASHENC-yes)
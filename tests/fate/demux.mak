@@ -141,6 +141,15 @@ fate-xwma-demux: CMD = crc -i $(TARGET_SAMPLES)/xwma/ergon.xwma -acodec copy
 FATE_SAMPLES_DEMUX-$(CONFIG_MPEGTS_DEMUXER) += fate-ts-demux
 fate-ts-demux: CMD = framecrc -i $(TARGET_SAMPLES)/ac3/mp3ac325-4864-small.ts -codec copy
 
+# 88x72 frames do not divide the I/O buffer size, so that some of the packets
+# span a buffer refill and are copied while the others are shared.
+FATE_DEMUX-$(call ALLYES, RAWVIDEO_DEMUXER FRAMECRC_MUXER) += fate-shareiobuf
+fate-shareiobuf: tests/data/vsynth1.yuv
+fate-shareiobuf: CMD = shareiobuf_cmp -f rawvideo -s 88x72 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -c copy
+fate-shareiobuf: CMP = null
+fate-shareiobuf: REF = /dev/null
+
 FATE_SAMPLES_DEMUX += $(FATE_SAMPLES_DEMUX-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_SAMPLES_DEMUX)
-fate-demux: $(FATE_SAMPLES_DEMUX)
+FATE_FFMPEG += $(FATE_DEMUX-yes)
+fate-demux: $(FATE_SAMPLES_DEMUX) $(FATE_DEMUX-yes)
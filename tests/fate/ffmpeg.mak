@@ -25,6 +25,10 @@ fate-ffmpeg-filter_colorkey: CMD = framecrc -idct simple -fflags +bitexact -flag
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact
 
+FATE_FFMPEG-$(call ALLYES, COLOR_FILTER SPLIT_FILTER SCALE_FILTER MPEG4_ENCODER) += fate-ffmpeg-enc_thread
+fate-ffmpeg-enc_thread: CMD = framecrc -filter_complex "color=d=1:r=5,split[a][b];[b]scale=160:120[c]" \
+  -map "[a]" -map "[c]" -c:v mpeg4 -enc_thread_queue_size 2 -fflags +bitexact -flags +bitexact
+
 FATE_SAMPLES_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
@@ -204,6 +204,36 @@ FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_F
 fate-filter-overlay_yuv444: tests/data/filtergraphs/overlay_yuv444
 fate-filter-overlay_yuv444: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuv444
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_yuv420-threads
+fate-filter-overlay_yuv420-threads: tests/data/filtergraphs/overlay_yuv420
+fate-filter-overlay_yuv420-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_threads 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuv420
+fate-filter-overlay_yuv420-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-overlay_yuv420
+
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER ALPHAMERGE_FILTER OVERLAY_FILTER) += fate-filter-overlay_yuva420
+fate-filter-overlay_yuva420: tests/data/filtergraphs/overlay_yuva420
+fate-filter-overlay_yuva420: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuva420
+
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER ALPHAMERGE_FILTER OVERLAY_FILTER) += fate-filter-overlay_yuva420-threads
+fate-filter-overlay_yuva420-threads: tests/data/filtergraphs/overlay_yuva420
+fate-filter-overlay_yuva420-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_threads 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_yuva420
+fate-filter-overlay_yuva420-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-overlay_yuva420
+
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_rgb-threads
+fate-filter-overlay_rgb-threads: tests/data/filtergraphs/overlay_rgb
+fate-filter-overlay_rgb-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_threads 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_rgb
+fate-filter-overlay_rgb-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-overlay_rgb
+
+FATE_FILTER_VSYNTH-$(call ALLYES, HWUPLOAD_FILTER HWDOWNLOAD_FILTER FORMAT_FILTER) += fate-filter-hwupload-software
+fate-filter-hwupload-software: CMD = framecrc -c:v pgmyuv -i $(SRC) -software_device transfer_cost=0 -vf hwupload,hwdownload,format=yuv420p
+
+FATE_FILTER_VSYNTH-$(call ALLYES, HWMAP_FILTER FORMAT_FILTER) += fate-filter-hwmap-software
+fate-filter-hwmap-software: CMD = framecrc -c:v pgmyuv -i $(SRC) -software_device map_cost=0 -vf hwmap,format=software,hwmap,format=yuv420p
+fate-filter-hwmap-software: REF = $(SRC_PATH)/tests/ref/fate/filter-hwupload-software
+
+FATE_FILTER_VSYNTH-$(call ALLYES, HWUPLOAD_FILTER HWDOWNLOAD_FILTER FORMAT_FILTER) += fate-filter-hwupload-software-auto
+fate-filter-hwupload-software-auto: CMD = framecrc -c:v pgmyuv -i $(SRC) -software_device transfer_cost=0 -vf format=software,format=yuv420p
+fate-filter-hwupload-software-auto: REF = $(SRC_PATH)/tests/ref/fate/filter-hwupload-software
+
 FATE_FILTER_VSYNTH-$(CONFIG_PHASE_FILTER) += fate-filter-phase
 fate-filter-phase: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf phase
 
@@ -376,6 +406,11 @@ FATE_FILTER-$(call ALLYES, TESTSRC_FILTER SINE_FILTER CONCAT_FILTER) += fate-fil
 fate-filter-concat: tests/data/filtergraphs/concat
 fate-filter-concat: CMD = framecrc -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/concat
 
+# commands sent by a filter running on a frame threading worker
+FATE_FILTER-$(call ALLYES, TESTSRC_FILTER FORMAT_FILTER SENDCMD_FILTER HUE_FILTER) += fate-filter-sendcmd-frame-threads
+fate-filter-sendcmd-frame-threads: tests/data/filtergraphs/sendcmd
+fate-filter-sendcmd-frame-threads: CMD = framecrc -filter_frame_threads -filter_complex_threads 3 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/sendcmd
+
 FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FPS_FILTER MPDECIMATE_FILTER) += fate-filter-mpdecimate
 fate-filter-mpdecimate: CMD = framecrc -lavfi testsrc2=r=2:d=10,fps=3,mpdecimate -r 3 -pix_fmt yuv420p
 
@@ -404,6 +439,9 @@ fate-filter-crop_scale_vflip: CMD = video_filter "null,null,crop=iw-200:ih-200:2
 FATE_FILTER_VSYNTH-$(call ALLYES, CROP_FILTER VFLIP_FILTER) += fate-filter-crop_vflip
 fate-filter-crop_vflip: CMD = video_filter "crop=iw-100:ih-100:100:100,vflip"
 
+FATE_FILTER_VSYNTH-$(call ALLYES, CROP_FILTER VFLIP_FILTER) += fate-filter-crop_vflip-frame-threads
+fate-filter-crop_vflip-frame-threads: CMD = video_filter "crop=iw-100:ih-100:100:100,vflip" -filter_frame_threads -filter_threads 3
+
 FATE_FILTER_VSYNTH-$(CONFIG_NULL_FILTER) += fate-filter-null
 fate-filter-null: CMD = video_filter "null"
 
@@ -413,6 +451,12 @@ fate-filter-scale200: CMD = video_filter "scale=w=200:h=200"
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500
 fate-filter-scale500: CMD = video_filter "scale=w=500:h=500"
 
+FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale200-threads
+fate-filter-scale200-threads: CMD = video_filter "scale=w=200:h=200" -filter_threads 4
+
+FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500-threads
+fate-filter-scale500-threads: CMD = video_filter "scale=w=500:h=500:flags=lanczos" -filter_threads 3
+
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scalechroma
 fate-filter-scalechroma: tests/data/vsynth1.yuv
 fate-filter-scalechroma: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv444p -i tests/data/vsynth1.yuv -pix_fmt yuv420p -sws_flags +bitexact -vf scale=out_v_chr_pos=33:out_h_chr_pos=151
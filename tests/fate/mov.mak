@@ -16,7 +16,15 @@ FATE_MOV_FFPROBE = fate-mov-aac-2048-priming \
 FATE_SAMPLES_AVCONV += $(FATE_MOV)
 FATE_SAMPLES_FFPROBE += $(FATE_MOV_FFPROBE)
 
-fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE)
+# Demux a generated file twice, building then loading the index cache.
+FATE_MOV_FFMPEG-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG4_ENCODER MP2_ENCODER MOV_MUXER MOV_DEMUXER FRAMECRC_MUXER) += fate-mov-index-cache
+fate-mov-index-cache: CMD = index_cache_cmp -f lavfi -i testsrc=d=4:r=25 -f lavfi -i sine=d=4 -c:v mpeg4 -bf 2 -g 12 -c:a mp2
+fate-mov-index-cache: CMP = null
+fate-mov-index-cache: REF = /dev/null
+
+FATE_FFMPEG += $(FATE_MOV_FFMPEG-yes)
+
+fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FFMPEG-yes)
 
 # Make sure we handle edit lists correctly in normal cases.
 fate-mov-1elist-noctts: CMD = framemd5 -i $(TARGET_SAMPLES)/mov/mov-1elist-noctts.mov
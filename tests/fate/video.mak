@@ -360,5 +360,22 @@ fate-smvjpeg: CMD = framecrc -idct simple -flags +bitexact -i $(TARGET_SAMPLES)/
 
 FATE_VIDEO += $(FATE_VIDEO-yes)
 
+# The slice threaded encoder writes a restart marker after each row of blocks,
+# decoding the restart intervals in parallel must give the same frames.
+tests/data/mjpeg-slice-threads.avi: TAG = GEN
+tests/data/mjpeg-slice-threads.avi: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+		-f lavfi -i testsrc=d=1:r=10:s=320x240 -c:v mjpeg -qscale 5 -pix_fmt yuvj420p \
+		-threads 4 -thread_type slice -flags +bitexact -fflags +bitexact -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_MJPEG_THREADS-$(if $(HAVE_THREADS),$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER MJPEG_ENCODER AVI_MUXER AVI_DEMUXER MJPEG_DECODER MD5_MUXER)) += fate-mjpeg-slice-threads
+fate-mjpeg-slice-threads: tests/data/mjpeg-slice-threads.avi
+fate-mjpeg-slice-threads: CMD = threads_cmp 4 slice -i $(TARGET_PATH)/tests/data/mjpeg-slice-threads.avi
+fate-mjpeg-slice-threads: CMP = null
+fate-mjpeg-slice-threads: REF = /dev/null
+
+FATE_FFMPEG += $(FATE_MJPEG_THREADS-yes)
+fate-mjpeg-threads: $(FATE_MJPEG_THREADS-yes)
+
 FATE_SAMPLES_FFMPEG += $(FATE_VIDEO)
 fate-video: $(FATE_VIDEO)
@@ -0,0 +1,168 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Measure the packet rate of a stream copy, reading the input one packet at
+ * a time with av_read_frame() or in batches with av_read_frames().
+ */
+
+#include "config.h"
+#if HAVE_UNISTD_H
+#include <unistd.h>             /* getopt */
+#endif
+
+#include "libavformat/avformat.h"
+#include "libavutil/time.h"
+
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#define MAX_BATCH 1024
+
+static void usage(int ret)
+{
+    fprintf(ret ? stderr : stdout,
+            "Usage: remux_bench [-b batch] [-o options] [-f format] input [output]\n"
+            "    -b batch   number of packets read per call, 0 to use av_read_frame()\n"
+            "    -o options demuxer options, as a key=value:key=value list\n"
+            "    -f format  output format, the null muxer by default\n");
+    exit(ret);
+}
+
+static int open_output(AVFormatContext **pout, AVFormatContext *in,
+                       const char *format, const char *filename)
+{
+    AVFormatContext *out;
+    int i, ret;
+
+    ret = avformat_alloc_output_context2(pout, NULL, format, filename);
+    if (ret < 0)
+        return ret;
+    out = *pout;
+
+    for (i = 0; i < in->nb_streams; i++) {
+        AVStream *ist = in->streams[i];
+        AVStream *ost = avformat_new_stream(out, NULL);
+        if (!ost)
+            return AVERROR(ENOMEM);
+        ret = avcodec_parameters_copy(ost->codecpar, ist->codecpar);
+        if (ret < 0)
+            return ret;
+        ost->codecpar->codec_tag = 0;
+        ost->time_base           = ist->time_base;
+    }
+
+    if (!(out->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&out->pb, filename, AVIO_FLAG_WRITE);
+        if (ret < 0)
+            return ret;
+    }
+    return avformat_write_header(out, NULL);
+}
+
+static int write_packet(AVFormatContext *out, AVFormatContext *in, AVPacket *pkt)
+{
+    av_packet_rescale_ts(pkt, in->streams[pkt->stream_index]->time_base,
+                         out->streams[pkt->stream_index]->time_base);
+    return av_write_frame(out, pkt);
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *in = NULL, *out = NULL;
+    AVDictionary *options = NULL;
+    const char *format = "null", *output = "-";
+    AVPacket pkts[MAX_BATCH];
+    int64_t nb_packets = 0, t0, t1;
+    int opt, i, n, ret, batch = 32;
+
+    while ((opt = getopt(argc, argv, "b:o:f:h")) != -1) {
+        switch (opt) {
+        case 'b':
+            batch = av_clip(atoi(optarg), 0, MAX_BATCH);
+            break;
+        case 'o':
+            if (av_dict_parse_string(&options, optarg, "=", ":", 0) < 0)
+                usage(1);
+            break;
+        case 'f':
+            format = optarg;
+            break;
+        case 'h':
+            usage(0);
+        default:
+            usage(1);
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 1 || argc > 2)
+        usage(1);
+    if (argc == 2)
+        output = argv[1];
+
+    av_register_all();
+    ret = avformat_open_input(&in, argv[0], NULL, &options);
+    av_dict_free(&options);
+    if (ret < 0 ||
+        (ret = avformat_find_stream_info(in, NULL)) < 0) {
+        fprintf(stderr, "%s: %s\n", argv[0], av_err2str(ret));
+        return 1;
+    }
+    if ((ret = open_output(&out, in, format, output)) < 0) {
+        fprintf(stderr, "%s: %s\n", output, av_err2str(ret));
+        return 1;
+    }
+
+    t0 = av_gettime_relative();
+    for (;;) {
+        if (batch) {
+            ret = n = av_read_frames(in, pkts, batch);
+        } else {
+            ret = av_read_frame(in, &pkts[0]);
+            n   = 1;
+        }
+        if (ret < 0)
+            break;
+        for (i = 0; i < n; i++) {
+            if (ret >= 0)
+                ret = write_packet(out, in, &pkts[i]);
+            av_packet_unref(&pkts[i]);
+        }
+        if (ret < 0)
+            break;
+        nb_packets += n;
+    }
+    t1 = av_gettime_relative();
+    if (ret != AVERROR_EOF)
+        fprintf(stderr, "Error while remuxing: %s\n", av_err2str(ret));
+
+    av_write_trailer(out);
+    printf("%"PRId64" packets in %"PRId64" ms, %"PRId64" packets/s\n",
+           nb_packets, (t1 - t0) / 1000,
+           nb_packets * 1000000 / FFMAX(t1 - t0, 1));
+
+    if (!(out->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&out->pb);
+    avformat_free_context(out);
+    avformat_close_input(&in);
+
+    return ret == AVERROR_EOF ? 0 : 1;
+}